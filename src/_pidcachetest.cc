@@ -0,0 +1,185 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2016, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "pidcache_.h"
+#include "pidsignature_.h"
+
+#include "ert/process.h"
+
+#include "gtest/gtest.h"
+
+#include <string>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <sys/wait.h>
+
+static void
+writePidFile(const std::string &aFileName, struct Ert_Pid aPid)
+{
+    struct PidSignature *signature = 0;
+
+    ASSERT_TRUE((signature = createPidSignature(aPid, 0)));
+
+    /* Replace the pidfile atomically so that the cache never reads
+     * a partially written pidfile. */
+
+    std::string tmpFileName = aFileName + ".tmp";
+
+    FILE *file = fopen(tmpFileName.c_str(), "w");
+    ASSERT_TRUE(file);
+
+    EXPECT_LT(0, fprintf(file, "%d\n\n%s\n%s\n",
+                         aPid.mPid, signature->mSignature, "pidcachetest"));
+    EXPECT_EQ(0, fclose(file));
+
+    EXPECT_EQ(0, rename(tmpFileName.c_str(), aFileName.c_str()));
+
+    signature = destroyPidSignature(signature);
+}
+
+TEST(PidCacheTest, RevalidateUnchangedPidFile)
+{
+    char dirName[] = "/tmp/pidcachetest.XXXXXX";
+    ASSERT_TRUE(mkdtemp(dirName));
+
+    std::string pidFileName = std::string(dirName) + "/test.pid";
+
+    writePidFile(pidFileName, ert_ownProcessId());
+
+    struct PidCache pidCache;
+    EXPECT_EQ(0, createPidCache(&pidCache, 4));
+
+    struct sockaddr_un   pidServerAddr;
+    struct PidSignature *signature = 0;
+
+    EXPECT_TRUE((signature = lookupPidCache(
+                     &pidCache, pidFileName.c_str(), &pidServerAddr)));
+    EXPECT_EQ(getpid(), signature->mPid.mPid);
+    EXPECT_EQ(std::string("pidcachetest"),
+              std::string(&pidServerAddr.sun_path[1]));
+    EXPECT_EQ(0u, pidCache.mHits);
+    EXPECT_EQ(1u, pidCache.mMisses);
+    signature = destroyPidSignature(signature);
+
+    EXPECT_TRUE((signature = lookupPidCache(
+                     &pidCache, pidFileName.c_str(), &pidServerAddr)));
+    EXPECT_EQ(getpid(), signature->mPid.mPid);
+    EXPECT_EQ(1u, pidCache.mHits);
+    EXPECT_EQ(1u, pidCache.mMisses);
+    signature = destroyPidSignature(signature);
+
+    writePidFile(pidFileName, ert_ownProcessId());
+
+    EXPECT_TRUE((signature = lookupPidCache(
+                     &pidCache, pidFileName.c_str(), &pidServerAddr)));
+    EXPECT_EQ(getpid(), signature->mPid.mPid);
+    EXPECT_EQ(1u, pidCache.mHits);
+    EXPECT_EQ(2u, pidCache.mMisses);
+    signature = destroyPidSignature(signature);
+
+    EXPECT_EQ(0, unlink(pidFileName.c_str()));
+
+    errno = 0;
+    EXPECT_FALSE((signature = lookupPidCache(
+                      &pidCache, pidFileName.c_str(), &pidServerAddr)));
+    EXPECT_EQ(ENOENT, errno);
+    EXPECT_EQ(3u, pidCache.mMisses);
+
+    closePidCache(&pidCache);
+
+    EXPECT_EQ(0, rmdir(dirName));
+}
+
+TEST(PidCacheTest, InvalidateExitedProcess)
+{
+    char dirName[] = "/tmp/pidcachetest.XXXXXX";
+    ASSERT_TRUE(mkdtemp(dirName));
+
+    std::string pidFileName = std::string(dirName) + "/test.pid";
+
+    int exitPipe[2];
+    ASSERT_EQ(0, pipe(exitPipe));
+
+    pid_t childPid = fork();
+    ASSERT_NE(-1, childPid);
+
+    if ( ! childPid)
+    {
+        char buf[1];
+
+        close(exitPipe[1]);
+        _exit(read(exitPipe[0], buf, sizeof(buf)) ? EXIT_FAILURE : 0);
+    }
+
+    close(exitPipe[0]);
+
+    writePidFile(pidFileName, Ert_Pid(childPid));
+
+    struct PidCache pidCache;
+    EXPECT_EQ(0, createPidCache(&pidCache, 4));
+
+    struct sockaddr_un   pidServerAddr;
+    struct PidSignature *signature = 0;
+
+    EXPECT_TRUE((signature = lookupPidCache(
+                     &pidCache, pidFileName.c_str(), &pidServerAddr)));
+    EXPECT_EQ(childPid, signature->mPid.mPid);
+    signature = destroyPidSignature(signature);
+
+    EXPECT_TRUE((signature = lookupPidCache(
+                     &pidCache, pidFileName.c_str(), &pidServerAddr)));
+    EXPECT_EQ(childPid, signature->mPid.mPid);
+    EXPECT_EQ(1u, pidCache.mHits);
+    signature = destroyPidSignature(signature);
+
+    /* Once the process has exited and been reaped, the unchanged
+     * pidfile no longer names a running process. */
+
+    close(exitPipe[1]);
+
+    int status;
+    EXPECT_EQ(childPid, waitpid(childPid, &status, 0));
+
+    EXPECT_TRUE((signature = lookupPidCache(
+                     &pidCache, pidFileName.c_str(), &pidServerAddr)));
+    EXPECT_EQ(0, signature->mPid.mPid);
+    EXPECT_EQ(1u, pidCache.mHits);
+    EXPECT_EQ(2u, pidCache.mMisses);
+    signature = destroyPidSignature(signature);
+
+    closePidCache(&pidCache);
+
+    EXPECT_EQ(0, unlink(pidFileName.c_str()));
+    EXPECT_EQ(0, rmdir(dirName));
+}
+
+#include "../googletest/src/gtest_main.cc"
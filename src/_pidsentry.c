@@ -31,6 +31,8 @@
 
 #include "agent.h"
 #include "command.h"
+#include "fanout.h"
+#include "registry.h"
 
 #include "options_.h"
 
@@ -72,11 +74,19 @@ cmdRunCommand(const char          *aPidFileName,
 
     case CommandStatusOk:
         command = &command_;
-        ERT_ERROR_IF(
-            runCommand(command, aCmd));
+        if (ClientVerbCommand != gOptions.mClient.mVerb)
+        {
+            ERT_ERROR_IF(
+                runCommandVerb(command, gOptions.mClient.mVerb, &exitCode));
+        }
+        else
+        {
+            ERT_ERROR_IF(
+                runCommand(command, aCmd));
 
-        ERT_ERROR_IF(
-            reapCommand(command, &exitCode));
+            ERT_ERROR_IF(
+                reapCommand(command, &exitCode));
+        }
         break;
 
     case CommandStatusUnreachablePidFile:
@@ -114,6 +124,83 @@ Ert_Finally:
     return rc;
 }
 
+/* -------------------------------------------------------------------------- */
+static int
+cmdRunFanOut(const char          *aPattern,
+             const char * const  *aCmd,
+             struct Ert_ExitCode *aExitCode)
+{
+    int rc = -1;
+
+    struct Ert_ExitCode exitCode = { EXIT_FAILURE };
+
+    struct FanOut  fanOut_;
+    struct FanOut *fanOut = 0;
+
+    ERT_ERROR_IF(
+        createFanOut(&fanOut_, aPattern, gOptions.mClient.mFanOut));
+    fanOut = &fanOut_;
+
+    ERT_ERROR_IF(
+        runFanOut(fanOut, aCmd, &exitCode));
+
+    *aExitCode = exitCode;
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        fanOut = closeFanOut(fanOut);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+cmdListRegistry(const char *aRegistryName, struct Ert_ExitCode *aExitCode)
+{
+    int rc = -1;
+
+    struct Ert_ExitCode exitCode = { EXIT_FAILURE };
+
+    struct Registry  registry_;
+    struct Registry *registry = 0;
+
+    /* A registry that has not been created yet has no entries, but
+     * other errors are reported. */
+
+    if (openRegistry(&registry_, aRegistryName))
+    {
+        ERT_ERROR_UNLESS(
+            ENOENT == errno);
+    }
+    else
+    {
+        registry = &registry_;
+
+        ERT_ERROR_IF(
+            printRegistry(registry, stdout) || fflush(stdout));
+    }
+
+    exitCode.mStatus = EXIT_SUCCESS;
+
+    *aExitCode = exitCode;
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        registry = closeRegistry(registry);
+    });
+
+    return rc;
+}
+
 /* -------------------------------------------------------------------------- */
 static int
 cmdMonitorChild(const char * const *aCmd, struct Ert_ExitCode *aExitCode)
@@ -200,12 +287,32 @@ main(int argc, char **argv)
         ( ! gOptions.mClient.mActive &&   gOptions.mServer.mActive ) ||
         (   gOptions.mClient.mActive && ! gOptions.mServer.mActive ) );
 
-    if (gOptions.mClient.mActive)
+    if (gOptions.mClient.mActive && ClientVerbList == gOptions.mClient.mVerb)
         ERT_ABORT_IF(
-            cmdRunCommand(gOptions.mClient.mPidFile, args, &exitCode),
+            cmdListRegistry(gOptions.mClient.mRegistry, &exitCode),
+            {
+                ert_terminate(errno,
+                          "Failed to list registry: %s",
+                          gOptions.mClient.mRegistry);
+            });
+    else if (gOptions.mClient.mActive && gOptions.mClient.mFanOut)
+        ERT_ABORT_IF(
+            cmdRunFanOut(gOptions.mClient.mPidFile, args, &exitCode),
             {
                 ert_terminate(errno,
-                          "Failed to run command: %s", args[0]);
+                          "Failed to fan out command: %s", args[0]);
+            });
+    else if (gOptions.mClient.mActive)
+        ERT_ABORT_IF(
+            cmdRunCommand(gOptions.mClient.mPidFile, args, &exitCode),
+            {
+                if (args)
+                    ert_terminate(errno,
+                              "Failed to run command: %s", args[0]);
+                else
+                    ert_terminate(errno,
+                              "Failed to act on pidfile: %s",
+                              gOptions.mClient.mPidFile);
             });
     else
         ERT_ABORT_IF(
@@ -0,0 +1,513 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2016, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "command.h"
+#include "pidcache_.h"
+#include "pidserver.h"
+#include "sentrystatus.h"
+
+#include "ert/process.h"
+
+#include "gtest/gtest.h"
+
+#include <string>
+
+#include <poll.h>
+#include <stdio.h>
+#include <unistd.h>
+
+/* Count the allocations made while the pid server is serving clients,
+ * forwarding each allocation to the implementation in libc. */
+
+extern "C" void *__libc_malloc(size_t);
+extern "C" void *__libc_calloc(size_t, size_t);
+extern "C" void *__libc_realloc(void *, size_t);
+
+static bool     sCounting;
+static unsigned sAllocations;
+
+extern "C" void *
+malloc(size_t aSize)
+{
+    if (sCounting)
+        ++sAllocations;
+    return __libc_malloc(aSize);
+}
+
+extern "C" void *
+calloc(size_t aCount, size_t aSize)
+{
+    if (sCounting)
+        ++sAllocations;
+    return __libc_calloc(aCount, aSize);
+}
+
+extern "C" void *
+realloc(void *aPtr, size_t aSize)
+{
+    if (sCounting)
+        ++sAllocations;
+    return __libc_realloc(aPtr, aSize);
+}
+
+static void
+connectClient(struct Ert_UnixSocket     *aClient,
+              struct PidServer          *aServer,
+              const struct PidSignature *aSignature)
+{
+    int err = ert_connectUnixSocket(
+        aClient,
+        aServer->mSocketAddr.sun_path,
+        sizeof(aServer->mSocketAddr.sun_path));
+    EXPECT_TRUE(0 == err || EINPROGRESS == errno);
+
+    EXPECT_EQ(1, ert_waitUnixSocketWriteReady(aClient, 0));
+    EXPECT_EQ(0, sendPidSignature(aClient->mSocket->mFile, aSignature, 0));
+}
+
+static void
+serveClients(struct PidServer *aServer)
+{
+    sCounting = true;
+
+    EXPECT_EQ(0, acceptPidServerConnection(aServer));
+
+    while ( ! TAILQ_EMPTY(&aServer->mHandshakes))
+        EXPECT_NE(-1, cleanPidServer(aServer));
+
+    sCounting = false;
+}
+
+static void
+drainClients(struct PidServer *aServer)
+{
+    sCounting = true;
+
+    int clean;
+    while ( ! (clean = cleanPidServer(aServer)))
+        continue;
+    EXPECT_EQ(1, clean);
+
+    sCounting = false;
+}
+
+TEST(PidServerTest, SteadyStateAllocation)
+{
+    static const unsigned references = 4;
+
+    struct PidServer pidServer;
+
+    EXPECT_EQ(0, createPidServer(&pidServer, ert_ownProcessId(), references, 0));
+
+    struct PidSignature *pidSignature = 0;
+
+    EXPECT_TRUE((pidSignature = createPidSignature(ert_ownProcessId(), 0)));
+
+    /* The first round allows any lazy initialisation to complete, after
+     * which no further allocations are expected as the references are
+     * repeatedly acquired and released. One more client than there are
+     * references is refused without an acknowledgement. */
+
+    for (unsigned round = 0; 8 > round; ++round)
+    {
+        if (1 == round)
+            sAllocations = 0;
+
+        struct Ert_UnixSocket clients[references + 1];
+
+        for (unsigned ix = 0; references > ix; ++ix)
+            connectClient(&clients[ix], &pidServer, pidSignature);
+
+        serveClients(&pidServer);
+
+        connectClient(&clients[references], &pidServer, pidSignature);
+
+        serveClients(&pidServer);
+
+        for (unsigned ix = 0; references + 1 > ix; ++ix)
+        {
+            char buf[1];
+
+            EXPECT_EQ(1, ert_waitUnixSocketReadReady(&clients[ix], 0));
+
+            ssize_t rdlen = ert_readSocket(clients[ix].mSocket, buf, 1, 0);
+
+            if (references > ix)
+                EXPECT_EQ(1, rdlen);
+            else
+                EXPECT_GE(0, rdlen);
+
+            struct Ert_UnixSocket *client = &clients[ix];
+
+            client = ert_closeUnixSocket(client);
+        }
+
+        drainClients(&pidServer);
+    }
+
+    EXPECT_EQ(0u, sAllocations);
+
+    pidSignature = destroyPidSignature(pidSignature);
+
+    struct PidServer *pidServerPtr = &pidServer;
+
+    pidServerPtr = closePidServer(pidServerPtr);
+}
+
+TEST(PidServerTest, UnboundedSteadyStateAllocation)
+{
+    static const unsigned clients = 48;
+
+    struct PidServer pidServer;
+
+    EXPECT_EQ(0, createPidServer(&pidServer, ert_ownProcessId(), 0, 0));
+
+    struct PidSignature *pidSignature = 0;
+
+    EXPECT_TRUE((pidSignature = createPidSignature(ert_ownProcessId(), 0)));
+
+    /* Without a limit, every client is served, and the storage grows
+     * to the largest number of clients served at the same time, after
+     * which no further allocations are expected. */
+
+    for (unsigned round = 0; 4 > round; ++round)
+    {
+        if (1 == round)
+            sAllocations = 0;
+
+        struct Ert_UnixSocket client[clients];
+
+        for (unsigned ix = 0; clients > ix; ++ix)
+            connectClient(&client[ix], &pidServer, pidSignature);
+
+        serveClients(&pidServer);
+
+        for (unsigned ix = 0; clients > ix; ++ix)
+        {
+            char buf[1];
+
+            EXPECT_EQ(1, ert_waitUnixSocketReadReady(&client[ix], 0));
+            EXPECT_EQ(1, ert_readSocket(client[ix].mSocket, buf, 1, 0));
+
+            struct Ert_UnixSocket *clientPtr = &client[ix];
+
+            clientPtr = ert_closeUnixSocket(clientPtr);
+        }
+
+        drainClients(&pidServer);
+    }
+
+    EXPECT_EQ(0u, sAllocations);
+
+    pidSignature = destroyPidSignature(pidSignature);
+
+    struct PidServer *pidServerPtr = &pidServer;
+
+    pidServerPtr = closePidServer(pidServerPtr);
+}
+
+TEST(PidServerTest, StatusQuery)
+{
+    struct PidServer pidServer;
+
+    EXPECT_EQ(0, createPidServer(&pidServer, ert_ownProcessId(), 1, 0));
+
+    struct SentryStatus sentryStatus;
+
+    EXPECT_EQ(0, createSentryStatus(&sentryStatus));
+
+    attachPidServerStatus(&pidServer, &sentryStatus);
+
+    setSentryStatusState(&sentryStatus, SentryStatusRunning, 0);
+
+    struct PidSignature *pidSignature = 0;
+
+    EXPECT_TRUE((pidSignature = createPidSignature(ert_ownProcessId(), 0)));
+
+    struct Ert_UnixSocket client;
+
+    connectClient(&client, &pidServer, pidSignature);
+
+    serveClients(&pidServer);
+
+    char buf[1];
+
+    EXPECT_EQ(1, ert_waitUnixSocketReadReady(&client, 0));
+    EXPECT_EQ(1, ert_readSocket(client.mSocket, buf, 1, 0));
+
+    /* A client holding a reference asks for the status, and is sent
+     * a snapshot while continuing to hold the reference. */
+
+    buf[0] = SENTRY_STATUS_QUERY_REQUEST;
+
+    EXPECT_EQ(1, ert_writeSocket(client.mSocket, buf, 1, 0));
+
+    struct SentryStatusSnapshot snapshot;
+
+    while (1 != ert_waitUnixSocketReadReady(&client, &Ert_ZeroDuration))
+        EXPECT_EQ(0, cleanPidServer(&pidServer));
+
+    EXPECT_EQ(
+        (ssize_t) sizeof(snapshot),
+        ert_readSocket(client.mSocket, (char *) &snapshot, sizeof(snapshot), 0));
+
+    EXPECT_EQ((uint32_t) SENTRY_STATUS_VERSION, snapshot.mVersion);
+    EXPECT_EQ((uint32_t) sizeof(snapshot), snapshot.mSize);
+    EXPECT_EQ(ert_ownProcessId().mPid, snapshot.mChildPid);
+    EXPECT_EQ((uint32_t) SentryStatusRunning, snapshot.mState);
+
+    EXPECT_FALSE(TAILQ_EMPTY(&pidServer.mClients));
+
+    struct Ert_UnixSocket *clientPtr = &client;
+
+    clientPtr = ert_closeUnixSocket(clientPtr);
+
+    drainClients(&pidServer);
+
+    pidSignature = destroyPidSignature(pidSignature);
+
+    struct PidServer *pidServerPtr = &pidServer;
+
+    pidServerPtr = closePidServer(pidServerPtr);
+
+    struct SentryStatus *sentryStatusPtr = &sentryStatus;
+
+    sentryStatusPtr = closeSentryStatus(sentryStatusPtr);
+}
+
+TEST(PidServerTest, WaitForExit)
+{
+    struct PidServer pidServer;
+
+    EXPECT_EQ(0, createPidServer(&pidServer, ert_ownProcessId(), 1, 0));
+
+    struct SentryStatus sentryStatus;
+
+    EXPECT_EQ(0, createSentryStatus(&sentryStatus));
+
+    attachPidServerStatus(&pidServer, &sentryStatus);
+
+    setSentryStatusState(&sentryStatus, SentryStatusRunning, 0);
+
+    struct PidSignature *pidSignature = 0;
+
+    EXPECT_TRUE((pidSignature = createPidSignature(ert_ownProcessId(), 0)));
+
+    struct Ert_UnixSocket client;
+
+    connectClient(&client, &pidServer, pidSignature);
+
+    serveClients(&pidServer);
+
+    char buf[1];
+
+    EXPECT_EQ(1, ert_waitUnixSocketReadReady(&client, 0));
+    EXPECT_EQ(1, ert_readSocket(client.mSocket, buf, 1, 0));
+
+    /* A client holding a reference asks to wait, and is sent the
+     * exit code once the sentry has gone, after which the reference
+     * is released. */
+
+    buf[0] = SENTRY_STATUS_WAIT_REQUEST;
+
+    EXPECT_EQ(1, ert_writeSocket(client.mSocket, buf, 1, 0));
+
+    while ( ! TAILQ_FIRST(&pidServer.mClients)->mWaiting)
+        EXPECT_EQ(0, cleanPidServer(&pidServer));
+
+    setSentryStatusState(&sentryStatus, SentryStatusExited, 0);
+    setSentryStatusExitCode(&sentryStatus, 3);
+
+    EXPECT_EQ(1, notifyPidServerExit(&pidServer));
+
+    struct SentryStatusSnapshot snapshot;
+
+    EXPECT_EQ(1, ert_waitUnixSocketReadReady(&client, 0));
+    EXPECT_EQ(
+        (ssize_t) sizeof(snapshot),
+        ert_readSocket(client.mSocket, (char *) &snapshot, sizeof(snapshot), 0));
+
+    EXPECT_EQ((uint32_t) SentryStatusExited, snapshot.mState);
+    EXPECT_EQ(3, snapshot.mExitCode);
+
+    EXPECT_EQ(0, ert_readSocket(client.mSocket, buf, 1, 0));
+
+    struct Ert_UnixSocket *clientPtr = &client;
+
+    clientPtr = ert_closeUnixSocket(clientPtr);
+
+    pidSignature = destroyPidSignature(pidSignature);
+
+    struct PidServer *pidServerPtr = &pidServer;
+
+    pidServerPtr = closePidServer(pidServerPtr);
+
+    struct SentryStatus *sentryStatusPtr = &sentryStatus;
+
+    sentryStatusPtr = closeSentryStatus(sentryStatusPtr);
+}
+
+TEST(PidServerTest, LeaseExpiry)
+{
+    struct PidServer pidServer;
+
+    EXPECT_EQ(0, createPidServer(&pidServer, ert_ownProcessId(), 1, 1));
+
+    struct PidSignature *pidSignature = 0;
+
+    EXPECT_TRUE((pidSignature = createPidSignature(ert_ownProcessId(), 0)));
+
+    struct Ert_UnixSocket client;
+
+    connectClient(&client, &pidServer, pidSignature);
+
+    serveClients(&pidServer);
+
+    char buf[1];
+
+    EXPECT_EQ(1, ert_waitUnixSocketReadReady(&client, 0));
+    EXPECT_EQ(1, ert_readSocket(client.mSocket, buf, 1, 0));
+
+    /* A client that continues to hold its reference after the child
+     * process exits is told that the lease has expired, and the
+     * reference is released. */
+
+    EXPECT_EQ(0, notifyPidServerExit(&pidServer));
+
+    struct pollfd pollFd =
+    {
+        pidServer.mEventQueue->mFile->mFd, POLLIN, 0,
+    };
+
+    int clean;
+    while ( ! (clean = cleanPidServer(&pidServer)))
+        EXPECT_EQ(1, poll(&pollFd, 1, -1));
+    EXPECT_EQ(1, clean);
+
+    EXPECT_EQ(1, ert_waitUnixSocketReadReady(&client, 0));
+    EXPECT_EQ(1, ert_readSocket(client.mSocket, buf, 1, 0));
+    EXPECT_EQ(SENTRY_STATUS_LEASE_EXPIRED, buf[0]);
+
+    EXPECT_EQ(0, ert_readSocket(client.mSocket, buf, 1, 0));
+
+    struct Ert_UnixSocket *clientPtr = &client;
+
+    clientPtr = ert_closeUnixSocket(clientPtr);
+
+    pidSignature = destroyPidSignature(pidSignature);
+
+    struct PidServer *pidServerPtr = &pidServer;
+
+    pidServerPtr = closePidServer(pidServerPtr);
+}
+
+TEST(PidServerTest, CachedCommand)
+{
+    struct PidServer pidServer;
+
+    EXPECT_EQ(0, createPidServer(&pidServer, ert_ownProcessId(), 0, 0));
+
+    struct PidSignature *pidSignature = 0;
+
+    EXPECT_TRUE((pidSignature = createPidSignature(ert_ownProcessId(), 0)));
+
+    char dirName[] = "/tmp/pidservertest.XXXXXX";
+    ASSERT_TRUE(mkdtemp(dirName));
+
+    std::string pidFileName = std::string(dirName) + "/test.pid";
+
+    FILE *file = fopen(pidFileName.c_str(), "w");
+    ASSERT_TRUE(file);
+
+    EXPECT_LT(0, fprintf(file, "%d\n\n%s\n%s\n",
+                         getpid(),
+                         pidSignature->mSignature,
+                         &pidServer.mSocketAddr.sun_path[1]));
+    EXPECT_EQ(0, fclose(file));
+
+    struct PidCache pidCache;
+    EXPECT_EQ(0, createPidCache(&pidCache, 4));
+
+    /* A client polling the pid file reads it once, and thereafter
+     * obtains a reference to the child process using the signature
+     * held in the cache. */
+
+    for (unsigned round = 0; 4 > round; ++round)
+    {
+        struct Command command;
+
+        EXPECT_EQ(
+            CommandStatusOk,
+            openCachedCommand(&command, pidFileName.c_str(), &pidCache));
+        EXPECT_EQ(CommandHandshakeSend, command.mHandshake);
+
+        EXPECT_EQ(1, ert_waitUnixSocketWriteReady(command.mKeeperTether, 0));
+        EXPECT_EQ(0, handshakeCommand(&command));
+        EXPECT_EQ(CommandHandshakeReceive, command.mHandshake);
+
+        serveClients(&pidServer);
+
+        EXPECT_EQ(1, ert_waitUnixSocketReadReady(command.mKeeperTether, 0));
+        EXPECT_EQ(0, handshakeCommand(&command));
+        EXPECT_EQ(CommandHandshakeDone, command.mHandshake);
+        EXPECT_EQ(getpid(), command.mChildPid.mPid);
+
+        struct Command *commandPtr = &command;
+
+        commandPtr = closeCommand(commandPtr);
+
+        drainClients(&pidServer);
+    }
+
+    EXPECT_EQ(3u, pidCache.mHits);
+    EXPECT_EQ(1u, pidCache.mMisses);
+
+    /* Once the pid file is removed, the outcome is the same as it
+     * would be without the cache. */
+
+    EXPECT_EQ(0, unlink(pidFileName.c_str()));
+
+    struct Command command;
+
+    EXPECT_EQ(
+        CommandStatusNonexistentPidFile,
+        openCachedCommand(&command, pidFileName.c_str(), &pidCache));
+
+    closePidCache(&pidCache);
+
+    EXPECT_EQ(0, rmdir(dirName));
+
+    pidSignature = destroyPidSignature(pidSignature);
+
+    struct PidServer *pidServerPtr = &pidServer;
+
+    pidServerPtr = closePidServer(pidServerPtr);
+}
+
+#include "../googletest/src/gtest_main.cc"
@@ -0,0 +1,291 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2016, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "_pidumbilical.h"
+
+#include "umbilicalmonitor.h"
+#include "umbilicaldaemon.h"
+#include "umbilicalbeat.h"
+#include "pidserver.h"
+#include "sentrystatus.h"
+
+#include "options_.h"
+
+#include "ert/env.h"
+#include "ert/process.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* -------------------------------------------------------------------------- */
+/* Umbilical Program
+ *
+ * The umbilical process forked by the sentry replaces its image with
+ * this program. The umbilical connection is inherited on stdin and
+ * stdout, and the remaining state is described in the environment.
+ *
+ * When run with the name of a socket, the program instead runs as
+ * a long-lived umbilical daemon with which sentries can register. */
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+parseUmbilicalEnv_(struct UmbilicalArgs *self)
+{
+    int rc = -1;
+
+    const char *umbilicalEnv;
+    ERT_ERROR_UNLESS(
+        (umbilicalEnv = ert_getEnvString(PIDUMBILICAL_ENV)),
+        {
+            errno = ENOENT;
+        });
+
+    ERT_ERROR_IF(
+        parseUmbilicalArgs(self, umbilicalEnv));
+
+    gOptions.mServer.mTimeout.mUmbilical_s = self->mTimeout_s;
+    gOptions.mServer.mSuspicion            = self->mSuspicion;
+    gOptions.mOptions.mDebug               = self->mDebug;
+    gOptions.mOptions.mTest                = self->mTest;
+
+    /* Do not leak the description of the umbilical process into
+     * any other program. */
+
+    ERT_ERROR_IF(
+        ert_deleteEnv(PIDUMBILICAL_ENV));
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+cmdRunUmbilicalDaemon(const char *aName)
+{
+    int rc = -1;
+
+    struct UmbilicalDaemon  umbilicalDaemon_;
+    struct UmbilicalDaemon *umbilicalDaemon = 0;
+
+    ert_debug(
+        0,
+        "umbilical daemon pid %" PRId_Ert_Pid " name %s",
+        FMTd_Ert_Pid(ert_ownProcessId()),
+        aName);
+
+    ERT_ERROR_IF(
+        ert_ignoreProcessSigPipe());
+
+    ERT_ERROR_IF(
+        createUmbilicalDaemon(&umbilicalDaemon_, aName));
+    umbilicalDaemon = &umbilicalDaemon_;
+
+    ERT_ERROR_IF(
+        runUmbilicalDaemon(umbilicalDaemon));
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        umbilicalDaemon = closeUmbilicalDaemon(umbilicalDaemon);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+cmdMonitorUmbilical(const struct UmbilicalArgs *aEnv)
+{
+    int rc = -1;
+
+    struct PidServer  pidServer_;
+    struct PidServer *pidServer = 0;
+
+    struct UmbilicalBeat  umbilicalBeat_;
+    struct UmbilicalBeat *umbilicalBeat = 0;
+
+    struct SentryStatus  sentryStatus_;
+    struct SentryStatus *sentryStatus = 0;
+
+    ert_debug(
+        0,
+        "umbilical program pid %" PRId_Ert_Pid " pgid %" PRId_Ert_Pgid,
+        FMTd_Ert_Pid(ert_ownProcessId()),
+        FMTd_Ert_Pgid(ert_ownProcessGroupId()));
+
+    ERT_ERROR_IF(
+        ert_ignoreProcessSigPipe());
+
+    if (-1 != aEnv->mPidServerFd)
+    {
+        ERT_ERROR_IF(
+            adoptPidServer(
+                &pidServer_,
+                aEnv->mChildPid,
+                aEnv->mPidServerFd,
+                aEnv->mPidFd,
+                aEnv->mReferences,
+                aEnv->mLease_s));
+        pidServer = &pidServer_;
+    }
+
+    if (-1 != aEnv->mStatusFd)
+    {
+        ERT_ERROR_IF(
+            adoptSentryStatus(&sentryStatus_, aEnv->mStatusFd));
+        sentryStatus = &sentryStatus_;
+
+        if (pidServer)
+            attachPidServerStatus(pidServer, sentryStatus);
+    }
+
+    if (-1 != aEnv->mBeatFd)
+    {
+        ERT_ERROR_IF(
+            adoptUmbilicalBeat(&umbilicalBeat_, aEnv->mBeatFd));
+        umbilicalBeat = &umbilicalBeat_;
+    }
+
+    ERT_ERROR_IF(
+        superviseUmbilicalMonitor(
+            aEnv->mSentryPid,
+            aEnv->mSentryPgid,
+            aEnv->mChildPgid,
+            pidServer,
+            umbilicalBeat));
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        umbilicalBeat = closeUmbilicalBeat(umbilicalBeat);
+        pidServer     = closePidServer(pidServer);
+        sentryStatus  = closeSentryStatus(sentryStatus);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+main(int argc, char **argv)
+{
+    struct Ert_ExitCode exitCode = { EXIT_FAILURE };
+
+    struct Ert_TestModule  testModule_;
+    struct Ert_TestModule *testModule = 0;
+
+    struct Ert_TimeKeepingModule  timeKeepingModule_;
+    struct Ert_TimeKeepingModule *timeKeepingModule = 0;
+
+    struct Ert_ProcessModule  processModule_;
+    struct Ert_ProcessModule *processModule = 0;
+
+    ERT_ABORT_IF(
+        Ert_Test_init(&testModule_, "PIDSENTRY_TEST_ERROR"));
+    testModule = &testModule_;
+
+    ERT_ABORT_IF(
+        Ert_Timekeeping_init(&timeKeepingModule_));
+    timeKeepingModule = &timeKeepingModule_;
+
+    ERT_ABORT_IF(
+        Ert_Process_init(&processModule_, argv[0]));
+    processModule = &processModule_;
+
+    initOptions();
+
+    /* The daemon is started by hand as pidumbilical [-d ...] NAME,
+     * whereas the umbilical process is always run without arguments. */
+
+    int argi = 1;
+
+    for ( ; argi < argc && ! strcmp(argv[argi], "-d"); ++argi)
+        ++gOptions.mOptions.mDebug;
+
+    if (argi < argc)
+    {
+        ERT_ABORT_IF(
+            argi + 1 != argc,
+            {
+                ert_terminate(0, "Usage: %s [-d ...] name", argv[0]);
+            });
+
+        ert_initOptions(&gOptions.mOptions);
+
+        ERT_ABORT_IF(
+            cmdRunUmbilicalDaemon(argv[argi]),
+            {
+                ert_terminate(errno, "Failed to run umbilical daemon");
+            });
+    }
+    else
+    {
+        struct UmbilicalArgs umbilicalEnv;
+        ERT_ABORT_IF(
+            parseUmbilicalEnv_(&umbilicalEnv),
+            {
+                ert_terminate(
+                    errno, "Unable to parse environment %s", PIDUMBILICAL_ENV);
+            });
+
+        ert_initOptions(&gOptions.mOptions);
+
+        ERT_ABORT_IF(
+            cmdMonitorUmbilical(&umbilicalEnv),
+            {
+                ert_terminate(errno, "Failed to monitor umbilical");
+            });
+    }
+
+    exitCode.mStatus = EXIT_SUCCESS;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    processModule     = Ert_Process_exit(processModule);
+    timeKeepingModule = Ert_Timekeeping_exit(timeKeepingModule);
+    testModule        = Ert_Test_exit(testModule);
+
+    return exitCode.mStatus;
+}
+
+/* -------------------------------------------------------------------------- */
@@ -30,6 +30,11 @@
 #include "childprocess.h"
 #include "umbilical.h"
 #include "tether.h"
+#include "taskscan.h"
+#include "wakeup.h"
+#include "umbilicalbeat.h"
+#include "umbilicalrtt.h"
+#include "sentrystatus.h"
 
 #include "options_.h"
 
@@ -41,7 +46,10 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <string.h>
 
+#include <sys/socket.h>
+#include <sys/wait.h>
 
 /* -------------------------------------------------------------------------- */
 enum PollFdChildKind
@@ -50,6 +58,7 @@ enum PollFdChildKind
     POLL_FD_CHILD_UMBILICAL,
     POLL_FD_CHILD_PARENT,
     POLL_FD_CHILD_EVENTPIPE,
+    POLL_FD_CHILD_NOTIFY,
     POLL_FD_CHILD_KINDS
 };
 
@@ -59,6 +68,7 @@ static const char *pollFdNames_[POLL_FD_CHILD_KINDS] =
     [POLL_FD_CHILD_UMBILICAL] = "umbilical",
     [POLL_FD_CHILD_PARENT]    = "parent",
     [POLL_FD_CHILD_EVENTPIPE] = "event pipe",
+    [POLL_FD_CHILD_NOTIFY]    = "notify",
 };
 
 /* -------------------------------------------------------------------------- */
@@ -67,7 +77,8 @@ enum PollFdChildTimerKind
     POLL_FD_CHILD_TIMER_TETHER,
     POLL_FD_CHILD_TIMER_UMBILICAL,
     POLL_FD_CHILD_TIMER_TERMINATION,
-    POLL_FD_CHILD_TIMER_DISCONNECTION,
+    POLL_FD_CHILD_TIMER_HANG,
+    POLL_FD_CHILD_TIMER_HEARTBEAT,
     POLL_FD_CHILD_TIMER_KINDS
 };
 
@@ -76,9 +87,18 @@ static const char *pollFdTimerNames_[POLL_FD_CHILD_TIMER_KINDS] =
     [POLL_FD_CHILD_TIMER_TETHER]        = "tether",
     [POLL_FD_CHILD_TIMER_UMBILICAL]     = "umbilical",
     [POLL_FD_CHILD_TIMER_TERMINATION]   = "termination",
-    [POLL_FD_CHILD_TIMER_DISCONNECTION] = "disconnection",
+    [POLL_FD_CHILD_TIMER_HANG]          = "hang",
+    [POLL_FD_CHILD_TIMER_HEARTBEAT]     = "heartbeat",
 };
 
+/* -------------------------------------------------------------------------- */
+/* Umbilical pings back off from a fraction of the umbilical timeout cycle
+ * to the full cycle, and a ping is brought forward to share a wakeup if
+ * it is due within a fraction of the current interval. */
+
+#define UMBILICAL_PING_BACKOFF   8
+#define UMBILICAL_PING_PIGGYBACK 4
+
 /* -------------------------------------------------------------------------- */
 int
 createChildProcess(struct ChildProcess *self)
@@ -90,6 +110,8 @@ createChildProcess(struct ChildProcess *self)
 
     self->mShellCommand     = 0;
     self->mTetherPipe       = 0;
+    self->mHeartbeat        = 0;
+    self->mNotifySocket     = 0;
     self->mLatch.mChild     = 0;
     self->mLatch.mUmbilical = 0;
 
@@ -122,6 +144,21 @@ createChildProcess(struct ChildProcess *self)
     ERT_ERROR_IF(
         ert_nonBlockingFile(self->mTetherPipe->mWrFile, 0));
 
+    if (gOptions.mServer.mHeartbeat.mSlots)
+    {
+        ERT_ERROR_IF(
+            createHeartbeat(
+                &self->mHeartbeat_, gOptions.mServer.mHeartbeat.mSlots));
+        self->mHeartbeat = &self->mHeartbeat_;
+    }
+
+    if (gOptions.mServer.mNotify)
+    {
+        ERT_ERROR_IF(
+            createNotifySocket(&self->mNotifySocket_));
+        self->mNotifySocket = &self->mNotifySocket_;
+    }
+
     rc = 0;
 
 Ert_Finally:
@@ -130,6 +167,9 @@ Ert_Finally:
     ({
         if (rc)
         {
+            self->mNotifySocket        =
+                closeNotifySocket(self->mNotifySocket);
+            self->mHeartbeat           = closeHeartbeat(self->mHeartbeat);
             self->mTetherPipe          = ert_closePipe(self->mTetherPipe);
             self->mChildMonitor.mMutex =
                 ert_destroyThreadSigMutex(self->mChildMonitor.mMutex);
@@ -414,6 +454,105 @@ Ert_Finally:
     return rc;
 }
 
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+advertiseChildProcessFd_(const char **aCmd, const char *aName, int aFd)
+{
+    int rc = -1;
+
+    /* Advertise the file descriptor to the child program. If the name
+     * looks like an environment variable, set the variable, otherwise
+     * substitute the file descriptor for the name in the first matching
+     * argument of the command. */
+
+    char fdArg[sizeof(int) * CHAR_BIT + 1];
+
+    ERT_ERROR_IF(
+        0 > sprintf(fdArg, "%d", aFd));
+
+    bool useEnv = isupper((unsigned char) aName[0]);
+
+    for (unsigned ix = 1; useEnv && aName[ix]; ++ix)
+    {
+        unsigned char ch = aName[ix];
+
+        if ( ! isupper(ch) && ! isdigit(ch) && ch != '_')
+            useEnv = false;
+    }
+
+    if (useEnv)
+    {
+        ERT_ERROR_IF(
+            setenv(aName, fdArg, 1));
+    }
+    else
+    {
+        /* Start scanning from the first argument, leaving
+         * the command name intact. */
+
+        char *matchArg = 0;
+
+        for (unsigned ix = 1; aCmd[ix]; ++ix)
+        {
+            matchArg = strstr(aCmd[ix], aName);
+
+            if (matchArg)
+            {
+                char replacedArg[
+                    strlen(aCmd[ix]) - strlen(aName) + strlen(fdArg) + 1];
+
+                int matchLen = matchArg - aCmd[ix];
+
+                ERT_ERROR_UNLESS(
+                    aCmd[ix] + matchLen == matchArg,
+                    {
+                        errno = ERANGE;
+                    });
+
+                ERT_ERROR_IF(
+                    0 > sprintf(
+                        replacedArg,
+                        "%.*s%s%s",
+                        matchLen,
+                        aCmd[ix],
+                        fdArg,
+                        matchArg + strlen(aName)));
+
+                char *dupArg = 0;
+                ERT_ERROR_UNLESS(
+                    dupArg = strdup(replacedArg),
+                    {
+                        ert_terminate(
+                            errno,
+                            "Unable to duplicate '%s'",
+                            replacedArg);
+                    });
+
+                aCmd[ix] = dupArg;
+
+                break;
+            }
+        }
+
+        ERT_ERROR_UNLESS(
+            matchArg,
+            {
+                ert_terminate(
+                    0,
+                    "Unable to find matching argument '%s'",
+                    aName);
+            });
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
 /* -------------------------------------------------------------------------- */
 struct ForkChildProcess_
 {
@@ -496,92 +635,10 @@ runChildProcess_(struct ForkChildProcess_ *self)
                 if (0 > tetherFd)
                     tetherFd = self->mChildProcess->mTetherPipe->mWrFile->mFd;
 
-                char tetherArg[sizeof(int) * CHAR_BIT + 1];
-
-                ERT_ERROR_IF(
-                    0 > sprintf(tetherArg, "%d", tetherFd));
-
                 if (gOptions.mServer.mName)
-                {
-                    bool useEnv = isupper(
-                        (unsigned char) gOptions.mServer.mName[0]);
-
-                    for (unsigned ix = 1;
-                         useEnv && gOptions.mServer.mName[ix];
-                         ++ix)
-                    {
-                        unsigned char ch = gOptions.mServer.mName[ix];
-
-                        if ( ! isupper(ch) && ! isdigit(ch) && ch != '_')
-                            useEnv = false;
-                    }
-
-                    if (useEnv)
-                    {
-                        ERT_ERROR_IF(
-                            setenv(gOptions.mServer.mName, tetherArg, 1));
-                    }
-                    else
-                    {
-                        /* Start scanning from the first argument, leaving
-                         * the command name intact. */
-
-                        char *matchArg = 0;
-
-                        for (unsigned ix = 1; cmd[ix]; ++ix)
-                        {
-                            matchArg = strstr(cmd[ix], gOptions.mServer.mName);
-
-                            if (matchArg)
-                            {
-                                char replacedArg[
-                                    strlen(cmd[ix])                -
-                                    strlen(gOptions.mServer.mName) +
-                                    strlen(tetherArg)              + 1];
-
-                                int matchLen = matchArg - cmd[ix];
-
-                                ERT_ERROR_UNLESS(
-                                    cmd[ix] + matchLen == matchArg,
-                                    {
-                                        errno = ERANGE;
-                                    });
-
-                                ERT_ERROR_IF(
-                                  0 > sprintf(
-                                    replacedArg,
-                                    "%.*s%s%s",
-                                    matchLen,
-                                    cmd[ix],
-                                    tetherArg,
-                                    matchArg + strlen(gOptions.mServer.mName)));
-
-                                char *dupArg = 0;
-                                ERT_ERROR_UNLESS(
-                                    dupArg = strdup(replacedArg),
-                                    {
-                                        ert_terminate(
-                                            errno,
-                                            "Unable to duplicate '%s'",
-                                            replacedArg);
-                                    });
-
-                                cmd[ix] = dupArg;
-
-                                break;
-                            }
-                        }
-
-                        ERT_ERROR_UNLESS(
-                            matchArg,
-                            {
-                                ert_terminate(
-                                    0,
-                                    "Unable to find matching argument '%s'",
-                                    gOptions.mServer.mName);
-                            });
-                    }
-                }
+                    ERT_ERROR_IF(
+                        advertiseChildProcessFd_(
+                            cmd, gOptions.mServer.mName, tetherFd));
 
                 if (tetherFd == self->mChildProcess->mTetherPipe->mWrFile->mFd)
                     break;
@@ -597,6 +654,60 @@ runChildProcess_(struct ForkChildProcess_ *self)
 
         } while (0);
 
+        /* The heartbeat region is shared with the child program, so
+         * the file descriptor must survive the upcoming exec(). */
+
+        if (self->mChildProcess->mHeartbeat)
+        {
+            struct Heartbeat *heartbeat = self->mChildProcess->mHeartbeat;
+
+            ERT_ERROR_IF(
+                ert_closeFileOnExec(heartbeat->mFile, 0));
+
+            ERT_ERROR_IF(
+                advertiseChildProcessFd_(
+                    cmd,
+                    gOptions.mServer.mHeartbeat.mName,
+                    heartbeat->mFile->mFd));
+        }
+
+        /* The notification socket is bound in the abstract namespace,
+         * so the child program connects to it by name and the file
+         * descriptor is not inherited. Advertise the tether timeout
+         * as the watchdog interval because WATCHDOG=1 counts as
+         * activity on the tether. */
+
+        if (self->mChildProcess->mNotifySocket)
+        {
+            ERT_ERROR_IF(
+                setenv(
+                    "NOTIFY_SOCKET",
+                    self->mChildProcess->mNotifySocket->mName, 1));
+
+            if (gOptions.mServer.mTether &&
+                gOptions.mServer.mTimeout.mTether_s)
+            {
+                char watchdogPid[sizeof(pid_t) * CHAR_BIT + 1];
+                char watchdogUsec[sizeof(unsigned long long) * CHAR_BIT + 1];
+
+                ERT_ERROR_IF(
+                    0 > sprintf(
+                        watchdogPid,
+                        "%" PRId_Ert_Pid,
+                        FMTd_Ert_Pid(ert_ownProcessId())));
+
+                ERT_ERROR_IF(
+                    0 > sprintf(
+                        watchdogUsec,
+                        "%llu",
+                        1000000ULL * gOptions.mServer.mTimeout.mTether_s));
+
+                ERT_ERROR_IF(
+                    setenv("WATCHDOG_PID", watchdogPid, 1) ||
+                    setenv("WATCHDOG_USEC", watchdogUsec, 1));
+            }
+        }
+
         ERT_ERROR_IF(
             createShellCommand(&shellCommand_, cmd));
         shellCommand = &shellCommand_;
@@ -777,7 +888,67 @@ Ert_Finally:
 static void
 closeChildFiles_(struct ChildProcess *self)
 {
-    self->mTetherPipe = ert_closePipe(self->mTetherPipe);
+    self->mNotifySocket = closeNotifySocket(self->mNotifySocket);
+    self->mHeartbeat    = closeHeartbeat(self->mHeartbeat);
+    self->mTetherPipe   = ert_closePipe(self->mTetherPipe);
+}
+
+/* -------------------------------------------------------------------------- */
+int
+peekChildProcess(struct ChildProcess *self, struct Ert_ExitCode *aExitCode)
+{
+    int rc = -1;
+
+    /* Wait for the child process to terminate, and collect its exit
+     * code, but leave the child process as a zombie so that its pid
+     * is not reused until the child process is reaped. */
+
+    siginfo_t siginfo;
+
+    int err;
+    do
+        err = waitid(P_PID, self->mPid.mPid, &siginfo, WEXITED | WNOWAIT);
+    while (-1 == err && EINTR == errno);
+
+    ERT_ERROR_IF(
+        -1 == err);
+
+    int status;
+
+    switch (siginfo.si_code)
+    {
+    default:
+        ERT_ERROR_IF(
+            true,
+            {
+                errno = EINVAL;
+            });
+
+    case CLD_EXITED:
+        status = W_EXITCODE(siginfo.si_status, 0);
+        break;
+
+    case CLD_KILLED:
+        status = W_EXITCODE(0, siginfo.si_status);
+        break;
+
+    case CLD_DUMPED:
+        status = W_EXITCODE(0, siginfo.si_status) | WCOREFLAG;
+        break;
+    }
+
+    *aExitCode = ert_extractProcessExitStatus(status, self->mPid);
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        ert_finally_warn_if(rc, self, printChildProcess);
+    });
+
+    return rc;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -851,25 +1022,23 @@ enum ChildTerminationAction
     ChildTermination_Actions,
 };
 
-struct ChildSignalPlan
-{
-    struct Ert_Pid mPid;
-    int            mSig;
-};
-
 struct ChildMonitor
 {
-    struct Ert_Pid mChildPid;
+    struct Ert_Pid       mChildPid;
+    struct ChildProcess *mChildProcess;
 
     struct TetherThread   *mTetherThread;
     struct Ert_EventPipe  *mEventPipe;
     struct Ert_EventLatch *mContLatch;
+    struct SentryStatus   *mStatus;
 
     struct
     {
-        const struct ChildSignalPlan *mSignalPlans[ChildTermination_Actions];
-        const struct ChildSignalPlan *mSignalPlan;
-        struct Ert_Duration           mSignalPeriod;
+        const struct SignalPlanStep *mSignalPlans[ChildTermination_Actions];
+        const struct SignalPlanStep *mSignalPlan;
+        struct Ert_Duration          mSignalPeriod;
+        struct Ert_Pgid              mPgid;
+        unsigned                     mSteps;    /* Signal plan steps taken */
     } mTermination;
 
     struct
@@ -877,16 +1046,50 @@ struct ChildMonitor
         struct Ert_File *mFile;
         struct Ert_Pid   mPid;
         bool             mPreempt;       /* Request back-to-back pings */
+        bool             mPiggyback;     /* Ping joins another wakeup */
+        bool             mShared;        /* Heartbeat in shared memory */
         unsigned         mCycleCount;    /* Current number of cycles */
         unsigned         mCycleLimit;    /* Cycles before triggering */
+
+        struct Ert_Duration mInterval;   /* Current ping interval */
+        struct Ert_Duration mCeiling;    /* Longest ping interval */
+        struct WakeupMeter  mWakeups;
+
+        unsigned                  mSuspicion; /* Phi threshold, or zero */
+        struct Ert_EventClockTime mPingTime;  /* Time last ping was sent */
+        struct UmbilicalRtt       mRtt;
+
+        struct UmbilicalBeat *mBeat;
     } mUmbilical;
 
     struct
     {
         unsigned mCycleCount;       /* Current number of cycles */
         unsigned mCycleLimit;       /* Cycles before triggering */
+        bool     mReconfigured;     /* Timeout changed since last armed */
     } mTether;
 
+    struct
+    {
+        struct TaskScan *mScan;
+    } mHang;
+
+    struct
+    {
+        struct Heartbeat *mHeartbeat;
+        unsigned          mCycleLimit;  /* Cycles before triggering */
+    } mHeartbeat;
+
+    struct
+    {
+        struct NotifySocket           *mSocket;
+        struct Ert_Pgid                mPgid;
+        struct ChildProcessReadyMethod mReadyMethod;
+        bool                           mReady;
+        bool                           mStopping;
+        struct Ert_EventClockTime      mWatchdog;   /* Last keepalive */
+    } mNotify;
+
     struct
     {
         bool mChildLatchDisabled;
@@ -952,71 +1155,132 @@ activateFdTimerTermination_(struct ChildMonitor             *self,
 
         ert_lapTimeTrigger(
             &terminationTimer->mSince, terminationTimer->mPeriod, aPollTime);
+
+        setSentryStatusState(
+            self->mStatus,
+            SentryStatusTerminating, self->mTermination.mSteps);
     }
 }
 
 static ERT_CHECKED int
-pollFdTimerTermination_(struct ChildMonitor             *self,
-                        const struct Ert_EventClockTime *aPollTime)
+signalFdTimerTermination_(struct ChildMonitor             *self,
+                          const struct SignalPlanStep     *aStep,
+                          const struct Ert_EventClockTime *aPollTime)
 {
     int rc = -1;
 
-    /* Remember that this function races termination of the child process.
-     * The child process might have terminated by the time this function
-     * attempts to deliver the next signal. This should be handled
-     * correctly because the child process will remain as a zombie
-     * and signals will be delivered successfully, but without effect. */
+    struct Ert_ProcessSignalName sigName;
 
-    struct Ert_Pid pidNum = self->mTermination.mSignalPlan->mPid;
-    int            sigNum = self->mTermination.mSignalPlan->mSig;
+    const char *sigText = ert_formatProcessSignalName(&sigName, aStep->mSig);
 
-    if (self->mTermination.mSignalPlan[1].mSig)
-        ++self->mTermination.mSignalPlan;
+    switch (aStep->mTarget)
+    {
+    default:
+        ert_ensure(false);
+        break;
 
-    struct Ert_ProcessSignalName sigName;
+    case SignalTargetPid:
+        ert_warn(
+            0,
+            "Killing child pid %" PRId_Ert_Pid " with %s",
+            FMTd_Ert_Pid(self->mChildPid),
+            sigText);
 
-    ert_warn(
-        0,
-        "Killing child pid %" PRId_Ert_Pid " with %s",
-        FMTd_Ert_Pid(pidNum),
-        ert_formatProcessSignalName(&sigName, sigNum));
+        ERT_ERROR_IF(
+            kill(self->mChildPid.mPid, aStep->mSig));
+        break;
 
-    ERT_ERROR_IF(
-        kill(pidNum.mPid, sigNum));
+    case SignalTargetPgid:
+        ert_warn(
+            0,
+            "Killing child pgid %" PRId_Ert_Pgid " with %s",
+            FMTd_Ert_Pgid(self->mTermination.mPgid),
+            sigText);
+
+        ERT_ERROR_IF(
+            ert_signalProcessGroup(self->mTermination.mPgid, aStep->mSig) &&
+            ESRCH != errno);
+        break;
+
+    case SignalTargetTree:
+        {
+            /* Refresh the scan immediately before delivering the
+             * signal to find the current descendants of the child,
+             * and to narrow the window in which a pid might be reused. */
+
+            ERT_ERROR_IF(
+                -1 == runTaskScan(self->mHang.mScan, aPollTime));
+
+            int signalled;
+            ERT_ERROR_IF(
+                (signalled = signalTaskScan(self->mHang.mScan, aStep->mSig),
+                 -1 == signalled));
+
+            ert_warn(
+                0,
+                "Killing %d processes in child tree pid %" PRId_Ert_Pid
+                " with %s",
+                signalled,
+                FMTd_Ert_Pid(self->mChildPid),
+                sigText);
+        }
+        break;
+    }
 
     rc = 0;
 
 Ert_Finally:
 
-    ERT_FINALLY
-    ({
-        ert_finally_warn_if(rc, self, printChildProcessMonitor);
-    });
+    ERT_FINALLY({});
 
     return rc;
 }
 
-/* -------------------------------------------------------------------------- */
-/* Maintain Parent Connection
- *
- * This connection allows for monitoring ofthe parent. The child will
- * terminate if the parent terminates. */
-
 static ERT_CHECKED int
-pollFdParent_(struct ChildMonitor             *self,
-              const struct Ert_EventClockTime *aPollTime)
+pollFdTimerTermination_(struct ChildMonitor             *self,
+                        const struct Ert_EventClockTime *aPollTime)
 {
     int rc = -1;
 
-    ert_warn(
-        0,
-        "Parent pid %" PRId_Ert_Pid " has terminated",
-        FMTd_Ert_Pid(self->mParent.mPid));
+    struct Ert_PollFdTimerAction *terminationTimer =
+        &self->mPollFdTimerActions[POLL_FD_CHILD_TIMER_TERMINATION];
 
-    self->mPollFds[POLL_FD_CHILD_PARENT].fd     = -1;
-    self->mPollFds[POLL_FD_CHILD_PARENT].events = 0;
+    /* Remember that this function races termination of the child process.
+     * The child process might have terminated by the time this function
+     * attempts to deliver the next signal. This should be handled
+     * correctly because the child process will remain as a zombie
+     * and signals will be delivered successfully, but without effect.
+     *
+     * Deliver steps back to back until reaching a step that specifies
+     * a delay, and use that delay to schedule the next step. The last
+     * step is repeated until the child process terminates. */
 
-    activateFdTimerTermination_(self, ChildTermination_Terminate, aPollTime);
+    while (1)
+    {
+        const struct SignalPlanStep *step = self->mTermination.mSignalPlan;
+
+        bool lastStep = ! step[1].mSig;
+
+        if ( ! lastStep)
+            ++self->mTermination.mSignalPlan;
+
+        ERT_ERROR_IF(
+            signalFdTimerTermination_(self, step, aPollTime));
+
+        setSentryStatusState(
+            self->mStatus,
+            SentryStatusTerminating, ++self->mTermination.mSteps);
+
+        if (step->mPeriod_ms || lastStep)
+        {
+            terminationTimer->mPeriod =
+                0 >= step->mPeriod_ms
+                ? self->mTermination.mSignalPeriod
+                : Ert_Duration(
+                    ERT_NSECS(Ert_MilliSeconds(step->mPeriod_ms)));
+            break;
+        }
+    }
 
     rc = 0;
 
@@ -1030,45 +1294,348 @@ Ert_Finally:
     return rc;
 }
 
-/* -------------------------------------------------------------------------- */
-/* Maintain Umbilical Connection
- *
- * This connection allows the umbilical monitor to terminate the child
- * process if it detects that the watchdog is no longer functioning
- * properly. This is important in scenarios where the supervisor
- * init(8) kills the watchdog without giving the watchdog a chance
- * to clean up, or if the watchdog fails catatrophically. */
-
 static void
-restartFdTimerUmbilical_(struct ChildMonitor             *self,
-                         const struct Ert_EventClockTime *aPollTime)
+advanceFdTimerTermination_(struct ChildMonitor             *self,
+                           const struct Ert_EventClockTime *aPollTime)
 {
-    if (self->mUmbilical.mCycleCount != self->mUmbilical.mCycleLimit)
+    /* Once the child process has terminated, there is no need to wait
+     * for the current step of the signal plan to take effect. Skip the
+     * remaining steps that only target the child process, and take the
+     * next step that targets the remaining processes immediately. */
+
+    struct Ert_PollFdTimerAction *terminationTimer =
+        &self->mPollFdTimerActions[POLL_FD_CHILD_TIMER_TERMINATION];
+
+    if (terminationTimer->mPeriod.duration.ns)
     {
-        ert_ensure(self->mUmbilical.mCycleCount < self->mUmbilical.mCycleLimit);
+        const struct SignalPlanStep *step = self->mTermination.mSignalPlan;
 
-        self->mUmbilical.mCycleCount = 0;
+        while (step->mSig && SignalTargetPid == step->mTarget)
+            ++step;
 
-        ert_lapTimeRestart(
-            &self->mPollFdTimerActions[POLL_FD_CHILD_TIMER_UMBILICAL].mSince,
-            aPollTime);
+        if ( ! step->mSig)
+        {
+            ert_debug(1, "completed termination plan");
+
+            terminationTimer->mPeriod = Ert_ZeroDuration;
+        }
+        else
+        {
+            ert_debug(1, "advancing termination plan");
+
+            self->mTermination.mSignalPlan = step;
+
+            ert_lapTimeTrigger(
+                &terminationTimer->mSince,
+                terminationTimer->mPeriod, aPollTime);
+        }
     }
 }
 
+/* -------------------------------------------------------------------------- */
+/* Runtime Reconfiguration
+ *
+ * Clients of the pid server can change the timeouts and signal plans
+ * while the child process is running. A change is not applied to a
+ * running timer, but takes effect when the timer is next rearmed, so
+ * that each timer always runs with a consistent period and cycle count.
+ * Signal plans cannot be changed once termination has started because
+ * the plan in progress is being stepped through. */
+
 static void
-pollFdCloseUmbilical_(struct ChildMonitor             *self,
-                      const struct Ert_EventClockTime *aPollTime)
+rearmFdTimerTether_(struct ChildMonitor             *self,
+                    const struct Ert_EventClockTime *aPollTime)
 {
-    struct Ert_PollFdTimerAction *umbilicalTimer =
-        &self->mPollFdTimerActions[POLL_FD_CHILD_TIMER_UMBILICAL];
+    struct Ert_PollFdTimerAction *tetherTimer =
+        &self->mPollFdTimerActions[POLL_FD_CHILD_TIMER_TETHER];
 
-    self->mPollFds[POLL_FD_CHILD_UMBILICAL].fd     = -1;
-    self->mPollFds[POLL_FD_CHILD_UMBILICAL].events = 0;
+    ert_debug(0, "tether timeout %us", gOptions.mServer.mTimeout.mTether_s);
 
-    /* Since the umbilical connection is no longer being monitored, there
-     * is no reason to run its associated timer. */
+    self->mTether.mReconfigured = false;
+    self->mTether.mCycleCount   = 0;
 
-    umbilicalTimer->mPeriod = Ert_ZeroDuration;
+    tetherTimer->mPeriod = Ert_Duration(Ert_NanoSeconds(
+        ERT_NSECS(Ert_Seconds(gOptions.mServer.mTimeout.mTether_s)).ns /
+        self->mTether.mCycleLimit));
+
+    if (tetherTimer->mPeriod.duration.ns)
+        ert_lapTimeRestart(&tetherTimer->mSince, aPollTime);
+}
+
+static bool
+validSignalPlan_(const struct SignalPlan *aPlan)
+{
+    return aPlan->mStep[0].mSig && ! aPlan->mStep[SIGNAL_PLAN_STEPS].mSig;
+}
+
+static bool
+treeSignalPlan_(const struct SignalPlan *aPlan)
+{
+    for (const struct SignalPlanStep *step = aPlan->mStep; step->mSig; ++step)
+    {
+        if (SignalTargetTree == step->mTarget)
+            return true;
+    }
+
+    return false;
+}
+
+static ERT_CHECKED int
+reconfigureChildMonitor_(struct ChildMonitor             *self,
+                         int                              aFd,
+                         const struct Ert_EventClockTime *aPollTime)
+{
+    int rc = -1;
+
+    /* The pid server fills the pipe before passing it, so reading the
+     * configuration cannot block. The pid server does not interpret
+     * the configuration, so validate it completely before applying
+     * any part of it. */
+
+    struct SentryConfig config;
+
+    ssize_t rdlen;
+    ERT_ERROR_IF(
+        (rdlen = read(aFd, &config, sizeof(config)),
+         -1 == rdlen || (errno = EPROTO, sizeof(config) != rdlen)));
+
+    ERT_ERROR_IF(
+        SENTRY_CONFIG_VERSION != config.mVersion ||
+        sizeof(config) != config.mSize ||
+        ((config.mFields & SentryConfigSignal) && ! config.mSignal_s) ||
+        ((config.mFields & SentryConfigTermPlan) &&
+            ! validSignalPlan_(&config.mTermPlan)) ||
+        ((config.mFields & SentryConfigAbortPlan) &&
+            ! validSignalPlan_(&config.mAbortPlan)),
+        {
+            errno = EPROTO;
+        });
+
+    /* The scan of the process tree is only created when the sentry
+     * starts, so a plan that targets the tree can only be applied to a
+     * sentry that was started with a scan. */
+
+    ERT_ERROR_IF(
+        ! self->mHang.mScan &&
+        (((config.mFields & SentryConfigTermPlan) &&
+            treeSignalPlan_(&config.mTermPlan)) ||
+         ((config.mFields & SentryConfigAbortPlan) &&
+            treeSignalPlan_(&config.mAbortPlan))),
+        {
+            errno = EINVAL;
+        });
+
+    if (config.mFields & SentryConfigSignal)
+    {
+        ert_debug(0, "signal period %us", config.mSignal_s);
+
+        gOptions.mServer.mTimeout.mSignal_s = config.mSignal_s;
+
+        self->mTermination.mSignalPeriod =
+            Ert_Duration(ERT_NSECS(Ert_Seconds(config.mSignal_s)));
+    }
+
+    /* The drain timeout is read by the tether thread only when the
+     * tether is flushed, and the flush request provides the ordering
+     * needed to publish the new value. Once flushed, it is too late. */
+
+    if (config.mFields & SentryConfigDrain)
+    {
+        if (self->mTetherThread->mFlushed)
+            ert_warn(0, "Unable to change drain timeout while draining");
+        else
+        {
+            ert_debug(0, "drain timeout %ums", config.mDrain_ms);
+
+            gOptions.mServer.mTimeout.mDrain_ms = config.mDrain_ms;
+        }
+    }
+
+    if (config.mFields & (SentryConfigTermPlan | SentryConfigAbortPlan))
+    {
+        if (self->mTermination.mSignalPlan)
+            ert_warn(0, "Unable to change signal plan while terminating");
+        else
+        {
+            /* The signal plans of the monitor refer to these, so the
+             * new plans are used when termination starts. */
+
+            if (config.mFields & SentryConfigTermPlan)
+                gOptions.mServer.mSignalPlan.mTerminate = config.mTermPlan;
+
+            if (config.mFields & SentryConfigAbortPlan)
+                gOptions.mServer.mSignalPlan.mAbort = config.mAbortPlan;
+        }
+    }
+
+    /* The tether timer is disarmed once termination starts. Otherwise,
+     * if the tether timer is not running, there is no rearm to wait for,
+     * so start it now. */
+
+    if (config.mFields & SentryConfigTether)
+    {
+        gOptions.mServer.mTimeout.mTether_s = config.mTether_s;
+
+        struct Ert_PollFdTimerAction *tetherTimer =
+            &self->mPollFdTimerActions[POLL_FD_CHILD_TIMER_TETHER];
+
+        if (gOptions.mServer.mTether && ! self->mTermination.mSignalPlan)
+        {
+            if (tetherTimer->mPeriod.duration.ns)
+                self->mTether.mReconfigured = true;
+            else
+                rearmFdTimerTether_(self, aPollTime);
+        }
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+/* Maintain Parent Connection
+ *
+ * This connection allows for monitoring ofthe parent. The child will
+ * terminate if the parent terminates. */
+
+static ERT_CHECKED int
+pollFdParent_(struct ChildMonitor             *self,
+              const struct Ert_EventClockTime *aPollTime)
+{
+    int rc = -1;
+
+    ert_warn(
+        0,
+        "Parent pid %" PRId_Ert_Pid " has terminated",
+        FMTd_Ert_Pid(self->mParent.mPid));
+
+    self->mPollFds[POLL_FD_CHILD_PARENT].fd     = -1;
+    self->mPollFds[POLL_FD_CHILD_PARENT].events = 0;
+
+    activateFdTimerTermination_(self, ChildTermination_Terminate, aPollTime);
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        ert_finally_warn_if(rc, self, printChildProcessMonitor);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+/* Maintain Umbilical Connection
+ *
+ * This connection allows the umbilical monitor to terminate the child
+ * process if it detects that the watchdog is no longer functioning
+ * properly. This is important in scenarios where the supervisor
+ * init(8) kills the watchdog without giving the watchdog a chance
+ * to clean up, or if the watchdog fails catatrophically. */
+
+static void
+restartFdTimerUmbilical_(struct ChildMonitor             *self,
+                         const struct Ert_EventClockTime *aPollTime)
+{
+    if (self->mUmbilical.mCycleCount != self->mUmbilical.mCycleLimit)
+    {
+        ert_ensure(self->mUmbilical.mCycleCount < self->mUmbilical.mCycleLimit);
+
+        self->mUmbilical.mCycleCount = 0;
+
+        ert_lapTimeRestart(
+            &self->mPollFdTimerActions[POLL_FD_CHILD_TIMER_UMBILICAL].mSince,
+            aPollTime);
+    }
+}
+
+static void
+resetFdTimerUmbilical_(struct ChildMonitor *self)
+{
+    /* Start again from the shortest ping interval after any event that
+     * casts doubt on the health of the umbilical connection. */
+
+    self->mUmbilical.mInterval = Ert_Duration(
+        Ert_NanoSeconds(
+            self->mUmbilical.mCeiling.duration.ns / UMBILICAL_PING_BACKOFF));
+}
+
+static void
+scheduleFdTimerUmbilical_(struct ChildMonitor             *self,
+                          const struct Ert_EventClockTime *aPollTime)
+{
+    /* While the umbilical connection remains healthy, back off the ping
+     * interval towards the ceiling, and schedule the next ping in phase
+     * with the pings of other sentries on the host so that they
+     * wake together. */
+
+    uint64_t interval_ns = 2 * self->mUmbilical.mInterval.duration.ns;
+
+    if (interval_ns > self->mUmbilical.mCeiling.duration.ns)
+        interval_ns = self->mUmbilical.mCeiling.duration.ns;
+
+    self->mUmbilical.mInterval = Ert_Duration(Ert_NanoSeconds(interval_ns));
+
+    alignWakeupTimer(
+        &self->mPollFdTimerActions[POLL_FD_CHILD_TIMER_UMBILICAL],
+        self->mUmbilical.mInterval,
+        aPollTime);
+}
+
+static void
+piggybackFdTimerUmbilical_(struct ChildMonitor             *self,
+                           const struct Ert_EventClockTime *aPollTime)
+{
+    /* If the event loop is already awake for some other reason, and the
+     * next ping will soon be due, expire the umbilical timer now so that
+     * the ping is sent as part of this wakeup rather than needing
+     * a wakeup of its own. */
+
+    struct Ert_PollFdTimerAction *umbilicalTimer =
+        &self->mPollFdTimerActions[POLL_FD_CHILD_TIMER_UMBILICAL];
+
+    if (self->mUmbilical.mCycleCount == self->mUmbilical.mCycleLimit &&
+        umbilicalTimer->mPeriod.duration.ns &&
+        ! self->mUmbilical.mPiggyback)
+    {
+        struct Ert_Duration remaining =
+            ownWakeupTimerRemaining(umbilicalTimer, aPollTime);
+
+        if (remaining.duration.ns &&
+            remaining.duration.ns <= self->mUmbilical.mInterval.duration.ns /
+                                     UMBILICAL_PING_PIGGYBACK)
+        {
+            ert_debug(1, "piggyback umbilical ping");
+
+            self->mUmbilical.mPiggyback = true;
+
+            ert_lapTimeTrigger(&umbilicalTimer->mSince,
+                               umbilicalTimer->mPeriod, aPollTime);
+        }
+    }
+}
+
+static void
+pollFdCloseUmbilical_(struct ChildMonitor             *self,
+                      const struct Ert_EventClockTime *aPollTime)
+{
+    struct Ert_PollFdTimerAction *umbilicalTimer =
+        &self->mPollFdTimerActions[POLL_FD_CHILD_TIMER_UMBILICAL];
+
+    self->mPollFds[POLL_FD_CHILD_UMBILICAL].fd     = -1;
+    self->mPollFds[POLL_FD_CHILD_UMBILICAL].events = 0;
+
+    /* Since the umbilical connection is no longer being monitored, there
+     * is no reason to run its associated timer. */
+
+    umbilicalTimer->mPeriod = Ert_ZeroDuration;
 
     activateFdTimerTermination_(self, ChildTermination_Terminate, aPollTime);
 }
@@ -1086,6 +1653,33 @@ pollFdUmbilical_(struct ChildMonitor             *self,
 
     char buf[1];
 
+    /* Besides echoes, the umbilical process sends TETHER_ATTACH_MESSAGE
+     * accompanied by a pipe on which to copy the output of the child
+     * process to a client of the pid server, and SENTRY_CONFIG_MESSAGE
+     * accompanied by a pipe from which to read a new configuration. */
+
+    int passedFd = -1;
+
+    struct iovec iov =
+    {
+        .iov_base = buf,
+        .iov_len  = sizeof(buf),
+    };
+
+    union
+    {
+        struct cmsghdr mHeader;
+        char           mBuf[CMSG_SPACE(sizeof(int))];
+    } control;
+
+    struct msghdr msg =
+    {
+        .msg_iov        = &iov,
+        .msg_iovlen     = 1,
+        .msg_control    = control.mBuf,
+        .msg_controllen = sizeof(control.mBuf),
+    };
+
     /* If the far end did not read the previous ping, and simply closed its
      * end of the connection (likely because it either failed or was
      * inadvertently killed), then the read will return ECONNRESET. This
@@ -1093,12 +1687,26 @@ pollFdUmbilical_(struct ChildMonitor             *self,
 
     ssize_t rdlen;
     ERT_ERROR_IF(
-        (rdlen = read(
-            self->mPollFds[POLL_FD_CHILD_UMBILICAL].fd, buf, sizeof(buf)),
+        (rdlen = recvmsg(
+            self->mPollFds[POLL_FD_CHILD_UMBILICAL].fd,
+            &msg, MSG_CMSG_CLOEXEC),
          -1 == rdlen
          ? EINTR != errno && ECONNRESET != errno
          : (errno = 0, rdlen && sizeof(buf) != rdlen)));
 
+    if (0 < rdlen)
+    {
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+
+        if (cmsg &&
+            SOL_SOCKET == cmsg->cmsg_level &&
+            SCM_RIGHTS == cmsg->cmsg_type &&
+            CMSG_LEN(sizeof(int)) == cmsg->cmsg_len)
+        {
+            memcpy(&passedFd, CMSG_DATA(cmsg), sizeof(passedFd));
+        }
+    }
+
     bool umbilicalClosed = false;
 
     if ( ! rdlen)
@@ -1121,10 +1729,31 @@ pollFdUmbilical_(struct ChildMonitor             *self,
             pollFdCloseUmbilical_(self, aPollTime);
         }
     }
+    else if (TETHER_ATTACH_MESSAGE == buf[0])
+    {
+        /* A client that cannot be attached sees the pipe closed without
+         * receiving any output. */
+
+        if (-1 == passedFd)
+            ert_debug(0, "received umbilical attach without pipe");
+        else if (attachTetherThread(self->mTetherThread, passedFd))
+            ert_warn(errno, "Unable to attach tether");
+        else
+            passedFd = -1;
+    }
+    else if (SENTRY_CONFIG_MESSAGE == buf[0])
+    {
+        if (-1 == passedFd)
+            ert_debug(0, "received umbilical configuration without pipe");
+        else if (reconfigureChildMonitor_(self, passedFd, aPollTime))
+            ert_warn(errno, "Unable to reconfigure sentry");
+    }
     else
     {
         ert_debug(1, "received umbilical connection echo %zd", rdlen);
 
+        markWakeupMeter(&self->mUmbilical.mWakeups);
+
         /* When the echo is received on the umbilical connection
          * schedule the next umbilical ping. The next ping is
          * scheduled immediately if the timer has been preempted. */
@@ -1133,12 +1762,56 @@ pollFdUmbilical_(struct ChildMonitor             *self,
 
         self->mUmbilical.mCycleCount = self->mUmbilical.mCycleLimit;
 
+        /* Record the round trip time of the ping, unless the sentry was
+         * stopped while waiting for the echo, since the stoppage says
+         * nothing about the health of the umbilical connection. */
+
         if ( ! self->mUmbilical.mPreempt)
-            ert_lapTimeRestart(&umbilicalTimer->mSince, aPollTime);
+        {
+            struct Ert_EventClockTime echoTime = ert_eventclockTime();
+
+            markUmbilicalRtt(
+                &self->mUmbilical.mRtt,
+                Ert_Duration(
+                    Ert_NanoSeconds(
+                        echoTime.eventclock.ns -
+                        self->mUmbilical.mPingTime.eventclock.ns)));
+
+            markSentryStatusRtt(
+                self->mStatus,
+                Ert_Duration(Ert_NanoSeconds(self->mUmbilical.mRtt.mMean_ns)),
+                Ert_Duration(Ert_NanoSeconds(self->mUmbilical.mRtt.mMax_ns)));
+        }
+
+        if (self->mUmbilical.mBeat && ! self->mUmbilical.mShared)
+        {
+            /* The first echo shows that the umbilical monitor is
+             * running. If a shared heartbeat is available, stop
+             * pinging and use the heartbeat from here on. The
+             * connection remains open so that the termination of
+             * either process is still detected. */
+
+            ert_debug(0, "umbilical heartbeat shared");
+
+            self->mUmbilical.mShared     = true;
+            self->mUmbilical.mPreempt    = false;
+            self->mUmbilical.mCycleCount = 0;
+
+            umbilicalTimer->mPeriod = self->mUmbilical.mCeiling;
+
+            alignWakeupTimer(
+                umbilicalTimer, self->mUmbilical.mCeiling, aPollTime);
+        }
+        else if ( ! self->mUmbilical.mPreempt)
+            scheduleFdTimerUmbilical_(self, aPollTime);
         else
         {
             self->mUmbilical.mPreempt = false;
 
+            resetFdTimerUmbilical_(self);
+
+            umbilicalTimer->mPeriod = self->mUmbilical.mInterval;
+
             ert_lapTimeTrigger(&umbilicalTimer->mSince,
                                umbilicalTimer->mPeriod, aPollTime);
         }
@@ -1150,6 +1823,10 @@ Ert_Finally:
 
     ERT_FINALLY
     ({
+        if (-1 != passedFd)
+            ERT_ABORT_IF(
+                ert_closeFd(passedFd));
+
         ert_finally_warn_if(rc, self, printChildProcessMonitor);
     });
 
@@ -1177,6 +1854,7 @@ pollFdWriteUmbilical_(struct ChildMonitor *self)
      * an echo to be returned from the umbilical monitor. */
 
     self->mUmbilical.mCycleCount = 0;
+    self->mUmbilical.mPingTime   = ert_eventclockTime();
 
     rc = 0;
 
@@ -1242,7 +1920,12 @@ pollFdContUmbilical_(struct ChildMonitor             *self,
      *
      *  a. The process is just about to receive the echo from the
      *     previous ping
-     *  b. The process has yet to send the next ping */
+     *  b. The process has yet to send the next ping
+     *
+     * In either case, the stoppage casts doubt on the health of the
+     * connection, so restart the back off of the ping interval. */
+
+    resetFdTimerUmbilical_(self);
 
     if (self->mUmbilical.mCycleCount != self->mUmbilical.mCycleLimit)
     {
@@ -1275,53 +1958,127 @@ Ert_Finally:
 }
 
 static ERT_CHECKED int
-pollFdTimerUmbilical_(struct ChildMonitor             *self,
-                      const struct Ert_EventClockTime *aPollTime)
+expireFdTimerUmbilical_(struct ChildMonitor             *self,
+                        const struct Ert_EventClockTime *aPollTime)
 {
     int rc = -1;
 
-    if (self->mUmbilical.mCycleCount != self->mUmbilical.mCycleLimit)
-    {
-        ert_ensure(self->mUmbilical.mCycleCount < self->mUmbilical.mCycleLimit);
+    ert_ensure(self->mUmbilical.mCycleCount < self->mUmbilical.mCycleLimit);
 
-        /* If waiting on a response from the umbilical monitor, apply
-         * a timeout, and if the timeout is exceeded terminate the
-         * child process. */
+    /* When registered with an umbilical daemon, there is no umbilical
+     * child process that can be inspected. */
+
+    struct Ert_ChildProcessState umbilicalState;
 
-        struct Ert_ChildProcessState umbilicalState;
+    if ( ! self->mUmbilical.mPid.mPid)
+        umbilicalState.mChildState = Ert_ChildProcessStateRunning;
+    else
         ERT_ERROR_IF(
             (umbilicalState = ert_monitorProcessChild(self->mUmbilical.mPid),
              Ert_ChildProcessStateError == umbilicalState.mChildState &&
              ECHILD != errno));
 
-        /* Beware that the umbilical process might no longer be active.
-         * If so, do nothing here, and rely on subsequent brokn umbilical
-         * connection to trigger action. */
+    /* Beware that the umbilical process might no longer be active.
+     * If so, do nothing here, and rely on subsequent brokn umbilical
+     * connection to trigger action. */
 
-        if (Ert_ChildProcessStateError != umbilicalState.mChildState)
+    if (Ert_ChildProcessStateError != umbilicalState.mChildState)
+    {
+        if (Ert_ChildProcessStateTrapped == umbilicalState.mChildState ||
+            Ert_ChildProcessStateStopped == umbilicalState.mChildState)
         {
-            if (Ert_ChildProcessStateTrapped == umbilicalState.mChildState ||
-                Ert_ChildProcessStateStopped == umbilicalState.mChildState)
-            {
-                ert_debug(
-                    0,
-                    "deferred timeout umbilical status %"
-                    PRIs_Ert_ChildProcessState,
-                    FMTs_Ert_ChildProcessState(umbilicalState));
+            ert_debug(
+                0,
+                "deferred timeout umbilical status %"
+                PRIs_Ert_ChildProcessState,
+                FMTs_Ert_ChildProcessState(umbilicalState));
 
-                self->mUmbilical.mCycleCount = 0;
-            }
-            else
+            self->mUmbilical.mCycleCount = 0;
+
+            resetFdTimerUmbilical_(self);
+        }
+        else
+        {
+            if (++self->mUmbilical.mCycleCount ==
+                self->mUmbilical.mCycleLimit)
             {
-                if (++self->mUmbilical.mCycleCount ==
-                    self->mUmbilical.mCycleLimit)
-                {
+                if ( ! self->mUmbilical.mSuspicion || self->mUmbilical.mShared)
                     ert_warn(0, "Umbilical connection timed out");
+                else
+                {
+                    unsigned phi = ownUmbilicalRttPhi(
+                        &self->mUmbilical.mRtt,
+                        Ert_Duration(
+                            Ert_NanoSeconds(
+                                aPollTime->eventclock.ns -
+                                self->mUmbilical.mPingTime.eventclock.ns)));
+
+                    ert_warn(
+                        0,
+                        "Umbilical connection timed out with suspicion %u.%02u",
+                        phi / 100, phi % 100);
+                }
+
+                reportUmbilicalRtt(&self->mUmbilical.mRtt, "rtt");
+
+                pollFdCloseUmbilical_(self, aPollTime);
+            }
+        }
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+static ERT_CHECKED int
+pollFdTimerUmbilical_(struct ChildMonitor             *self,
+                      const struct Ert_EventClockTime *aPollTime)
+{
+    int rc = -1;
+
+    struct Ert_PollFdTimerAction *umbilicalTimer =
+        &self->mPollFdTimerActions[POLL_FD_CHILD_TIMER_UMBILICAL];
+
+    /* Only count wakeups that were needed specifically to service
+     * the umbilical connection. */
+
+    if (self->mUmbilical.mPiggyback)
+        self->mUmbilical.mPiggyback = false;
+    else
+        markWakeupMeter(&self->mUmbilical.mWakeups);
+
+    if (self->mUmbilical.mShared)
+    {
+        /* When sharing a heartbeat with the umbilical monitor, show
+         * that the sentry is running, and check that the umbilical
+         * monitor has also made progress since the previous tick. */
+
+        beatUmbilicalBeat(self->mUmbilical.mBeat, UmbilicalBeatSentry);
 
-                    pollFdCloseUmbilical_(self, aPollTime);
-                }
-            }
-        }
+        if (sampleUmbilicalBeat(self->mUmbilical.mBeat,
+                                UmbilicalBeatUmbilical))
+            self->mUmbilical.mCycleCount = 0;
+        else
+            ERT_ERROR_IF(
+                expireFdTimerUmbilical_(self, aPollTime));
+
+        if (umbilicalTimer->mPeriod.duration.ns)
+            alignWakeupTimer(
+                umbilicalTimer, self->mUmbilical.mCeiling, aPollTime);
+    }
+    else if (self->mUmbilical.mCycleCount != self->mUmbilical.mCycleLimit)
+    {
+        /* If waiting on a response from the umbilical monitor, apply
+         * a timeout, and if the timeout is exceeded terminate the
+         * child process. */
+
+        ERT_ERROR_IF(
+            expireFdTimerUmbilical_(self, aPollTime));
     }
     else
     {
@@ -1332,11 +2089,31 @@ pollFdTimerUmbilical_(struct ChildMonitor             *self,
                              EINTR       != errno &&
                              EWOULDBLOCK != errno)));
 
-        if (-1 == wrErr)
+        if (-1 != wrErr)
         {
-            struct Ert_PollFdTimerAction *umbilicalTimer =
-                &self->mPollFdTimerActions[POLL_FD_CHILD_TIMER_UMBILICAL];
+            /* Once the ping is sent, wait for the echo using the full
+             * umbilical timeout, regardless of the current ping
+             * interval. If a suspicion threshold is configured, stop
+             * waiting as soon as the suspicion level computed from the
+             * recent round trip times crosses the threshold, but never
+             * wait longer than the full timeout. */
+
+            struct Ert_Duration deadline = ownUmbilicalRttDeadline(
+                &self->mUmbilical.mRtt,
+                self->mUmbilical.mSuspicion,
+                Ert_Duration(
+                    Ert_NanoSeconds(
+                        self->mUmbilical.mCeiling.duration.ns *
+                        self->mUmbilical.mCycleLimit)));
 
+            umbilicalTimer->mPeriod = Ert_Duration(
+                Ert_NanoSeconds(
+                    deadline.duration.ns / self->mUmbilical.mCycleLimit));
+
+            ert_lapTimeRestart(&umbilicalTimer->mSince, aPollTime);
+        }
+        else
+        {
             switch (errno)
             {
             default:
@@ -1489,6 +2266,19 @@ restartFdTimerTether_(struct ChildMonitor             *self,
 
         ert_lapTimeRestart(&tetherTimer->mSince, aPollTime);
     }
+
+    /* Similarly, a stoppage should not be mistaken for a stalled
+     * heartbeat. */
+
+    struct Ert_PollFdTimerAction *heartbeatTimer =
+        &self->mPollFdTimerActions[POLL_FD_CHILD_TIMER_HEARTBEAT];
+
+    if (heartbeatTimer->mPeriod.duration.ns)
+    {
+        restartHeartbeat(self->mHeartbeat.mHeartbeat);
+
+        ert_lapTimeRestart(&heartbeatTimer->mSince, aPollTime);
+    }
 }
 
 static ERT_CHECKED int
@@ -1497,6 +2287,8 @@ pollFdTimerTether_(struct ChildMonitor             *self,
 {
     int rc = -1;
 
+    piggybackFdTimerUmbilical_(self, aPollTime);
+
     /* The tether timer is only active if there is a tether and it was
      * configured with a timeout. The timeout expires if there was
      * no activity on the tether with the consequence that the monitored
@@ -1507,6 +2299,15 @@ pollFdTimerTether_(struct ChildMonitor             *self,
         struct Ert_PollFdTimerAction *tetherTimer =
             &self->mPollFdTimerActions[POLL_FD_CHILD_TIMER_TETHER];
 
+        /* A reconfigured timeout is applied when the timer expires,
+         * restarting the timeout with the new period. */
+
+        if (self->mTether.mReconfigured)
+        {
+            rearmFdTimerTether_(self, aPollTime);
+            break;
+        }
+
         struct Ert_ChildProcessState childState;
 
         ERT_ERROR_IF(
@@ -1547,6 +2348,13 @@ pollFdTimerTether_(struct ChildMonitor             *self,
                     lock = ert_unlockMutex(lock);
                 }
 
+                /* Keepalives received on the notification socket
+                 * also count as activity on the tether. */
+
+                if (since.eventclock.ns <
+                        self->mNotify.mWatchdog.eventclock.ns)
+                    since = self->mNotify.mWatchdog;
+
                 if (aPollTime->eventclock.ns <
                     since.eventclock.ns + tetherTimer->mPeriod.duration.ns)
                 {
@@ -1584,6 +2392,245 @@ Ert_Finally:
     return rc;
 }
 
+/* -------------------------------------------------------------------------- */
+/* Notification Socket
+ *
+ * The child process can use the sd_notify(3) protocol to indicate when
+ * it is ready, to provide keepalives in place of activity on the tether,
+ * and to indicate that it has started to shut down. */
+
+static ERT_CHECKED int
+pollFdNotify_(struct ChildMonitor             *self,
+              const struct Ert_EventClockTime *aPollTime)
+{
+    int rc = -1;
+
+    int events;
+    ERT_ERROR_IF(
+        (events = receiveNotifySocket(
+            self->mNotify.mSocket, self->mNotify.mPgid),
+         -1 == events));
+
+    if (events & NotifySocketWatchdog)
+    {
+        ert_debug(1, "received watchdog keepalive");
+
+        self->mNotify.mWatchdog = *aPollTime;
+    }
+
+    /* Ignore a readiness indication that arrives after the child
+     * process has terminated, perhaps from another member of the
+     * process group, to avoid publishing a pid that is already dead. */
+
+    if ((events & NotifySocketReady) &&
+        ! self->mNotify.mReady && ! self->mEvent.mChildLatchDisabled)
+    {
+        ert_debug(
+            0,
+            "child pid %" PRId_Ert_Pid " is ready",
+            FMTd_Ert_Pid(self->mChildPid));
+
+        self->mNotify.mReady = true;
+
+        ERT_ERROR_IF(
+            callChildProcessReadyMethod(
+                self->mNotify.mReadyMethod, self->mChildProcess));
+    }
+
+    /* Once the child process has started to shut down, it is no longer
+     * expected to show activity on the tether. Start draining the
+     * tether now so that the drain timeout runs concurrently with
+     * the shutdown of the child rather than after it. */
+
+    if ((events & NotifySocketStopping) && ! self->mNotify.mStopping)
+    {
+        ert_debug(
+            0,
+            "child pid %" PRId_Ert_Pid " is stopping",
+            FMTd_Ert_Pid(self->mChildPid));
+
+        self->mNotify.mStopping = true;
+
+        self->mPollFdTimerActions[
+            POLL_FD_CHILD_TIMER_TETHER].mPeriod = Ert_ZeroDuration;
+
+        if ( ! self->mTetherThread->mFlushed)
+            ERT_ERROR_IF(
+                flushTetherThread(
+                    self->mTetherThread, TetherThreadFlushStopping));
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        ert_finally_warn_if(rc, self, printChildProcessMonitor);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+/* Heartbeat Region
+ *
+ * The child process can demonstrate progress by incrementing counters
+ * in a memory region shared with the watchdog, rather than by writing
+ * to the tether. Sample the counters, and terminate the child if any
+ * counter in use stops advancing. */
+
+static ERT_CHECKED int
+pollFdTimerHeartbeat_(struct ChildMonitor             *self,
+                      const struct Ert_EventClockTime *aPollTime)
+{
+    int rc = -1;
+
+    piggybackFdTimerUmbilical_(self, aPollTime);
+
+    struct Ert_PollFdTimerAction *heartbeatTimer =
+        &self->mPollFdTimerActions[POLL_FD_CHILD_TIMER_HEARTBEAT];
+
+    do
+    {
+        struct Ert_ChildProcessState childState;
+
+        ERT_ERROR_IF(
+            (childState = ert_monitorProcessChild(self->mChildPid),
+             Ert_ChildProcessStateError == childState.mChildState &&
+             ECHILD != errno));
+
+        /* Once the child process has terminated, there are no more
+         * heartbeats to monitor. If the child process is stopped, defer
+         * the timeout until it continues. */
+
+        if (Ert_ChildProcessStateError == childState.mChildState ||
+            self->mEvent.mChildLatchDisabled)
+        {
+            heartbeatTimer->mPeriod = Ert_ZeroDuration;
+            break;
+        }
+
+        if (Ert_ChildProcessStateTrapped == childState.mChildState ||
+            Ert_ChildProcessStateStopped == childState.mChildState)
+        {
+            ert_debug(
+                0,
+                "deferred heartbeat child status %"
+                PRIs_Ert_ChildProcessState,
+                FMTs_Ert_ChildProcessState(childState));
+
+            restartHeartbeat(self->mHeartbeat.mHeartbeat);
+            break;
+        }
+
+        int stalled;
+        ERT_ERROR_IF(
+            (stalled = sampleHeartbeat(
+                self->mHeartbeat.mHeartbeat, self->mHeartbeat.mCycleLimit),
+             -1 == stalled));
+
+        if (stalled)
+        {
+            ert_debug(
+                0,
+                "heartbeat timeout after %ds",
+                gOptions.mServer.mHeartbeat.mTimeout_s);
+
+            heartbeatTimer->mPeriod = Ert_ZeroDuration;
+
+            activateFdTimerTermination_(
+                self, ChildTermination_Abort, aPollTime);
+        }
+
+    } while (0);
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        ert_finally_warn_if(rc, self, printChildProcessMonitor);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+/* Thread Hang Detector
+ *
+ * Activity on the tether only shows that some thread in the child is
+ * making progress. Optionally scan the threads of the child process group
+ * to find any thread that remains in uninterruptible sleep (or other
+ * configured state) for longer than the configured threshold. */
+
+static ERT_CHECKED int
+pollFdTimerHang_(struct ChildMonitor             *self,
+                 const struct Ert_EventClockTime *aPollTime)
+{
+    int rc = -1;
+
+    piggybackFdTimerUmbilical_(self, aPollTime);
+
+    struct Ert_PollFdTimerAction *hangTimer =
+        &self->mPollFdTimerActions[POLL_FD_CHILD_TIMER_HANG];
+
+    do
+    {
+        /* Once the child process has terminated, there is nothing
+         * further to scan. */
+
+        if (self->mEvent.mChildLatchDisabled)
+        {
+            hangTimer->mPeriod = Ert_ZeroDuration;
+            break;
+        }
+
+        int stalled;
+        ERT_ERROR_IF(
+            (stalled = runTaskScan(self->mHang.mScan, aPollTime),
+             -1 == stalled));
+
+        if ( ! stalled)
+            break;
+
+        switch (gOptions.mServer.mHang.mAction)
+        {
+        default:
+            ert_ensure(false);
+            break;
+
+        case HangActionWarn:
+            break;
+
+        case HangActionTerminate:
+            hangTimer->mPeriod = Ert_ZeroDuration;
+            activateFdTimerTermination_(
+                self, ChildTermination_Terminate, aPollTime);
+            break;
+
+        case HangActionAbort:
+            hangTimer->mPeriod = Ert_ZeroDuration;
+            activateFdTimerTermination_(
+                self, ChildTermination_Abort, aPollTime);
+            break;
+        }
+
+    } while (0);
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        ert_finally_warn_if(rc, self, printChildProcessMonitor);
+    });
+
+    return rc;
+}
+
 /* -------------------------------------------------------------------------- */
 static bool
 pollFdCompletion_(struct ChildMonitor *self)
@@ -1637,21 +2684,19 @@ pollFdReapChildEvent_(struct ChildMonitor             *self,
 
         self->mEvent.mChildLatchDisabled = true;
 
+        advanceFdTimerTermination_(self, aPollTime);
+
+        setSentryStatusState(
+            self->mStatus, SentryStatusExited, self->mTermination.mSteps);
+
         /* Record when the child has terminated, but do not exit
          * the event loop until all the IO has been flushed. With the
          * child terminated, no further input can be produced so indicate
          * to the tether thread that it should start flushing data now. */
 
         ERT_ERROR_IF(
-            flushTetherThread(self->mTetherThread));
-
-        /* Once the child process has terminated, start the disconnection
-         * timer that sends a periodic signal to the tether thread
-         * to ensure that it will not block. */
-
-        self->mPollFdTimerActions[
-            POLL_FD_CHILD_TIMER_DISCONNECTION].mPeriod = Ert_Duration(
-                ERT_NSECS(Ert_Seconds(1)));
+            flushTetherThread(
+                self->mTetherThread, TetherThreadFlushTerminated));
     }
 
     rc = 0;
@@ -1663,30 +2708,6 @@ Ert_Finally:
     return rc;
 }
 
-static ERT_CHECKED int
-pollFdTimerChild_(struct ChildMonitor             *self,
-                  const struct Ert_EventClockTime *aPollTime)
-{
-    int rc = -1;
-
-    ert_debug(0, "disconnecting tether thread");
-
-    ERT_ERROR_IF(
-        pingTetherThread(self->mTetherThread));
-
-    rc = 0;
-
-Ert_Finally:
-
-    ERT_FINALLY
-    ({
-        ert_finally_warn_if(rc, self, printChildProcessMonitor);
-    });
-
-    return rc;
-
-}
-
 /* -------------------------------------------------------------------------- */
 /* Event Pipe
  *
@@ -1773,11 +2794,12 @@ Ert_Finally:
 
 /* -------------------------------------------------------------------------- */
 int
-monitorChildProcess(struct ChildProcess     *self,
-                    struct UmbilicalProcess *aUmbilicalProcess,
-                    struct Ert_File         *aUmbilicalFile,
-                    struct Ert_Pid           aParentPid,
-                    struct Ert_Pipe         *aParentPipe)
+monitorChildProcess(struct ChildProcess           *self,
+                    struct UmbilicalProcess       *aUmbilicalProcess,
+                    struct Ert_File               *aUmbilicalFile,
+                    struct Ert_Pid                 aParentPid,
+                    struct Ert_Pipe               *aParentPipe,
+                    struct ChildProcessReadyMethod aReadyMethod)
 {
     int rc = -1;
 
@@ -1795,6 +2817,9 @@ monitorChildProcess(struct ChildProcess     *self,
     struct Ert_EventPipe  eventPipe_;
     struct Ert_EventPipe *eventPipe = 0;
 
+    struct TaskScan  taskScan_;
+    struct TaskScan *taskScan = 0;
+
     struct Ert_PollFd  pollfd_;
     struct Ert_PollFd *pollfd = 0;
 
@@ -1804,18 +2829,19 @@ monitorChildProcess(struct ChildProcess     *self,
         ert_createPipe(&nullPipe_, O_CLOEXEC | O_NONBLOCK));
     nullPipe = &nullPipe_;
 
-    /* Create a thread to use a blocking copy to transfer data from a
-     * local pipe to stdout. This is primarily because SPLICE_F_NONBLOCK
-     * cannot guarantee that the operation is non-blocking unless both
-     * source and destination file descriptors are also themselves non-blocking.
+    /* Create a thread to transfer data from a local pipe to stdout.
+     * This is primarily because SPLICE_F_NONBLOCK cannot guarantee that
+     * the operation is non-blocking unless both source and destination
+     * file descriptors are also themselves non-blocking.
      *
-     * The child thread is used to perform a potentially blocking
-     * transfer between an intermediate pipe and stdout, while
-     * the main monitoring thread deals exclusively with non-blocking
-     * file descriptors. */
+     * The child thread is used to perform the transfer between an
+     * intermediate pipe and stdout, waiting for stdout to become ready
+     * rather than blocking, while the main monitoring thread deals
+     * exclusively with non-blocking file descriptors. */
 
     ERT_ERROR_IF(
-        createTetherThread(&tetherThread_, nullPipe));
+        createTetherThread(
+            &tetherThread_, nullPipe, aUmbilicalProcess->mStatus));
     tetherThread = &tetherThread_;
 
     ERT_ERROR_IF(
@@ -1826,18 +2852,74 @@ monitorChildProcess(struct ChildProcess     *self,
         ert_createEventLatch(&contLatch_, "continue"));
     contLatch = &contLatch_;
 
+    /* The scan of the threads of the child process group is used both
+     * to detect hung threads, and to find the descendants of the child
+     * process when a signal plan targets the process tree. Only sample
+     * the scheduler state of the threads if hang detection is enabled. */
+
+    bool scanTree = false;
+
+    const struct SignalPlan *signalPlans[] =
+    {
+        &gOptions.mServer.mSignalPlan.mTerminate,
+        &gOptions.mServer.mSignalPlan.mAbort,
+    };
+
+    for (unsigned px = 0; ERT_NUMBEROF(signalPlans) > px; ++px)
+    {
+        for (const struct SignalPlanStep *step = signalPlans[px]->mStep;
+             step->mSig;
+             ++step)
+        {
+            if (SignalTargetTree == step->mTarget)
+                scanTree = true;
+        }
+    }
+
+    if (gOptions.mServer.mHang.mTimeout_s || scanTree)
+    {
+        ERT_ERROR_IF(
+            createTaskScan(
+                &taskScan_,
+                self->mPid,
+                self->mPgid,
+                gOptions.mServer.mHang.mTimeout_s
+                    ? gOptions.mServer.mHang.mStates : "",
+                Ert_Duration(
+                    ERT_NSECS(
+                        Ert_Seconds(gOptions.mServer.mHang.mTimeout_s)))));
+        taskScan = &taskScan_;
+    }
+
     /* Divide the timeout into two cycles so that if the child process is
      * stopped, the first cycle will have a chance to detect it and
      * defer the timeout. */
 
     const unsigned timeoutCycles = 2;
 
+    /* The umbilical ping interval backs off towards the ceiling of one
+     * timeout cycle. Allow the kernel some slack to coalesce the resulting
+     * wakeups. The slack is only applied after the child and the tether
+     * thread have been created so that neither inherits it. */
+
+    const struct Ert_Duration umbilicalPeriod = Ert_Duration(
+        Ert_NanoSeconds(
+            ERT_NSECS(
+                Ert_Seconds(
+                    gOptions.mServer.mTimeout.mUmbilical_s)).ns
+            / timeoutCycles));
+
+    ERT_ERROR_IF(
+        setWakeupSlack(umbilicalPeriod));
+
     struct ChildMonitor childMonitor_ =
     {
         .mChildPid     = self->mPid,
+        .mChildProcess = self,
         .mTetherThread = tetherThread,
         .mEventPipe    = eventPipe,
         .mContLatch    = contLatch,
+        .mStatus       = aUmbilicalProcess->mStatus,
 
         .mParent =
         {
@@ -1845,6 +2927,27 @@ monitorChildProcess(struct ChildProcess     *self,
             .mPipe = aParentPipe,
         },
 
+        .mHang =
+        {
+            .mScan = taskScan,
+        },
+
+        .mHeartbeat =
+        {
+            .mHeartbeat  = self->mHeartbeat,
+            .mCycleLimit = timeoutCycles,
+        },
+
+        .mNotify =
+        {
+            .mSocket      = self->mNotifySocket,
+            .mPgid        = self->mPgid,
+            .mReadyMethod = aReadyMethod,
+            .mReady       = false,
+            .mStopping    = false,
+            .mWatchdog    = ERT_EVENTCLOCKTIME_INIT,
+        },
+
         .mEvent =
         {
             .mChildLatchDisabled     = false,
@@ -1854,37 +2957,17 @@ monitorChildProcess(struct ChildProcess     *self,
         .mTermination =
         {
             .mSignalPlan   = 0,
+            .mPgid         = self->mPgid,
+            .mSteps        = 0,
             .mSignalPeriod = Ert_Duration(
                 ERT_NSECS(Ert_Seconds(gOptions.mServer.mTimeout.mSignal_s))),
             .mSignalPlans  =
             {
-                /* When terminating the child process, first request that
-                 * the child terminate by sending it SIGTERM or other, and
-                 * if the child does not terminate, resort to sending SIGKILL.
-                 *
-                 * Do not kill the child process group here since that would
-                 * also terminate the umbilical process prematurely. Rely on
-                 * the umbilical process to clean up the process group. */
-
-                [ChildTermination_Terminate] = (struct ChildSignalPlan[])
-                {
-                    { self->mPid, SIGTERM },
-                    { self->mPid, SIGKILL },
-                    { Ert_Pid(0) }
-                },
-
-                /* Choose to send SIGABRT in the case that the tether
-                 * connection has been inactive past the timeout period.
-                 * The implication here is that the child might be
-                 * stuck and unable to produce output, so a core file
-                 * might be useful to diagnose the situation. */
-
-                [ChildTermination_Abort] = (struct ChildSignalPlan[])
-                {
-                    { self->mPid, SIGABRT },
-                    { self->mPid, SIGKILL },
-                    { Ert_Pid(0) }
-                },
+                [ChildTermination_Terminate] =
+                    gOptions.mServer.mSignalPlan.mTerminate.mStep,
+
+                [ChildTermination_Abort] =
+                    gOptions.mServer.mSignalPlan.mAbort.mStep,
             },
         },
 
@@ -1893,14 +2976,21 @@ monitorChildProcess(struct ChildProcess     *self,
             .mFile       = aUmbilicalFile,
             .mPid        = aUmbilicalProcess->mPid,
             .mPreempt    = false,
+            .mPiggyback  = false,
+            .mShared     = false,
             .mCycleCount = timeoutCycles,
             .mCycleLimit = timeoutCycles,
+            .mCeiling    = umbilicalPeriod,
+            .mBeat       = aUmbilicalProcess->mBeat,
+            .mSuspicion  = gOptions.mServer.mSuspicion,
+            .mPingTime   = ERT_EVENTCLOCKTIME_INIT,
         },
 
         .mTether =
         {
-            .mCycleCount = 0,
-            .mCycleLimit = timeoutCycles,
+            .mCycleCount   = 0,
+            .mCycleLimit   = timeoutCycles,
+            .mReconfigured = false,
         },
 
         /* Experiments at http://www.greenend.org.uk/rjk/tech/poll.html show
@@ -1938,6 +3028,13 @@ monitorChildProcess(struct ChildProcess     *self,
                 .fd     = tetherThread->mControlPipe->mWrFile->mFd,
                 .events = ERT_POLL_DISCONNECTEVENT,
             },
+
+            [POLL_FD_CHILD_NOTIFY] =
+            {
+                .fd     = (self->mNotifySocket
+                           ? self->mNotifySocket->mFile->mFd : -1),
+                .events = self->mNotifySocket ? ERT_POLL_INPUTEVENTS : 0,
+            },
         },
 
         .mPollFdActions =
@@ -1950,6 +3047,8 @@ monitorChildProcess(struct ChildProcess     *self,
                 Ert_PollFdCallbackMethod(&childMonitor_, pollFdEventPipe_) },
             [POLL_FD_CHILD_TETHER]     = {
                 Ert_PollFdCallbackMethod(&childMonitor_, pollFdTether_) },
+            [POLL_FD_CHILD_NOTIFY]     = {
+                Ert_PollFdCallbackMethod(&childMonitor_, pollFdNotify_) },
         },
 
         .mPollFdTimerActions =
@@ -1975,11 +3074,7 @@ monitorChildProcess(struct ChildProcess     *self,
                 .mAction = Ert_PollFdCallbackMethod(
                     &childMonitor_, pollFdTimerUmbilical_),
                 .mSince  = ERT_EVENTCLOCKTIME_INIT,
-                .mPeriod = Ert_Duration(
-                    Ert_NanoSeconds(
-                      ERT_NSECS(
-                        Ert_Seconds(
-                          gOptions.mServer.mTimeout.mUmbilical_s)).ns / 2)),
+                .mPeriod = umbilicalPeriod,
             },
 
             [POLL_FD_CHILD_TIMER_TERMINATION] =
@@ -1990,12 +3085,36 @@ monitorChildProcess(struct ChildProcess     *self,
                 .mPeriod = Ert_ZeroDuration,
             },
 
-            [POLL_FD_CHILD_TIMER_DISCONNECTION] =
+            [POLL_FD_CHILD_TIMER_HANG] =
             {
+                /* Sample the threads twice per threshold period so
+                 * that a stuck thread is detected within one and a
+                 * half times the threshold of entering the flagged
+                 * state. */
+
                 .mAction = Ert_PollFdCallbackMethod(
-                    &childMonitor_, pollFdTimerChild_),
+                    &childMonitor_, pollFdTimerHang_),
                 .mSince  = ERT_EVENTCLOCKTIME_INIT,
-                .mPeriod = Ert_ZeroDuration,
+                .mPeriod = Ert_Duration(Ert_NanoSeconds(
+                    ERT_NSECS(Ert_Seconds(taskScan
+                                  ? gOptions.mServer.mHang.mTimeout_s
+                                  : 0)).ns / timeoutCycles)),
+            },
+
+            [POLL_FD_CHILD_TIMER_HEARTBEAT] =
+            {
+                /* A counter must advance at least once in every
+                 * timeout period, but it is only checked at each
+                 * cycle, so a stalled counter is detected within
+                 * one and a half times the timeout. */
+
+                .mAction = Ert_PollFdCallbackMethod(
+                    &childMonitor_, pollFdTimerHeartbeat_),
+                .mSince  = ERT_EVENTCLOCKTIME_INIT,
+                .mPeriod = Ert_Duration(Ert_NanoSeconds(
+                    ERT_NSECS(Ert_Seconds(self->mHeartbeat
+                                  ? gOptions.mServer.mHeartbeat.mTimeout_s
+                                  : 0)).ns / timeoutCycles)),
             },
         },
     };
@@ -2065,9 +3184,18 @@ monitorChildProcess(struct ChildProcess     *self,
 
     updateChildProcessMonitor_(self, childMonitor);
 
+    resetFdTimerUmbilical_(childMonitor);
+    startWakeupMeter(&childMonitor->mUmbilical.mWakeups, "umbilical");
+    startUmbilicalRtt(&childMonitor->mUmbilical.mRtt);
+
+    setSentryStatusState(childMonitor->mStatus, SentryStatusRunning, 0);
+
     ERT_ERROR_IF(
         ert_runPollFdLoop(pollfd));
 
+    reportWakeupMeter(&childMonitor->mUmbilical.mWakeups);
+    reportUmbilicalRtt(&childMonitor->mUmbilical.mRtt, "rtt");
+
     rc = 0;
 
 Ert_Finally:
@@ -2088,6 +3216,7 @@ Ert_Finally:
             Ert_EventLatchSettingError == ert_unbindEventLatchPipe(
                 self->mLatch.mChild));
 
+        taskScan  = closeTaskScan(taskScan);
         contLatch = ert_closeEventLatch(contLatch);
         eventPipe = ert_closeEventPipe(eventPipe);
 
@@ -30,6 +30,8 @@
 #define CHILD_H
 
 #include "shellcommand.h"
+#include "heartbeat.h"
+#include "notifysocket.h"
 
 #include "ert/compiler.h"
 #include "ert/pid.h"
@@ -40,8 +42,39 @@
 #include <stdio.h>
 #include <sys/types.h>
 
+/* -------------------------------------------------------------------------- */
+ERT_BEGIN_C_SCOPE;
+struct ChildProcess;
+ERT_END_C_SCOPE;
+
+#define ERT_METHOD_DEFINITION
+#define METHOD_RETURN_ChildProcessReadyMethod    int
+#define METHOD_CONST_ChildProcessReadyMethod
+#define METHOD_ARG_LIST_ChildProcessReadyMethod  \
+    (struct ChildProcess *aChildProcess_)
+#define METHOD_CALL_LIST_ChildProcessReadyMethod \
+    (aChildProcess_)
+
+#define ERT_METHOD_NAME      ChildProcessReadyMethod
+#define ERT_METHOD_RETURN    METHOD_RETURN_ChildProcessReadyMethod
+#define ERT_METHOD_CONST     METHOD_CONST_ChildProcessReadyMethod
+#define ERT_METHOD_ARG_LIST  METHOD_ARG_LIST_ChildProcessReadyMethod
+#define ERT_METHOD_CALL_LIST METHOD_CALL_LIST_ChildProcessReadyMethod
+#include "ert/method.h"
+
+#define ChildProcessReadyMethod(Object_, Method_)       \
+    ERT_METHOD_TRAMPOLINE(                              \
+        Object_, Method_,                               \
+        ChildProcessReadyMethod_,                       \
+        METHOD_RETURN_ChildProcessReadyMethod,          \
+        METHOD_CONST_ChildProcessReadyMethod,           \
+        METHOD_ARG_LIST_ChildProcessReadyMethod,        \
+        METHOD_CALL_LIST_ChildProcessReadyMethod)
+
+/* -------------------------------------------------------------------------- */
 ERT_BEGIN_C_SCOPE;
 
+struct Ert_ExitCode;
 struct Ert_SocketPair;
 struct Ert_BellSocketPair;
 
@@ -68,6 +101,12 @@ struct ChildProcess
     struct Ert_Pipe  mTetherPipe_;
     struct Ert_Pipe *mTetherPipe;
 
+    struct Heartbeat  mHeartbeat_;
+    struct Heartbeat *mHeartbeat;
+
+    struct NotifySocket  mNotifySocket_;
+    struct NotifySocket *mNotifySocket;
+
     struct
     {
         struct Ert_ThreadSigMutex  mMutex_;
@@ -100,15 +139,19 @@ ERT_CHECKED int
 closeChildProcessTether(struct ChildProcess *self);
 
 ERT_CHECKED int
-monitorChildProcess(struct ChildProcess     *self,
-                    struct UmbilicalProcess *aUmbilicalProcess,
-                    struct Ert_File         *aUmbilicalFile,
-                    struct Ert_Pid           aParentPid,
-                    struct Ert_Pipe         *aParentPipe);
+monitorChildProcess(struct ChildProcess           *self,
+                    struct UmbilicalProcess       *aUmbilicalProcess,
+                    struct Ert_File               *aUmbilicalFile,
+                    struct Ert_Pid                 aParentPid,
+                    struct Ert_Pipe               *aParentPipe,
+                    struct ChildProcessReadyMethod aReadyMethod);
 
 ERT_CHECKED int
 raiseChildProcessSigCont(struct ChildProcess *self);
 
+ERT_CHECKED int
+peekChildProcess(struct ChildProcess *self, struct Ert_ExitCode *aExitCode);
+
 ERT_CHECKED int
 reapChildProcess(struct ChildProcess *self, int *aStatus);
 
@@ -30,52 +30,102 @@
 #include "command.h"
 #include "shellcommand.h"
 
+#include "pidcache_.h"
 #include "pidfile_.h"
 #include "pidsignature_.h"
+#include "sentrystatus.h"
 #include "options_.h"
 
 #include "ert/env.h"
 #include "ert/process.h"
 #include "ert/fdset.h"
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
 #include <fcntl.h>
+#include <limits.h>
 
 #include <sys/un.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
 
 /* -------------------------------------------------------------------------- */
 struct Command *
 closeCommand(struct Command *self)
 {
     if (self)
+    {
         self->mKeeperTether = ert_closeUnixSocket(self->mKeeperTether);
+        self->mPidFdFile    = ert_closeFile(self->mPidFdFile);
+        self->mPidSignature = destroyPidSignature(self->mPidSignature);
+        self->mPidFile      = destroyPidFile(self->mPidFile);
+    }
 
     return 0;
 }
 
 /* -------------------------------------------------------------------------- */
-enum CommandStatus
-createCommand(struct Command *self,
-              const char     *aPidFileName)
+static void
+initCommand_(struct Command *self)
 {
-    int rc = -1;
-
-    enum CommandStatus status = CommandStatusOk;
-
     self->mPid          = Ert_Pid(0);
     self->mChildPid     = Ert_Pid(0);
     self->mKeeperTether = 0;
+    self->mPidFdFile    = 0;
+    self->mHandshake    = CommandHandshakeDone;
+    self->mPidSignature = 0;
+    self->mPidFile      = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+connectCommand_(struct Command *self)
+{
+    int rc = -1;
+
+    /* The connection is not waited upon here, so that a caller can
+     * complete the handshakes for many pid files concurrently. */
+
+    struct sockaddr_un *pidKeeperAddr = &self->mPidServerAddr;
+
+    int err;
+    ERT_ERROR_IF(
+        (err = ert_connectUnixSocket(&self->mKeeperTether_,
+                                     pidKeeperAddr->sun_path,
+                                     sizeof(pidKeeperAddr->sun_path)),
+         -1 == err && EINPROGRESS != errno));
+    self->mKeeperTether = &self->mKeeperTether_;
+
+    self->mHandshake = CommandHandshakeSend;
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
 
-    struct PidSignature *pidSignature = 0;
+/* -------------------------------------------------------------------------- */
+enum CommandStatus
+openCommand(struct Command *self,
+            const char     *aPidFileName)
+{
+    int rc = -1;
+
+    enum CommandStatus status = CommandStatusOk;
 
-    struct PidFile  pidFile_;
-    struct PidFile *pidFile = 0;
+    initCommand_(self);
 
     do
     {
         enum Ert_PathNameStatus pathNameStatus;
         ERT_ERROR_IF(
-            (pathNameStatus = initPidFile(&pidFile_, aPidFileName),
+            (pathNameStatus = initPidFile(&self->mPidFile_, aPidFileName),
              Ert_PathNameStatusError == pathNameStatus));
 
         if (Ert_PathNameStatusOk != pathNameStatus)
@@ -83,11 +133,11 @@ createCommand(struct Command *self,
             status = CommandStatusUnreachablePidFile;
             break;
         }
-        pidFile = &pidFile_;
+        self->mPidFile = &self->mPidFile_;
 
         struct Ert_Pid pid;
         ERT_ERROR_IF(
-            (pid = openPidFile(pidFile, O_CLOEXEC),
+            (pid = openPidFile(self->mPidFile, O_CLOEXEC),
              pid.mPid && ENOENT != errno && EACCES != errno));
 
         if (pid.mPid)
@@ -109,19 +159,19 @@ createCommand(struct Command *self,
         }
 
         ERT_ERROR_IF(
-            acquirePidFileReadLock(pidFile));
+            acquirePidFileReadLock(self->mPidFile));
 
-        struct sockaddr_un pidKeeperAddr;
         ERT_ERROR_UNLESS(
-            pidSignature = readPidFile(pidFile, &pidKeeperAddr));
+            self->mPidSignature = readPidFile(
+                self->mPidFile, &self->mPidServerAddr));
 
-        if ( ! pidSignature->mPid.mPid)
+        if ( ! self->mPidSignature->mPid.mPid)
         {
             status = CommandStatusZombiePidFile;
             break;
         }
 
-        if (-1 == pidSignature->mPid.mPid)
+        if (-1 == self->mPidSignature->mPid.mPid)
         {
             status = CommandStatusMalformedPidFile;
             break;
@@ -130,7 +180,8 @@ createCommand(struct Command *self,
         /* If the pid file can be read and an authentic pid extracted,
          * that pid will remain viable because the sentry will not
          * reap the child process unless it can acquire a lock on
-         * the same pid file.
+         * the same pid file. The lock is held until the handshake
+         * completes.
          *
          * Obtain a reference to the child process group, and do not proceed
          * until a positive acknowledgement is received to indicate that
@@ -141,52 +192,252 @@ createCommand(struct Command *self,
          * allows for a race where the pid server is replaced by another
          * program servicing the same connection address. */
 
-        int err;
         ERT_ERROR_IF(
-            (err = ert_connectUnixSocket(&self->mKeeperTether_,
-                                         pidKeeperAddr.sun_path,
-                                         sizeof(pidKeeperAddr.sun_path)),
-             -1 == err && EINPROGRESS != errno));
-        self->mKeeperTether = &self->mKeeperTether_;
+            connectCommand_(self));
 
-        ERT_ERROR_IF(
-            (err = ert_waitUnixSocketWriteReady(self->mKeeperTether, 0),
-             -1 == err || (errno = 0, ! err)));
+    } while (0);
+
+    /* Run the command if the child process is running, or if
+     * the force to run the command regardless of the state of the
+     * child process. */
+
+    if (CommandStatusNonexistentPidFile == status ||
+        CommandStatusZombiePidFile      == status)
+    {
+        if (gOptions.mClient.mRelaxed)
+            status = CommandStatusOk;
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (rc)
+            status = CommandStatusError;
+
+        if (CommandStatusOk != status ||
+            CommandHandshakeDone == self->mHandshake)
+        {
+            self->mHandshake = CommandHandshakeDone;
+            self = closeCommand(self);
+        }
+    });
+
+    return status;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+receiveCommandMessage_(struct Command *self, char *aMessage, int *aFd)
+{
+    int rc = -1;
+
+    /* Messages from the pid server are a single byte, optionally
+     * carrying a file descriptor. */
+
+    char buf[1];
+
+    struct iovec iov =
+    {
+        .iov_base = buf,
+        .iov_len  = sizeof(buf),
+    };
+
+    union
+    {
+        struct cmsghdr mHeader;
+        char           mBuf[CMSG_SPACE(sizeof(int))];
+    } control;
+
+    struct msghdr msg =
+    {
+        .msg_iov        = &iov,
+        .msg_iovlen     = 1,
+        .msg_control    = control.mBuf,
+        .msg_controllen = sizeof(control.mBuf),
+    };
+
+    ssize_t rdBytes;
+
+    do
+        rdBytes = recvmsg(
+            self->mKeeperTether->mSocket->mFile->mFd, &msg, MSG_CMSG_CLOEXEC);
+    while (-1 == rdBytes && EINTR == errno);
+
+    ERT_ERROR_IF(
+        -1 == rdBytes || (errno = 0, 1 != rdBytes));
+
+    *aMessage = buf[0];
+    *aFd      = -1;
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
 
-        /* In case a connection race occurs, send the pid signature
-         * to allow the pid server to verify that it is serving a valid
-         * client. */
+    if (cmsg &&
+        SOL_SOCKET == cmsg->cmsg_level &&
+        SCM_RIGHTS == cmsg->cmsg_type &&
+        CMSG_LEN(sizeof(int)) == cmsg->cmsg_len)
+    {
+        memcpy(aFd, CMSG_DATA(cmsg), sizeof(*aFd));
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+receiveCommandAcknowledgement_(struct Command *self)
+{
+    int rc = -1;
+
+    /* The acknowledgement optionally carries a pidfd for the child
+     * process. Collect the pidfd so that it can be provided to the
+     * command. */
+
+    char ack;
+    int  pidFd;
 
+    ERT_ERROR_IF(
+        receiveCommandMessage_(self, &ack, &pidFd));
+
+    if (-1 != pidFd)
+    {
         ERT_ERROR_IF(
-            sendPidSignature(
-                self->mKeeperTether->mSocket->mFile, pidSignature, 0));
+            ert_createFile(&self->mPidFdFile_, pidFd),
+            {
+                close(pidFd);
+            });
+        self->mPidFdFile = &self->mPidFdFile_;
+    }
+
+    rc = 0;
 
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+handshakeCommand(struct Command *self)
+{
+    int rc = -1;
+
+    /* Take the next step of the handshake without blocking, leaving
+     * the handshake unchanged if the keeper tether is not yet ready. */
+
+    int err;
+
+    switch (self->mHandshake)
+    {
+    default:
+        ert_ensure(false);
+
+    case CommandHandshakeDone:
+        break;
+
+    case CommandHandshakeSend:
         ERT_ERROR_IF(
-            (err = ert_waitUnixSocketReadReady(self->mKeeperTether, 0),
+            (err = ert_waitUnixSocketWriteReady(
+                self->mKeeperTether, &Ert_ZeroDuration),
              -1 == err));
 
-        char buf[1];
-        ERT_ERROR_IF(
-            (err = ert_readSocket(
-                self->mKeeperTether->mSocket, buf, sizeof(buf), 0),
-             -1 == err || (errno = 0, 1 != err)));
+        if (err)
+        {
+            /* In case a connection race occurs, send the pid signature
+             * to allow the pid server to verify that it is serving
+             * a valid client. */
 
-        self->mChildPid = pidSignature->mPid;
+            ERT_ERROR_IF(
+                sendPidSignature(
+                    self->mKeeperTether->mSocket->mFile,
+                    self->mPidSignature, 0));
 
-    } while (0);
+            self->mHandshake = CommandHandshakeReceive;
+        }
+        break;
 
-    /* Run the command if the child process is running, or if
-     * the force to run the command regardless of the state of the
-     * child process. */
+    case CommandHandshakeReceive:
+        ERT_ERROR_IF(
+            (err = ert_waitUnixSocketReadReady(
+                self->mKeeperTether, &Ert_ZeroDuration),
+             -1 == err));
 
-    if (CommandStatusNonexistentPidFile == status ||
-        CommandStatusZombiePidFile      == status)
-    {
-        if (gOptions.mClient.mRelaxed)
+        if (err)
         {
-            self->mChildPid = Ert_Pid(0);
-            status          = CommandStatusOk;
+            ERT_ERROR_IF(
+                receiveCommandAcknowledgement_(self));
+
+            self->mChildPid  = self->mPidSignature->mPid;
+            self->mHandshake = CommandHandshakeDone;
+
+            /* There is no further need to hold a lock on the pidfile
+             * because acquisition of a reference to the child process
+             * group is the sole requirement. The signature is retained
+             * to allow the status of the child to be queried. */
+
+            self->mPidFile = destroyPidFile(self->mPidFile);
         }
+        break;
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+enum CommandStatus
+openCachedCommand(struct Command  *self,
+                  const char      *aPidFileName,
+                  struct PidCache *aPidCache)
+{
+    int rc = -1;
+
+    enum CommandStatus status = CommandStatusOk;
+
+    initCommand_(self);
+
+    /* Clients that poll the same pid file repeatedly can use the
+     * signature held in the cache, and so avoid reading the pid file
+     * and acquiring a lock on it each time. The lock is not needed
+     * because the pid server refuses the handshake unless the signature
+     * names the child process that it serves. If the cache cannot
+     * provide the signature of a running process, read the pid file
+     * so that the outcome is reported exactly as it would be without
+     * the cache. */
+
+    struct PidSignature *signature = lookupPidCache(
+        aPidCache, aPidFileName, &self->mPidServerAddr);
+
+    if ( ! signature || 0 >= signature->mPid.mPid)
+    {
+        signature = destroyPidSignature(signature);
+
+        ERT_ERROR_IF(
+            (status = openCommand(self, aPidFileName),
+             CommandStatusError == status));
+    }
+    else
+    {
+        self->mPidSignature = signature;
+        signature = 0;
+
+        ERT_ERROR_IF(
+            connectCommand_(self));
     }
 
     rc = 0;
@@ -196,18 +447,62 @@ Ert_Finally:
     ERT_FINALLY
     ({
         if (rc)
+        {
             status = CommandStatusError;
+            self   = closeCommand(self);
+        }
+    });
+
+    return status;
+}
+
+/* -------------------------------------------------------------------------- */
+enum CommandStatus
+createCommand(struct Command *self,
+              const char     *aPidFileName)
+{
+    return createCachedCommand(self, aPidFileName, 0);
+}
 
-        if (CommandStatusOk != status || ! self->mChildPid.mPid)
-            self->mKeeperTether = ert_closeUnixSocket(self->mKeeperTether);
+/* -------------------------------------------------------------------------- */
+enum CommandStatus
+createCachedCommand(struct Command  *self,
+                    const char      *aPidFileName,
+                    struct PidCache *aPidCache)
+{
+    int rc = -1;
 
-        /* There is no further need to hold a lock on the pidfile because
-         * acquisition of a reference to the child process group is the
-         * sole requirement. */
+    enum CommandStatus status;
+    ERT_ERROR_IF(
+        (status = (aPidCache
+                   ? openCachedCommand(self, aPidFileName, aPidCache)
+                   : openCommand(self, aPidFileName)),
+         CommandStatusError == status));
 
-        pidFile = destroyPidFile(pidFile);
+    while (CommandHandshakeDone != self->mHandshake)
+    {
+        int err;
+        ERT_ERROR_IF(
+            (err = (CommandHandshakeSend == self->mHandshake
+                    ? ert_waitUnixSocketWriteReady(self->mKeeperTether, 0)
+                    : ert_waitUnixSocketReadReady(self->mKeeperTether, 0)),
+             -1 == err));
 
-        pidSignature = destroyPidSignature(pidSignature);
+        ERT_ERROR_IF(
+            handshakeCommand(self));
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (rc)
+        {
+            status = CommandStatusError;
+            self   = closeCommand(self);
+        }
     });
 
     return status;
@@ -298,6 +593,12 @@ prepareCommandProcess_(struct CommandProcess_          *self,
                 aPreFork->mBlacklistFds,
                 self->mCommand->mKeeperTether->mSocket->mFile));
 
+    if (self->mCommand->mPidFdFile)
+        ERT_ERROR_IF(
+            ert_removeFdSetFile(
+                aPreFork->mBlacklistFds,
+                self->mCommand->mPidFdFile));
+
     rc = 0;
 
 Ert_Finally:
@@ -344,6 +645,27 @@ postCommandProcessChild_(struct CommandProcess_ *self)
         ert_debug(0, "%s=%s", pidSentryPidEnv, watchdogChildPid);
     }
 
+    /* Provide the pidfd, if available, so that the command can signal
+     * and wait for the child process without looking up the pid. */
+
+    const char *pidSentryPidFdEnv = "PIDSENTRY_PIDFD";
+
+    if ( ! self->mCommand->mPidFdFile)
+        ERT_ERROR_IF(
+            ert_deleteEnv(pidSentryPidFdEnv) && ENOENT != errno);
+    else
+    {
+        ERT_ERROR_IF(
+            ert_closeFdOnExec(self->mCommand->mPidFdFile->mFd, 0));
+
+        const char *watchdogChildPidFd;
+        ERT_ERROR_UNLESS(
+            (watchdogChildPidFd = ert_setEnvInt(
+                pidSentryPidFdEnv, self->mCommand->mPidFdFile->mFd)));
+
+        ert_debug(0, "%s=%s", pidSentryPidFdEnv, watchdogChildPidFd);
+    }
+
     rc = 0;
 
 Ert_Finally:
@@ -446,7 +768,460 @@ reapCommand(struct Command      *self,
                  -1 == rdReady));
 
             if (rdReady)
+            {
+                /* The pid server says why the reference was lost if the
+                 * lease on the reference expired. */
+
+                char buf[1];
+
+                ssize_t rdlen;
+                ERT_ERROR_IF(
+                    (rdlen = ert_readSocket(
+                        self->mKeeperTether->mSocket, buf, sizeof(buf), 0),
+                     -1 == rdlen && ECONNRESET != errno));
+
+                if (1 == rdlen && SENTRY_STATUS_LEASE_EXPIRED == buf[0])
+                    ert_message(
+                        0,
+                        "Lease on reference to child pid %" PRId_Ert_Pid
+                        " expired",
+                        FMTd_Ert_Pid(self->mChildPid));
+
                 exitCode.mStatus = 255;
+            }
+        }
+    }
+
+    *aExitCode = exitCode;
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+signalCommand(struct Command *self, int aSignal)
+{
+    int rc = -1;
+
+    ert_ensure(self->mChildPid.mPid);
+
+    /* Prefer the pidfd, if one was provided, because it cannot refer
+     * to any process other than the child process. */
+
+    int err = -1;
+
+    errno = ENOSYS;
+
+#ifdef SYS_pidfd_send_signal
+    if (self->mPidFdFile)
+        err = syscall(
+            SYS_pidfd_send_signal, self->mPidFdFile->mFd, aSignal, 0, 0);
+#endif
+
+    if (-1 == err && ENOSYS == errno)
+        err = kill(self->mChildPid.mPid, aSignal);
+
+    ERT_ERROR_IF(
+        -1 == err);
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+waitCommand(struct Command *self, struct Ert_ExitCode *aExitCode)
+{
+    int rc = -1;
+
+    /* Ask the pid server to send a status snapshot on the connection
+     * holding the reference once the child process has exited, and its
+     * output has been drained. The snapshot carries the exit code of
+     * the child process. If the pid server closes the connection
+     * without a snapshot, the exit code is not known. */
+
+    static const char waitRequest[1] = { SENTRY_STATUS_WAIT_REQUEST };
+
+    ssize_t wrlen;
+    ERT_ERROR_IF(
+        (wrlen = ert_writeSocket(
+            self->mKeeperTether->mSocket,
+            waitRequest, sizeof(waitRequest), 0),
+         -1 == wrlen || (errno = EIO, sizeof(waitRequest) != wrlen)));
+
+    int ready;
+    ERT_ERROR_IF(
+        (ready = ert_waitUnixSocketReadReady(self->mKeeperTether, 0),
+         -1 == ready));
+
+    struct SentryStatusSnapshot snapshot;
+
+    ssize_t rdlen;
+    ERT_ERROR_IF(
+        (rdlen = ert_readSocket(
+            self->mKeeperTether->mSocket,
+            (char *) &snapshot, sizeof(snapshot), 0),
+         -1 == rdlen
+         ? ECONNRESET != errno
+         : (errno = EPROTO, rdlen && sizeof(snapshot) != rdlen)));
+
+    ERT_ERROR_IF(
+        0 >= rdlen,
+        {
+            errno = ECHILD;
+        });
+
+    ERT_ERROR_IF(
+        SENTRY_STATUS_VERSION != snapshot.mVersion ||
+        sizeof(snapshot) > snapshot.mSize,
+        {
+            errno = EPROTO;
+        });
+
+    ERT_ERROR_IF(
+        0 > snapshot.mExitCode,
+        {
+            errno = ECHILD;
+        });
+
+    *aExitCode = (struct Ert_ExitCode) { snapshot.mExitCode };
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+attachCommand(struct Command *self)
+{
+    int rc = -1;
+
+    int attachFd = -1;
+
+    /* Ask the pid server for a pipe carrying a copy of the output of
+     * the child process, and copy the output to stdout until the sentry
+     * closes the pipe. Output produced before the attachment is not
+     * seen, and if this process does not keep up, the sentry closes
+     * the pipe rather than slow the child process. */
+
+    static const char attachRequest[1] = { SENTRY_STATUS_ATTACH_REQUEST };
+
+    ssize_t wrlen;
+    ERT_ERROR_IF(
+        (wrlen = ert_writeSocket(
+            self->mKeeperTether->mSocket,
+            attachRequest, sizeof(attachRequest), 0),
+         -1 == wrlen || (errno = EIO, sizeof(attachRequest) != wrlen)));
+
+    int ready;
+    ERT_ERROR_IF(
+        (ready = ert_waitUnixSocketReadReady(self->mKeeperTether, 0),
+         -1 == ready));
+
+    char reply;
+    ERT_ERROR_IF(
+        receiveCommandMessage_(self, &reply, &attachFd));
+
+    ERT_ERROR_IF(
+        SENTRY_STATUS_ATTACH_REQUEST != reply,
+        {
+            errno = EPROTO;
+        });
+
+    ERT_ERROR_IF(
+        -1 == attachFd,
+        {
+            errno = ECONNREFUSED;
+        });
+
+    while (1)
+    {
+        /* Copy whatever is available, rather than waiting to fill the
+         * buffer, so that the output is seen as it is produced. */
+
+        char buf[PIPE_BUF];
+
+        ssize_t rdlen;
+        ERT_ERROR_IF(
+            (rdlen = read(attachFd, buf, sizeof(buf)),
+             -1 == rdlen && EINTR != errno));
+
+        if ( ! rdlen)
+            break;
+
+        if (-1 == rdlen)
+            continue;
+
+        ERT_ERROR_IF(
+            (wrlen = ert_writeFd(STDOUT_FILENO, buf, rdlen, 0),
+             -1 == wrlen
+             ? EPIPE != errno
+             : (errno = EIO, rdlen != wrlen)));
+
+        if (-1 == wrlen)
+            break;
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (-1 != attachFd)
+            ERT_ABORT_IF(
+                ert_closeFd(attachFd));
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+reconfigureCommand(struct Command *self, const struct SentryConfig *aConfig)
+{
+    int rc = -1;
+
+    int replyFd = -1;
+
+    /* Send the request and the configuration in a single write so that
+     * the pid server can read the configuration as soon as it sees the
+     * request. The reply only shows that the configuration was passed
+     * to the sentry, which applies it as each timer is rearmed. */
+
+    struct SentryConfig config = *aConfig;
+
+    config.mVersion = SENTRY_CONFIG_VERSION;
+    config.mSize    = sizeof(config);
+
+    char request[1 + sizeof(config)];
+
+    request[0] = SENTRY_STATUS_RECONFIGURE_REQUEST;
+    memcpy(request + 1, &config, sizeof(config));
+
+    ssize_t wrlen;
+    ERT_ERROR_IF(
+        (wrlen = ert_writeSocket(
+            self->mKeeperTether->mSocket, request, sizeof(request), 0),
+         -1 == wrlen || (errno = EIO, sizeof(request) != wrlen)));
+
+    int ready;
+    ERT_ERROR_IF(
+        (ready = ert_waitUnixSocketReadReady(self->mKeeperTether, 0),
+         -1 == ready));
+
+    char reply;
+    ERT_ERROR_IF(
+        receiveCommandMessage_(self, &reply, &replyFd));
+
+    ERT_ERROR_IF(
+        SENTRY_STATUS_REFUSED == reply,
+        {
+            errno = ECONNREFUSED;
+        });
+
+    ERT_ERROR_IF(
+        SENTRY_STATUS_RECONFIGURE_REQUEST != reply,
+        {
+            errno = EPROTO;
+        });
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (-1 != replyFd)
+            ERT_ABORT_IF(
+                ert_closeFd(replyFd));
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+queryCommandStatus(struct Command              *self,
+                   struct SentryStatusSnapshot *aSnapshot)
+{
+    int rc = -1;
+
+    ert_ensure(self->mChildPid.mPid);
+
+    /* Ask the pid server to send a status snapshot on the connection
+     * holding the reference. The reference continues to be held once
+     * the snapshot is received. */
+
+    static const char queryRequest[1] = { SENTRY_STATUS_QUERY_REQUEST };
+
+    ssize_t wrlen;
+    ERT_ERROR_IF(
+        (wrlen = ert_writeSocket(
+            self->mKeeperTether->mSocket,
+            queryRequest, sizeof(queryRequest), 0),
+         -1 == wrlen || (errno = EIO, sizeof(queryRequest) != wrlen)));
+
+    int ready;
+    ERT_ERROR_IF(
+        (ready = ert_waitUnixSocketReadReady(self->mKeeperTether, 0),
+         -1 == ready));
+
+    /* Newer pid servers might append fields to the snapshot, so only
+     * read the fields that are understood here. */
+
+    ssize_t rdlen;
+    ERT_ERROR_IF(
+        (rdlen = ert_readSocket(
+            self->mKeeperTether->mSocket,
+            (char *) aSnapshot, sizeof(*aSnapshot), 0),
+         -1 == rdlen || (errno = EPROTO, sizeof(*aSnapshot) != rdlen)));
+
+    ERT_ERROR_IF(
+        SENTRY_STATUS_VERSION != aSnapshot->mVersion ||
+        sizeof(*aSnapshot) > aSnapshot->mSize,
+        {
+            errno = EPROTO;
+        });
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+runCommandVerb(struct Command      *self,
+               enum ClientVerb      aVerb,
+               struct Ert_ExitCode *aExitCode)
+{
+    int rc = -1;
+
+    struct Ert_ExitCode exitCode = { EXIT_FAILURE };
+
+    /* Client verbs act on the child process from this process while
+     * the reference to the child process is held, avoiding the cost
+     * of creating a process to run a command. */
+
+    if ( ! self->mChildPid.mPid)
+    {
+        ert_message(0, "No child process running");
+    }
+    else
+    {
+        switch (aVerb)
+        {
+        default:
+            ert_ensure(false);
+            break;
+
+        case ClientVerbPrintPid:
+            ERT_ERROR_IF(
+                -1 == dprintf(STDOUT_FILENO,
+                              "%" PRId_Ert_Pid "\n",
+                              FMTd_Ert_Pid(self->mChildPid)));
+            exitCode.mStatus = EXIT_SUCCESS;
+            break;
+
+        case ClientVerbSignal:
+            if ( ! signalCommand(self, gOptions.mClient.mSignal))
+                exitCode.mStatus = EXIT_SUCCESS;
+            else
+            {
+                struct Ert_ProcessSignalName sigName;
+
+                ert_message(
+                    errno,
+                    "Unable to send %s to child pid %" PRId_Ert_Pid,
+                    ert_formatProcessSignalName(
+                        &sigName, gOptions.mClient.mSignal),
+                    FMTd_Ert_Pid(self->mChildPid));
+            }
+            break;
+
+        case ClientVerbStatus:
+            {
+                struct SentryStatusSnapshot snapshot;
+
+                ERT_ERROR_IF(
+                    queryCommandStatus(self, &snapshot));
+
+                ERT_ERROR_IF(
+                    0 > (gOptions.mClient.mJson
+                         ? printSentryStatusSnapshotJson(&snapshot, stdout)
+                         : printSentryStatusSnapshot(&snapshot, stdout)) ||
+                    fflush(stdout));
+
+                if (SentryStatusExited != snapshot.mState)
+                    exitCode.mStatus = EXIT_SUCCESS;
+            }
+            break;
+
+        case ClientVerbAttach:
+            if ( ! attachCommand(self))
+                exitCode.mStatus = EXIT_SUCCESS;
+            else
+            {
+                ERT_ERROR_UNLESS(
+                    ECONNREFUSED == errno);
+
+                ert_message(
+                    0,
+                    "Unable to attach to output of child pid %" PRId_Ert_Pid,
+                    FMTd_Ert_Pid(self->mChildPid));
+            }
+            break;
+
+        case ClientVerbReconfigure:
+            if ( ! reconfigureCommand(self, &gOptions.mClient.mConfig))
+                exitCode.mStatus = EXIT_SUCCESS;
+            else
+            {
+                ERT_ERROR_UNLESS(
+                    ECONNREFUSED == errno);
+
+                ert_message(
+                    0,
+                    "Unable to reconfigure sentry of child pid %" PRId_Ert_Pid,
+                    FMTd_Ert_Pid(self->mChildPid));
+            }
+            break;
+
+        case ClientVerbWait:
+            if (waitCommand(self, &exitCode))
+            {
+                ERT_ERROR_UNLESS(
+                    ECHILD == errno);
+
+                ert_message(
+                    0,
+                    "Unable to determine exit code of child pid %"
+                    PRId_Ert_Pid,
+                    FMTd_Ert_Pid(self->mChildPid));
+
+                exitCode.mStatus = EXIT_FAILURE;
+            }
+            break;
         }
     }
 
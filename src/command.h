@@ -32,10 +32,19 @@
 #include "ert/compiler.h"
 #include "ert/unixsocket.h"
 #include "ert/pid.h"
+#include "ert/file.h"
+
+#include "pidfile_.h"
+#include "options_.h"
+
+#include <sys/un.h>
 
 ERT_BEGIN_C_SCOPE;
 
 struct Ert_ExitCode;
+struct PidCache;
+struct PidSignature;
+struct SentryStatusSnapshot;
 
 enum CommandStatus
 {
@@ -48,6 +57,13 @@ enum CommandStatus
     CommandStatusMalformedPidFile    = 5,
 };
 
+enum CommandHandshake
+{
+    CommandHandshakeDone,
+    CommandHandshakeSend,       /* Waiting to send the pid signature */
+    CommandHandshakeReceive,    /* Waiting for the acknowledgement */
+};
+
 /* -------------------------------------------------------------------------- */
 struct Command
 {
@@ -56,6 +72,17 @@ struct Command
 
     struct Ert_UnixSocket  mKeeperTether_;
     struct Ert_UnixSocket *mKeeperTether;
+
+    struct Ert_File  mPidFdFile_;   /* Pidfd of the child, if provided */
+    struct Ert_File *mPidFdFile;
+
+    struct sockaddr_un mPidServerAddr;
+
+    enum CommandHandshake mHandshake;
+    struct PidSignature  *mPidSignature;
+
+    struct PidFile  mPidFile_;
+    struct PidFile *mPidFile;
 };
 
 /* -------------------------------------------------------------------------- */
@@ -63,6 +90,23 @@ enum CommandStatus
 createCommand(struct Command *self,
               const char     *aPidFileName);
 
+enum CommandStatus
+createCachedCommand(struct Command  *self,
+                    const char      *aPidFileName,
+                    struct PidCache *aPidCache);
+
+enum CommandStatus
+openCommand(struct Command *self,
+            const char     *aPidFileName);
+
+enum CommandStatus
+openCachedCommand(struct Command  *self,
+                  const char      *aPidFileName,
+                  struct PidCache *aPidCache);
+
+ERT_CHECKED int
+handshakeCommand(struct Command *self);
+
 ERT_CHECKED int
 runCommand(struct Command     *self,
            const char * const *aCmd);
@@ -71,6 +115,28 @@ ERT_CHECKED int
 reapCommand(struct Command      *self,
             struct Ert_ExitCode *aExitCode);
 
+ERT_CHECKED int
+signalCommand(struct Command *self, int aSignal);
+
+ERT_CHECKED int
+waitCommand(struct Command      *self,
+            struct Ert_ExitCode *aExitCode);
+
+ERT_CHECKED int
+attachCommand(struct Command *self);
+
+ERT_CHECKED int
+reconfigureCommand(struct Command *self, const struct SentryConfig *aConfig);
+
+ERT_CHECKED int
+queryCommandStatus(struct Command              *self,
+                   struct SentryStatusSnapshot *aSnapshot);
+
+ERT_CHECKED int
+runCommandVerb(struct Command      *self,
+               enum ClientVerb      aVerb,
+               struct Ert_ExitCode *aExitCode);
+
 struct Command *
 closeCommand(struct Command *self);
 
@@ -0,0 +1,262 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2016, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "commandbench.h"
+
+#include "command.h"
+
+#include "options_.h"
+#include "pidcache_.h"
+
+#include "ert/process.h"
+#include "ert/timekeeping.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* -------------------------------------------------------------------------- */
+/* Client Verb Benchmark
+ *
+ * Repeatedly acquire a reference to the child process named in a pid
+ * file, and check that the child is alive, either in this process as
+ * a client verb does, or by running a shell command as a client command
+ * does. The verb is also run using a pid cache, as a client polling
+ * the same pid file would. Report the rate of each.
+ *
+ * Usage: commandbench [-d ...] pidfile [iterations] */
+
+#define COMMANDBENCH_ITERATIONS 1000
+
+#define COMMANDBENCH_CACHE_SIZE 4
+
+/* -------------------------------------------------------------------------- */
+static double
+ownElapsedSeconds_(uint64_t aSince_ns)
+{
+    return (ert_monotonicTime().monotonic.ns - aSince_ns) / 1e9;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+probeCommand_(const char          *aPidFileName,
+              const char * const  *aCmd,
+              struct PidCache     *aPidCache)
+{
+    int rc = -1;
+
+    struct Command  command_;
+    struct Command *command = 0;
+
+    enum CommandStatus status;
+    ERT_ERROR_IF(
+        (status = createCachedCommand(&command_, aPidFileName, aPidCache),
+         CommandStatusOk != status || (command = &command_, false)),
+        {
+            if (CommandStatusError != status)
+                errno = ESRCH;
+        });
+
+    ERT_ERROR_UNLESS(
+        command->mChildPid.mPid,
+        {
+            errno = ESRCH;
+        });
+
+    if ( ! aCmd)
+    {
+        ERT_ERROR_IF(
+            signalCommand(command, 0));
+    }
+    else
+    {
+        ERT_ERROR_IF(
+            runCommand(command, aCmd));
+
+        struct Ert_ExitCode exitCode;
+        ERT_ERROR_IF(
+            reapCommand(command, &exitCode));
+
+        ERT_ERROR_IF(
+            exitCode.mStatus,
+            {
+                errno = ESRCH;
+            });
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        command = closeCommand(command);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+runCommandBench_(const char *aPidFileName, unsigned aIterations)
+{
+    int rc = -1;
+
+    struct PidCache  pidCache_;
+    struct PidCache *pidCache = 0;
+
+    ERT_ERROR_IF(
+        createPidCache(&pidCache_, COMMANDBENCH_CACHE_SIZE));
+    pidCache = &pidCache_;
+
+    static const char * const shellCmd[] =
+    {
+        "kill -0 $PIDSENTRY_PID", 0,
+    };
+
+    static const struct
+    {
+        const char         *mName;
+        const char * const *mCmd;
+        bool                mCached;
+    } probes[] =
+    {
+        { "verb",    0,        false },
+        { "cached",  0,        true },
+        { "command", shellCmd, false },
+    };
+
+    for (unsigned px = 0; ERT_NUMBEROF(probes) > px; ++px)
+    {
+        uint64_t since_ns = ert_monotonicTime().monotonic.ns;
+
+        for (unsigned ix = 0; aIterations > ix; ++ix)
+            ERT_ERROR_IF(
+                probeCommand_(aPidFileName,
+                              probes[px].mCmd,
+                              probes[px].mCached ? pidCache : 0));
+
+        double seconds = ownElapsedSeconds_(since_ns);
+
+        printf("%s %u probes %.3fs %.1fus/probe rate %.0f/s\n",
+               probes[px].mName,
+               aIterations,
+               seconds,
+               seconds * 1e6 / aIterations,
+               aIterations / seconds);
+    }
+
+    printf("cache hits %lu misses %lu\n",
+           pidCache->mHits, pidCache->mMisses);
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        pidCache = closePidCache(pidCache);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+main(int argc, char **argv)
+{
+    struct Ert_ExitCode exitCode = { EXIT_FAILURE };
+
+    struct Ert_TestModule  testModule_;
+    struct Ert_TestModule *testModule = 0;
+
+    struct Ert_TimeKeepingModule  timeKeepingModule_;
+    struct Ert_TimeKeepingModule *timeKeepingModule = 0;
+
+    struct Ert_ProcessModule  processModule_;
+    struct Ert_ProcessModule *processModule = 0;
+
+    ERT_ABORT_IF(
+        Ert_Test_init(&testModule_, "PIDSENTRY_TEST_ERROR"));
+    testModule = &testModule_;
+
+    ERT_ABORT_IF(
+        Ert_Timekeeping_init(&timeKeepingModule_));
+    timeKeepingModule = &timeKeepingModule_;
+
+    ERT_ABORT_IF(
+        Ert_Process_init(&processModule_, argv[0]));
+    processModule = &processModule_;
+
+    initOptions();
+
+    int argi = 1;
+
+    for ( ; argi < argc && ! strcmp(argv[argi], "-d"); ++argi)
+        ++gOptions.mOptions.mDebug;
+
+    const char *pidFileName = 0;
+    unsigned    iterations  = COMMANDBENCH_ITERATIONS;
+
+    ERT_ABORT_IF(
+        argi >= argc || argi + 2 < argc ||
+        (pidFileName = argv[argi++],
+         argi < argc &&
+         (ert_parseUInt(argv[argi], &iterations) || ! iterations)),
+        {
+            ert_terminate(
+                0, "Usage: %s [-d ...] pidfile [iterations]", argv[0]);
+        });
+
+    ert_initOptions(&gOptions.mOptions);
+
+    ERT_ABORT_IF(
+        ert_ignoreProcessSigPipe());
+
+    ERT_ABORT_IF(
+        runCommandBench_(pidFileName, iterations),
+        {
+            ert_terminate(errno, "Failed to run command benchmark");
+        });
+
+    exitCode.mStatus = EXIT_SUCCESS;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    processModule     = Ert_Process_exit(processModule);
+    timeKeepingModule = Ert_Timekeeping_exit(timeKeepingModule);
+    testModule        = Ert_Test_exit(testModule);
+
+    return exitCode.mStatus;
+}
+
+/* -------------------------------------------------------------------------- */
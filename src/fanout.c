@@ -0,0 +1,438 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2016, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "fanout.h"
+
+#include "ert/error.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define FANOUT_EVENT_BATCH 64
+
+#define FANOUT_HANDSHAKE_TIMEOUT_S 30
+
+/* -------------------------------------------------------------------------- */
+static const char *
+ownFanOutStatusName_(enum CommandStatus aStatus)
+{
+    switch (aStatus)
+    {
+    default:
+        return "error";
+
+    case CommandStatusOk:
+        return "ok";
+
+    case CommandStatusUnreachablePidFile:
+        return "unreachable";
+
+    case CommandStatusNonexistentPidFile:
+        return "nonexistent";
+
+    case CommandStatusInaccessiblePidFile:
+        return "inaccessible";
+
+    case CommandStatusZombiePidFile:
+        return "zombie";
+
+    case CommandStatusMalformedPidFile:
+        return "malformed";
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+static void
+closeFanOutTarget_(struct FanOutTarget_ *self)
+{
+    self->mEvent   = ert_closeFileEventQueueActivity(self->mEvent);
+    self->mCommand = closeCommand(self->mCommand);
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+armFanOutTarget_(struct FanOutTarget_ *self)
+{
+    return ert_armFileEventQueueActivity(
+        self->mEvent,
+        CommandHandshakeSend == self->mCommand->mHandshake
+        ? Ert_FileEventQueuePollWrite
+        : Ert_FileEventQueuePollRead,
+        Ert_FileEventQueueActivityMethod(
+            self,
+            ERT_LAMBDA(
+                int, (struct FanOutTarget_ *self_),
+                {
+                    /* A failed handshake only affects this target, so
+                     * record the failure and allow the remaining
+                     * handshakes to proceed. */
+
+                    if (handshakeCommand(self_->mCommand))
+                    {
+                        ert_warn(
+                            errno,
+                            "Unable to reach pid server for '%s'",
+                            self_->mPidFileName);
+
+                        self_->mStatus = CommandStatusError;
+
+                        closeFanOutTarget_(self_);
+                    }
+                    else if (
+                        CommandHandshakeDone != self_->mCommand->mHandshake)
+                    {
+                        return armFanOutTarget_(self_);
+                    }
+                    else
+                    {
+                        self_->mEvent = ert_closeFileEventQueueActivity(
+                            self_->mEvent);
+                    }
+
+                    --self_->mFanOut->mPending;
+
+                    return 0;
+                })));
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+openFanOutTarget_(struct FanOut        *self,
+                  struct FanOutTarget_ *aTarget)
+{
+    int rc = -1;
+
+    /* Open, lock and read each pid file in turn, but only start the
+     * connection to each pid server so that the handshakes with all
+     * the pid servers can proceed concurrently. */
+
+    aTarget->mStatus = openCommand(&aTarget->mCommand_, aTarget->mPidFileName);
+
+    if (CommandStatusError == aTarget->mStatus)
+    {
+        ert_warn(
+            errno, "Unable to open pidfile '%s'", aTarget->mPidFileName);
+    }
+    else if (CommandStatusOk == aTarget->mStatus)
+    {
+        aTarget->mCommand = &aTarget->mCommand_;
+
+        if (CommandHandshakeDone != aTarget->mCommand->mHandshake)
+        {
+            ERT_ERROR_IF(
+                ert_createFileEventQueueActivity(
+                    &aTarget->mEvent_,
+                    self->mEventQueue,
+                    aTarget->mCommand->mKeeperTether->mSocket->mFile));
+            aTarget->mEvent = &aTarget->mEvent_;
+
+            ERT_ERROR_IF(
+                armFanOutTarget_(aTarget));
+
+            ++self->mPending;
+        }
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+reapFanOutTarget_(struct FanOut *self)
+{
+    int rc = -1;
+
+    struct Ert_Pid pid;
+    ERT_ERROR_IF(
+        (pid = ert_waitProcessChildren(),
+         -1 == pid.mPid || (errno = ECHILD, ! pid.mPid)));
+
+    struct FanOutTarget_ *target = 0;
+
+    for (size_t ix = 0; self->mTargets > ix; ++ix)
+    {
+        if (self->mTarget[ix].mRunning &&
+            self->mTarget[ix].mCommand->mPid.mPid == pid.mPid)
+        {
+            target = &self->mTarget[ix];
+            break;
+        }
+    }
+
+    ert_ensure(target);
+
+    ERT_ERROR_IF(
+        reapCommand(target->mCommand, &target->mExitCode));
+
+    target->mRunning = false;
+    target->mReaped  = true;
+
+    /* Release the reference to the child process as soon as the
+     * command completes rather than when all the commands complete. */
+
+    closeFanOutTarget_(target);
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+runFanOut(struct FanOut       *self,
+          const char * const  *aCmd,
+          struct Ert_ExitCode *aExitCode)
+{
+    int rc = -1;
+
+    for (size_t ix = 0; self->mTargets > ix; ++ix)
+        ERT_ERROR_IF(
+            openFanOutTarget_(self, &self->mTarget[ix]));
+
+    /* The read lock on each pid file is held until its handshake
+     * completes, so do not wait indefinitely for a pid server that
+     * does not respond. Abandon the handshakes that are still
+     * outstanding when the deadline expires so that their locks
+     * are released. */
+
+    struct Ert_Duration handshakeTimeout =
+        Ert_Duration(ERT_NSECS(Ert_Seconds(FANOUT_HANDSHAKE_TIMEOUT_S)));
+
+    struct Ert_EventClockTime since = ERT_EVENTCLOCKTIME_INIT;
+
+    while (self->mPending)
+    {
+        struct Ert_Duration remaining;
+
+        if (ert_deadlineTimeExpired(
+                &since, handshakeTimeout, &remaining, 0))
+        {
+            for (size_t ix = 0; self->mTargets > ix; ++ix)
+            {
+                struct FanOutTarget_ *target = &self->mTarget[ix];
+
+                if (target->mEvent)
+                {
+                    ert_warn(
+                        ETIMEDOUT,
+                        "Unable to reach pid server for '%s'",
+                        target->mPidFileName);
+
+                    target->mStatus = CommandStatusError;
+
+                    closeFanOutTarget_(target);
+                }
+            }
+
+            self->mPending = 0;
+            break;
+        }
+
+        ERT_ERROR_IF(
+            ert_pollFileEventQueueActivity(self->mEventQueue, &remaining));
+    }
+
+    /* Run the command against each target that has a reference to its
+     * child process, or that is allowed to run without one, limiting
+     * the number of commands that are running at any time. */
+
+    unsigned running = 0;
+
+    for (size_t ix = 0; self->mTargets > ix; ++ix)
+    {
+        struct FanOutTarget_ *target = &self->mTarget[ix];
+
+        if (CommandStatusOk != target->mStatus)
+            continue;
+
+        if (self->mParallel <= running)
+        {
+            ERT_ERROR_IF(
+                reapFanOutTarget_(self));
+            --running;
+        }
+
+        ERT_ERROR_IF(
+            runCommand(target->mCommand, aCmd));
+
+        target->mRunning = true;
+        ++running;
+    }
+
+    while (running)
+    {
+        ERT_ERROR_IF(
+            reapFanOutTarget_(self));
+        --running;
+    }
+
+    /* Summarise the outcome for each pid file on a separate line
+     * with the name of the pid file last, since it is the only field
+     * that might contain whitespace. */
+
+    struct Ert_ExitCode exitCode = { EXIT_SUCCESS };
+
+    for (size_t ix = 0; self->mTargets > ix; ++ix)
+    {
+        struct FanOutTarget_ *target = &self->mTarget[ix];
+
+        if ( ! target->mReaped)
+        {
+            exitCode.mStatus = EXIT_FAILURE;
+
+            ERT_ERROR_IF(
+                -1 == dprintf(STDOUT_FILENO,
+                              "%s - - %s\n",
+                              ownFanOutStatusName_(target->mStatus),
+                              target->mPidFileName));
+        }
+        else
+        {
+            if (target->mExitCode.mStatus)
+                exitCode.mStatus = EXIT_FAILURE;
+
+            ERT_ERROR_IF(
+                -1 == dprintf(STDOUT_FILENO,
+                              "%s %" PRId_Ert_Pid " %" PRId_Ert_ExitCode
+                              " %s\n",
+                              ownFanOutStatusName_(target->mStatus),
+                              FMTd_Ert_Pid(target->mCommand_.mChildPid),
+                              FMTd_Ert_ExitCode(target->mExitCode),
+                              target->mPidFileName));
+        }
+    }
+
+    *aExitCode = exitCode;
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+createFanOut(struct FanOut *self,
+             const char    *aPattern,
+             unsigned       aParallel)
+{
+    int rc = -1;
+
+    self->mGlob       = 0;
+    self->mEventQueue = 0;
+    self->mParallel   = aParallel;
+    self->mPending    = 0;
+    self->mTargets    = 0;
+    self->mTarget     = 0;
+
+    ert_ensure(aParallel);
+
+    /* Names in a brace list that do not match an existing file are
+     * retained so that they are reported in the summary. */
+
+    int err = glob(aPattern, GLOB_BRACE | GLOB_NOCHECK, 0, &self->mGlob_);
+    self->mGlob = &self->mGlob_;
+
+    ERT_ERROR_IF(
+        err,
+        {
+            errno = GLOB_NOSPACE == err ? ENOMEM : EIO;
+        });
+
+    ERT_ERROR_UNLESS(
+        (self->mTarget = calloc(self->mGlob->gl_pathc,
+                                sizeof(*self->mTarget))));
+
+    for (size_t ix = 0; self->mGlob->gl_pathc > ix; ++ix)
+    {
+        struct FanOutTarget_ *target = &self->mTarget[ix];
+
+        target->mFanOut      = self;
+        target->mPidFileName = self->mGlob->gl_pathv[ix];
+        target->mStatus      = CommandStatusError;
+        target->mCommand     = 0;
+        target->mEvent       = 0;
+        target->mRunning     = false;
+        target->mReaped      = false;
+        target->mExitCode    = (struct Ert_ExitCode) { EXIT_FAILURE };
+    }
+    self->mTargets = self->mGlob->gl_pathc;
+
+    ERT_ERROR_IF(
+        ert_createFileEventQueue(&self->mEventQueue_, FANOUT_EVENT_BATCH));
+    self->mEventQueue = &self->mEventQueue_;
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (rc)
+            self = closeFanOut(self);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+struct FanOut *
+closeFanOut(struct FanOut *self)
+{
+    if (self)
+    {
+        for (size_t ix = 0; self->mTargets > ix; ++ix)
+            closeFanOutTarget_(&self->mTarget[ix]);
+
+        self->mEventQueue = ert_closeFileEventQueue(self->mEventQueue);
+
+        free(self->mTarget);
+
+        if (self->mGlob)
+            globfree(self->mGlob);
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
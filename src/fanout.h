@@ -0,0 +1,96 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2016, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef FANOUT_H
+#define FANOUT_H
+
+#include "command.h"
+
+#include "ert/compiler.h"
+#include "ert/fileeventqueue.h"
+#include "ert/process.h"
+
+#include <glob.h>
+#include <stdbool.h>
+
+ERT_BEGIN_C_SCOPE;
+
+struct FanOut;
+
+/* -------------------------------------------------------------------------- */
+struct FanOutTarget_
+{
+    struct FanOut      *mFanOut;
+    const char         *mPidFileName;
+    enum CommandStatus  mStatus;
+
+    struct Command  mCommand_;
+    struct Command *mCommand;
+
+    struct Ert_FileEventQueueActivity  mEvent_;
+    struct Ert_FileEventQueueActivity *mEvent;
+
+    bool                mRunning;
+    bool                mReaped;
+    struct Ert_ExitCode mExitCode;
+};
+
+struct FanOut
+{
+    glob_t  mGlob_;
+    glob_t *mGlob;
+
+    struct Ert_FileEventQueue  mEventQueue_;
+    struct Ert_FileEventQueue *mEventQueue;
+
+    unsigned mParallel;
+    unsigned mPending;          /* Handshakes in progress */
+
+    size_t                mTargets;
+    struct FanOutTarget_ *mTarget;
+};
+
+/* -------------------------------------------------------------------------- */
+ERT_CHECKED int
+createFanOut(struct FanOut *self,
+             const char    *aPattern,
+             unsigned       aParallel);
+
+ERT_CHECKED int
+runFanOut(struct FanOut       *self,
+          const char * const  *aCmd,
+          struct Ert_ExitCode *aExitCode);
+
+ERT_CHECKED struct FanOut *
+closeFanOut(struct FanOut *self);
+
+/* -------------------------------------------------------------------------- */
+
+ERT_END_C_SCOPE;
+
+#endif /* FANOUT_H */
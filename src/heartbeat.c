@@ -0,0 +1,195 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2016, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "heartbeat.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <inttypes.h>
+
+#include <sys/syscall.h>
+#include <linux/memfd.h>
+
+/* -------------------------------------------------------------------------- */
+/* Heartbeat Region
+ *
+ * Rather than requiring the child to write to the tether to demonstrate
+ * progress, the child can increment counters in a memory region shared
+ * with the watchdog. A heartbeat then costs a single atomic add in
+ * the child, rather than a write(2) and a copy through the tether. */
+
+/* -------------------------------------------------------------------------- */
+int
+createHeartbeat(struct Heartbeat *self, unsigned aSlots)
+{
+    int rc = -1;
+
+    self->mFile       = 0;
+    self->mRegion     = 0;
+    self->mRegionSize = pidHeartbeatSize(aSlots);
+    self->mSlots      = aSlots;
+    self->mSamples    = 0;
+
+    ERT_ERROR_UNLESS(
+        (self->mSamples = calloc(aSlots, sizeof(*self->mSamples))));
+
+    /* Use the system call directly because older versions of glibc
+     * do not provide a wrapper for memfd_create(2). */
+
+    ERT_ERROR_IF(
+        ert_createFile(
+            &self->mFile_,
+            syscall(SYS_memfd_create,
+                    "pidsentry-heartbeat", MFD_CLOEXEC | MFD_ALLOW_SEALING)));
+    self->mFile = &self->mFile_;
+
+    ERT_ERROR_IF(
+        ert_ftruncateFile(self->mFile, self->mRegionSize));
+
+    /* Seal the size of the region before it is shared with the child,
+     * so that the child cannot truncate the file and cause the sentry
+     * to fault when it samples the heartbeat. */
+
+    ERT_ERROR_IF(
+        fcntl(self->mFile->mFd,
+              F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL));
+
+    void *region;
+    ERT_ERROR_IF(
+        (region = mmap(0, self->mRegionSize,
+                       PROT_READ | PROT_WRITE, MAP_SHARED,
+                       self->mFile->mFd, 0),
+         MAP_FAILED == region));
+    self->mRegion = region;
+
+    self->mRegion->mSlots   = aSlots;
+    self->mRegion->mVersion = PIDHEARTBEAT_VERSION;
+    self->mRegion->mMagic   = PIDHEARTBEAT_MAGIC;
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (rc)
+            self = closeHeartbeat(self);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+struct Heartbeat *
+closeHeartbeat(struct Heartbeat *self)
+{
+    if (self)
+    {
+        if (self->mRegion)
+            ERT_ABORT_IF(
+                munmap(self->mRegion, self->mRegionSize));
+
+        self->mFile = ert_closeFile(self->mFile);
+
+        free(self->mSamples);
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+printHeartbeat(const struct Heartbeat *self, FILE *aFile)
+{
+    return fprintf(aFile,
+                   "<heartbeat %p fd %d slots %u>",
+                   self, self->mFile->mFd, self->mSlots);
+}
+
+/* -------------------------------------------------------------------------- */
+void
+restartHeartbeat(struct Heartbeat *self)
+{
+    for (unsigned ix = 0; self->mSlots > ix; ++ix)
+        self->mSamples[ix].mCycleCount = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+sampleHeartbeat(struct Heartbeat *self, unsigned aCycleLimit)
+{
+    int rc = -1;
+
+    int stalled = 0;
+
+    /* A slot that has never been used, or that has been retired by
+     * the child, has a zero counter and is not monitored. Otherwise
+     * a slot is declared stalled if its counter has not advanced
+     * for the specified number of cycles. */
+
+    for (unsigned ix = 0; self->mSlots > ix; ++ix)
+    {
+        struct HeartbeatSample_ *sample = &self->mSamples[ix];
+
+        uint64_t count = __atomic_load_n(
+            &self->mRegion->mSlot[ix].mCount, __ATOMIC_RELAXED);
+
+        if ( ! count || count != sample->mCount)
+        {
+            sample->mCount      = count;
+            sample->mCycleCount = 0;
+        }
+        else if (aCycleLimit > sample->mCycleCount)
+        {
+            if (aCycleLimit == ++sample->mCycleCount)
+            {
+                ert_warn(
+                    0,
+                    "Heartbeat slot %u stalled at count %" PRIu64,
+                    ix, count);
+
+                ++stalled;
+            }
+        }
+    }
+
+    rc = stalled;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        ert_finally_warn_if(-1 == rc, self, printHeartbeat);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,79 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2016, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef HEARTBEAT_H
+#define HEARTBEAT_H
+
+#include "pidheartbeat.h"
+
+#include "ert/compiler.h"
+#include "ert/file.h"
+
+#include <stdio.h>
+
+ERT_BEGIN_C_SCOPE;
+
+/* -------------------------------------------------------------------------- */
+struct HeartbeatSample_
+{
+    uint64_t mCount;            /* Counter value at last sample */
+    unsigned mCycleCount;       /* Samples without progress */
+};
+
+struct Heartbeat
+{
+    struct Ert_File  mFile_;
+    struct Ert_File *mFile;
+
+    struct PidHeartbeat     *mRegion;
+    size_t                   mRegionSize;
+    unsigned                 mSlots;
+    struct HeartbeatSample_ *mSamples;
+};
+
+/* -------------------------------------------------------------------------- */
+ERT_CHECKED int
+createHeartbeat(struct Heartbeat *self, unsigned aSlots);
+
+struct Heartbeat *
+closeHeartbeat(struct Heartbeat *self);
+
+void
+restartHeartbeat(struct Heartbeat *self);
+
+ERT_CHECKED int
+sampleHeartbeat(struct Heartbeat *self, unsigned aCycleLimit);
+
+int
+printHeartbeat(const struct Heartbeat *self, FILE *aFile);
+
+/* -------------------------------------------------------------------------- */
+
+ERT_END_C_SCOPE;
+
+#endif /* HEARTBEAT_H */
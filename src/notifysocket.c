@@ -0,0 +1,309 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2016, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "notifysocket.h"
+
+#include "ert/error.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <sys/socket.h>
+
+/* -------------------------------------------------------------------------- */
+/* Notification Socket
+ *
+ * Provide a datagram socket compatible with the sd_notify(3) protocol
+ * so that the child process can indicate when it is ready, when it
+ * is stopping, and provide keepalives. The socket is bound to an
+ * address in the abstract namespace chosen by the kernel, and the
+ * address is advertised to the child in NOTIFY_SOCKET. */
+
+#define NOTIFY_SOCKET_MESSAGE_SIZE_ 4096
+
+/* -------------------------------------------------------------------------- */
+int
+createNotifySocket(struct NotifySocket *self)
+{
+    int rc = -1;
+
+    self->mFile    = 0;
+    self->mName[0] = 0;
+
+    ERT_ERROR_IF(
+        ert_createFile(
+            &self->mFile_,
+            socket(AF_UNIX,
+                   SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0)));
+    self->mFile = &self->mFile_;
+
+    /* Binding only the address family requests that the kernel
+     * choose a unique name in the abstract namespace. */
+
+    struct sockaddr_un sockAddr = { .sun_family = AF_UNIX };
+
+    ERT_ERROR_IF(
+        bind(self->mFile->mFd,
+             (struct sockaddr *) &sockAddr, sizeof(sockAddr.sun_family)));
+
+    socklen_t sockAddrLen = sizeof(sockAddr);
+
+    ERT_ERROR_IF(
+        getsockname(self->mFile->mFd,
+                    (struct sockaddr *) &sockAddr, &sockAddrLen));
+
+    size_t nameLen = sockAddrLen - offsetof(struct sockaddr_un, sun_path);
+
+    ERT_ERROR_IF(
+        ! nameLen || sockAddr.sun_path[0] || sizeof(self->mName) <= nameLen,
+        {
+            errno = EAFNOSUPPORT;
+        });
+
+    self->mName[0] = '@';
+    memcpy(&self->mName[1], &sockAddr.sun_path[1], nameLen - 1);
+    self->mName[nameLen] = 0;
+
+    /* Request the credentials of each sender so that notifications
+     * from processes outside the child process group can be ignored. */
+
+    int passCred = 1;
+
+    ERT_ERROR_IF(
+        setsockopt(self->mFile->mFd,
+                   SOL_SOCKET, SO_PASSCRED, &passCred, sizeof(passCred)));
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (rc)
+            self = closeNotifySocket(self);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+struct NotifySocket *
+closeNotifySocket(struct NotifySocket *self)
+{
+    if (self)
+        self->mFile = ert_closeFile(self->mFile);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+printNotifySocket(const struct NotifySocket *self, FILE *aFile)
+{
+    return fprintf(aFile,
+                   "<notify socket %p fd %d %s>",
+                   self, self->mFile->mFd, self->mName);
+}
+
+/* -------------------------------------------------------------------------- */
+static unsigned
+parseNotifySocketMessage_(char *aMsg)
+{
+    unsigned events = 0;
+
+    /* Each message comprises newline separated assignments. Only
+     * the subset of the assignments used to control the child
+     * process is recognised, and the remainder are ignored. */
+
+    for (char *next = aMsg; next; )
+    {
+        char *line = next;
+
+        next = strchr(line, '\n');
+        if (next)
+            *next++ = 0;
+
+        if ( ! strcmp(line, "READY=1"))
+            events |= NotifySocketReady;
+        else if ( ! strcmp(line, "WATCHDOG=1"))
+            events |= NotifySocketWatchdog;
+        else if ( ! strcmp(line, "STOPPING=1"))
+            events |= NotifySocketStopping;
+        else if (line[0])
+            ert_debug(0, "ignoring notification '%s'", line);
+    }
+
+    return events;
+}
+
+int
+receiveNotifySocket(struct NotifySocket *self, struct Ert_Pgid aPgid)
+{
+    int rc = -1;
+
+    int events = 0;
+
+    do
+    {
+        char buf[NOTIFY_SOCKET_MESSAGE_SIZE_ + 1];
+
+        union
+        {
+            struct cmsghdr mHeader;
+            char           mBuf[CMSG_SPACE(sizeof(struct ucred)) +
+                                CMSG_SPACE(sizeof(int) * 16)];
+        } control;
+
+        struct iovec iov =
+        {
+            .iov_base = buf,
+            .iov_len  = sizeof(buf) - 1,
+        };
+
+        struct msghdr msg =
+        {
+            .msg_iov        = &iov,
+            .msg_iovlen     = 1,
+            .msg_control    = &control,
+            .msg_controllen = sizeof(control),
+        };
+
+        ssize_t rdlen;
+        ERT_ERROR_IF(
+            (rdlen = recvmsg(self->mFile->mFd,
+                             &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC),
+             -1 == rdlen && EWOULDBLOCK != errno && EINTR != errno));
+
+        if (-1 == rdlen)
+            break;
+
+        /* Close any file descriptors that were passed because this
+         * implementation does not provide a file descriptor store, and
+         * only accept notifications accompanied by the credentials
+         * of the sender. */
+
+        const struct ucred *cred = 0;
+
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+             cmsg;
+             cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if (SOL_SOCKET != cmsg->cmsg_level)
+                continue;
+
+            if (SCM_CREDENTIALS == cmsg->cmsg_type &&
+                CMSG_LEN(sizeof(*cred)) == cmsg->cmsg_len)
+            {
+                cred = (const struct ucred *) CMSG_DATA(cmsg);
+            }
+            else if (SCM_RIGHTS == cmsg->cmsg_type)
+            {
+                const int *fds = (const int *) CMSG_DATA(cmsg);
+
+                size_t numFds =
+                    (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(*fds);
+
+                for (size_t ix = 0; numFds > ix; ++ix)
+                    ERT_ABORT_IF(
+                        close(fds[ix]) && EINTR != errno);
+            }
+        }
+
+        if (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC))
+        {
+            ert_debug(0, "ignoring truncated notification");
+            break;
+        }
+
+        /* Only accept notifications accompanied by the credentials of
+         * the sender, and only from senders running as the same user as
+         * the sentry, or as root. */
+
+        if ( ! cred)
+        {
+            ert_debug(0, "ignoring notification without credentials");
+            break;
+        }
+
+        if (cred->uid && cred->uid != geteuid())
+        {
+            ert_debug(
+                0,
+                "ignoring notification from pid %d uid %d",
+                (int) cred->pid,
+                (int) cred->uid);
+            break;
+        }
+
+        /* Additionally require that the sender is a member of the child
+         * process group. Short lived senders such as systemd-notify(1)
+         * will often have exited by the time the notification is read,
+         * in which case their membership can no longer be established,
+         * and the credentials alone are used to authorise the sender. */
+
+        pid_t senderPgid = getpgid(cred->pid);
+
+        if (-1 == senderPgid && ESRCH == errno)
+        {
+            ert_debug(
+                0,
+                "accepting notification from exited pid %d",
+                (int) cred->pid);
+        }
+        else if (senderPgid != aPgid.mPgid)
+        {
+            ert_debug(
+                0,
+                "ignoring notification from pid %d pgid %d",
+                (int) cred->pid,
+                (int) senderPgid);
+            break;
+        }
+
+        buf[rdlen] = 0;
+
+        events = parseNotifySocketMessage_(buf);
+
+    } while (0);
+
+    rc = events;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        ert_finally_warn_if(-1 == rc, self, printNotifySocket);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
@@ -33,6 +33,8 @@
 #include "ert/process.h"
 
 #include <string.h>
+#include <signal.h>
+#include <limits.h>
 #include <unistd.h>
 #include <getopt.h>
 
@@ -45,12 +47,30 @@ struct Options gOptions;
 #define DEFAULT_SIGNAL_PERIOD_S     30
 #define DEFAULT_DRAIN_TIMEOUT_S     30
 #define DEFAULT_PIDFILE_MODE        "u=r"
+#define DEFAULT_PIDFILE_FORMAT      "text"
+#define DEFAULT_HANG_STATES         "D"
+#define DEFAULT_HANG_ACTION         "abort"
+#define DEFAULT_HEARTBEAT_TIMEOUT_S 30
+#define DEFAULT_HEARTBEAT_NAME      "PIDSENTRY_HEARTBEAT"
+#define DEFAULT_LEASE_S             0
+#define DEFAULT_REGISTRY            "/run/pidsentry.registry"
+
+/* When terminating the child process, first request that the child
+ * terminate by sending it SIGTERM, and if the child does not terminate,
+ * resort to sending SIGKILL. Choose to send SIGABRT in the case that the
+ * child is unresponsive. The implication here is that the child might be
+ * stuck, so a core file might be useful to diagnose the situation. */
+
+#define DEFAULT_TERMINATE_PLAN      "TERM,KILL"
+#define DEFAULT_ABORT_PLAN          "ABRT,KILL"
 
 /* -------------------------------------------------------------------------- */
 static const char programUsage_[] =
 "usage : %s { --server | -s } [ monitoring-options | "
                                "general-options ] cmd ...\n"
 "        %s { --client | -c } [ general-options ] file cmd ... \n"
+"        %s { --client | -c } [ general-options ] client-verb file\n"
+"        %s { --client | -c } [ general-options ] --list [ registry ]\n"
 "\n"
 "mode:\n"
 " --server | -s\n"
@@ -71,12 +91,53 @@ static const char programUsage_[] =
 "      Run in test mode using a non-zero test level. [Default: No test]\n"
 "\n"
 "client options:\n"
+"  --fanout N\n"
+"      Treat file as a glob(7) pattern, with braces to list alternatives,\n"
+"      and run the command against each matching pid file. The pid\n"
+"      servers for all the files are contacted concurrently, and at most\n"
+"      N commands run at a time. Print a summary line for each file on\n"
+"      stdout once all the commands have completed. [Default: Run the\n"
+"      command against a single pid file]\n"
 "  --relaxed | -R\n"
 "      Always run the client command, even if there is no child process\n"
 "      running. The environment variable PIDSENTRY_PID to will only be set\n"
 "      if there is a child process running.\n"
 "\n"
+"client verbs:\n"
+"      Rather than running a command, act on the child process directly\n"
+"      while holding a reference to it.\n"
+"  --attach\n"
+"      Copy the output of the child process to stdout as it is produced\n"
+"      until the sentry exits. Output produced before attaching is not\n"
+"      copied, and a client that cannot keep up is detached.\n"
+"  --list\n"
+"      Rather than naming a pid file, name a registry shared by sentries\n"
+"      started with --registry, and print a line for each sentry that\n"
+"      is registered. The registry is read without locking, and the pid\n"
+"      servers are not contacted. [Default: " DEFAULT_REGISTRY "]\n"
+"  --printpid\n"
+"      Print the pid of the child process on stdout.\n"
+"  --reconfigure K=V\n"
+"      Change the configuration of the running sentry, where K is one of\n"
+"      timeout, termplan or abortplan, and V takes the same form as the\n"
+"      argument of the server option of the same name. The umbilical\n"
+"      timeout cannot be changed. Changes take effect when each timer is\n"
+"      next rearmed. This option can be repeated.\n"
+"  --signal S\n"
+"      Send signal S, named (eg TERM) or numbered, to the child process.\n"
+"  --status[=json]\n"
+"      Query the sentry, and print the status of the child process on\n"
+"      stdout, optionally in JSON. Exit successfully only if the child\n"
+"      process is still running.\n"
+"  --wait\n"
+"      Wait for the child process to terminate, and its output to be\n"
+"      drained, then exit with the exit code of the child process.\n"
+"\n"
 "server options:\n"
+"  --abortplan P\n"
+"      Use the signal plan P to terminate the child process when it is\n"
+"      unresponsive. See --termplan for the format of P. [Default: P = "
+    DEFAULT_ABORT_PLAN "]\n"
 "  --announce | -a\n"
 "      Announce the name of program or the shell command running in the\n"
 "      child process as it is started and when it has stopped.\n"
@@ -84,15 +145,48 @@ static const char programUsage_[] =
 "      Tether child using file descriptor N in the child process, and\n"
 "      copy received data to stdout of the watchdog. Specify N as - to\n"
 "      allocate a new file descriptor. [Default: N = 1 (stdout) ].\n"
+"  --hang L\n"
+"      Scan the threads of the child process group, and act on any thread\n"
+"      that remains in a flagged scheduler state for too long. The list L\n"
+"      comprises up to three comma separated values: T, S and A.\n"
+"        T  time in seconds a thread can remain flagged, zero to disable\n"
+"        S  scheduler states to flag (eg D for uninterruptible sleep)\n"
+"        A  action to take: abort, term or warn\n"
+"      [Default: Do not scan threads, S,A = "
+    DEFAULT_HANG_STATES ","
+    DEFAULT_HANG_ACTION "]\n"
+"  --heartbeat L\n"
+"      Share a region of progress counters with the child process, and\n"
+"      terminate the child if any counter in use stops advancing. The\n"
+"      list L comprises up to three comma separated values: S, T and N.\n"
+"        S  number of counter slots, zero to disable\n"
+"        T  timeout in seconds for a counter to advance\n"
+"        N  name of the fd of the region, used as for --name\n"
+"      See pidheartbeat.h for the layout of the region.\n"
+"      [Default: No heartbeat, T,N = "
+    ERT_STRINGIFY(DEFAULT_HEARTBEAT_TIMEOUT_S) ","
+    DEFAULT_HEARTBEAT_NAME "]\n"
 "  --identify | -i\n"
 "      Print the pid of the child process on stdout before starting\n"
 "      the child program. [Default: Do not print the pid of the child]\n"
+"  --lease S\n"
+"      Once the child process has terminated, release references still\n"
+"      held by clients after S seconds, and report each client. A lease\n"
+"      of zero holds references until the clients release them.\n"
+"      [Default: S = " ERT_STRINGIFY(DEFAULT_LEASE_S) "]\n"
 "  --name N | -n N\n"
 "      Name the fd of the tether. If N matches [A-Z][A-Z0-9_]*, then\n"
 "      create an environment variable of that name and set is value to\n"
 "      the fd of the tether. Otherwise replace the first command\n"
 "      line argument with a substring that matches N with the fd\n"
 "      of the tether. [Default: Do not advertise fd]\n"
+"  --notify\n"
+"      Provide a notification socket to the child process using the\n"
+"      sd_notify(3) protocol, and advertise it in NOTIFY_SOCKET. Only\n"
+"      publish the pidfile, and identify and announce the child process,\n"
+"      once the child sends READY=1. WATCHDOG=1 counts as activity on\n"
+"      the tether, and STOPPING=1 starts draining the tether.\n"
+"      [Default: No notification socket]\n"
 "  --orphaned | -o\n"
 "      If this process ever becomes a child of init(8), terminate the\n"
 "      child process. This option is only useful if the parent of this\n"
@@ -100,6 +194,10 @@ static const char programUsage_[] =
 "  --pidfile file | -p file\n"
 "      The pid of the child is stored in the specified file, and the files\n"
 "      is removed when the child terminates. [Default: No pidfile]\n"
+"  --pidfileformat F\n"
+"      Write the pidfile as text, or as binary with a fixed header and\n"
+"      checksum, followed by the text. Clients read either format.\n"
+"      [Default: " DEFAULT_PIDFILE_FORMAT "]\n"
 "  --pidfilemode mode | -m mode\n"
 "      Override the file mode for permissions for the pidfile. The\n"
 "      permissions can be specified in octal or symbolic form. [Default: "
@@ -107,6 +205,44 @@ static const char programUsage_[] =
 "  --quiet | -q\n"
 "      Do not copy received data from tether to stdout. This is an\n"
 "      alternative to closing stdout. [Default: Copy data from tether]\n"
+"  --references N\n"
+"      Hold at most N concurrent references to the child process from\n"
+"      clients using the pidfile. Storage for all N references, and for\n"
+"      the handshakes that precede them, is reserved at startup, and\n"
+"      further clients are refused until a reference is released.\n"
+"      [Default: Unlimited references]\n"
+"  --registry file\n"
+"      Claim a slot in the named registry shared by the sentries on the\n"
+"      host, and publish the pids, pidfile, pid server address and state\n"
+"      there so that clients can list them using --list. Failing to\n"
+"      register is reported, but is not fatal. [Default: Do not register]\n"
+"  --sharedbeat\n"
+"      Exchange heartbeats with the umbilical process using counters in\n"
+"      shared memory rather than pings over the umbilical connection. The\n"
+"      connection is still used to detect termination of either process.\n"
+"      [Default: Ping over the umbilical connection]\n"
+"  --suspicion P\n"
+"      Declare the umbilical connection failed once the phi accrual\n"
+"      suspicion level, computed from the recent round trip times of\n"
+"      umbilical pings, reaches P. The umbilical timeout U configured by\n"
+"      --timeout remains the longest time to wait for an echo. A level\n"
+"      of P suggests a chance of about 1 in 10^P that the connection is\n"
+"      healthy. The umbilical process applies the same threshold to\n"
+"      the recent intervals between pings. [Default: Wait for the\n"
+"      umbilical timeout]\n"
+"  --termplan P\n"
+"      Use the signal plan P to terminate the child process. The plan\n"
+"      comprises up to " ERT_STRINGIFY(SIGNAL_PLAN_STEPS) " comma separated steps, each of the\n"
+"      form S:T@D.\n"
+"        S  signal name (eg TERM) or number\n"
+"        T  target: pid (the child), pgid (its process group), or tree\n"
+"           (its descendants, including those that left the group)\n"
+"        D  delay before the next step, in s or ms (eg 5s or 300ms)\n"
+"      Both T and D are optional, defaulting to pid and the delay\n"
+"      configured by --timeout. The last step is repeated until the\n"
+"      child terminates, and once the child terminates, remaining steps\n"
+"      that target the pgid or tree are taken without delay.\n"
+"      [Default: P = " DEFAULT_TERMINATE_PLAN "]\n"
 "  --timeout L | -t L\n"
 "      Specify the timeout list L. The list L comprises up to four\n"
 "      comma separated values: T, U, V and W. Each of the values is either\n"
@@ -115,12 +251,18 @@ static const char programUsage_[] =
 "        T  timeout in seconds for activity on the tether, zero to disable\n"
 "        U  timeout in seconds for activity on the umbilical, zero to disable\n"
 "        V  delay in seconds between signals to terminate the child\n"
-"        W  timeout in seconds to drain data from the tether, zero to disable\n"
+"        W  timeout in seconds to drain data from the tether, zero to disable,\n"
+"           or in milliseconds if given an ms suffix\n"
 "      [Default: T,U,V,W = "
     ERT_STRINGIFY(DEFAULT_TETHER_TIMEOUT_S) ","
     ERT_STRINGIFY(DEFAULT_UMBILICAL_TIMEOUT_S) ","
     ERT_STRINGIFY(DEFAULT_SIGNAL_PERIOD_S) ","
     ERT_STRINGIFY(DEFAULT_DRAIN_TIMEOUT_S) "]\n"
+"  --umbilicaldaemon name\n"
+"      Register with the umbilical daemon listening on the named socket\n"
+"      rather than starting a dedicated umbilical process. The daemon is\n"
+"      started separately as pidumbilical name. This option cannot be\n"
+"      used with --sharedbeat. [Default: Start a dedicated umbilical]\n"
 "  --untethered | -u\n"
 "      Run child process without a tether and only watch for termination.\n"
 "      [Default: Tether child process]\n"
@@ -132,25 +274,65 @@ static const char shortOptions_[] =
 enum OptionKind
 {
     OptionTest = CHAR_MAX + 1,
+    OptionHang,
+    OptionHeartbeat,
+    OptionNotify,
+    OptionTermPlan,
+    OptionAbortPlan,
+    OptionSharedBeat,
+    OptionUmbilicalDaemon,
+    OptionSuspicion,
+    OptionReferences,
+    OptionLease,
+    OptionFanOut,
+    OptionSignal,
+    OptionStatus,
+    OptionWait,
+    OptionPrintPid,
+    OptionAttach,
+    OptionReconfigure,
+    OptionList,
+    OptionRegistry,
+    OptionPidFileFormat,
 };
 
 static struct option longOptions_[] =
 {
+    { "abortplan",  required_argument, 0, OptionAbortPlan },
     { "announce",   no_argument,       0, 'a' },
+    { "attach",     no_argument,       0, OptionAttach },
     { "client",     no_argument,       0, 'c' },
     { "debug",      no_argument,       0, 'd' },
+    { "fanout",     required_argument, 0, OptionFanOut },
     { "fd",         required_argument, 0, 'f' },
+    { "hang",       required_argument, 0, OptionHang },
+    { "heartbeat",  required_argument, 0, OptionHeartbeat },
     { "relaxed",    no_argument,       0, 'R' },
     { "identify",   no_argument,       0, 'i' },
+    { "lease",      required_argument, 0, OptionLease },
+    { "list",       no_argument,       0, OptionList },
+    { "pidfileformat", required_argument, 0, OptionPidFileFormat },
     { "pidfilemode",required_argument, 0, 'm' },
+    { "printpid",   no_argument,       0, OptionPrintPid },
     { "name",       required_argument, 0, 'n' },
+    { "notify",     no_argument,       0, OptionNotify },
     { "orphaned",   no_argument,       0, 'o' },
     { "pidfile",    required_argument, 0, 'p' },
     { "quiet",      no_argument,       0, 'q' },
+    { "reconfigure",required_argument, 0, OptionReconfigure },
+    { "references", required_argument, 0, OptionReferences },
+    { "registry",   required_argument, 0, OptionRegistry },
     { "server",     no_argument,       0, 's' },
+    { "sharedbeat", no_argument,       0, OptionSharedBeat },
+    { "signal",     required_argument, 0, OptionSignal },
+    { "status",     optional_argument, 0, OptionStatus },
+    { "suspicion",  required_argument, 0, OptionSuspicion },
+    { "termplan",   required_argument, 0, OptionTermPlan },
     { "test",       required_argument, 0, OptionTest },
     { "timeout",    required_argument, 0, 't' },
+    { "umbilicaldaemon", required_argument, 0, OptionUmbilicalDaemon },
     { "untethered", no_argument,       0, 'u' },
+    { "wait",       no_argument,       0, OptionWait },
     { 0 },
 };
 
@@ -172,52 +354,577 @@ setOptionMode(enum OptionMode  self,
 {
     enum OptionMode rc = OptionModeError;
 
-    if (OptionModeError != self)
+    if (OptionModeError != self)
+    {
+        if (OptionModeUnknown == self || aMode == self)
+            rc = aMode;
+        else
+        {
+            if (aLongOpt)
+                ert_message(0, "Incompatible option --%s", aLongOpt);
+            else
+                ert_message(0, "Incompatible option -%c", aShortOpt);
+        }
+    }
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static void
+showUsage_(void)
+{
+    const char *arg0 = ert_ownProcessName();
+
+    dprintf(STDERR_FILENO, programUsage_, arg0, arg0, arg0, arg0);
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+parsePidFileFormat_(const char *aArg, enum PidFileFormat *aFormat)
+{
+    int rc = -1;
+
+    if ( ! strcmp(aArg, "text"))
+        *aFormat = PidFileFormatText;
+    else if ( ! strcmp(aArg, "binary"))
+        *aFormat = PidFileFormatBinary;
+    else
+        ERT_ERROR_IF(
+            true,
+            {
+                errno = EINVAL;
+            });
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+setClientVerb_(enum ClientVerb aVerb, const char *aLongOptName)
+{
+    int rc = -1;
+
+    ERT_ERROR_IF(
+        ClientVerbCommand != gOptions.mClient.mVerb &&
+        aVerb             != gOptions.mClient.mVerb,
+        {
+            errno = EINVAL;
+            ert_message(
+                0, "Conflicting client verb --%s", aLongOptName);
+        });
+
+    gOptions.mClient.mVerb = aVerb;
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+parseDuration_ms_(char *aArg, unsigned *aDuration_ms)
+{
+    int rc = -1;
+
+    /* Durations are specified in seconds by default, but can be
+     * given explicit units using either an s or ms suffix. The
+     * argument is modified in place to remove the suffix. */
+
+    size_t argLen = strlen(aArg);
+
+    unsigned scale = 1000;
+
+    if (2 < argLen && ! strcmp(aArg + argLen - 2, "ms"))
+    {
+        scale = 1;
+        aArg[argLen - 2] = 0;
+    }
+    else if (1 < argLen && 's' == aArg[argLen - 1])
+    {
+        aArg[argLen - 1] = 0;
+    }
+
+    unsigned duration;
+    ERT_ERROR_IF(
+        ert_parseUInt(aArg, &duration));
+
+    ERT_ERROR_IF(
+        UINT_MAX / scale < duration,
+        {
+            errno = ERANGE;
+        });
+
+    *aDuration_ms = duration * scale;
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static const struct SignalName_
+{
+    const char *mName;
+    int         mSig;
+} signalNames_[] =
+{
+    { "HUP",  SIGHUP  },
+    { "INT",  SIGINT  },
+    { "QUIT", SIGQUIT },
+    { "ABRT", SIGABRT },
+    { "KILL", SIGKILL },
+    { "USR1", SIGUSR1 },
+    { "USR2", SIGUSR2 },
+    { "ALRM", SIGALRM },
+    { "TERM", SIGTERM },
+    { "CONT", SIGCONT },
+    { "STOP", SIGSTOP },
+    { "TSTP", SIGTSTP },
+};
+
+static ERT_CHECKED int
+parseSignalName_(const char *aArg, int *aSig)
+{
+    int rc = -1;
+
+    /* Signals are named with or without the SIG prefix, or
+     * given by number. */
+
+    const char *sigName = aArg;
+
+    if ( ! strncmp(sigName, "SIG", 3))
+        sigName += 3;
+
+    int sig = 0;
+
+    for (unsigned ix = 0; ERT_NUMBEROF(signalNames_) > ix; ++ix)
+    {
+        if ( ! strcmp(sigName, signalNames_[ix].mName))
+        {
+            sig = signalNames_[ix].mSig;
+            break;
+        }
+    }
+
+    if ( ! sig)
+    {
+        unsigned sigNum;
+        ERT_ERROR_IF(
+            ert_parseUInt(sigName, &sigNum));
+
+        ERT_ERROR_IF(
+            ! sigNum || NSIG <= sigNum,
+            {
+                errno = EINVAL;
+            });
+
+        sig = sigNum;
+    }
+
+    *aSig = sig;
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+static ERT_CHECKED int
+parseSignalPlanStep_(char *aArg, struct SignalPlanStep *aStep)
+{
+    int rc = -1;
+
+    /* Each step has the form S:T@D, where only the signal S is
+     * required. Split the step in place, starting from the end. */
+
+    aStep->mTarget    = SignalTargetPid;
+    aStep->mPeriod_ms = -1;
+
+    char *delay = strchr(aArg, '@');
+    if (delay)
+    {
+        *delay++ = 0;
+
+        unsigned period_ms;
+        ERT_ERROR_IF(
+            parseDuration_ms_(delay, &period_ms));
+
+        ERT_ERROR_IF(
+            INT_MAX < period_ms,
+            {
+                errno = ERANGE;
+            });
+
+        aStep->mPeriod_ms = period_ms;
+    }
+
+    char *target = strchr(aArg, ':');
+    if (target)
+    {
+        *target++ = 0;
+
+        if ( ! strcmp(target, "pid"))
+            aStep->mTarget = SignalTargetPid;
+        else if ( ! strcmp(target, "pgid"))
+            aStep->mTarget = SignalTargetPgid;
+        else if ( ! strcmp(target, "tree"))
+            aStep->mTarget = SignalTargetTree;
+        else
+            ERT_ERROR_IF(
+                true,
+                {
+                    errno = EINVAL;
+                });
+    }
+
+    ERT_ERROR_IF(
+        parseSignalName_(aArg, &aStep->mSig));
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+static ERT_CHECKED int
+processSignalPlanOption(const char *aArg, struct SignalPlan *aPlan)
+{
+    int rc = -1;
+
+    struct Ert_ParseArgList *argList = 0;
+
+    struct Ert_ParseArgList argList_;
+    ERT_ERROR_IF(
+        ert_createParseArgListCSV(&argList_, aArg));
+    argList = &argList_;
+
+    ERT_ERROR_IF(
+        1 > argList->mArgc || SIGNAL_PLAN_STEPS < argList->mArgc,
+        {
+            errno = EINVAL;
+        });
+
+    struct SignalPlan plan = { .mStep = { { 0 } } };
+
+    for (unsigned ix = 0; argList->mArgc > ix; ++ix)
+        ERT_ERROR_IF(
+            parseSignalPlanStep_(argList->mArgv[ix], &plan.mStep[ix]));
+
+    *aPlan = plan;
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (argList)
+            argList = ert_closeParseArgList(argList);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+void
+initOptions()
+{
+    gOptions.mServer.mTimeout.mTether_s    = DEFAULT_TETHER_TIMEOUT_S;
+    gOptions.mServer.mTimeout.mSignal_s    = DEFAULT_SIGNAL_PERIOD_S;
+    gOptions.mServer.mTimeout.mUmbilical_s = DEFAULT_UMBILICAL_TIMEOUT_S;
+    gOptions.mServer.mTimeout.mDrain_ms    = DEFAULT_DRAIN_TIMEOUT_S * 1000;
+
+    ert_ensure(
+        sizeof(gOptions.mServer.mHang.mStates) > strlen(DEFAULT_HANG_STATES));
+    strcpy(gOptions.mServer.mHang.mStates, DEFAULT_HANG_STATES);
+    gOptions.mServer.mHang.mAction = HangActionAbort;
+
+    ert_ensure(
+        sizeof(gOptions.mServer.mHeartbeat.mName) >
+            strlen(DEFAULT_HEARTBEAT_NAME));
+    strcpy(gOptions.mServer.mHeartbeat.mName, DEFAULT_HEARTBEAT_NAME);
+    gOptions.mServer.mHeartbeat.mTimeout_s = DEFAULT_HEARTBEAT_TIMEOUT_S;
+
+    gOptions.mServer.mReferences = 0;
+    gOptions.mServer.mLease_s    = DEFAULT_LEASE_S;
+
+    ert_ensure(
+        ! processSignalPlanOption(
+            DEFAULT_TERMINATE_PLAN, &gOptions.mServer.mSignalPlan.mTerminate));
+    ert_ensure(
+        ! processSignalPlanOption(
+            DEFAULT_ABORT_PLAN, &gOptions.mServer.mSignalPlan.mAbort));
+
+    ert_ensure(
+        ! ert_parseMode(
+            Ert_Mode(0), Ert_Umask(0),
+            DEFAULT_PIDFILE_MODE, &gOptions.mServer.mPidFileMode));
+    ert_ensure(
+        ! parsePidFileFormat_(
+            DEFAULT_PIDFILE_FORMAT, &gOptions.mServer.mPidFileFormat));
+
+    gOptions.mServer.mTetherFd = STDOUT_FILENO;
+    gOptions.mServer.mTether   = &gOptions.mServer.mTetherFd;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+parseTimeoutList_(const char          *aArg,
+                  struct SentryConfig *aConfig,
+                  unsigned            *aUmbilical_s)
+{
+    int rc = -1;
+
+    struct Ert_ParseArgList *argList = 0;
+
+    /* Parse the timeout list into aConfig, marking the fields that were
+     * specified. The umbilical timeout cannot be changed once the sentry
+     * is running, so aUmbilical_s is null when reconfiguring. */
+
+    struct Ert_ParseArgList argList_;
+    ERT_ERROR_IF(
+        ert_createParseArgListCSV(&argList_, aArg));
+    argList = &argList_;
+
+    ERT_ERROR_IF(
+        1 > argList->mArgc || 4 < argList->mArgc,
+        {
+            errno = EINVAL;
+        });
+
+    if (*argList->mArgv[0])
+    {
+        ERT_ERROR_IF(
+            ert_parseUInt(argList->mArgv[0], &aConfig->mTether_s));
+        aConfig->mFields |= SentryConfigTether;
+    }
+
+    if (1 < argList->mArgc && *argList->mArgv[1])
+    {
+        ERT_ERROR_IF(
+            ! aUmbilical_s,
+            {
+                errno = EINVAL;
+            });
+        ERT_ERROR_IF(
+            ert_parseUInt(argList->mArgv[1], aUmbilical_s));
+    }
+
+    if (2 < argList->mArgc && *argList->mArgv[2])
+    {
+        ERT_ERROR_IF(
+            ert_parseUInt(argList->mArgv[2], &aConfig->mSignal_s));
+        ERT_ERROR_IF(
+            0 >= aConfig->mSignal_s,
+            {
+                errno = EINVAL;
+            });
+        aConfig->mFields |= SentryConfigSignal;
+    }
+
+    if (3 < argList->mArgc && *argList->mArgv[3])
+    {
+        ERT_ERROR_IF(
+            parseDuration_ms_(argList->mArgv[3], &aConfig->mDrain_ms));
+        aConfig->mFields |= SentryConfigDrain;
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (argList)
+            argList = ert_closeParseArgList(argList);
+    });
+
+    return rc;
+}
+
+static ERT_CHECKED int
+processTimeoutOption(const char *aArg)
+{
+    int rc = -1;
+
+    struct SentryConfig config =
+    {
+        .mTether_s = gOptions.mServer.mTimeout.mTether_s,
+        .mSignal_s = gOptions.mServer.mTimeout.mSignal_s,
+        .mDrain_ms = gOptions.mServer.mTimeout.mDrain_ms,
+    };
+
+    unsigned umbilical_s = gOptions.mServer.mTimeout.mUmbilical_s;
+
+    ERT_ERROR_IF(
+        parseTimeoutList_(aArg, &config, &umbilical_s));
+
+    gOptions.mServer.mTimeout.mTether_s    = config.mTether_s;
+    gOptions.mServer.mTimeout.mUmbilical_s = umbilical_s;
+    gOptions.mServer.mTimeout.mSignal_s    = config.mSignal_s;
+    gOptions.mServer.mTimeout.mDrain_ms    = config.mDrain_ms;
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+processReconfigureOption(const char *aArg)
+{
+    int rc = -1;
+
+    /* Each reconfiguration has the form K=V, where V takes the same form
+     * as the argument of the server option named by K. */
+
+    struct SentryConfig *config = &gOptions.mClient.mConfig;
+
+    const char *value = strchr(aArg, '=');
+
+    ERT_ERROR_IF(
+        ! value,
+        {
+            errno = EINVAL;
+        });
+
+    size_t keyLen = value++ - aArg;
+
+    if (strlen("timeout") == keyLen && ! strncmp(aArg, "timeout", keyLen))
+    {
+        ERT_ERROR_IF(
+            parseTimeoutList_(value, config, 0));
+    }
+    else if (strlen("termplan") == keyLen &&
+             ! strncmp(aArg, "termplan", keyLen))
+    {
+        ERT_ERROR_IF(
+            processSignalPlanOption(value, &config->mTermPlan));
+        config->mFields |= SentryConfigTermPlan;
+    }
+    else if (strlen("abortplan") == keyLen &&
+             ! strncmp(aArg, "abortplan", keyLen))
+    {
+        ERT_ERROR_IF(
+            processSignalPlanOption(value, &config->mAbortPlan));
+        config->mFields |= SentryConfigAbortPlan;
+    }
+    else
+    {
+        ERT_ERROR_IF(
+            true,
+            {
+                errno = EINVAL;
+            });
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+processHangOption(const char *aArg)
+{
+    int rc = -1;
+
+    struct Ert_ParseArgList *argList = 0;
+
+    struct Ert_ParseArgList argList_;
+    ERT_ERROR_IF(
+        ert_createParseArgListCSV(&argList_, aArg));
+    argList = &argList_;
+
+    ERT_ERROR_IF(
+        1 > argList->mArgc || 3 < argList->mArgc,
+        {
+            errno = EINVAL;
+        });
+
+    ERT_ERROR_IF(
+        ert_parseUInt(argList->mArgv[0], &gOptions.mServer.mHang.mTimeout_s));
+
+    if (1 < argList->mArgc && *argList->mArgv[1])
+    {
+        /* Only accept the single letter states that the kernel
+         * reports in /proc/pid/task/tid/stat. */
+
+        const char *states = argList->mArgv[1];
+
+        ERT_ERROR_IF(
+            sizeof(gOptions.mServer.mHang.mStates) <= strlen(states) ||
+            strspn(states, "DIKPRSTWXZtx") != strlen(states),
+            {
+                errno = EINVAL;
+            });
+
+        strcpy(gOptions.mServer.mHang.mStates, states);
+    }
+
+    if (2 < argList->mArgc && *argList->mArgv[2])
     {
-        if (OptionModeUnknown == self || aMode == self)
-            rc = aMode;
+        const char *action = argList->mArgv[2];
+
+        if ( ! strcmp(action, "abort"))
+            gOptions.mServer.mHang.mAction = HangActionAbort;
+        else if ( ! strcmp(action, "term"))
+            gOptions.mServer.mHang.mAction = HangActionTerminate;
+        else if ( ! strcmp(action, "warn"))
+            gOptions.mServer.mHang.mAction = HangActionWarn;
         else
-        {
-            if (aLongOpt)
-                ert_message(0, "Incompatible option --%s", aLongOpt);
-            else
-                ert_message(0, "Incompatible option -%c", aShortOpt);
-        }
+            ERT_ERROR_IF(
+                true,
+                {
+                    errno = EINVAL;
+                });
     }
 
-    return rc;
-}
-
-/* -------------------------------------------------------------------------- */
-static void
-showUsage_(void)
-{
-    const char *arg0 = ert_ownProcessName();
-
-    dprintf(STDERR_FILENO, programUsage_, arg0, arg0);
-}
+    rc = 0;
 
-/* -------------------------------------------------------------------------- */
-void
-initOptions()
-{
-    gOptions.mServer.mTimeout.mTether_s    = DEFAULT_TETHER_TIMEOUT_S;
-    gOptions.mServer.mTimeout.mSignal_s    = DEFAULT_SIGNAL_PERIOD_S;
-    gOptions.mServer.mTimeout.mUmbilical_s = DEFAULT_UMBILICAL_TIMEOUT_S;
-    gOptions.mServer.mTimeout.mDrain_s     = DEFAULT_DRAIN_TIMEOUT_S;
+Ert_Finally:
 
-    ert_ensure(
-        ! ert_parseMode(
-            Ert_Mode(0), Ert_Umask(0),
-            DEFAULT_PIDFILE_MODE, &gOptions.mServer.mPidFileMode));
+    ERT_FINALLY
+    ({
+        if (argList)
+            argList = ert_closeParseArgList(argList);
+    });
 
-    gOptions.mServer.mTetherFd = STDOUT_FILENO;
-    gOptions.mServer.mTether   = &gOptions.mServer.mTetherFd;
+    return rc;
 }
 
 /* -------------------------------------------------------------------------- */
 static ERT_CHECKED int
-processTimeoutOption(const char *aArg)
+processHeartbeatOption(const char *aArg)
 {
     int rc = -1;
 
@@ -229,37 +936,38 @@ processTimeoutOption(const char *aArg)
     argList = &argList_;
 
     ERT_ERROR_IF(
-        1 > argList->mArgc || 4 < argList->mArgc,
+        1 > argList->mArgc || 3 < argList->mArgc,
         {
             errno = EINVAL;
         });
 
     ERT_ERROR_IF(
-        ert_parseUInt(argList->mArgv[0], &gOptions.mServer.mTimeout.mTether_s));
+        ert_parseUInt(argList->mArgv[0], &gOptions.mServer.mHeartbeat.mSlots));
 
     if (1 < argList->mArgc && *argList->mArgv[1])
     {
         ERT_ERROR_IF(
             ert_parseUInt(
-                argList->mArgv[1], &gOptions.mServer.mTimeout.mUmbilical_s));
+                argList->mArgv[1], &gOptions.mServer.mHeartbeat.mTimeout_s));
+        ERT_ERROR_IF(
+            0 >= gOptions.mServer.mHeartbeat.mTimeout_s,
+            {
+                errno = EINVAL;
+            });
     }
 
     if (2 < argList->mArgc && *argList->mArgv[2])
     {
+        const char *name = argList->mArgv[2];
+
         ERT_ERROR_IF(
-            ert_parseUInt(
-                argList->mArgv[2], &gOptions.mServer.mTimeout.mSignal_s));
-        ERT_ERROR_IF(
-            0 >= gOptions.mServer.mTimeout.mSignal_s,
+            sizeof(gOptions.mServer.mHeartbeat.mName) <= strlen(name),
             {
                 errno = EINVAL;
             });
-    }
 
-    if (3 < argList->mArgc && *argList->mArgv[3])
-        ERT_ERROR_IF(
-            ert_parseUInt(
-                argList->mArgv[3], &gOptions.mServer.mTimeout.mDrain_s));
+        strcpy(gOptions.mServer.mHeartbeat.mName, name);
+    }
 
     rc = 0;
 
@@ -348,6 +1056,98 @@ processOptions(int argc, char **argv, const char * const **args)
             ++options.mDebug;
             break;
 
+        case OptionFanOut:
+            mode = setOptionMode(
+                mode, OptionModeRunCommand, longOptName, opt);
+            ERT_ERROR_IF(
+                ert_parseUInt(optarg, &gOptions.mClient.mFanOut) ||
+                ! gOptions.mClient.mFanOut,
+                {
+                    errno = EINVAL;
+                    ert_message(
+                        0, "Badly formed fan out limit - '%s'", optarg);
+                });
+            break;
+
+        case OptionSignal:
+            mode = setOptionMode(
+                mode, OptionModeRunCommand, longOptName, opt);
+            ERT_ERROR_IF(
+                setClientVerb_(ClientVerbSignal, longOptName) ||
+                parseSignalName_(optarg, &gOptions.mClient.mSignal),
+                {
+                    errno = EINVAL;
+                    ert_message(0, "Badly formed signal - '%s'", optarg);
+                });
+            break;
+
+        case OptionStatus:
+            mode = setOptionMode(
+                mode, OptionModeRunCommand, longOptName, opt);
+            ERT_ERROR_IF(
+                setClientVerb_(ClientVerbStatus, longOptName) ||
+                (optarg && strcmp(optarg, "json")),
+                {
+                    errno = EINVAL;
+                    ert_message(
+                        0, "Badly formed status format - '%s'", optarg);
+                });
+            gOptions.mClient.mJson = !! optarg;
+            break;
+
+        case OptionWait:
+            mode = setOptionMode(
+                mode, OptionModeRunCommand, longOptName, opt);
+            ERT_ERROR_IF(
+                setClientVerb_(ClientVerbWait, longOptName),
+                {
+                    errno = EINVAL;
+                });
+            break;
+
+        case OptionPrintPid:
+            mode = setOptionMode(
+                mode, OptionModeRunCommand, longOptName, opt);
+            ERT_ERROR_IF(
+                setClientVerb_(ClientVerbPrintPid, longOptName),
+                {
+                    errno = EINVAL;
+                });
+            break;
+
+        case OptionAttach:
+            mode = setOptionMode(
+                mode, OptionModeRunCommand, longOptName, opt);
+            ERT_ERROR_IF(
+                setClientVerb_(ClientVerbAttach, longOptName),
+                {
+                    errno = EINVAL;
+                });
+            break;
+
+        case OptionList:
+            mode = setOptionMode(
+                mode, OptionModeRunCommand, longOptName, opt);
+            ERT_ERROR_IF(
+                setClientVerb_(ClientVerbList, longOptName),
+                {
+                    errno = EINVAL;
+                });
+            break;
+
+        case OptionReconfigure:
+            mode = setOptionMode(
+                mode, OptionModeRunCommand, longOptName, opt);
+            ERT_ERROR_IF(
+                setClientVerb_(ClientVerbReconfigure, longOptName) ||
+                processReconfigureOption(optarg),
+                {
+                    errno = EINVAL;
+                    ert_message(
+                        0, "Badly formed reconfiguration - '%s'", optarg);
+                });
+            break;
+
         case 'f':
             mode = setOptionMode(
                 mode, OptionModeMonitorChild, longOptName, opt);
@@ -370,18 +1170,149 @@ processOptions(int argc, char **argv, const char * const **args)
             }
             break;
 
+        case OptionHang:
+            mode = setOptionMode(
+                mode, OptionModeMonitorChild, longOptName, opt);
+            ERT_ERROR_IF(
+                processHangOption(optarg),
+                {
+                    errno = EINVAL;
+                    ert_message(0, "Badly formed hang detector - '%s'", optarg);
+                });
+            break;
+
+        case OptionHeartbeat:
+            mode = setOptionMode(
+                mode, OptionModeMonitorChild, longOptName, opt);
+            ERT_ERROR_IF(
+                processHeartbeatOption(optarg),
+                {
+                    errno = EINVAL;
+                    ert_message(0, "Badly formed heartbeat - '%s'", optarg);
+                });
+            break;
+
         case 'i':
             mode = setOptionMode(
                 mode, OptionModeMonitorChild, longOptName, opt);
             gOptions.mServer.mIdentify = true;
             break;
 
+        case OptionTermPlan:
+            mode = setOptionMode(
+                mode, OptionModeMonitorChild, longOptName, opt);
+            ERT_ERROR_IF(
+                processSignalPlanOption(
+                    optarg, &gOptions.mServer.mSignalPlan.mTerminate),
+                {
+                    errno = EINVAL;
+                    ert_message(0, "Badly formed signal plan - '%s'", optarg);
+                });
+            break;
+
+        case OptionAbortPlan:
+            mode = setOptionMode(
+                mode, OptionModeMonitorChild, longOptName, opt);
+            ERT_ERROR_IF(
+                processSignalPlanOption(
+                    optarg, &gOptions.mServer.mSignalPlan.mAbort),
+                {
+                    errno = EINVAL;
+                    ert_message(0, "Badly formed signal plan - '%s'", optarg);
+                });
+            break;
+
+        case OptionNotify:
+            mode = setOptionMode(
+                mode, OptionModeMonitorChild, longOptName, opt);
+            gOptions.mServer.mNotify = true;
+            break;
+
+        case OptionLease:
+            mode = setOptionMode(
+                mode, OptionModeMonitorChild, longOptName, opt);
+            ERT_ERROR_IF(
+                ert_parseUInt(optarg, &gOptions.mServer.mLease_s),
+                {
+                    errno = EINVAL;
+                    ert_message(0, "Badly formed lease - '%s'", optarg);
+                });
+            break;
+
         case 'o':
             mode = setOptionMode(
                 mode, OptionModeMonitorChild, longOptName, opt);
             gOptions.mServer.mOrphaned = true;
             break;
 
+        case OptionReferences:
+            mode = setOptionMode(
+                mode, OptionModeMonitorChild, longOptName, opt);
+            ERT_ERROR_IF(
+                ert_parseUInt(optarg, &gOptions.mServer.mReferences) ||
+                ! gOptions.mServer.mReferences,
+                {
+                    errno = EINVAL;
+                    ert_message(
+                        0, "Badly formed reference limit - '%s'", optarg);
+                });
+            break;
+
+        case OptionSharedBeat:
+            mode = setOptionMode(
+                mode, OptionModeMonitorChild, longOptName, opt);
+            gOptions.mServer.mSharedBeat = true;
+            break;
+
+        case OptionSuspicion:
+            mode = setOptionMode(
+                mode, OptionModeMonitorChild, longOptName, opt);
+            ERT_ERROR_IF(
+                ert_parseUInt(optarg, &gOptions.mServer.mSuspicion) ||
+                ! gOptions.mServer.mSuspicion,
+                {
+                    errno = EINVAL;
+                    ert_message(
+                        0, "Badly formed suspicion level - '%s'", optarg);
+                });
+            break;
+
+        case OptionRegistry:
+            mode = setOptionMode(
+                mode, OptionModeMonitorChild, longOptName, opt);
+            ERT_ERROR_UNLESS(
+                optarg[0],
+                {
+                    errno = EINVAL;
+                    ert_message(0, "Empty registry name");
+                });
+            gOptions.mServer.mRegistry = optarg;
+            break;
+
+        case OptionUmbilicalDaemon:
+            mode = setOptionMode(
+                mode, OptionModeMonitorChild, longOptName, opt);
+            ERT_ERROR_UNLESS(
+                optarg[0],
+                {
+                    errno = EINVAL;
+                    ert_message(0, "Empty umbilical daemon name");
+                });
+            gOptions.mServer.mUmbilicalDaemon = optarg;
+            break;
+
+        case OptionPidFileFormat:
+            mode = setOptionMode(
+                mode, OptionModeMonitorChild, longOptName, opt);
+            ERT_ERROR_IF(
+                parsePidFileFormat_(optarg, &gOptions.mServer.mPidFileFormat),
+                {
+                    errno = EINVAL;
+                    ert_message(
+                        0, "Unrecognised pidfile format - '%s'", optarg);
+                });
+            break;
+
         case 'm':
             mode = setOptionMode(
                 mode, OptionModeMonitorChild, longOptName, opt);
@@ -471,7 +1402,9 @@ processOptions(int argc, char **argv, const char * const **args)
         }
     }
 
-    ert_initOptions(&options);
+    gOptions.mOptions = options;
+
+    ert_initOptions(&gOptions.mOptions);
 
     ERT_ERROR_IF(
         OptionModeUnknown == mode,
@@ -489,6 +1422,31 @@ processOptions(int argc, char **argv, const char * const **args)
     case OptionModeRunCommand:
         ert_ensure(   gOptions.mClient.mActive);
         ert_ensure( ! gOptions.mServer.mActive);
+
+        /* Listing the registry does not involve any pid file, and the
+         * only argument is the optional name of the registry. */
+
+        if (ClientVerbList == gOptions.mClient.mVerb)
+        {
+            ERT_ERROR_IF(
+                gOptions.mClient.mFanOut,
+                {
+                    errno = EINVAL;
+                    ert_message(0, "Client verb unavailable with fan out");
+                });
+
+            gOptions.mClient.mRegistry =
+                optind < argc ? argv[optind++] : DEFAULT_REGISTRY;
+
+            ERT_ERROR_IF(
+                optind < argc,
+                {
+                    errno = EINVAL;
+                    ert_message(0, "Unexpected argument with registry");
+                });
+            break;
+        }
+
         ERT_ERROR_IF(
             optind >= argc,
             {
@@ -497,16 +1455,47 @@ processOptions(int argc, char **argv, const char * const **args)
             });
 
         gOptions.mClient.mPidFile = argv[optind++];
+
+        /* Client verbs act on the child process directly, so there
+         * is no command to run, and no command to fan out. */
+
+        if (ClientVerbCommand != gOptions.mClient.mVerb)
+        {
+            ERT_ERROR_IF(
+                gOptions.mClient.mFanOut,
+                {
+                    errno = EINVAL;
+                    ert_message(0, "Client verb unavailable with fan out");
+                });
+
+            ERT_ERROR_IF(
+                optind < argc,
+                {
+                    errno = EINVAL;
+                    ert_message(0, "Unexpected command with client verb");
+                });
+        }
         break;
 
     case OptionModeMonitorChild:
         ert_ensure(   gOptions.mServer.mActive);
         ert_ensure( ! gOptions.mClient.mActive);
+
+        /* The umbilical daemon serves many sentries, so it cannot map
+         * a heartbeat region shared with any single one of them. */
+
+        ERT_ERROR_IF(
+            gOptions.mServer.mSharedBeat && gOptions.mServer.mUmbilicalDaemon,
+            {
+                errno = EINVAL;
+                ert_message(
+                    0, "Shared heartbeat unavailable with umbilical daemon");
+            });
         break;
     }
 
     ERT_ERROR_IF(
-        optind >= argc,
+        optind >= argc && ClientVerbCommand == gOptions.mClient.mVerb,
         {
             errno = EINVAL;
             ert_message(0, "Missing command for execution");
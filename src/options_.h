@@ -34,11 +34,88 @@
 #include "ert/pid.h"
 #include "ert/mode.h"
 
+#include "pidfile_.h"
+
 #include <sys/types.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 ERT_BEGIN_C_SCOPE;
 
+/* -------------------------------------------------------------------------- */
+enum HangAction
+{
+    HangActionAbort,
+    HangActionTerminate,
+    HangActionWarn,
+};
+
+/* -------------------------------------------------------------------------- */
+enum SignalTarget
+{
+    SignalTargetPid,
+    SignalTargetPgid,
+    SignalTargetTree,
+};
+
+struct SignalPlanStep
+{
+    int               mSig;
+    enum SignalTarget mTarget;
+    int               mPeriod_ms;   /* Negative to use the signal period */
+};
+
+#define SIGNAL_PLAN_STEPS 8
+
+struct SignalPlan
+{
+    struct SignalPlanStep mStep[SIGNAL_PLAN_STEPS + 1]; /* Zero terminated */
+};
+
+/* -------------------------------------------------------------------------- */
+/* The subset of the server options that can be changed while the child
+ * process is running. Only the fields named in mFields are changed.
+ * The configuration is passed between processes running the same
+ * program, so native types are used throughout. */
+
+enum SentryConfigField
+{
+    SentryConfigTether    = 1 << 0,
+    SentryConfigSignal    = 1 << 1,
+    SentryConfigDrain     = 1 << 2,
+    SentryConfigTermPlan  = 1 << 3,
+    SentryConfigAbortPlan = 1 << 4,
+};
+
+#define SENTRY_CONFIG_VERSION 1
+
+struct SentryConfig
+{
+    uint32_t mVersion;
+    uint32_t mSize;
+    unsigned mFields;               /* enum SentryConfigField */
+
+    unsigned mTether_s;
+    unsigned mSignal_s;
+    unsigned mDrain_ms;
+
+    struct SignalPlan mTermPlan;
+    struct SignalPlan mAbortPlan;
+};
+
+/* -------------------------------------------------------------------------- */
+enum ClientVerb
+{
+    ClientVerbCommand,          /* Run the command against the child */
+    ClientVerbSignal,
+    ClientVerbStatus,
+    ClientVerbWait,
+    ClientVerbPrintPid,
+    ClientVerbAttach,
+    ClientVerbReconfigure,
+    ClientVerbList,
+};
+
 /* -------------------------------------------------------------------------- */
 struct Options
 {
@@ -49,6 +126,13 @@ struct Options
         bool        mActive;
         bool        mRelaxed;
         const char *mPidFile;
+        const char *mRegistry;
+        unsigned    mFanOut;
+
+        enum ClientVerb     mVerb;
+        int                 mSignal;
+        bool                mJson;
+        struct SentryConfig mConfig;
 
     } mClient;
 
@@ -58,21 +142,49 @@ struct Options
         const char     *mName;
         const char     *mPidFile;
         struct Ert_Mode mPidFileMode;
+        enum PidFileFormat mPidFileFormat;
         int             mTetherFd;
         const int      *mTether;
         bool            mIdentify;
         bool            mQuiet;
         bool            mOrphaned;
         bool            mAnnounce;
+        bool            mNotify;
+        bool            mSharedBeat;
+        const char     *mUmbilicalDaemon;
+        const char     *mRegistry;
+        unsigned        mSuspicion;
+        unsigned        mReferences;
+        unsigned        mLease_s;
 
         struct
         {
             unsigned mTether_s;
             unsigned mUmbilical_s;
             unsigned mSignal_s;
-            unsigned mDrain_s;
+            unsigned mDrain_ms;
         } mTimeout;
 
+        struct
+        {
+            struct SignalPlan mTerminate;
+            struct SignalPlan mAbort;
+        } mSignalPlan;
+
+        struct
+        {
+            unsigned        mTimeout_s;
+            char            mStates[16];
+            enum HangAction mAction;
+        } mHang;
+
+        struct
+        {
+            unsigned mSlots;
+            unsigned mTimeout_s;
+            char     mName[64];
+        } mHeartbeat;
+
     } mServer;
 
 };
@@ -0,0 +1,545 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2016, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "pidcache_.h"
+#include "pidfile_.h"
+#include "pidsignature_.h"
+
+#include "ert/error.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/inotify.h>
+#include <sys/syscall.h>
+
+/* -------------------------------------------------------------------------- */
+/* Pid Signature Cache
+ *
+ * Clients that repeatedly query the same pidfiles can use the cache to
+ * avoid reading each pidfile, and the process signature from /proc,
+ * every time. An entry remembers the pid and signature read from a
+ * pidfile, and remains valid until either the directory containing the
+ * pidfile reports a change to that name, or the pidfd of the process
+ * reports that the process has exited. Revalidating an entry requires
+ * only a read of the inotify queue, and a poll of the pidfd.
+ *
+ * The directory is watched before the pidfile is read, and the pidfd
+ * is opened before the signature is checked a second time, so that
+ * a change that races with the filling of an entry is never missed.
+ * Kernels without pidfds cannot detect that the process has exited,
+ * so entries are never filled on those kernels. */
+
+#define PIDCACHE_WATCH_MASK                             \
+    (IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | \
+     IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF)
+
+/* -------------------------------------------------------------------------- */
+static uint32_t
+hashPidCacheName_(const char *aFileName)
+{
+    uint32_t hash = 2166136261u;
+
+    for (const char *ptr = aFileName; *ptr; ++ptr)
+        hash = (hash ^ (unsigned char) *ptr) * 16777619u;
+
+    return hash;
+}
+
+/* -------------------------------------------------------------------------- */
+static void
+clearPidCacheEntry_(struct PidCacheEntry_ *self)
+{
+    free(self->mFileName);
+
+    self->mFileName  = 0;
+    self->mBaseName  = 0;
+    self->mWatch     = -1;
+    self->mSignature = destroyPidSignature(self->mSignature);
+    self->mPidFdFile = ert_closeFile(self->mPidFdFile);
+}
+
+/* -------------------------------------------------------------------------- */
+int
+createPidCache(struct PidCache *self, unsigned aSize)
+{
+    int rc = -1;
+
+    self->mNotifyFile = 0;
+    self->mEntry      = 0;
+    self->mSize       = 0;
+    self->mClock      = 0;
+    self->mHits       = 0;
+    self->mMisses     = 0;
+
+    ERT_ERROR_UNLESS(
+        aSize,
+        {
+            errno = EINVAL;
+        });
+
+    ERT_ERROR_IF(
+        ert_createFile(
+            &self->mNotifyFile_, inotify_init1(IN_NONBLOCK | IN_CLOEXEC)));
+    self->mNotifyFile = &self->mNotifyFile_;
+
+    ERT_ERROR_UNLESS(
+        self->mEntry = calloc(aSize, sizeof(*self->mEntry)));
+    self->mSize = aSize;
+
+    for (unsigned ix = 0; ix < self->mSize; ++ix)
+    {
+        self->mEntry[ix].mWatch     = -1;
+        self->mEntry[ix].mPidFdFile = 0;
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (rc)
+            self = closePidCache(self);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+struct PidCache *
+closePidCache(struct PidCache *self)
+{
+    if (self)
+    {
+        for (unsigned ix = 0; ix < self->mSize; ++ix)
+            clearPidCacheEntry_(&self->mEntry[ix]);
+
+        free(self->mEntry);
+
+        self->mEntry      = 0;
+        self->mSize       = 0;
+        self->mNotifyFile = ert_closeFile(self->mNotifyFile);
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+static void
+invalidatePidCache_(struct PidCache              *self,
+                    const struct inotify_event *aEvent)
+{
+    /* Events about the directory itself, including the removal of
+     * the watch, invalidate all the entries in the directory. */
+
+    for (unsigned ix = 0; ix < self->mSize; ++ix)
+    {
+        struct PidCacheEntry_ *entry = &self->mEntry[ix];
+
+        if ( ! entry->mFileName)
+            continue;
+
+        if ( ! (aEvent->mask & IN_Q_OVERFLOW))
+        {
+            if (aEvent->wd != entry->mWatch)
+                continue;
+
+            if (aEvent->len && strcmp(aEvent->name, entry->mBaseName))
+                continue;
+        }
+
+        ert_debug(0, "invalidate cached pidfile %s", entry->mFileName);
+
+        clearPidCacheEntry_(entry);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+drainPidCache_(struct PidCache *self)
+{
+    int rc = -1;
+
+    while (1)
+    {
+        char buf[sizeof(struct inotify_event) + NAME_MAX + 1]
+            __attribute__((__aligned__(__alignof__(struct inotify_event))));
+
+        ssize_t len = read(self->mNotifyFile->mFd, buf, sizeof(buf));
+
+        if (-1 == len)
+        {
+            if (EINTR == errno)
+                continue;
+
+            ERT_ERROR_UNLESS(
+                EAGAIN == errno || EWOULDBLOCK == errno);
+            break;
+        }
+
+        for (char *ptr = buf; ptr < buf + len; )
+        {
+            const struct inotify_event *event = (void *) ptr;
+
+            invalidatePidCache_(self, event);
+
+            ptr += sizeof(*event) + event->len;
+        }
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+pollPidCacheExit_(const struct PidCacheEntry_ *self)
+{
+    int rc = -1;
+
+    /* The pidfd becomes readable once the process has exited. */
+
+    struct pollfd pollFd =
+    {
+        .fd     = self->mPidFdFile->mFd,
+        .events = POLLIN,
+    };
+
+    int ready;
+    ERT_ERROR_IF(
+        (ready = poll(&pollFd, 1, 0),
+         -1 == ready));
+
+    rc = !! ready;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+watchPidCacheEntry_(struct PidCache       *self,
+                    struct PidCacheEntry_ *aEntry,
+                    const char            *aFileName)
+{
+    int rc = -1;
+
+    ERT_ERROR_UNLESS(
+        aEntry->mFileName = strdup(aFileName));
+
+    const char *baseName = strrchr(aEntry->mFileName, '/');
+
+    aEntry->mBaseName = baseName ? baseName + 1 : aEntry->mFileName;
+
+    size_t dirLen = aEntry->mBaseName - aEntry->mFileName;
+
+    do
+    {
+        char dirName[dirLen + 2];
+
+        if ( ! dirLen)
+            strcpy(dirName, ".");
+        else if (1 == dirLen)
+            strcpy(dirName, "/");
+        else
+        {
+            memcpy(dirName, aEntry->mFileName, dirLen - 1);
+            dirName[dirLen - 1] = 0;
+        }
+
+        ERT_ERROR_IF(
+            (aEntry->mWatch = inotify_add_watch(
+                self->mNotifyFile->mFd, dirName, PIDCACHE_WATCH_MASK),
+             -1 == aEntry->mWatch));
+
+    } while (0);
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+openPidCacheEntry_(struct PidCacheEntry_     *self,
+                   const struct PidSignature *aSignature)
+{
+    int rc = -1;
+
+    struct PidSignature *signature = 0;
+
+    int pidFd;
+
+#ifdef SYS_pidfd_open
+    pidFd = syscall(SYS_pidfd_open, aSignature->mPid.mPid, 0);
+#else
+    pidFd = -1;
+    errno = ENOSYS;
+#endif
+
+    if (-1 == pidFd)
+    {
+        ERT_ERROR_UNLESS(
+            ESRCH == errno || ENOSYS == errno);
+    }
+    else
+    {
+        ERT_ERROR_IF(
+            ert_closeFdOnExec(pidFd, O_CLOEXEC),
+            {
+                close(pidFd);
+            });
+
+        ERT_ERROR_IF(
+            ert_createFile(&self->mPidFdFile_, pidFd));
+        self->mPidFdFile = &self->mPidFdFile_;
+
+        /* The pid might have been reused before the pidfd was opened,
+         * so check that the pidfd refers to the named process. */
+
+        ERT_ERROR_IF(
+            (signature = createPidSignature(aSignature->mPid, 0),
+             ! signature && ENOENT != errno));
+
+        if (signature && ! strcmp(signature->mSignature,
+                                  aSignature->mSignature))
+            ERT_ERROR_UNLESS(
+                self->mSignature = createPidSignature(
+                    aSignature->mPid, aSignature->mSignature));
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        signature = destroyPidSignature(signature);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED struct PidSignature *
+fillPidCache_(struct PidCache    *self,
+              const char         *aFileName,
+              struct sockaddr_un *aPidServerAddr)
+{
+    int rc = -1;
+
+    struct PidSignature *signature = 0;
+
+    struct PidFile  pidFile_;
+    struct PidFile *pidFile = 0;
+
+    /* Prefer an unused entry, otherwise reuse the entry that was least
+     * recently used. */
+
+    struct PidCacheEntry_ *entry = &self->mEntry[0];
+
+    for (unsigned ix = 1; ix < self->mSize; ++ix)
+    {
+        if (entry->mFileName && (
+                ! self->mEntry[ix].mFileName ||
+                self->mEntry[ix].mUsed < entry->mUsed))
+            entry = &self->mEntry[ix];
+    }
+
+    clearPidCacheEntry_(entry);
+
+    /* Only fill the entry if the directory can be watched, but still
+     * read the pidfile and report the outcome to the caller. */
+
+    if (watchPidCacheEntry_(self, entry, aFileName))
+    {
+        ERT_ERROR_UNLESS(
+            ENOENT == errno || EACCES == errno || ENOSPC == errno);
+
+        clearPidCacheEntry_(entry);
+    }
+
+    enum Ert_PathNameStatus pathNameStatus;
+    ERT_ERROR_IF(
+        (pathNameStatus = initPidFile(&pidFile_, aFileName),
+         Ert_PathNameStatusOk != pathNameStatus),
+        {
+            if (Ert_PathNameStatusError != pathNameStatus)
+                errno = ENOENT;
+        });
+    pidFile = &pidFile_;
+
+    ERT_ERROR_IF(
+        openPidFile(pidFile, O_CLOEXEC).mPid);
+
+    ERT_ERROR_IF(
+        acquirePidFileReadLock(pidFile));
+
+    struct sockaddr_un pidServerAddr;
+    ERT_ERROR_UNLESS(
+        signature = readPidFile(pidFile, &pidServerAddr));
+
+    if (0 < signature->mPid.mPid)
+    {
+        *aPidServerAddr = pidServerAddr;
+
+        if (entry->mFileName)
+        {
+            ERT_ERROR_IF(
+                openPidCacheEntry_(entry, signature));
+
+            if (entry->mSignature)
+            {
+                entry->mHash           = hashPidCacheName_(aFileName);
+                entry->mUsed           = ++self->mClock;
+                entry->mPidServerAddr  = pidServerAddr;
+            }
+        }
+    }
+
+    if (entry->mFileName && ! entry->mSignature)
+        clearPidCacheEntry_(entry);
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        pidFile = destroyPidFile(pidFile);
+
+        if (rc)
+        {
+            signature = destroyPidSignature(signature);
+
+            clearPidCacheEntry_(entry);
+        }
+    });
+
+    return signature;
+}
+
+/* -------------------------------------------------------------------------- */
+struct PidSignature *
+lookupPidCache(struct PidCache    *self,
+               const char         *aFileName,
+               struct sockaddr_un *aPidServerAddr)
+{
+    int rc = -1;
+
+    struct PidSignature *signature = 0;
+
+    ERT_ERROR_IF(
+        drainPidCache_(self));
+
+    uint32_t hash = hashPidCacheName_(aFileName);
+
+    struct PidCacheEntry_ *entry = 0;
+
+    for (unsigned ix = 0; ix < self->mSize; ++ix)
+    {
+        struct PidCacheEntry_ *candidate = &self->mEntry[ix];
+
+        if (candidate->mSignature &&
+            hash == candidate->mHash &&
+            ! strcmp(aFileName, candidate->mFileName))
+        {
+            entry = candidate;
+            break;
+        }
+    }
+
+    if (entry)
+    {
+        int exited;
+        ERT_ERROR_IF(
+            (exited = pollPidCacheExit_(entry),
+             -1 == exited));
+
+        if (exited)
+        {
+            ert_debug(0, "cached pid %" PRId_Ert_Pid " exited",
+                      FMTd_Ert_Pid(entry->mSignature->mPid));
+
+            clearPidCacheEntry_(entry);
+            entry = 0;
+        }
+    }
+
+    if (entry)
+    {
+        ++self->mHits;
+
+        entry->mUsed    = ++self->mClock;
+        *aPidServerAddr = entry->mPidServerAddr;
+
+        ERT_ERROR_UNLESS(
+            signature = createPidSignature(
+                entry->mSignature->mPid, entry->mSignature->mSignature));
+    }
+    else
+    {
+        ++self->mMisses;
+
+        ERT_ERROR_UNLESS(
+            signature = fillPidCache_(self, aFileName, aPidServerAddr));
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (rc)
+            signature = destroyPidSignature(signature);
+    });
+
+    return signature;
+}
+
+/* -------------------------------------------------------------------------- */
@@ -34,7 +34,13 @@
 #include "ert/parse.h"
 #include "ert/mode.h"
 
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 #include <sys/file.h>
 #include <sys/un.h>
@@ -49,6 +55,41 @@
 
 #define PIDFILE_SIZE_ 1024
 
+/* -------------------------------------------------------------------------- */
+/* Binary pid file header
+ *
+ * The binary format starts with a fixed header that carries the same
+ * content as the text format, with a checksum that covers the header.
+ * The text format follows the header as a trailer so that the pidfile
+ * remains legible, but readers only use the header. */
+
+#define PIDFILE_HEADER_VERSION_ 2
+
+static const char pidFileMagic_[8] = "PIDSNTRY";
+
+struct PidFileHeader_
+{
+    char     mMagic[8];
+    uint32_t mVersion;
+    uint32_t mSize;             /* Size of this header */
+    int32_t  mPid;
+    uint32_t mChecksum;         /* Computed with this field zero */
+    uint64_t mStartTime;        /* Start time of the process in ticks */
+    char     mBootId[64];       /* System incarnation */
+    char     mPidServerAddr[    /* Abstract address without leading nul */
+        sizeof(((struct sockaddr_un *) 0)->sun_path)];
+    uint32_t mTrailerSize;      /* Size of the text that follows */
+};
+
+/* A pid file created with either format is published only when complete,
+ * and is locked before it is published. */
+
+struct PidFileRecord_
+{
+    struct Ert_Pid            mPid;
+    const struct sockaddr_un *mPidServerAddr;
+};
+
 static const struct Ert_LockType * const lockTypeRead_  = &Ert_LockTypeRead;
 static const struct Ert_LockType * const lockTypeWrite_ = &Ert_LockTypeWrite;
 
@@ -59,6 +100,31 @@ printPidFile(const struct PidFile *self, FILE *aFile)
     return fprintf(aFile, "<pidfile %p %s>", self, self->mPathName->mFileName);
 }
 
+/* -------------------------------------------------------------------------- */
+void
+setPidFileFormat(struct PidFile *self, enum PidFileFormat aFormat)
+{
+    self->mFormat = aFormat;
+}
+
+/* -------------------------------------------------------------------------- */
+static uint32_t
+checksumPidFileHeader_(const struct PidFileHeader_ *aHeader)
+{
+    struct PidFileHeader_ header = *aHeader;
+
+    header.mChecksum = 0;
+
+    uint32_t checksum = 2166136261u;
+
+    const unsigned char *ptr = (const unsigned char *) &header;
+
+    for (size_t ix = 0; sizeof(header) > ix; ++ix)
+        checksum = (checksum ^ ptr[ix]) * 16777619u;
+
+    return checksum;
+}
+
 /* -------------------------------------------------------------------------- */
 static ERT_CHECKED int
 lockPidFile_(
@@ -101,7 +167,79 @@ Ert_Finally:
 
 /* -------------------------------------------------------------------------- */
 static ERT_CHECKED struct PidSignature *
-readPidFile_(char *aBuf, struct sockaddr_un *aPidKeeperAddr)
+matchPidFile_(struct Ert_Pid      aPid,
+              const char         *aPidSignature,
+              const char         *aPidKeeperAddr,
+              struct sockaddr_un *aPidKeeperAddrOut)
+{
+    int rc = -1;
+
+    struct PidSignature *signature = 0;
+
+    size_t pidKeeperAddrLen = strlen(aPidKeeperAddr);
+
+    ERT_ERROR_IF(
+        pidKeeperAddrLen + 2 > sizeof(aPidKeeperAddrOut->sun_path),
+        {
+            errno = EADDRNOTAVAIL;
+        });
+
+    aPidKeeperAddrOut->sun_path[0] = 0;
+    memcpy(&aPidKeeperAddrOut->sun_path[1], aPidKeeperAddr, pidKeeperAddrLen);
+    memset(aPidKeeperAddrOut->sun_path + pidKeeperAddrLen + 1,
+           0,
+           sizeof(aPidKeeperAddrOut->sun_path) - pidKeeperAddrLen - 1);
+
+    ert_debug(0, "pidfile address %s", &aPidKeeperAddrOut->sun_path[1]);
+
+    ERT_ERROR_IF(
+        (signature = createPidSignature(aPid, 0),
+         ! signature && ENOENT != errno));
+
+    do
+    {
+        if (signature)
+        {
+            if ( ! strcmp(aPidSignature, signature->mSignature))
+            {
+                ert_debug(0, "pidfile signature %s", aPidSignature);
+                break;
+            }
+
+            ert_debug(
+                0,
+                "pidfile signature %s vs %s",
+                aPidSignature,
+                signature->mSignature);
+        }
+
+        /* The process either does not exist, or if it does exist the two
+         * process signatures do not match. Use Pid.mPid == 0 to
+         * distinguish this case. */
+
+        signature = destroyPidSignature(signature);
+
+        ERT_ERROR_UNLESS(
+            signature = createPidSignature(Ert_Pid(0), 0));
+
+    } while (0);
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (rc)
+            signature = destroyPidSignature(signature);
+    });
+
+    return signature;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED struct PidSignature *
+readPidFileText_(char *aBuf, struct sockaddr_un *aPidKeeperAddr)
 {
     int rc = -1;
 
@@ -134,10 +272,6 @@ readPidFile_(char *aBuf, struct sockaddr_un *aPidKeeperAddr)
         *addrPtr  = 0;
         *--endPtr = 0;
 
-        const char *pidSignature     = sigPtr + 1;
-        const char *pidKeeperAddr    = addrPtr + 1;
-        size_t      pidKeeperAddrLen = endPtr - pidKeeperAddr;
-
         struct Ert_Pid parsedPid;
         if (ert_parsePid(aBuf, &parsedPid))
             break;
@@ -145,53 +279,85 @@ readPidFile_(char *aBuf, struct sockaddr_un *aPidKeeperAddr)
         if ( ! parsedPid.mPid)
             break;
 
-        ERT_ERROR_IF(
-            pidKeeperAddrLen + 2 > sizeof(aPidKeeperAddr->sun_path),
-            {
-                errno = EADDRNOTAVAIL;
-            });
+        ERT_ERROR_UNLESS(
+            signature = matchPidFile_(
+                parsedPid, sigPtr + 1, addrPtr + 1, aPidKeeperAddr));
 
-        aPidKeeperAddr->sun_path[0] = 0;
-        memcpy(&aPidKeeperAddr->sun_path[1], pidKeeperAddr, pidKeeperAddrLen);
-        memset(aPidKeeperAddr->sun_path + pidKeeperAddrLen + 1,
-               0,
-               sizeof(aPidKeeperAddr->sun_path) - pidKeeperAddrLen - 1);
+    } while (0);
 
-        ert_debug(0, "pidfile address %s", &aPidKeeperAddr->sun_path[1]);
+     /* Use Pid.mPid == -1 to indicate that there was a problem parsing or
+     * otherwise interpreting the pid. */
 
-        ERT_ERROR_IF(
-            (signature = createPidSignature(parsedPid, 0),
-             ! signature && ENOENT != errno));
+    if ( ! signature)
+        ERT_ERROR_UNLESS(
+            signature = createPidSignature(Ert_Pid(-1), 0));
 
-        if (signature)
-        {
-            if ( ! strcmp(pidSignature, signature->mSignature))
-            {
-                ert_debug(0, "pidfile signature %s", pidSignature);
-                break;
-            }
+    rc = 0;
 
-            ert_debug(
-                0,
-                "pidfile signature %s vs %s",
-                pidSignature,
-                signature->mSignature);
-        }
+Ert_Finally:
 
-        /* The process either does not exist, or if it does exist the two
-         * process signatures do not match. Use Pid.mPid == 0 to
-         * distinguish this case. */
+    ERT_FINALLY
+    ({
+        if (rc)
+            signature = destroyPidSignature(signature);
+    });
 
-        signature = destroyPidSignature(signature);
+    return signature;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED struct PidSignature *
+readPidFileBinary_(const char         *aBuf,
+                   size_t              aBufLen,
+                   struct sockaddr_un *aPidKeeperAddr)
+{
+    int rc = -1;
+
+    struct PidSignature *signature = 0;
+
+    do
+    {
+        struct PidFileHeader_ header;
+
+        if (sizeof(header) > aBufLen)
+            break;
+
+        memcpy(&header, aBuf, sizeof(header));
+
+        if (PIDFILE_HEADER_VERSION_ != header.mVersion ||
+            sizeof(header) != header.mSize ||
+            aBufLen - sizeof(header) != header.mTrailerSize)
+            break;
+
+        if (checksumPidFileHeader_(&header) != header.mChecksum)
+            break;
+
+        if (0 >= header.mPid)
+            break;
+
+        if ( ! memchr(header.mBootId, 0, sizeof(header.mBootId)) ||
+             ! memchr(header.mPidServerAddr,
+                      0, sizeof(header.mPidServerAddr)) ||
+             ! header.mPidServerAddr[0])
+            break;
+
+        /* Reconstitute the signature from its parts so that it can be
+         * compared with the signature of the running process. */
+
+        char pidSignature[
+            sizeof(header.mBootId) + sizeof("18446744073709551615")];
+
+        ERT_ERROR_IF(
+            0 > sprintf(pidSignature,
+                        "%s:%" PRIu64, header.mBootId, header.mStartTime));
 
         ERT_ERROR_UNLESS(
-            signature = createPidSignature(Ert_Pid(0), 0));
+            signature = matchPidFile_(
+                Ert_Pid(header.mPid),
+                pidSignature, header.mPidServerAddr, aPidKeeperAddr));
 
     } while (0);
 
-     /* Use Pid.mPid == -1 to indicate that there was a problem parsing or
-     * otherwise interpreting the pid. */
-
     if ( ! signature)
         ERT_ERROR_UNLESS(
             signature = createPidSignature(Ert_Pid(-1), 0));
@@ -242,9 +408,22 @@ readPidFile(const struct PidFile *self,
 
             if ( ! lastlen)
             {
-                buf[buflen] = 0;
-                ERT_ERROR_UNLESS(
-                    signature = readPidFile_(buf, aPidKeeperAddr));
+                /* Distinguish the binary format by its magic, which
+                 * cannot start a pid file in the text format. */
+
+                if (sizeof(pidFileMagic_) <= buflen &&
+                    ! memcmp(buf, pidFileMagic_, sizeof(pidFileMagic_)))
+                {
+                    ERT_ERROR_UNLESS(
+                        signature = readPidFileBinary_(
+                            buf, buflen, aPidKeeperAddr));
+                }
+                else
+                {
+                    buf[buflen] = 0;
+                    ERT_ERROR_UNLESS(
+                        signature = readPidFileText_(buf, aPidKeeperAddr));
+                }
                 break;
             }
         }
@@ -257,7 +436,7 @@ readPidFile(const struct PidFile *self,
         char emptyPid[] = "";
 
         ERT_ERROR_UNLESS(
-            signature = readPidFile_(emptyPid, 0));
+            signature = readPidFileText_(emptyPid, 0));
 
     } while (0);
 
@@ -434,9 +613,331 @@ Ert_Finally:
     return rc;
 }
 
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+createPidFile_(struct PidFile           *self,
+               struct Ert_Pid            aPid,
+               const struct sockaddr_un *aPidServerAddr);
+
+static ERT_CHECKED int
+initPidFileContent_(struct PidFile              *self,
+                    const struct PidFileRecord_ *aRecord)
+{
+    int rc = -1;
+
+    /* Open the pidfile using lock file semantics for writing, but
+     * with readonly permissions. Use of lock file semantics ensures
+     * that the watchdog will be the owner of the pid file, and
+     * readonly permissions dissuades other processes from modifying
+     * the content. */
+
+    ERT_ERROR_IF(
+        acquirePidFileWriteLock(self));
+
+    if (aRecord)
+        ERT_ERROR_IF(
+            createPidFile_(self, aRecord->mPid, aRecord->mPidServerAddr));
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+preparePidFile_(struct PidFile               *self,
+                unsigned                      aFlags,
+                struct Ert_Mode               aMode,
+                const struct PidFileRecord_  *aRecord)
+{
+    int rc = -1;
+
+    ert_ensure( ! self->mFile);
+
+    /* Prepare the pidfile as an unnamed file in the enclosing directory,
+     * lock it, and write the content if it is already known, so that
+     * once it is given a name, other processes either find no pidfile,
+     * or find a locked pidfile that is complete once unlocked.
+     *
+     * Return 1 if the pidfile was prepared, or 0 if the file system
+     * does not support unnamed files. */
+
+    int prepared = 0;
+
+    int tmpFd = openat(self->mPathName->mDirFile->mFd,
+                       ".",
+                       O_TMPFILE | O_RDWR | aFlags,
+                       aMode.mMode);
+
+    if (-1 == tmpFd)
+        ERT_ERROR_UNLESS(
+            EOPNOTSUPP == errno || EISDIR == errno || EINVAL == errno);
+    else
+    {
+        ERT_ERROR_IF(
+            ert_createFile(&self->mFile_, tmpFd));
+        self->mFile = &self->mFile_;
+
+        ERT_ERROR_IF(
+            initPidFileContent_(self, aRecord));
+
+        prepared = 1;
+    }
+
+    rc = prepared;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (-1 == rc)
+        {
+            self->mFile = ert_closeFile(self->mFile);
+            self->mLock = 0;
+        }
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+openPidFileExclusive_(struct PidFile               *self,
+                      unsigned                      aFlags,
+                      struct Ert_Mode               aMode,
+                      const struct PidFileRecord_  *aRecord)
+{
+    int rc = -1;
+
+    ert_ensure( ! self->mFile);
+
+    /* Without support for unnamed files, the new pidfile is briefly
+     * visible while it is empty and unlocked. */
+
+    ERT_ERROR_IF(
+        ert_createFile(
+            &self->mFile_,
+            ert_openPathName(
+                self->mPathName,
+                O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | aFlags,
+                aMode)));
+    self->mFile = &self->mFile_;
+
+    ERT_ERROR_IF(
+        initPidFileContent_(self, aRecord));
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (rc)
+        {
+            self->mFile = ert_closeFile(self->mFile);
+            self->mLock = 0;
+        }
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+replacePidFile_(struct PidFile *self, const char *aProcFdName)
+{
+    int rc = -1;
+
+    int dirFd = self->mPathName->mDirFile->mFd;
+
+    /* Give the prepared pidfile a private name, then rename it over the
+     * stale pidfile so that the name always refers to a pidfile. A name
+     * left behind by an earlier process with the same pid is reused. */
+
+    char tmpName[sizeof(".pidsentry.") + sizeof(pid_t) * CHAR_BIT];
+
+    ERT_ERROR_IF(
+        0 > sprintf(tmpName,
+                    ".pidsentry.%" PRId_Ert_Pid,
+                    FMTd_Ert_Pid(ert_ownProcessId())));
+
+    int err;
+    ERT_ERROR_IF(
+        (err = linkat(AT_FDCWD, aProcFdName,
+                      dirFd, tmpName, AT_SYMLINK_FOLLOW),
+         err && EEXIST != errno));
+
+    if (err)
+    {
+        ERT_ERROR_IF(
+            unlinkat(dirFd, tmpName, 0) && ENOENT != errno);
+
+        ERT_ERROR_IF(
+            linkat(AT_FDCWD, aProcFdName,
+                   dirFd, tmpName, AT_SYMLINK_FOLLOW));
+    }
+
+    ERT_ERROR_IF(
+        renameat(dirFd, tmpName, dirFd, self->mPathName->mBaseName),
+        {
+            int renameErr = errno;
+
+            if (unlinkat(dirFd, tmpName, 0))
+                ert_warn(errno, "Unable to remove %s", tmpName);
+
+            errno = renameErr;
+        });
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
 /* -------------------------------------------------------------------------- */
 static ERT_CHECKED struct Ert_Pid
-generatePidFile_(struct PidFile *self, unsigned aFlags, struct Ert_Mode aMode)
+linkPidFile_(struct PidFile *self)
+{
+    int rc = -1;
+
+    struct PidSignature *pidSignature = 0;
+
+    struct Ert_Pid pid = Ert_Pid(-1);
+
+    struct PidFile  existing_;
+    struct PidFile *existing = 0;
+
+    ert_ensure(lockTypeWrite_ == self->mLock);
+
+    existing_.mPathName = self->mPathName;
+    existing_.mFile     = 0;
+    existing_.mLock     = 0;
+    existing_.mFormat   = self->mFormat;
+
+    char procFdName[sizeof("/proc/self/fd/") + sizeof(int) * CHAR_BIT];
+
+    ERT_ERROR_IF(
+        0 > sprintf(procFdName, "/proc/self/fd/%d", self->mFile->mFd));
+
+    /* Each attempt either links the prepared pidfile, which fails if
+     * the name is taken, finds that the name is taken by a live process,
+     * or locks a stale pidfile and replaces it. If a competitor replaced
+     * the stale pidfile first, the next attempt finds the pidfile of the
+     * competitor. The race is resolved in a bounded number of attempts,
+     * unless other processes repeatedly remove the pidfile. */
+
+    while (1)
+    {
+        int err;
+
+        ERT_TEST_RACE
+        ({
+            ERT_ERROR_IF(
+                (err = linkat(AT_FDCWD, procFdName,
+                              self->mPathName->mDirFile->mFd,
+                              self->mPathName->mBaseName,
+                              AT_SYMLINK_FOLLOW),
+                 err && EEXIST != errno));
+        });
+
+        if ( ! err)
+            break;
+
+        ERT_ERROR_IF(
+            (err = ert_createFile(
+                &existing_.mFile_,
+                ert_openPathName(self->mPathName,
+                                 O_RDONLY | O_NOFOLLOW | O_CLOEXEC,
+                                 Ert_Mode(0))),
+             err && ENOENT != errno));
+
+        if (err)
+            continue;
+
+        existing        = &existing_;
+        existing->mFile = &existing->mFile_;
+
+        ERT_ERROR_IF(
+            acquirePidFileWriteLock_(existing));
+
+        int zombie;
+        ERT_ERROR_IF(
+            (zombie = detectPidFileZombie_(existing),
+             0 > zombie));
+
+        bool replaced = false;
+
+        if ( ! zombie)
+        {
+            /* If the pidfile names a valid process then give up since
+             * it means that the requested name is already taken.
+             * Otherwise, the pidfile is either empty, or names a process
+             * that no longer exists. Holding the lock prevents competitors
+             * from replacing the pidfile at the same time. */
+
+            struct sockaddr_un pidKeeperAddr;
+            ERT_ERROR_UNLESS(
+                pidSignature = readPidFile(existing, &pidKeeperAddr));
+
+            ERT_ERROR_IF(
+                pidSignature->mPid.mPid && -1 != pidSignature->mPid.mPid,
+                {
+                    errno = EEXIST;
+                    pid   = pidSignature->mPid;
+                });
+
+            pidSignature = destroyPidSignature(pidSignature);
+
+            ert_debug(
+                0,
+                "replacing existing file %" PRIs_Ert_Method,
+                FMTs_Ert_Method(existing, printPidFile));
+
+            ERT_ERROR_IF(
+                replacePidFile_(self, procFdName));
+
+            replaced = true;
+        }
+
+        existing->mFile = ert_closeFile(existing->mFile);
+        existing->mLock = 0;
+        existing        = 0;
+
+        if (replaced)
+            break;
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (existing)
+        {
+            existing->mFile = ert_closeFile(existing->mFile);
+            existing->mLock = 0;
+        }
+
+        pidSignature = destroyPidSignature(pidSignature);
+    });
+
+    return rc ? pid : Ert_Pid(0);
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED struct Ert_Pid
+generatePidFileExclusive_(struct PidFile               *self,
+                          unsigned                      aFlags,
+                          struct Ert_Mode               aMode,
+                          const struct PidFileRecord_  *aRecord)
 {
     int rc = -1;
 
@@ -513,24 +1014,13 @@ generatePidFile_(struct PidFile *self, unsigned aFlags, struct Ert_Mode aMode)
 
         /* This is a window where another process can also race to
          * create the pidfile. Guard against that by using O_EXCL
-         * which will only allow one of the prcesses to succeed.
-         *
-         * Open the pidfile using lock file semantics for writing, but
-         * with readonly permissions. Use of lock file semantics ensures
-         * that the watchdog will be the owner of the pid file, and
-         * readonly permissions dissuades other processes from modifying
-         * the content. */
+         * which will only allow one of the processes to succeed. */
 
         ert_ensure( ! self->mFile);
         ERT_TEST_RACE
         ({
             ERT_ERROR_IF(
-                (err = ert_createFile(
-                    &self->mFile_,
-                    ert_openPathName(
-                        self->mPathName,
-                        O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | aFlags,
-                        aMode)),
+                (err = openPidFileExclusive_(self, aFlags, aMode, aRecord),
                  err && EEXIST != errno));
         });
 
@@ -553,8 +1043,60 @@ Ert_Finally:
     return rc ? pid : Ert_Pid(0);
 }
 
+/* -------------------------------------------------------------------------- */
 static ERT_CHECKED struct Ert_Pid
-openPidFile_(struct PidFile *self, unsigned aFlags, struct Ert_Mode aMode)
+generatePidFile_(struct PidFile               *self,
+                 unsigned                      aFlags,
+                 struct Ert_Mode               aMode,
+                 const struct PidFileRecord_  *aRecord)
+{
+    int rc = -1;
+
+    struct Ert_Pid pid = Ert_Pid(-1);
+
+    ert_ensure(aMode.mMode & S_IRUSR);
+    ert_ensure( ! (aFlags & ~ O_CLOEXEC));
+    ert_ensure( ! self->mFile);
+
+    /* Prefer to prepare the pidfile completely before publishing it,
+     * but fall back to creating the pidfile in place if the file system
+     * does not support unnamed files. */
+
+    int prepared;
+    ERT_ERROR_IF(
+        (prepared = preparePidFile_(self, aFlags, aMode, aRecord),
+         -1 == prepared));
+
+    if (prepared)
+        ERT_ERROR_IF(
+            (pid = linkPidFile_(self),
+             pid.mPid));
+    else
+        ERT_ERROR_IF(
+            (pid = generatePidFileExclusive_(self, aFlags, aMode, aRecord),
+             pid.mPid));
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (rc)
+        {
+            self->mFile = ert_closeFile(self->mFile);
+            self->mLock = 0;
+        }
+    });
+
+    return rc ? pid : Ert_Pid(0);
+}
+
+static ERT_CHECKED struct Ert_Pid
+openPidFile_(struct PidFile               *self,
+             unsigned                      aFlags,
+             struct Ert_Mode               aMode,
+             const struct PidFileRecord_  *aRecord)
 {
     int rc = -1;
 
@@ -587,7 +1129,7 @@ openPidFile_(struct PidFile *self, unsigned aFlags, struct Ert_Mode aMode)
                 errno = EINVAL;
             });
         ERT_ERROR_IF(
-            (pid = generatePidFile_(self, openFlags, aMode),
+            (pid = generatePidFile_(self, openFlags, aMode, aRecord),
              pid.mPid));
     }
     else
@@ -630,7 +1172,7 @@ Ert_Finally:
 struct Ert_Pid
 openPidFile(struct PidFile *self, unsigned aFlags)
 {
-    return openPidFile_(self, aFlags, Ert_Mode(0));
+    return openPidFile_(self, aFlags, Ert_Mode(0), 0);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -687,6 +1229,7 @@ initPidFile(struct PidFile *self, const char *aFileName)
 
     self->mFile     = 0;
     self->mLock     = 0;
+    self->mFormat   = PidFileFormatText;
     self->mPathName = 0;
 
     ERT_ERROR_IF(
@@ -722,6 +1265,60 @@ destroyPidFile(struct PidFile *self)
     return 0;
 }
 
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+initPidFileHeader_(struct PidFileHeader_    *self,
+                   struct Ert_Pid            aPid,
+                   const char               *aSignature,
+                   const struct sockaddr_un *aPidServerAddr)
+{
+    int rc = -1;
+
+    /* Clear the entire header, including any padding, so that the
+     * checksum is reproducible. The signature comprises the system
+     * incarnation and the start time of the process, separated by the
+     * last colon. */
+
+    memset(self, 0, sizeof(*self));
+
+    const char *sepPtr = strrchr(aSignature, ':');
+
+    ERT_ERROR_UNLESS(
+        sepPtr,
+        {
+            errno = ERANGE;
+        });
+
+    size_t bootIdLen = sepPtr - aSignature;
+
+    ERT_ERROR_IF(
+        sizeof(self->mBootId) <= bootIdLen,
+        {
+            errno = ERANGE;
+        });
+
+    ERT_ERROR_IF(
+        ert_parseUInt64(sepPtr + 1, &self->mStartTime));
+
+    memcpy(self->mMagic, pidFileMagic_, sizeof(self->mMagic));
+    memcpy(self->mBootId, aSignature, bootIdLen);
+    memcpy(self->mPidServerAddr,
+           &aPidServerAddr->sun_path[1],
+           sizeof(aPidServerAddr->sun_path) - 1);
+
+    self->mVersion = PIDFILE_HEADER_VERSION_;
+    self->mSize    = sizeof(*self);
+    self->mPid     = aPid.mPid;
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
 /* -------------------------------------------------------------------------- */
 static ERT_CHECKED int
 createPidFile_(struct PidFile           *self,
@@ -744,6 +1341,19 @@ createPidFile_(struct PidFile           *self,
 
     char buf[PIDFILE_SIZE_+1];
 
+    struct PidFileHeader_ header;
+
+    size_t headerLen = 0;
+
+    if (PidFileFormatBinary == self->mFormat)
+    {
+        ERT_ERROR_IF(
+            initPidFileHeader_(
+                &header, aPid, signature->mSignature, aPidServerAddr));
+
+        headerLen = sizeof(header);
+    }
+
     /* The Linux Standard Base Core says:
      *
      *   If the -p pidfile option is specified, and the named pidfile exists,
@@ -756,26 +1366,39 @@ createPidFile_(struct PidFile           *self,
      * The Fedora implementation (FC12) reads all lines in the specified
      * pidfile, stopping on the first blank line. */
 
-    int buflen =
+    int textLen =
         snprintf(
-            buf, sizeof(buf),
+            buf + headerLen, sizeof(buf) - headerLen,
             "%" PRId_Ert_Pid "\n\n%s\n%s\n",
             FMTd_Ert_Pid(aPid),
             signature->mSignature,
             &aPidServerAddr->sun_path[1]);
 
     ERT_ERROR_IF(
-        0 > buflen,
+        0 > textLen,
         {
             errno = EIO;
         });
 
     ERT_ERROR_IF(
-        ! buflen || sizeof(buf) <= buflen,
+        ! textLen || sizeof(buf) - headerLen <= textLen,
         {
             errno = ERANGE;
         });
 
+    /* The text follows the binary header as a trailer, and the checksum
+     * is computed only once the size of the trailer is known. */
+
+    if (headerLen)
+    {
+        header.mTrailerSize = textLen;
+        header.mChecksum    = checksumPidFileHeader_(&header);
+
+        memcpy(buf, &header, headerLen);
+    }
+
+    size_t buflen = headerLen + textLen;
+
     /* Separate the formatting of the signature from the actual IO
      * so that it is possible to determine if there is a formatting
      * error, or an IO error. */
@@ -799,11 +1422,10 @@ Ert_Finally:
 }
 
 /* -------------------------------------------------------------------------- */
-struct Ert_Pid
-createPidFile(struct PidFile           *self,
-              struct Ert_Pid            aPid,
-              const struct sockaddr_un *aPidServerAddr,
-              struct Ert_Mode           aMode)
+static ERT_CHECKED struct Ert_Pid
+reservePidFile_(struct PidFile               *self,
+                struct Ert_Mode               aMode,
+                const struct PidFileRecord_  *aRecord)
 {
     int rc = -1;
 
@@ -838,31 +1460,33 @@ createPidFile(struct PidFile           *self,
 
         struct Ert_Pid openedPid = Ert_Pid(-1);
         ERT_ERROR_IF(
-            (openedPid = openPidFile_(self, O_CLOEXEC | O_CREAT, aMode),
+            (openedPid = openPidFile_(
+                self, O_CLOEXEC | O_CREAT, aMode, aRecord),
              openedPid.mPid),
             {
                 if (EEXIST == errno)
                     pid = openedPid;
             });
 
-        /* It is not possible to create the pidfile and acquire a flock
-         * as an atomic operation. The flock can only be acquired after
-         * the pidfile exists. Since this newly created pidfile is empty,
-         * it resembles an closed pidfile, and in the intervening time,
-         * another process might have removed it and replaced it with
-         * another, turning the pidfile held by this process into a zombie. */
+        /* The new pidfile is returned locked. If the pidfile could not
+         * be prepared before being linked into the directory, the flock
+         * could only be acquired after the pidfile was created. Since the
+         * newly created pidfile was empty, it resembled a closed pidfile,
+         * and in the intervening time, another process might have removed
+         * it and replaced it with another, turning the pidfile held by
+         * this process into a zombie. */
 
-        ERT_ERROR_IF(
-            acquirePidFileWriteLock(self));
+        ert_ensure(lockTypeWrite_ == self->mLock);
 
         ERT_ERROR_IF(
             (zombie = detectPidFileZombie_(self),
              0 > zombie));
     }
 
-    /* At this point, this process has a newly created, empty and locked
-     * pidfile. The pidfile cannot be deleted because a write lock must
-     * be held for deletion to occur. */
+    /* At this point, this process has a newly created and locked
+     * pidfile, that is empty unless its content was provided. The pidfile
+     * cannot be deleted because a write lock must be held for deletion
+     * to occur. */
 
     ert_debug(
         0,
@@ -870,6 +1494,38 @@ createPidFile(struct PidFile           *self,
         FMTs_Ert_Method(self, printPidFile),
         FMTs_Ert_Mode(aMode));
 
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        ert_finally_warn_if(rc, self, printPidFile);
+    });
+
+    return rc ? pid : Ert_Pid(0);
+}
+
+struct Ert_Pid
+reservePidFile(struct PidFile *self, struct Ert_Mode aMode)
+{
+    return reservePidFile_(self, aMode, 0);
+}
+
+/* -------------------------------------------------------------------------- */
+int
+publishPidFile(struct PidFile           *self,
+               struct Ert_Pid            aPid,
+               const struct sockaddr_un *aPidServerAddr)
+{
+    int rc = -1;
+
+    ERT_ERROR_UNLESS(
+        self->mFile && lockTypeWrite_ == self->mLock,
+        {
+            errno = EINVAL;
+        });
+
     ERT_ERROR_IF(
         createPidFile_(self, aPid, aPidServerAddr));
 
@@ -890,7 +1546,32 @@ Ert_Finally:
         ert_finally_warn_if(rc, self, printPidFile);
     });
 
-    return rc ? pid : Ert_Pid(0);;
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+struct Ert_Pid
+createPidFile(struct PidFile           *self,
+              struct Ert_Pid            aPid,
+              const struct sockaddr_un *aPidServerAddr,
+              struct Ert_Mode           aMode)
+{
+    /* Provide the content when creating the pidfile so that it is
+     * written before the pidfile is visible, leaving only the flock
+     * to be released. */
+
+    struct PidFileRecord_ record =
+    {
+        .mPid           = aPid,
+        .mPidServerAddr = aPidServerAddr,
+    };
+
+    struct Ert_Pid pid = reservePidFile_(self, aMode, &record);
+
+    if ( ! pid.mPid && releasePidFileLock_(self))
+        pid = Ert_Pid(-1);
+
+    return pid;
 }
 
 /* -------------------------------------------------------------------------- */
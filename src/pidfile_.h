@@ -42,6 +42,12 @@ struct sockaddr_un;
 
 struct PidSignature;
 
+enum PidFileFormat
+{
+    PidFileFormatText   = 1,    /* Four lines of text */
+    PidFileFormatBinary = 2,    /* Fixed header followed by the text */
+};
+
 struct PidFile
 {
     struct Ert_PathName        mPathName_;
@@ -49,6 +55,7 @@ struct PidFile
     struct Ert_File            mFile_;
     struct Ert_File           *mFile;
     const struct Ert_LockType *mLock;
+    enum PidFileFormat         mFormat;
 };
 
 /* -------------------------------------------------------------------------- */
@@ -58,6 +65,9 @@ initPidFile(struct PidFile *self, const char *aFileName);
 int
 printPidFile(const struct PidFile *self, FILE *aFile);
 
+void
+setPidFileFormat(struct PidFile *self, enum PidFileFormat aFormat);
+
 ERT_CHECKED struct PidFile *
 destroyPidFile(struct PidFile *self);
 
@@ -77,6 +87,14 @@ acquirePidFileWriteLock(struct PidFile *self);
 ERT_CHECKED int
 acquirePidFileReadLock(struct PidFile *self);
 
+ERT_CHECKED struct Ert_Pid
+reservePidFile(struct PidFile *self, struct Ert_Mode aMode);
+
+ERT_CHECKED int
+publishPidFile(struct PidFile           *self,
+               struct Ert_Pid            aPid,
+               const struct sockaddr_un *aPidServerAddr);
+
 ERT_CHECKED struct Ert_Pid
 createPidFile(struct PidFile           *self,
               struct Ert_Pid            aPid,
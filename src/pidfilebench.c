@@ -0,0 +1,447 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2016, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "pidfilebench.h"
+
+#include "pidfile_.h"
+
+#include "options_.h"
+
+#include "ert/process.h"
+#include "ert/timekeeping.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/resource.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+/* -------------------------------------------------------------------------- */
+/* Pidfile Creation Race
+ *
+ * Fork a number of sentries that race to create the same pidfile, either
+ * when no pidfile exists, or when a stale pidfile was left behind. Report
+ * the time taken until the winner has created the pidfile, and the cpu
+ * time consumed by the losers before they give up.
+ *
+ * Usage: pidfilebench [-d ...] [sentries] [rounds] */
+
+#define PIDFILEBENCH_SENTRIES 16
+#define PIDFILEBENCH_ROUNDS   100
+
+struct RaceResult_
+{
+    pid_t    mPid;
+    int      mWon;
+    uint64_t mTime_ns;
+};
+
+/* -------------------------------------------------------------------------- */
+static double
+ownCpuSeconds_(const struct rusage *aUsage)
+{
+    return aUsage->ru_utime.tv_sec + aUsage->ru_utime.tv_usec / 1e6 +
+           aUsage->ru_stime.tv_sec + aUsage->ru_stime.tv_usec / 1e6;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+raceSentry_(const char *aPidFileName,
+            int         aStartFd,
+            int         aResultFd,
+            int         aReleaseFd)
+{
+    int rc = -1;
+
+    struct PidFile  pidFile_;
+    struct PidFile *pidFile = 0;
+
+    struct RaceResult_ result =
+    {
+        .mPid = ert_ownProcessId().mPid,
+    };
+
+    ERT_ERROR_IF(
+        Ert_PathNameStatusOk != initPidFile(&pidFile_, aPidFileName));
+    pidFile = &pidFile_;
+
+    /* Wait until the start of the race is signalled by the closing of
+     * the start pipe, so that all the sentries race together. */
+
+    char buf[1];
+    ERT_ERROR_IF(
+        -1 == read(aStartFd, buf, sizeof(buf)));
+
+    struct sockaddr_un pidServerAddr =
+    {
+        .sun_family = AF_UNIX,
+        .sun_path   = "\0pidfilebench",
+    };
+
+    struct Ert_Pid pid;
+    ERT_ERROR_IF(
+        (pid = createPidFile(pidFile,
+                             ert_ownProcessId(),
+                             &pidServerAddr,
+                             gOptions.mServer.mPidFileMode),
+         -1 == pid.mPid));
+
+    result.mWon     = ! pid.mPid;
+    result.mTime_ns = ert_monotonicTime().monotonic.ns;
+
+    ERT_ERROR_IF(
+        sizeof(result) != write(aResultFd, &result, sizeof(result)));
+
+    /* The winner must remain alive until all the losers have finished,
+     * otherwise a loser could find the pidfile stale and replace it. */
+
+    ERT_ERROR_IF(
+        -1 == read(aReleaseFd, buf, sizeof(buf)));
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        pidFile = destroyPidFile(pidFile);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+runRace_(const char *aPidFileName,
+         unsigned    aSentries,
+         bool        aStale,
+         double     *aWinnerSeconds,
+         double     *aLoserSeconds)
+{
+    int rc = -1;
+
+    int startPipe[2]   = { -1, -1 };
+    int resultPipe[2]  = { -1, -1 };
+    int releasePipe[2] = { -1, -1 };
+
+    unsigned children = 0;
+    unsigned winners  = 0;
+
+    double loserSeconds = 0;
+
+    pid_t *loserPids = 0;
+
+    if (aStale)
+    {
+        /* Leave behind an empty pidfile to mimic a sentry that
+         * was killed before it could complete its pidfile. */
+
+        int fd;
+        ERT_ERROR_IF(
+            (fd = open(aPidFileName, O_WRONLY | O_CREAT | O_EXCL, 0444),
+             -1 == fd));
+        ERT_ERROR_IF(
+            close(fd));
+    }
+
+    ERT_ERROR_IF(
+        pipe2(startPipe, O_CLOEXEC) ||
+        pipe2(resultPipe, O_CLOEXEC) ||
+        pipe2(releasePipe, O_CLOEXEC));
+
+    ERT_ERROR_UNLESS(
+        loserPids = calloc(aSentries, sizeof(*loserPids)));
+
+    for (; aSentries > children; ++children)
+    {
+        pid_t childPid;
+        ERT_ERROR_IF(
+            (childPid = fork(),
+             -1 == childPid));
+
+        if ( ! childPid)
+        {
+            close(startPipe[1]);
+            close(resultPipe[0]);
+            close(releasePipe[1]);
+
+            _exit(raceSentry_(aPidFileName,
+                              startPipe[0],
+                              resultPipe[1],
+                              releasePipe[0])
+                  ? EXIT_FAILURE : EXIT_SUCCESS);
+        }
+    }
+
+    close(startPipe[0]);
+    startPipe[0] = -1;
+    close(resultPipe[1]);
+    resultPipe[1] = -1;
+    close(releasePipe[0]);
+    releasePipe[0] = -1;
+
+    uint64_t since_ns = ert_monotonicTime().monotonic.ns;
+
+    close(startPipe[1]);
+    startPipe[1] = -1;
+
+    uint64_t winner_ns = since_ns;
+    unsigned losers    = 0;
+
+    for (unsigned ix = 0; aSentries > ix; ++ix)
+    {
+        struct RaceResult_ result;
+        ERT_ERROR_IF(
+            sizeof(result) != read(resultPipe[0], &result, sizeof(result)),
+            {
+                errno = EPIPE;
+            });
+
+        if (result.mWon)
+        {
+            ++winners;
+            winner_ns = result.mTime_ns;
+        }
+        else
+        {
+            loserPids[losers++] = result.mPid;
+        }
+    }
+
+    ERT_ERROR_IF(
+        1 != winners,
+        {
+            errno = EEXIST;
+        });
+
+    close(releasePipe[1]);
+    releasePipe[1] = -1;
+
+    for (; children; --children)
+    {
+        int           status;
+        struct rusage usage;
+
+        pid_t childPid;
+        ERT_ERROR_IF(
+            (childPid = wait4(-1, &status, 0, &usage),
+             -1 == childPid));
+
+        ERT_ERROR_UNLESS(
+            WIFEXITED(status) && ! WEXITSTATUS(status),
+            {
+                errno = ECHILD;
+            });
+
+        for (unsigned ix = 0; losers > ix; ++ix)
+        {
+            if (loserPids[ix] == childPid)
+            {
+                loserSeconds += ownCpuSeconds_(&usage);
+                break;
+            }
+        }
+    }
+
+    *aWinnerSeconds = (winner_ns - since_ns) / 1e9;
+    *aLoserSeconds  = loserSeconds;
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        for (unsigned px = 0; 2 > px; ++px)
+        {
+            if (-1 != startPipe[px])
+                close(startPipe[px]);
+            if (-1 != resultPipe[px])
+                close(resultPipe[px]);
+            if (-1 != releasePipe[px])
+                close(releasePipe[px]);
+        }
+
+        for (; children; --children)
+            waitpid(-1, 0, 0);
+
+        free(loserPids);
+
+        if (unlink(aPidFileName) && ENOENT != errno)
+            ert_warn(errno, "Unable to remove %s", aPidFileName);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+runPidFileBench_(unsigned aSentries, unsigned aRounds)
+{
+    int rc = -1;
+
+    char  dirName_[] = "/tmp/pidfilebench.XXXXXX";
+    char *dirName    = 0;
+
+    char pidFileName[sizeof(dirName_) + sizeof("/pidfile")];
+
+    ERT_ERROR_UNLESS(
+        dirName = mkdtemp(dirName_));
+
+    ERT_ERROR_IF(
+        0 > sprintf(pidFileName, "%s/pidfile", dirName));
+
+    static const struct
+    {
+        const char *mName;
+        bool        mStale;
+    } races[] =
+    {
+        { "fresh", false },
+        { "stale", true },
+    };
+
+    for (unsigned rx = 0; ERT_NUMBEROF(races) > rx; ++rx)
+    {
+        double winnerSeconds = 0;
+        double loserSeconds  = 0;
+
+        for (unsigned ix = 0; aRounds > ix; ++ix)
+        {
+            double winner;
+            double loser;
+
+            ERT_ERROR_IF(
+                runRace_(pidFileName,
+                         aSentries, races[rx].mStale, &winner, &loser));
+
+            winnerSeconds += winner;
+            loserSeconds  += loser;
+        }
+
+        printf("%s %u sentries %u rounds "
+               "winner %.1fus/round losers %.1fus/loser\n",
+               races[rx].mName,
+               aSentries,
+               aRounds,
+               winnerSeconds * 1e6 / aRounds,
+               1 < aSentries
+               ? loserSeconds * 1e6 / aRounds / (aSentries - 1) : 0);
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        /* Removal of the directory fails if the race left behind
+         * any private names used to replace stale pidfiles. */
+
+        if (dirName && rmdir(dirName))
+            ert_warn(errno, "Unable to remove %s", dirName);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+main(int argc, char **argv)
+{
+    struct Ert_ExitCode exitCode = { EXIT_FAILURE };
+
+    struct Ert_TestModule  testModule_;
+    struct Ert_TestModule *testModule = 0;
+
+    struct Ert_TimeKeepingModule  timeKeepingModule_;
+    struct Ert_TimeKeepingModule *timeKeepingModule = 0;
+
+    struct Ert_ProcessModule  processModule_;
+    struct Ert_ProcessModule *processModule = 0;
+
+    ERT_ABORT_IF(
+        Ert_Test_init(&testModule_, "PIDSENTRY_TEST_ERROR"));
+    testModule = &testModule_;
+
+    ERT_ABORT_IF(
+        Ert_Timekeeping_init(&timeKeepingModule_));
+    timeKeepingModule = &timeKeepingModule_;
+
+    ERT_ABORT_IF(
+        Ert_Process_init(&processModule_, argv[0]));
+    processModule = &processModule_;
+
+    initOptions();
+
+    int argi = 1;
+
+    for ( ; argi < argc && ! strcmp(argv[argi], "-d"); ++argi)
+        ++gOptions.mOptions.mDebug;
+
+    unsigned sentries = PIDFILEBENCH_SENTRIES;
+    unsigned rounds   = PIDFILEBENCH_ROUNDS;
+
+    ERT_ABORT_IF(
+        argi + 2 < argc ||
+        (argi < argc &&
+         (ert_parseUInt(argv[argi++], &sentries) || ! sentries)) ||
+        (argi < argc &&
+         (ert_parseUInt(argv[argi++], &rounds) || ! rounds)),
+        {
+            ert_terminate(
+                0, "Usage: %s [-d ...] [sentries] [rounds]", argv[0]);
+        });
+
+    ert_initOptions(&gOptions.mOptions);
+
+    ERT_ABORT_IF(
+        runPidFileBench_(sentries, rounds),
+        {
+            ert_terminate(errno, "Failed to run pidfile benchmark");
+        });
+
+    exitCode.mStatus = EXIT_SUCCESS;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    processModule     = Ert_Process_exit(processModule);
+    timeKeepingModule = Ert_Timekeeping_exit(timeKeepingModule);
+    testModule        = Ert_Test_exit(testModule);
+
+    return exitCode.mStatus;
+}
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,155 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2016, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef PIDHEARTBEAT_H
+#define PIDHEARTBEAT_H
+
+/* Heartbeat Region
+ *
+ * This header is for use by child processes running under pidsentry
+ * with --heartbeat. It has no dependencies beyond libc and can be copied
+ * into the source tree of the child program.
+ *
+ * The watchdog shares a memory region with the child process, and
+ * advertises its file descriptor in the same way as --name does for the
+ * tether. Each thread of the child claims a slot, and indicates progress
+ * by incrementing the counter in its slot. The watchdog samples the
+ * counters periodically, and takes action if an active slot stops
+ * advancing. A slot is only monitored once its counter is non-zero, and
+ * can be retired by setting its counter back to zero.
+ *
+ *    struct PidHeartbeat *hb = pidHeartbeatAttach(getenv("HEARTBEAT"));
+ *
+ *    while (work())
+ *        pidHeartbeatBeat(hb, slot);
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* -------------------------------------------------------------------------- */
+#define PIDHEARTBEAT_MAGIC   0x50534842u    /* PSHB */
+#define PIDHEARTBEAT_VERSION 1u
+
+struct PidHeartbeatSlot
+{
+    /* Pad each slot to a cache line so that threads incrementing
+     * adjacent slots do not contend. */
+
+    uint64_t mCount;
+    uint64_t mPad_[7];
+};
+
+struct PidHeartbeat
+{
+    uint32_t mMagic;
+    uint32_t mVersion;
+    uint32_t mSlots;
+    uint32_t mReserved_[13];
+
+    struct PidHeartbeatSlot mSlot[];
+};
+
+/* -------------------------------------------------------------------------- */
+static inline size_t
+pidHeartbeatSize(unsigned aSlots)
+{
+    return sizeof(struct PidHeartbeat) +
+        aSlots * sizeof(struct PidHeartbeatSlot);
+}
+
+/* -------------------------------------------------------------------------- */
+static inline struct PidHeartbeat *
+pidHeartbeatAttach(const char *aFd)
+{
+    struct PidHeartbeat *self = 0;
+
+    if (aFd && *aFd)
+    {
+        char *end;
+        long  fd = strtol(aFd, &end, 10);
+
+        if ( ! *end && 0 <= fd)
+        {
+            struct PidHeartbeat *header = (struct PidHeartbeat *) mmap(
+                0, sizeof(*header), PROT_READ, MAP_SHARED, (int) fd, 0);
+
+            if (MAP_FAILED != header)
+            {
+                uint32_t magic   = header->mMagic;
+                uint32_t version = header->mVersion;
+                uint32_t slots   = header->mSlots;
+
+                munmap(header, sizeof(*header));
+
+                if (PIDHEARTBEAT_MAGIC == magic &&
+                    PIDHEARTBEAT_VERSION == version)
+                {
+                    self = (struct PidHeartbeat *) mmap(
+                        0, pidHeartbeatSize(slots),
+                        PROT_READ | PROT_WRITE, MAP_SHARED, (int) fd, 0);
+
+                    if (MAP_FAILED == self)
+                        self = 0;
+                }
+            }
+        }
+    }
+
+    return self;
+}
+
+/* -------------------------------------------------------------------------- */
+static inline void
+pidHeartbeatBeat(struct PidHeartbeat *self, unsigned aSlot)
+{
+    if (self && aSlot < self->mSlots)
+        __atomic_fetch_add(&self->mSlot[aSlot].mCount, 1, __ATOMIC_RELAXED);
+}
+
+/* -------------------------------------------------------------------------- */
+static inline void
+pidHeartbeatRetire(struct PidHeartbeat *self, unsigned aSlot)
+{
+    if (self && aSlot < self->mSlots)
+        __atomic_store_n(&self->mSlot[aSlot].mCount, 0, __ATOMIC_RELAXED);
+}
+
+/* -------------------------------------------------------------------------- */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PIDHEARTBEAT_H */
@@ -28,53 +28,176 @@
 */
 
 #include "pidserver.h"
+#include "sentrystatus.h"
+#include "tether.h"
+#include "options_.h"
 
-#include "ert/deadline.h"
+#include "ert/pipe.h"
+#include "ert/socket.h"
 
 #include <unistd.h>
-#include <stdlib.h>
+#include <fcntl.h>
+#include <string.h>
+
+#include <sys/timerfd.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+#define PIDSERVER_HANDSHAKE_TIMEOUT_S 30
+
+#define PIDSERVER_EVENT_BATCH   64  /* Events collected by each poll */
+#define PIDSERVER_CLEAN_BATCHES 16  /* Polls for each clean of the server */
+#define PIDSERVER_SLAB_RECORDS  64  /* Records in each chunk of the slabs */
+#define PIDSERVER_HANDSHAKES    16  /* Handshakes reserved beyond the limit */
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+armPidServerTimer_(struct PidServer *self);
+
+/* -------------------------------------------------------------------------- */
+#define PRIs_ucred "s"                      \
+                   "uid %" PRId_Ert_Uid " " \
+                   "gid %" PRId_Ert_Gid " " \
+                   "pid %" PRId_Ert_Pid
+
+#define FMTs_ucred(Ucred)                \
+    "",                                  \
+    FMTd_Ert_Uid(Ert_Uid((Ucred).uid)),  \
+    FMTd_Ert_Gid(Ert_Gid((Ucred).gid)),  \
+    FMTd_Ert_Pid(Ert_Pid((Ucred).pid))
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED struct PidServerClient_ *
+closePidServerClient_(struct PidServerClient_ *self)
+{
+    if (self)
+    {
+        self->mUnixSocket = ert_closeUnixSocket(self->mUnixSocket);
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+createPidServerClient_(struct PidServerClient_ *self,
+                       struct Ert_UnixSocket   *aSocket)
+{
+    int rc = -1;
+
+    self->mUnixSocket = 0;
+
+    ERT_ERROR_IF(
+        ert_acceptUnixSocket(&self->mUnixSocket_, aSocket),
+        {
+            if (EWOULDBLOCK != errno)
+                ert_warn(errno, "Unable to accept connection");
+        });
+    self->mUnixSocket = &self->mUnixSocket_;
+
+    ERT_ERROR_IF(
+        ert_ownUnixSocketPeerCred(self->mUnixSocket, &self->mCred));
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (rc)
+            self = closePidServerClient_(self);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static bool
+trustPidServerClient_(const struct PidServerClient_ *self)
+{
+    /* Only clients running as the same user as the server, or as
+     * root, are served. */
+
+    return geteuid() == self->mCred.uid || ! self->mCred.uid;
+}
 
 /* -------------------------------------------------------------------------- */
 static ERT_CHECKED struct PidServerClientActivity_ *
-closePidServerClientActivity_(struct PidServerClientActivity_ *self)
+closePidServerClientActivity_(struct PidServer                *aServer,
+                              struct PidServerClientActivity_ *self)
 {
     if (self)
     {
         ert_ensure( ! self->mList);
 
-        self->mEvent = ert_closeFileEventQueueActivity(self->mEvent);
+        self->mEvent  = ert_closeFileEventQueueActivity(self->mEvent);
+        self->mClient = closePidServerClient_(self->mClient);
 
-        free(self);
+        freeSlab(aServer->mReceiverSlab, self->mReceiver);
+        freeSlab(aServer->mActivitySlab, self);
     }
 
     return 0;
 }
 
 static ERT_CHECKED struct PidServerClientActivity_*
-createPidServerClientActivity_(
-    struct PidServerClient_               *aClient,
-    struct Ert_FileEventQueue             *aQueue,
-    struct PidServerClientActivityMethod_  aMethod)
+createPidServerClientActivity_(struct PidServer *aServer)
 {
     int rc = -1;
 
+    /* Each connection is held in a single record taken from the slab
+     * of the server, so that a storm of connections does not churn
+     * the heap. Return 0 with EWOULDBLOCK if there is no connection
+     * waiting to be accepted. */
+
     struct PidServerClientActivity_ *self = 0;
 
     ERT_ERROR_UNLESS(
-        (self = malloc(sizeof(*self))));
+        (self = allocSlab(aServer->mActivitySlab)));
 
-    self->mList   = 0;
-    self->mEvent  = 0;
-    self->mClient = aClient;
-    self->mMethod = aMethod;
+    self->mList     = 0;
+    self->mEvent    = 0;
+    self->mClient   = 0;
+    self->mReceiver = 0;
+    self->mSince    = (struct Ert_EventClockTime) ERT_EVENTCLOCKTIME_INIT;
+    self->mWaiting  = false;
+
+    ERT_ERROR_IF(
+        createPidServerClient_(&self->mClient_, aServer->mUnixSocket));
+    self->mClient = &self->mClient_;
 
     ERT_ERROR_IF(
         ert_createFileEventQueueActivity(
             &self->mEvent_,
-            aQueue,
-            aClient->mUnixSocket->mSocket->mFile));
+            aServer->mEventQueue,
+            self->mClient->mUnixSocket->mSocket->mFile));
     self->mEvent = &self->mEvent_;
 
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (rc)
+            self = closePidServerClientActivity_(aServer, self);
+    });
+
+    return self;
+}
+
+static ERT_CHECKED int
+armPidServerClientActivity_(
+    struct PidServerClientActivity_       *self,
+    struct PidServerClientActivityMethod_  aMethod)
+{
+    int rc = -1;
+
+    /* Activities on the event queue fire only once, so each is armed
+     * again with the method to run when the client is next readable. */
+
+    self->mMethod = aMethod;
+
     ERT_ERROR_IF(
         ert_armFileEventQueueActivity(
             self->mEvent,
@@ -93,61 +216,214 @@ createPidServerClientActivity_(
 
 Ert_Finally:
 
-    ERT_FINALLY
-    ({
-        if (rc)
-            self = closePidServerClientActivity_(self);
-    });
+    ERT_FINALLY({});
 
-    return self;
+    return rc;
 }
 
 /* -------------------------------------------------------------------------- */
-#define PRIs_ucred "s"                      \
-                   "uid %" PRId_Ert_Uid " " \
-                   "gid %" PRId_Ert_Gid " " \
-                   "pid %" PRId_Ert_Pid
+static ERT_CHECKED int
+initPidServer_(struct PidServer *self, struct Ert_Pid aPid)
+{
+    int rc = -1;
 
-#define FMTs_ucred(Ucred)                \
-    "",                                  \
-    FMTd_Ert_Uid(Ert_Uid((Ucred).uid)),  \
-    FMTd_Ert_Gid(Ert_Gid((Ucred).gid)),  \
-    FMTd_Ert_Pid(Ert_Pid((Ucred).pid))
+    /* Initialise the parts of the pid server that are common to
+     * creating a new pid server, and to adopting the listening socket
+     * of an existing pid server. */
+
+    self->mUnixSocket   = 0;
+    self->mEventQueue   = 0;
+    self->mPidSignature = 0;
+    self->mStatus       = 0;
+    self->mUmbilicalFd  = -1;
+    self->mTimerFile    = 0;
+    self->mTimerEvent   = 0;
+    self->mPidFdFile    = 0;
+    self->mReferences   = 0;
+    self->mHeld         = 0;
+    self->mDiscards     = 0;
+    self->mExited       = false;
+    self->mExitSince    = (struct Ert_EventClockTime) ERT_EVENTCLOCKTIME_INIT;
+
+    createSlab(&self->mActivitySlab_,
+               "pidserver client",
+               sizeof(struct PidServerClientActivity_),
+               PIDSERVER_SLAB_RECORDS);
+    self->mActivitySlab = &self->mActivitySlab_;
+
+    createSlab(&self->mReceiverSlab_,
+               "pidserver handshake",
+               sizeof(struct PidSignatureReceiver),
+               PIDSERVER_SLAB_RECORDS);
+    self->mReceiverSlab = &self->mReceiverSlab_;
+
+    TAILQ_INIT(&self->mHandshakes);
+    TAILQ_INIT(&self->mClients);
+
+    ERT_ERROR_UNLESS(
+        self->mPidSignature = createPidSignature(aPid, 0));
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
 
 /* -------------------------------------------------------------------------- */
-static ERT_CHECKED struct PidServerClient_ *
-closePidServerClient_(struct PidServerClient_ *self)
+static ERT_CHECKED int
+startPidServer_(struct PidServer *self,
+                unsigned          aReferences,
+                unsigned          aLease_s)
 {
-    if (self)
+    int rc = -1;
+
+    /* If the number of references is limited, reserve the records for
+     * all the references, and separately for the handshakes that precede
+     * them, so that no memory is allocated as clients come and go, and
+     * clients that have yet to complete their handshakes cannot take
+     * the places of the references. Otherwise, the slabs grow to the
+     * largest number of clients served at the same time. */
+
+    if (aReferences)
     {
-        self->mUnixSocket = ert_closeUnixSocket(self->mUnixSocket);
+        ERT_ERROR_IF(
+            fillSlab(self->mActivitySlab,
+                     aReferences + PIDSERVER_HANDSHAKES));
+        ERT_ERROR_IF(
+            fillSlab(self->mReceiverSlab, PIDSERVER_HANDSHAKES));
+    }
+
+    self->mReferences = aReferences;
+    self->mLease      = Ert_Duration(ERT_NSECS(Ert_Seconds(aLease_s)));
+
+    ERT_ERROR_IF(
+        ert_ownUnixSocketName(self->mUnixSocket, &self->mSocketAddr));
+
+    ERT_ERROR_IF(
+        self->mSocketAddr.sun_path[0]);
+
+    /* Accept connections until none remain, so the listening socket
+     * must not block. */
+
+    ERT_ERROR_IF(
+        ert_nonBlockingFd(
+            self->mUnixSocket->mSocket->mFile->mFd, O_NONBLOCK));
+
+    ERT_ERROR_IF(
+        ert_createFileEventQueue(
+            &self->mEventQueue_, PIDSERVER_EVENT_BATCH));
+    self->mEventQueue = &self->mEventQueue_;
+
+    /* A single timer on the event queue bounds the time taken by the
+     * handshakes of all the clients, and the time that references are
+     * held once the child process has exited. */
+
+    int timerFd;
+    ERT_ERROR_IF(
+        (timerFd = timerfd_create(
+            CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC),
+         -1 == timerFd));
+
+    ERT_ERROR_IF(
+        ert_createFile(&self->mTimerFile_, timerFd));
+    self->mTimerFile = &self->mTimerFile_;
+
+    ERT_ERROR_IF(
+        ert_createFileEventQueueActivity(
+            &self->mTimerEvent_, self->mEventQueue, self->mTimerFile));
+    self->mTimerEvent = &self->mTimerEvent_;
+
+    ERT_ERROR_IF(
+        armPidServerTimer_(self));
+
+    rc = 0;
+
+Ert_Finally:
 
-        free(self);
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+openPidServerPidFd_(struct PidServer *self, struct Ert_Pid aPid)
+{
+    int rc = -1;
+
+    /* The pid server is created by the parent of the child process
+     * before the child can be reaped, so the pidfd is certain to refer
+     * to the child process rather than to a process that has reused
+     * the pid. Older kernels do not provide pidfds, in which case
+     * clients only receive an acknowledgement. */
+
+    int pidFd;
+
+#ifdef SYS_pidfd_open
+    pidFd = syscall(SYS_pidfd_open, aPid.mPid, 0);
+#else
+    pidFd = -1;
+    errno = ENOSYS;
+#endif
+
+    if (-1 == pidFd)
+    {
+        ERT_ERROR_UNLESS(
+            ENOSYS == errno);
+
+        ert_debug(0, "pidfd unavailable for pid server");
+    }
+    else
+    {
+        ERT_ERROR_IF(
+            ert_closeFdOnExec(pidFd, O_CLOEXEC),
+            {
+                close(pidFd);
+            });
+
+        ERT_ERROR_IF(
+            ert_createFile(&self->mPidFdFile_, pidFd));
+        self->mPidFdFile = &self->mPidFdFile_;
     }
 
-    return 0;
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
 }
 
 /* -------------------------------------------------------------------------- */
-static ERT_CHECKED struct PidServerClient_ *
-createPidServerClient_(struct Ert_UnixSocket *aSocket)
+int
+createPidServer(struct PidServer *self,
+                struct Ert_Pid    aPid,
+                unsigned          aReferences,
+                unsigned          aLease_s)
 {
     int rc = -1;
 
-    struct PidServerClient_ *self = 0;
+    ERT_ERROR_IF(
+        initPidServer_(self, aPid));
 
-    ERT_ERROR_UNLESS(
-        (self = malloc(sizeof(*self))));
+    ert_debug(
+        0,
+        "create pid server for %" PRIs_Ert_Method,
+        FMTs_Ert_Method(self->mPidSignature, printPidSignature));
 
     ERT_ERROR_IF(
-        ert_acceptUnixSocket(&self->mUnixSocket_, aSocket),
-        {
-            ert_warn(errno, "Unable to accept connection");
-        });
+        openPidServerPidFd_(self, aPid));
+
+    ERT_ERROR_IF(
+        ert_createUnixSocket(&self->mUnixSocket_, 0, 0, 0));
     self->mUnixSocket = &self->mUnixSocket_;
 
     ERT_ERROR_IF(
-        ert_ownUnixSocketPeerCred(self->mUnixSocket, &self->mCred));
+        startPidServer_(self, aReferences, aLease_s));
 
     rc = 0;
 
@@ -156,47 +432,56 @@ Ert_Finally:
     ERT_FINALLY
     ({
         if (rc)
-            self = closePidServerClient_(self);
+            self = closePidServer(self);
     });
 
-    return self;
+    return rc;
 }
 
 /* -------------------------------------------------------------------------- */
 int
-createPidServer(struct PidServer *self, struct Ert_Pid aPid)
+adoptPidServer(struct PidServer *self,
+               struct Ert_Pid    aPid,
+               int               aFd,
+               int               aPidFd,
+               unsigned          aReferences,
+               unsigned          aLease_s)
 {
     int rc = -1;
 
-    self->mUnixSocket   = 0;
-    self->mEventQueue   = 0;
-    self->mPidSignature = 0;
-
-    TAILQ_INIT(&self->mClients);
-
-    ERT_ERROR_UNLESS(
-        self->mPidSignature = createPidSignature(aPid, 0));
+    ERT_ERROR_IF(
+        initPidServer_(self, aPid));
 
     ert_debug(
         0,
-        "create pid server for %" PRIs_Ert_Method,
+        "adopt pid server fd %d for %" PRIs_Ert_Method,
+        aFd,
         FMTs_Ert_Method(self->mPidSignature, printPidSignature));
 
-    ERT_ERROR_IF(
-        ert_createUnixSocket(&self->mUnixSocket_, 0, 0, 0));
-    self->mUnixSocket = &self->mUnixSocket_;
+    /* The listening socket was inherited across execve(2), so take
+     * ownership of it again, and ensure that it is not leaked into
+     * any other program. */
 
     ERT_ERROR_IF(
-        ert_ownUnixSocketName(self->mUnixSocket, &self->mSocketAddr));
+        ert_closeFdOnExec(aFd, O_CLOEXEC));
 
     ERT_ERROR_IF(
-        self->mSocketAddr.sun_path[0]);
+        ert_createSocket(&self->mUnixSocket_.mSocket_, aFd));
+    self->mUnixSocket_.mSocket = &self->mUnixSocket_.mSocket_;
+    self->mUnixSocket          = &self->mUnixSocket_;
+
+    if (-1 != aPidFd)
+    {
+        ERT_ERROR_IF(
+            ert_closeFdOnExec(aPidFd, O_CLOEXEC));
 
-    int numEvents = 16;
+        ERT_ERROR_IF(
+            ert_createFile(&self->mPidFdFile_, aPidFd));
+        self->mPidFdFile = &self->mPidFdFile_;
+    }
 
     ERT_ERROR_IF(
-        ert_createFileEventQueue(&self->mEventQueue_, numEvents));
-    self->mEventQueue = &self->mEventQueue_;
+        startPidServer_(self, aReferences, aLease_s));
 
     rc = 0;
 
@@ -230,6 +515,8 @@ enqueuePidServerConnection_(struct PidServer                *self,
 
     aActivity->mList = &aActivity->mList_;
 
+    ++self->mHeld;
+
     rc = 0;
 
 Ert_Finally:
@@ -250,19 +537,29 @@ discardPidServerConnection_(struct PidServer                *self,
     {
         if (activity->mList)
         {
-            ert_debug(
-                0,
-                "drop reference from %" PRIs_ucred,
-                FMTs_ucred(activity->mClient->mCred));
+            /* A client that has yet to complete its handshake does not
+             * yet hold a reference. */
+
+            if (activity->mReceiver)
+                TAILQ_REMOVE(&self->mHandshakes, activity, mList_);
+            else
+            {
+                ert_debug(
+                    0,
+                    "drop reference from %" PRIs_ucred,
+                    FMTs_ucred(activity->mClient->mCred));
+
+                TAILQ_REMOVE(&self->mClients, activity, mList_);
+
+                --self->mHeld;
+            }
 
-            TAILQ_REMOVE(&self->mClients, activity, mList_);
             activity->mList = 0;
         }
 
-        struct PidServerClient_ *client = activity->mClient;
+        ++self->mDiscards;
 
-        activity = closePidServerClientActivity_(activity);
-        client   = closePidServerClient_(client);
+        activity = closePidServerClientActivity_(self, activity);
     }
 
     return activity;
@@ -274,6 +571,14 @@ closePidServer(struct PidServer *self)
 {
     if (self)
     {
+        while ( ! TAILQ_EMPTY(&self->mHandshakes))
+        {
+            struct PidServerClientActivity_ *activity =
+                TAILQ_FIRST(&self->mHandshakes);
+
+            activity = discardPidServerConnection_(self, activity);
+        }
+
         while ( ! TAILQ_EMPTY(&self->mClients))
         {
             struct PidServerClientActivity_ *activity =
@@ -282,114 +587,899 @@ closePidServer(struct PidServer *self)
             activity = discardPidServerConnection_(self, activity);
         }
 
+        self->mTimerEvent   = ert_closeFileEventQueueActivity(
+            self->mTimerEvent);
+        self->mTimerFile    = ert_closeFile(self->mTimerFile);
+        self->mPidFdFile    = ert_closeFile(self->mPidFdFile);
         self->mEventQueue   = ert_closeFileEventQueue(self->mEventQueue);
         self->mUnixSocket   = ert_closeUnixSocket(self->mUnixSocket);
         self->mPidSignature = destroyPidSignature(self->mPidSignature);
+
+        self->mReceiverSlab = closeSlab(self->mReceiverSlab);
+        self->mActivitySlab = closeSlab(self->mActivitySlab);
    }
 
     return 0;
 }
 
 /* -------------------------------------------------------------------------- */
-int
-acceptPidServerConnection(struct PidServer *self)
+void
+attachPidServerStatus(struct PidServer *self, struct SentryStatus *aStatus)
 {
-    int rc = -1;
+    self->mStatus = aStatus;
+}
 
-    /* Accept a new connection from a client to hold an additional
-     * reference to the child process group. If this is the first
-     * reference, activate the janitor to periodically remove expired
-     * references.
-     *
-     * Do not accept the new connection if there is no more memory
-     * to store the connection record, but pause rather than allowing
-     * the event loop to spin wildly. */
+/* -------------------------------------------------------------------------- */
+static void
+sendPidServerStatus_(struct PidServer                *self,
+                     struct PidServerClientActivity_ *aActivity)
+{
+    struct SentryStatusSnapshot snapshot;
 
-    struct PidServerClient_         *client    = 0;
-    struct PidServerClientActivity_ *activity  = 0;
-    struct PidSignature             *signature = 0;
+    snapshotSentryStatus(
+        self->mStatus, self->mPidSignature->mPid, &snapshot);
 
-    struct Ert_Deadline  deadline_;
-    struct Ert_Deadline *deadline = 0;
+    /* The snapshot is much smaller than the socket buffer, and a client
+     * only has one request outstanding, so there is always room for the
+     * snapshot unless the client is misbehaving, in which case it is
+     * better to discard the snapshot than to stall the event loop. */
 
-    ERT_ERROR_UNLESS(
-        (client = createPidServerClient_(self->mUnixSocket)));
+    ssize_t wrBytes;
 
-    ERT_ERROR_UNLESS(
-        geteuid() == client->mCred.uid || ! client->mCred.uid,
-        {
-            ert_warn(
-                0,
-                "Discarding connection from %" PRIs_ucred,
-                FMTs_ucred(client->mCred));
-        });
+    do
+        wrBytes = send(
+            aActivity->mClient->mUnixSocket->mSocket->mFile->mFd,
+            &snapshot, sizeof(snapshot), MSG_DONTWAIT | MSG_NOSIGNAL);
+    while (-1 == wrBytes && EINTR == errno);
 
-    struct Ert_Duration pidSignatureTimeout =
-        Ert_Duration(ERT_NSECS(Ert_Seconds(30)));
+    if (sizeof(snapshot) != wrBytes)
+    {
+        ert_debug(
+            0,
+            "lost status from %" PRIs_ucred,
+            FMTs_ucred(aActivity->mClient->mCred));
+    }
+}
 
-    ERT_ERROR_IF(
-        ert_createDeadline(&deadline_, &pidSignatureTimeout));
-    deadline = &deadline_;
+/* -------------------------------------------------------------------------- */
+void
+attachPidServerUmbilical(struct PidServer *self, int aFd)
+{
+    self->mUmbilicalFd = aFd;
+}
 
-    ERT_ERROR_UNLESS(
-        signature = recvPidSignature(
-            client->mUnixSocket->mSocket->mFile, deadline));
+/* -------------------------------------------------------------------------- */
+static ssize_t
+sendPidServerMessage_(int aSocketFd, char aMessage, int aFd)
+{
+    /* Each message is a single byte, optionally carrying a file
+     * descriptor. Receivers that read the byte without collecting the
+     * file descriptor cause the duplicate to be discarded. */
+
+    char buf[1] = { aMessage };
+
+    struct iovec iov =
+    {
+        .iov_base = buf,
+        .iov_len  = sizeof(buf),
+    };
+
+    union
+    {
+        struct cmsghdr mHeader;
+        char           mBuf[CMSG_SPACE(sizeof(int))];
+    } control;
+
+    struct msghdr msg =
+    {
+        .msg_iov    = &iov,
+        .msg_iovlen = 1,
+    };
+
+    if (-1 != aFd)
+    {
+        msg.msg_control    = control.mBuf;
+        msg.msg_controllen = sizeof(control.mBuf);
+
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type  = SCM_RIGHTS;
+        cmsg->cmsg_len   = CMSG_LEN(sizeof(int));
+
+        memcpy(CMSG_DATA(cmsg), &aFd, sizeof(int));
+    }
+
+    ssize_t wrBytes;
+
+    do
+        wrBytes = sendmsg(aSocketFd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+    while (-1 == wrBytes && EINTR == errno);
+
+    return wrBytes;
+}
+
+/* -------------------------------------------------------------------------- */
+static ssize_t
+acknowledgePidServerConnection_(struct PidServer                *self,
+                                struct PidServerClientActivity_ *aActivity)
+{
+    /* If a pidfd for the child process is available, attach a duplicate
+     * of it to the acknowledgement so that the client can signal and
+     * wait for the child process without looking up the pid again. */
+
+    return sendPidServerMessage_(
+        aActivity->mClient->mUnixSocket->mSocket->mFile->mFd,
+        0,
+        self->mPidFdFile ? self->mPidFdFile->mFd : -1);
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+attachPidServerTether_(struct PidServer                *self,
+                       struct PidServerClientActivity_ *aActivity)
+{
+    int rc = -1;
+
+    struct Ert_Pipe  attachPipe_;
+    struct Ert_Pipe *attachPipe = 0;
+
+    /* The output of the child process is only available in the sentry,
+     * so create a pipe and send the writing end to the sentry over the
+     * umbilical connection, and the reading end to the client. The
+     * sentry attaches the pipe to its tether, and this process retains
+     * neither end so that the client sees end of file as soon as the
+     * sentry closes the pipe.
+     *
+     * If the output cannot be attached, the reply carries no pipe
+     * and the client sees the request refused. */
+
+    int rdFd = -1;
+
+    if (-1 == self->mUmbilicalFd || self->mExited)
+    {
+        ert_debug(
+            0,
+            "refusing attach from %" PRIs_ucred,
+            FMTs_ucred(aActivity->mClient->mCred));
+    }
+    else
+    {
+        ERT_ERROR_IF(
+            ert_createPipe(&attachPipe_, O_CLOEXEC));
+        attachPipe = &attachPipe_;
+
+        ssize_t wrBytes;
+        ERT_ERROR_IF(
+            (wrBytes = sendPidServerMessage_(
+                self->mUmbilicalFd,
+                TETHER_ATTACH_MESSAGE, attachPipe->mWrFile->mFd),
+             1 != wrBytes && EWOULDBLOCK != errno && EPIPE != errno));
+
+        if (1 == wrBytes)
+        {
+            ert_debug(
+                0,
+                "attach from %" PRIs_ucred,
+                FMTs_ucred(aActivity->mClient->mCred));
+
+            rdFd = attachPipe->mRdFile->mFd;
+        }
+    }
+
+    if (1 != sendPidServerMessage_(
+            aActivity->mClient->mUnixSocket->mSocket->mFile->mFd,
+            SENTRY_STATUS_ATTACH_REQUEST, rdFd))
+    {
+        ert_debug(
+            0,
+            "lost attach reply to %" PRIs_ucred,
+            FMTs_ucred(aActivity->mClient->mCred));
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        attachPipe = ert_closePipe(attachPipe);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static struct PidServerClientActivity_ *
+replyPidServerWaiter_(struct PidServer                *self,
+                      struct PidServerClientActivity_ *aActivity)
+{
+    /* Without a status, there is no exit code to send, and the client
+     * only sees the connection close. In either case, the child process
+     * has gone so there is no reason to hold the reference. */
+
+    ert_debug(
+        0,
+        "notify exit to %" PRIs_ucred,
+        FMTs_ucred(aActivity->mClient->mCred));
+
+    if (self->mStatus)
+        sendPidServerStatus_(self, aActivity);
+
+    return discardPidServerConnection_(self, aActivity);
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+reconfigurePidServer_(struct PidServer                *self,
+                      struct PidServerClientActivity_ *aActivity)
+{
+    int rc = -1;
+
+    struct Ert_Pipe  configPipe_;
+    struct Ert_Pipe *configPipe = 0;
+
+    /* Return 1 if the reconfiguration was received, whether or not
+     * it was passed to the sentry, and 0 if the request was malformed.
+     * The configuration is written in the same message as the request,
+     * so it is available now. The sentry validates the configuration
+     * before applying it. */
+
+    struct SentryConfig config;
+
+    int received = 0;
+
+    ssize_t rdBytes;
+
+    do
+        rdBytes = recv(
+            aActivity->mClient->mUnixSocket->mSocket->mFile->mFd,
+            &config, sizeof(config), MSG_DONTWAIT);
+    while (-1 == rdBytes && EINTR == errno);
+
+    if (sizeof(config) != rdBytes ||
+        SENTRY_CONFIG_VERSION != config.mVersion ||
+        sizeof(config) != config.mSize)
+    {
+        ert_warn(
+            0,
+            "Discarding malformed reconfiguration from %" PRIs_ucred,
+            FMTs_ucred(aActivity->mClient->mCred));
+    }
+    else
+    {
+        received = 1;
+
+        /* Pass the configuration to the sentry in a pipe so that the
+         * sentry can read it in one piece. The pipe is filled before
+         * it is sent, so the sentry can never block reading it. */
+
+        char reply = SENTRY_STATUS_REFUSED;
+
+        if ( ! trustPidServerClient_(aActivity->mClient))
+        {
+            ert_warn(
+                0,
+                "Refusing reconfiguration from %" PRIs_ucred,
+                FMTs_ucred(aActivity->mClient->mCred));
+        }
+        else if (-1 == self->mUmbilicalFd || self->mExited)
+        {
+            ert_debug(
+                0,
+                "refusing reconfiguration from %" PRIs_ucred,
+                FMTs_ucred(aActivity->mClient->mCred));
+        }
+        else
+        {
+            ERT_ERROR_IF(
+                ert_createPipe(&configPipe_, O_CLOEXEC));
+            configPipe = &configPipe_;
+
+            ssize_t wrBytes;
+            ERT_ERROR_IF(
+                (wrBytes = ert_writeFile(
+                    configPipe->mWrFile, (char *) &config, sizeof(config), 0),
+                 -1 == wrBytes || (errno = EIO, sizeof(config) != wrBytes)));
+
+            ert_closePipeWriter(configPipe);
+
+            ERT_ERROR_IF(
+                (wrBytes = sendPidServerMessage_(
+                    self->mUmbilicalFd,
+                    SENTRY_CONFIG_MESSAGE, configPipe->mRdFile->mFd),
+                 1 != wrBytes && EWOULDBLOCK != errno && EPIPE != errno));
+
+            if (1 == wrBytes)
+            {
+                ert_warn(
+                    0,
+                    "Reconfiguration from %" PRIs_ucred,
+                    FMTs_ucred(aActivity->mClient->mCred));
+
+                reply = SENTRY_STATUS_RECONFIGURE_REQUEST;
+            }
+        }
+
+        if (1 != sendPidServerMessage_(
+                aActivity->mClient->mUnixSocket->mSocket->mFile->mFd,
+                reply, -1))
+        {
+            ert_debug(
+                0,
+                "lost reconfiguration reply to %" PRIs_ucred,
+                FMTs_ucred(aActivity->mClient->mCred));
+        }
+    }
+
+    rc = received;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        configPipe = ert_closePipe(configPipe);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+armPidServerReference_(struct PidServer                *self,
+                       struct PidServerClientActivity_ *aActivity);
+
+static ERT_CHECKED int
+pollPidServerReference_(struct PidServer                *self,
+                        struct PidServerClientActivity_ *aActivity)
+{
+    int rc = -1;
+
+    struct PidServerClientActivity_ *activity = aActivity;
+
+    /* A client holding a reference writes nothing more than a single
+     * request to wait for the child process to exit, and requests to
+     * query the status of the sentry, to attach to the output of the
+     * child process, or to reconfigure the sentry. Anything else,
+     * including the client closing its connection, drops the
+     * reference. */
+
+    char buf[1];
+
+    ssize_t rdBytes;
+
+    do
+        rdBytes = recv(
+            activity->mClient->mUnixSocket->mSocket->mFile->mFd,
+            buf, sizeof(buf), MSG_DONTWAIT);
+    while (-1 == rdBytes && EINTR == errno);
+
+    if (-1 == rdBytes && EWOULDBLOCK == errno)
+    {
+        ERT_ERROR_IF(
+            armPidServerReference_(self, activity));
+        activity = 0;
+    }
+    else if (1 == rdBytes &&
+             SENTRY_STATUS_WAIT_REQUEST == buf[0] && ! activity->mWaiting)
+    {
+        ert_debug(
+            0,
+            "wait request from %" PRIs_ucred,
+            FMTs_ucred(activity->mClient->mCred));
+
+        activity->mWaiting = true;
+
+        if (self->mExited)
+            activity = replyPidServerWaiter_(self, activity);
+        else
+        {
+            ERT_ERROR_IF(
+                armPidServerReference_(self, activity));
+            activity = 0;
+        }
+    }
+    else if (1 == rdBytes &&
+             SENTRY_STATUS_QUERY_REQUEST == buf[0] && self->mStatus)
+    {
+        ert_debug(
+            0,
+            "status query from %" PRIs_ucred,
+            FMTs_ucred(activity->mClient->mCred));
+
+        sendPidServerStatus_(self, activity);
+
+        ERT_ERROR_IF(
+            armPidServerReference_(self, activity));
+        activity = 0;
+    }
+    else if (1 == rdBytes && SENTRY_STATUS_ATTACH_REQUEST == buf[0])
+    {
+        ERT_ERROR_IF(
+            attachPidServerTether_(self, activity));
+
+        ERT_ERROR_IF(
+            armPidServerReference_(self, activity));
+        activity = 0;
+    }
+    else if (1 == rdBytes && SENTRY_STATUS_RECONFIGURE_REQUEST == buf[0])
+    {
+        int received;
+        ERT_ERROR_IF(
+            (received = reconfigurePidServer_(self, activity),
+             -1 == received));
+
+        if (received)
+        {
+            ERT_ERROR_IF(
+                armPidServerReference_(self, activity));
+            activity = 0;
+        }
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        activity = discardPidServerConnection_(self, activity);
+    });
+
+    return rc;
+}
+
+static ERT_CHECKED int
+armPidServerReference_(struct PidServer                *self,
+                       struct PidServerClientActivity_ *aActivity)
+{
+    return armPidServerClientActivity_(
+        aActivity,
+        PidServerClientActivityMethod_(self, pollPidServerReference_));
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+handshakePidServerConnection_(struct PidServer                *self,
+                              struct PidServerClientActivity_ *aActivity)
+{
+    int rc = -1;
+
+    struct PidServerClientActivity_ *activity  = aActivity;
+    const struct PidSignature       *signature = 0;
+
+    /* Read as much of the signature as is available without blocking,
+     * and wait on the event queue for the remainder. Once the signature
+     * is complete, and matches the child process, acknowledge the
+     * client and hold the reference until the client disconnects. */
+
+    signature = pollPidSignatureReceiver(
+        activity->mReceiver, activity->mClient->mUnixSocket->mSocket->mFile);
+
+    if ( ! signature)
+    {
+        if (EWOULDBLOCK == errno || EINTR == errno)
+        {
+            ERT_ERROR_IF(
+                armPidServerClientActivity_(
+                    activity,
+                    PidServerClientActivityMethod_(
+                        self, handshakePidServerConnection_)));
+            activity = 0;
+        }
+        else
+        {
+            ert_warn(
+                errno,
+                "Discarding connection from %" PRIs_ucred,
+                FMTs_ucred(activity->mClient->mCred));
+        }
+    }
+    else if (rankPidSignature(self->mPidSignature, signature))
+    {
+        ert_warn(
+            0,
+            "Discarding connection for %" PRIs_Ert_Method,
+            FMTs_Ert_Method(signature, printPidSignature));
+    }
+    else if (self->mReferences && self->mReferences <= self->mHeld)
+    {
+        /* The client sees the connection closed without an
+         * acknowledgement. */
+
+        ert_warn(
+            0,
+            "Refusing connection from %" PRIs_ucred
+            " with %u references held",
+            FMTs_ucred(activity->mClient->mCred),
+            self->mHeld);
+    }
+    else
+    {
+        if (1 != acknowledgePidServerConnection_(self, activity))
+        {
+            ert_debug(
+                0,
+                "lost connection from %" PRIs_ucred,
+                FMTs_ucred(activity->mClient->mCred));
+        }
+        else
+        {
+            TAILQ_REMOVE(&self->mHandshakes, activity, mList_);
+            activity->mList = 0;
+
+            freeSlab(self->mReceiverSlab, activity->mReceiver);
+            activity->mReceiver = 0;
+
+            ERT_ERROR_IF(
+                armPidServerReference_(self, activity));
+
+            ERT_ERROR_IF(
+                enqueuePidServerConnection_(self, activity));
+            activity = 0;
+        }
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        activity = discardPidServerConnection_(self, activity);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static uint64_t
+ownPidServerLeaseExpiry_(const struct PidServer *self)
+{
+    /* Once the child process has exited, the references held by clients
+     * expire after the lease, if one is configured. Return zero if
+     * there is no lease to expire. */
+
+    return
+        self->mExited && self->mLease.duration.ns &&
+        ! TAILQ_EMPTY(&self->mClients)
+        ? self->mExitSince.eventclock.ns + self->mLease.duration.ns
+        : 0;
+}
+
+static ERT_CHECKED int
+schedulePidServerTimer_(struct PidServer *self)
+{
+    int rc = -1;
+
+    /* Handshakes are held in the order that the connections were
+     * accepted, so the first handshake is always the next to expire.
+     * Run the timer to the earlier of that handshake, and the expiry
+     * of the lease on the references, and disarm the timer if neither
+     * is outstanding. */
+
+    struct itimerspec expiry = { .it_value = { 0, 0 } };
+
+    uint64_t expiry_ns = ownPidServerLeaseExpiry_(self);
+
+    struct PidServerClientActivity_ *first = TAILQ_FIRST(&self->mHandshakes);
+
+    if (first)
+    {
+        uint64_t handshake_ns =
+            first->mSince.eventclock.ns +
+            ERT_NSECS(Ert_Seconds(PIDSERVER_HANDSHAKE_TIMEOUT_S)).ns;
+
+        if ( ! expiry_ns || handshake_ns < expiry_ns)
+            expiry_ns = handshake_ns;
+    }
+
+    if (expiry_ns)
+    {
+        struct Ert_EventClockTime now = ert_eventclockTime();
+
+        uint64_t remaining_ns =
+            expiry_ns > now.eventclock.ns ? expiry_ns - now.eventclock.ns : 1;
+
+        expiry.it_value.tv_sec  = remaining_ns / (1000 * 1000 * 1000);
+        expiry.it_value.tv_nsec = remaining_ns % (1000 * 1000 * 1000);
+
+        if ( ! expiry.it_value.tv_sec && ! expiry.it_value.tv_nsec)
+            expiry.it_value.tv_nsec = 1;
+    }
 
     ERT_ERROR_IF(
-        rankPidSignature(self->mPidSignature, signature),
+        timerfd_settime(self->mTimerFile->mFd, 0, &expiry, 0));
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static void
+expirePidServerLeases_(struct PidServer                *self,
+                       const struct Ert_EventClockTime *aNow)
+{
+    /* Release the references of clients that are still holding on to
+     * the child process once the lease has expired, so that a client
+     * that has hung cannot hold back the shutdown of the sentry. Tell
+     * each client before closing its connection, and name it so that
+     * it can be found. */
+
+    uint64_t expiry_ns = ownPidServerLeaseExpiry_(self);
+
+    if (expiry_ns && expiry_ns <= aNow->eventclock.ns)
+    {
+        while ( ! TAILQ_EMPTY(&self->mClients))
         {
+            struct PidServerClientActivity_ *activity =
+                TAILQ_FIRST(&self->mClients);
+
             ert_warn(
                 0,
-                "Discarding connection for %" PRIs_Ert_Method,
-                FMTs_Ert_Method(signature, printPidSignature));
-        });
+                "Releasing reference held by %" PRIs_ucred
+                " after lease expired",
+                FMTs_ucred(activity->mClient->mCred));
 
-    ERT_ERROR_UNLESS(
-        (activity = createPidServerClientActivity_(
-            client,
-            self->mEventQueue,
-            PidServerClientActivityMethod_(
-                self,
-                ERT_LAMBDA(
-                    int, (struct PidServer                *self_,
-                          struct PidServerClientActivity_ *aActivity),
-                    {
-                        struct PidServerClientActivity_ *activity_ = aActivity;
+            static const char leaseExpired[1] =
+            {
+                SENTRY_STATUS_LEASE_EXPIRED,
+            };
+
+            ssize_t wrBytes;
+
+            do
+                wrBytes = send(
+                    activity->mClient->mUnixSocket->mSocket->mFile->mFd,
+                    leaseExpired, sizeof(leaseExpired),
+                    MSG_DONTWAIT | MSG_NOSIGNAL);
+            while (-1 == wrBytes && EINTR == errno);
+
+            activity = discardPidServerConnection_(self, activity);
+        }
+    }
+}
+
+static ERT_CHECKED int
+expirePidServerTimer_(struct PidServer *self)
+{
+    int rc = -1;
+
+    uint64_t expirations;
+
+    ssize_t rdlen;
+    ERT_ERROR_IF(
+        (rdlen = read(
+            self->mTimerFile->mFd, &expirations, sizeof(expirations)),
+         -1 == rdlen
+         ? EWOULDBLOCK != errno && EINTR != errno
+         : (errno = EIO, sizeof(expirations) != rdlen)));
 
-                        activity_ =
-                            discardPidServerConnection_(self_, activity_);
+    struct Ert_EventClockTime now = ert_eventclockTime();
+
+    uint64_t timeout_ns =
+        ERT_NSECS(Ert_Seconds(PIDSERVER_HANDSHAKE_TIMEOUT_S)).ns;
+
+    while ( ! TAILQ_EMPTY(&self->mHandshakes))
+    {
+        struct PidServerClientActivity_ *activity =
+            TAILQ_FIRST(&self->mHandshakes);
 
-                        return 0;
-                    })))));
-    client = 0;
+        if (activity->mSince.eventclock.ns + timeout_ns > now.eventclock.ns)
+            break;
 
-    char buf[1] = { 0 };
+        ert_warn(
+            0,
+            "Discarding connection from %" PRIs_ucred " after timeout",
+            FMTs_ucred(activity->mClient->mCred));
+
+        activity = discardPidServerConnection_(self, activity);
+    }
+
+    expirePidServerLeases_(self, &now);
 
-    int wrBytes;
     ERT_ERROR_IF(
-        (wrBytes = ert_writeSocket(
-            activity->mClient->mUnixSocket->mSocket, buf, sizeof(buf), 0),
-         -1 == wrBytes || (errno = EIO, sizeof(buf) != wrBytes)));
+        schedulePidServerTimer_(self));
 
     ERT_ERROR_IF(
-        enqueuePidServerConnection_(self, activity));
-    activity = 0;
+        armPidServerTimer_(self));
 
     rc = 0;
 
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+armPidServerTimer_(struct PidServer *self)
+{
+    return ert_armFileEventQueueActivity(
+        self->mTimerEvent,
+        Ert_FileEventQueuePollRead,
+        Ert_FileEventQueueActivityMethod(
+            self,
+            ERT_LAMBDA(
+                int, (struct PidServer *self_),
+                {
+                    return expirePidServerTimer_(self_);
+                })));
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+refusePidServerClient_(struct PidServer *self)
+{
+    int rc = -1;
+
+    /* All the records are in use, so take the connection from the
+     * listening socket and close it immediately. The client sees the
+     * connection closed without an acknowledgement, and the listening
+     * socket does not remain readable to spin the event loop. */
+
+    struct PidServerClient_  client_;
+    struct PidServerClient_ *client = 0;
+
+    int accepted = 0;
+
+    ERT_ERROR_IF(
+        createPidServerClient_(&client_, self->mUnixSocket) &&
+        EWOULDBLOCK != errno);
+
+    if (client_.mUnixSocket)
+    {
+        client = &client_;
+
+        accepted = 1;
+
+        ert_warn(
+            0,
+            "Refusing connection from %" PRIs_ucred
+            " with %u references held",
+            FMTs_ucred(client->mCred),
+            self->mHeld);
+    }
+
+    rc = accepted;
+
 Ert_Finally:
 
     ERT_FINALLY
     ({
-        signature = destroyPidSignature(signature);
-        activity  = discardPidServerConnection_(self, activity);
-        deadline  = ert_closeDeadline(deadline);
-        client    = closePidServerClient_(client);
+        client = closePidServerClient_(client);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+acceptPidServerClient_(struct PidServer *self)
+{
+    int rc = -1;
+
+    /* Return 1 if a connection was taken from the listening socket,
+     * whether or not it was retained, and 0 if there are no more
+     * connections waiting.
+     *
+     * Do not accept the new connection if there is no more memory
+     * to store the connection record, but pause rather than allowing
+     * the event loop to spin wildly. */
+
+    struct PidServerClientActivity_ *activity = 0;
+
+    int accepted = 0;
+
+    ERT_ERROR_UNLESS(
+        (activity = createPidServerClientActivity_(self)) ||
+        EWOULDBLOCK == errno || ENOBUFS == errno);
+
+    if ( ! activity)
+    {
+        if (ENOBUFS == errno)
+            ERT_ERROR_IF(
+                (accepted = refusePidServerClient_(self),
+                 -1 == accepted));
+    }
+    else
+    {
+        accepted = 1;
+
+        struct PidServerClient_ *client = activity->mClient;
+
+        if ( ! trustPidServerClient_(client))
+        {
+            ert_warn(
+                0,
+                "Discarding connection from %" PRIs_ucred,
+                FMTs_ucred(client->mCred));
+        }
+        else if ( ! (activity->mReceiver = allocSlab(self->mReceiverSlab)))
+        {
+            ERT_ERROR_UNLESS(
+                ENOBUFS == errno);
+
+            ert_warn(
+                0,
+                "Refusing connection from %" PRIs_ucred
+                " with %u handshakes in progress",
+                FMTs_ucred(client->mCred),
+                PIDSERVER_HANDSHAKES);
+        }
+        else
+        {
+            createPidSignatureReceiver(activity->mReceiver);
+
+            activity->mSince = ert_eventclockTime();
+
+            ERT_ERROR_IF(
+                armPidServerClientActivity_(
+                    activity,
+                    PidServerClientActivityMethod_(
+                        self, handshakePidServerConnection_)));
+
+            bool firstHandshake = TAILQ_EMPTY(&self->mHandshakes);
+
+            TAILQ_INSERT_TAIL(&self->mHandshakes, activity, mList_);
+            activity->mList = &activity->mList_;
+            activity        = 0;
+
+            if (firstHandshake)
+                ERT_ERROR_IF(
+                    schedulePidServerTimer_(self));
+        }
+    }
+
+    rc = accepted;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        activity = discardPidServerConnection_(self, activity);
     });
 
     return rc;
 }
 
+/* -------------------------------------------------------------------------- */
+int
+acceptPidServerConnection(struct PidServer *self)
+{
+    int rc = -1;
+
+    /* Accept all the new connections from clients, each of which will
+     * hold an additional reference to the child process group once its
+     * handshake completes. The handshakes are driven from the event
+     * queue so that a slow or silent client cannot stall the caller. */
+
+    int accepted;
+
+    do
+    {
+        ERT_ERROR_IF(
+            (accepted = acceptPidServerClient_(self),
+             -1 == accepted));
+
+    } while (accepted);
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
 /* -------------------------------------------------------------------------- */
 int
 cleanPidServer(struct PidServer *self)
@@ -398,16 +1488,78 @@ cleanPidServer(struct PidServer *self)
 
     /* This function is called to process activity on the event
      * queue, and remove those references to the child process group
-     * that have expired. */
+     * that have expired.
+     *
+     * Each poll of the event queue collects at most one batch of
+     * events. When many clients disconnect together, keep polling
+     * while each batch continues to discard connections so that the
+     * closed references are drained in a single call, but bound the
+     * number of batches so that the caller is not starved. */
 
-    ERT_ERROR_IF(
-        ert_pollFileEventQueueActivity(self->mEventQueue, &Ert_ZeroDuration));
+    for (unsigned batch = 0; batch < PIDSERVER_CLEAN_BATCHES; ++batch)
+    {
+        unsigned discards = self->mDiscards;
+
+        ERT_ERROR_IF(
+            ert_pollFileEventQueueActivity(
+                self->mEventQueue, &Ert_ZeroDuration));
+
+        if (discards == self->mDiscards)
+            break;
+    }
 
     /* There is no further need to continue cleaning if there are no
-     * more outstanding connections. The last remaining connection
-     * must be the sentinel. */
+     * more outstanding connections, nor any handshakes in progress. */
+
+    rc = TAILQ_EMPTY(&self->mClients) && TAILQ_EMPTY(&self->mHandshakes);
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+notifyPidServerExit(struct PidServer *self)
+{
+    int rc = -1;
+
+    /* This function is called when the umbilical connection to the sentry
+     * closes. By then the sentry has published the exit code of the child
+     * process, having drained its output, so send the exit code to each
+     * client waiting for the child process to exit. Clients that ask
+     * to wait after this are answered immediately, and the remaining
+     * clients hold their references until the lease expires.
+     *
+     * Return 1 if no connections remain, in the same way as
+     * cleanPidServer(). */
+
+    if ( ! self->mExited)
+    {
+        self->mExited    = true;
+        self->mExitSince = ert_eventclockTime();
+    }
+
+    struct PidServerClientActivity_ *activity = TAILQ_FIRST(&self->mClients);
+
+    while (activity)
+    {
+        struct PidServerClientActivity_ *next = TAILQ_NEXT(activity, mList_);
+
+        if (activity->mWaiting)
+            activity = replyPidServerWaiter_(self, activity);
+
+        activity = next;
+    }
+
+    /* Start the lease on the references that remain. */
+
+    ERT_ERROR_IF(
+        schedulePidServerTimer_(self));
 
-    rc = TAILQ_EMPTY(&self->mClients);
+    rc = TAILQ_EMPTY(&self->mClients) && TAILQ_EMPTY(&self->mHandshakes);
 
 Ert_Finally:
 
@@ -30,12 +30,17 @@
 #define PIDSERVER_H
 
 #include "pidsignature_.h"
+#include "slab.h"
 
 #include "ert/compiler.h"
+#include "ert/file.h"
+#include "ert/timekeeping.h"
 #include "ert/unixsocket.h"
 #include "ert/fileeventqueue.h"
 #include "ert/queue.h"
 
+#include <stdbool.h>
+
 #include <sys/un.h>
 #include <sys/socket.h>
 
@@ -72,6 +77,7 @@ ERT_END_C_SCOPE;
 ERT_BEGIN_C_SCOPE;
 
 struct PidServer;
+struct SentryStatus;
 
 /* -------------------------------------------------------------------------- */
 struct PidServerClient_
@@ -94,8 +100,15 @@ struct PidServerClientActivity_
     struct Ert_FileEventQueueActivity  mEvent_;
     struct Ert_FileEventQueueActivity *mEvent;
 
-    struct PidServerClient_              *mClient;
+    struct PidServerClient_  mClient_;
+    struct PidServerClient_ *mClient;
+
     struct PidServerClientActivityMethod_ mMethod;
+
+    struct PidSignatureReceiver *mReceiver; /* Handshake in progress */
+    struct Ert_EventClockTime    mSince;    /* Start of handshake */
+
+    bool mWaiting;                          /* Waiting for child exit */
 };
 
 typedef TAILQ_HEAD(PidServerClientActivityList_,
@@ -112,23 +125,69 @@ struct PidServer
     struct Ert_FileEventQueue *mEventQueue;
 
     struct PidSignature *mPidSignature;
+    struct SentryStatus *mStatus;
+    int                  mUmbilicalFd;  /* Connection to the sentry, or -1 */
+
+    struct Ert_File  mTimerFile_;
+    struct Ert_File *mTimerFile;
+
+    struct Ert_File  mPidFdFile_;   /* Handed to each client, if available */
+    struct Ert_File *mPidFdFile;
+
+    struct Ert_FileEventQueueActivity  mTimerEvent_;
+    struct Ert_FileEventQueueActivity *mTimerEvent;
+
+    struct Slab  mActivitySlab_;
+    struct Slab *mActivitySlab;
+
+    struct Slab  mReceiverSlab_;
+    struct Slab *mReceiverSlab;
 
+    unsigned mReferences;                   /* Limit, or zero if unbounded */
+    unsigned mHeld;                         /* References held */
+    unsigned mDiscards;
+    bool     mExited;
+
+    struct Ert_Duration       mLease;       /* Hold after exit, or zero */
+    struct Ert_EventClockTime mExitSince;
+
+    struct PidServerClientActivityList_ mHandshakes;
     struct PidServerClientActivityList_ mClients;
 };
 
 /* -------------------------------------------------------------------------- */
 ERT_CHECKED int
-createPidServer(struct PidServer *self, struct Ert_Pid aPid);
+createPidServer(struct PidServer *self,
+                struct Ert_Pid    aPid,
+                unsigned          aReferences,
+                unsigned          aLease_s);
+
+ERT_CHECKED int
+adoptPidServer(struct PidServer *self,
+               struct Ert_Pid    aPid,
+               int               aFd,
+               int               aPidFd,
+               unsigned          aReferences,
+               unsigned          aLease_s);
 
 struct PidServer *
 closePidServer(struct PidServer *self);
 
+void
+attachPidServerStatus(struct PidServer *self, struct SentryStatus *aStatus);
+
+void
+attachPidServerUmbilical(struct PidServer *self, int aFd);
+
 ERT_CHECKED int
 acceptPidServerConnection(struct PidServer *self);
 
 ERT_CHECKED int
 cleanPidServer(struct PidServer *self);
 
+ERT_CHECKED int
+notifyPidServerExit(struct PidServer *self);
+
 /* -------------------------------------------------------------------------- */
 
 ERT_END_C_SCOPE;
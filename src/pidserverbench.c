@@ -0,0 +1,377 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2016, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "pidserverbench.h"
+
+#include "pidserver.h"
+
+#include "options_.h"
+
+#include "ert/process.h"
+#include "ert/timekeeping.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/resource.h>
+
+/* -------------------------------------------------------------------------- */
+/* PidServer Connection Storm
+ *
+ * Connect a large number of clients to a pid server running in the same
+ * process, completing the handshake of each, then disconnect them all
+ * at once. Report the rate at which references are accepted and
+ * drained, and the memory consumed by each reference.
+ *
+ * Usage: pidserverbench [-d ...] [connections] */
+
+#define PIDSERVERBENCH_CONNECTIONS 10000
+#define PIDSERVERBENCH_BATCH       64
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+raiseFileLimit_(unsigned aFiles)
+{
+    int rc = -1;
+
+    struct rlimit limit;
+
+    ERT_ERROR_IF(
+        getrlimit(RLIMIT_NOFILE, &limit));
+
+    if (limit.rlim_cur < aFiles)
+    {
+        ERT_ERROR_IF(
+            limit.rlim_max < aFiles,
+            {
+                errno = EMFILE;
+            });
+
+        limit.rlim_cur = aFiles;
+
+        ERT_ERROR_IF(
+            setrlimit(RLIMIT_NOFILE, &limit));
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static size_t
+ownResidentBytes_(void)
+{
+    unsigned long pages    = 0;
+    unsigned long resident = 0;
+
+    FILE *statm = fopen("/proc/self/statm", "r");
+
+    if (statm)
+    {
+        if (2 != fscanf(statm, "%lu %lu", &pages, &resident))
+            resident = 0;
+        fclose(statm);
+    }
+
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+/* -------------------------------------------------------------------------- */
+static double
+ownElapsedSeconds_(uint64_t aSince_ns)
+{
+    return (ert_monotonicTime().monotonic.ns - aSince_ns) / 1e9;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+connectClient_(struct Ert_UnixSocket     *self_,
+               const struct sockaddr_un  *aAddr,
+               const struct PidSignature *aSignature)
+{
+    int rc = -1;
+
+    struct Ert_UnixSocket *self = 0;
+
+    int err;
+    ERT_ERROR_IF(
+        (err = ert_connectUnixSocket(self_,
+                                     aAddr->sun_path,
+                                     sizeof(aAddr->sun_path)),
+         -1 == err && EINPROGRESS != errno));
+    self = self_;
+
+    ERT_ERROR_IF(
+        (err = ert_waitUnixSocketWriteReady(self, 0),
+         -1 == err || (errno = 0, ! err)));
+
+    ERT_ERROR_IF(
+        sendPidSignature(self->mSocket->mFile, aSignature, 0));
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (rc)
+            self = ert_closeUnixSocket(self);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+runPidServerBench_(unsigned aConnections)
+{
+    int rc = -1;
+
+    struct PidServer  pidServer_;
+    struct PidServer *pidServer = 0;
+
+    struct PidSignature *signature = 0;
+
+    struct Ert_UnixSocket *clients   = 0;
+    unsigned               connected = 0;
+
+    /* Each connection occupies one descriptor on each side. */
+
+    ERT_ERROR_IF(
+        raiseFileLimit_(2 * aConnections + 64));
+
+    ERT_ERROR_UNLESS(
+        (clients = malloc(sizeof(*clients) * aConnections)));
+
+    ERT_ERROR_IF(
+        createPidServer(&pidServer_, ert_ownProcessId(), aConnections, 0));
+    pidServer = &pidServer_;
+
+    ERT_ERROR_UNLESS(
+        (signature = createPidSignature(ert_ownProcessId(), 0)));
+
+    size_t residentBytes = ownResidentBytes_();
+
+    uint64_t since_ns = ert_monotonicTime().monotonic.ns;
+
+    /* Connect the clients in batches, and accept each batch before
+     * connecting the next so that the listen backlog does not
+     * overflow. Each client waits for the acknowledgement that
+     * indicates that its reference is held by the server. */
+
+    while (connected < aConnections)
+    {
+        unsigned batch = aConnections - connected;
+
+        if (PIDSERVERBENCH_BATCH < batch)
+            batch = PIDSERVERBENCH_BATCH;
+
+        unsigned first = connected;
+
+        for (unsigned ix = 0; ix < batch; ++ix)
+        {
+            ERT_ERROR_IF(
+                connectClient_(
+                    &clients[connected],
+                    &pidServer->mSocketAddr,
+                    signature));
+            ++connected;
+        }
+
+        ERT_ERROR_IF(
+            acceptPidServerConnection(pidServer));
+
+        while ( ! TAILQ_EMPTY(&pidServer->mHandshakes))
+        {
+            int err;
+            ERT_ERROR_IF(
+                (err = cleanPidServer(pidServer),
+                 -1 == err));
+        }
+
+        for (unsigned ix = first; ix < connected; ++ix)
+        {
+            char buf[1];
+
+            int err;
+            ERT_ERROR_IF(
+                (err = ert_readSocket(
+                    clients[ix].mSocket, buf, sizeof(buf), 0),
+                 -1 == err || (errno = 0, 1 != err)));
+        }
+    }
+
+    double acceptSeconds = ownElapsedSeconds_(since_ns);
+
+    size_t residentGrowth = ownResidentBytes_() - residentBytes;
+
+    size_t slabBytes =
+        ownSlabFootprint(pidServer->mActivitySlab) +
+        ownSlabFootprint(pidServer->mReceiverSlab);
+
+    /* Disconnect all the clients at once, and measure the time taken
+     * by the server to drain the closed references. */
+
+    while (connected--)
+    {
+        struct Ert_UnixSocket *client = &clients[connected];
+
+        client = ert_closeUnixSocket(client);
+    }
+    connected = 0;
+
+    unsigned cleans = 0;
+
+    since_ns = ert_monotonicTime().monotonic.ns;
+
+    while (1)
+    {
+        int err;
+        ERT_ERROR_IF(
+            (err = cleanPidServer(pidServer),
+             -1 == err));
+
+        ++cleans;
+
+        if (err)
+            break;
+    }
+
+    double drainSeconds = ownElapsedSeconds_(since_ns);
+
+    printf("connections %u\n", aConnections);
+    printf("accept %.3fs rate %.0f/s\n",
+           acceptSeconds, aConnections / acceptSeconds);
+    printf("drain %.3fs rate %.0f/s cleans %u\n",
+           drainSeconds, aConnections / drainSeconds, cleans);
+    printf("slab %zu bytes/reference\n",
+           slabBytes / aConnections);
+    printf("resident %zu bytes/reference\n",
+           residentGrowth / aConnections);
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        while (connected--)
+        {
+            struct Ert_UnixSocket *client = &clients[connected];
+
+            client = ert_closeUnixSocket(client);
+        }
+
+        signature = destroyPidSignature(signature);
+        pidServer = closePidServer(pidServer);
+
+        free(clients);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+main(int argc, char **argv)
+{
+    struct Ert_ExitCode exitCode = { EXIT_FAILURE };
+
+    struct Ert_TestModule  testModule_;
+    struct Ert_TestModule *testModule = 0;
+
+    struct Ert_TimeKeepingModule  timeKeepingModule_;
+    struct Ert_TimeKeepingModule *timeKeepingModule = 0;
+
+    struct Ert_ProcessModule  processModule_;
+    struct Ert_ProcessModule *processModule = 0;
+
+    ERT_ABORT_IF(
+        Ert_Test_init(&testModule_, "PIDSENTRY_TEST_ERROR"));
+    testModule = &testModule_;
+
+    ERT_ABORT_IF(
+        Ert_Timekeeping_init(&timeKeepingModule_));
+    timeKeepingModule = &timeKeepingModule_;
+
+    ERT_ABORT_IF(
+        Ert_Process_init(&processModule_, argv[0]));
+    processModule = &processModule_;
+
+    initOptions();
+
+    int argi = 1;
+
+    for ( ; argi < argc && ! strcmp(argv[argi], "-d"); ++argi)
+        ++gOptions.mOptions.mDebug;
+
+    unsigned connections = PIDSERVERBENCH_CONNECTIONS;
+
+    if (argi < argc)
+    {
+        ERT_ABORT_IF(
+            argi + 1 != argc ||
+            ert_parseUInt(argv[argi], &connections) || ! connections,
+            {
+                ert_terminate(0, "Usage: %s [-d ...] [connections]", argv[0]);
+            });
+    }
+
+    ert_initOptions(&gOptions.mOptions);
+
+    ERT_ABORT_IF(
+        ert_ignoreProcessSigPipe());
+
+    ERT_ABORT_IF(
+        runPidServerBench_(connections),
+        {
+            ert_terminate(errno, "Failed to run pid server benchmark");
+        });
+
+    exitCode.mStatus = EXIT_SUCCESS;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    processModule     = Ert_Process_exit(processModule);
+    timeKeepingModule = Ert_Timekeeping_exit(timeKeepingModule);
+    testModule        = Ert_Test_exit(testModule);
+
+    return exitCode.mStatus;
+}
+
+/* -------------------------------------------------------------------------- */
@@ -36,6 +36,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <fcntl.h>
 #include <ctype.h>
 
@@ -44,7 +45,7 @@ struct MarshalledPidSignature
 {
     pid_t  mPid;
     size_t mSignatureLen;
-    char   mSignature[1024+1];
+    char   mSignature[PIDSIGNATURE_MAX_LEN+1];
 };
 
 /* -------------------------------------------------------------------------- */
@@ -349,3 +350,96 @@ Ert_Finally:
 }
 
 /* -------------------------------------------------------------------------- */
+void
+createPidSignatureReceiver(struct PidSignatureReceiver *self)
+{
+    self->mSignature.mPid       = Ert_Pid(-1);
+    self->mSignature.mSignature = 0;
+
+    self->mReceived = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+const struct PidSignature *
+pollPidSignatureReceiver(struct PidSignatureReceiver *self,
+                         struct Ert_File             *aFile)
+{
+    int rc = -1;
+
+    /* Accumulate the marshalled signature as it arrives, without ever
+     * waiting for more to arrive. This allows the caller to run the
+     * exchange from an event loop, reading only when the connection is
+     * readable. Return the signature once it is complete, or indicate
+     * with EWOULDBLOCK that more is needed.
+     *
+     * The signature that is returned refers to the content of the
+     * receiver, and remains valid only as long as the receiver, so
+     * that no memory is allocated to receive it. */
+
+    pid_t  pid;
+    size_t signatureLen = 0;
+
+    const size_t headerLen = sizeof(pid) + sizeof(signatureLen);
+
+    size_t expectedLen = headerLen;
+
+    if (headerLen <= self->mReceived)
+    {
+        memcpy(&signatureLen, self->mBuf + sizeof(pid), sizeof(signatureLen));
+
+        expectedLen += signatureLen;
+    }
+
+    ssize_t rdlen;
+    ERT_ERROR_IF(
+        (rdlen = read(
+            aFile->mFd,
+            self->mBuf + self->mReceived,
+            expectedLen - self->mReceived),
+         -1 == rdlen || (errno = ECONNRESET, ! rdlen)));
+
+    self->mReceived += rdlen;
+
+    if (headerLen <= self->mReceived && headerLen == expectedLen)
+    {
+        memcpy(&signatureLen, self->mBuf + sizeof(pid), sizeof(signatureLen));
+
+        ERT_ERROR_IF(
+            PIDSIGNATURE_MAX_LEN < signatureLen,
+            {
+                errno = EINVAL;
+            });
+
+        expectedLen += signatureLen;
+    }
+
+    ERT_ERROR_IF(
+        expectedLen != self->mReceived,
+        {
+            errno = EWOULDBLOCK;
+        });
+
+    char *signature = self->mBuf + headerLen;
+
+    memcpy(&pid, self->mBuf, sizeof(pid));
+    signature[signatureLen] = 0;
+
+    ERT_ERROR_UNLESS(
+        strlen(signature) == signatureLen,
+        {
+            errno = ERANGE;
+        });
+
+    self->mSignature.mPid       = Ert_Pid(pid);
+    self->mSignature.mSignature = signature;
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc ? 0 : &self->mSignature;
+}
+
+/* -------------------------------------------------------------------------- */
@@ -34,18 +34,30 @@
 
 #include <stdio.h>
 
+#include <sys/types.h>
+
 /* -------------------------------------------------------------------------- */
 ERT_BEGIN_C_SCOPE;
 
 struct Ert_File;
 struct Ert_Deadline;
 
+#define PIDSIGNATURE_MAX_LEN 1024
+
 struct PidSignature
 {
     struct Ert_Pid mPid;
     char          *mSignature;
 };
 
+struct PidSignatureReceiver
+{
+    struct PidSignature mSignature;
+
+    size_t mReceived;
+    char   mBuf[sizeof(pid_t) + sizeof(size_t) + PIDSIGNATURE_MAX_LEN + 1];
+};
+
 /* -------------------------------------------------------------------------- */
 ERT_CHECKED struct PidSignature *
 createPidSignature(struct Ert_Pid aPid, const char *aSignature);
@@ -69,6 +81,13 @@ sendPidSignature(struct Ert_File           *aFile,
 ERT_CHECKED struct PidSignature *
 recvPidSignature(struct Ert_File *aFile, struct Ert_Deadline *aDeadline);
 
+void
+createPidSignatureReceiver(struct PidSignatureReceiver *self);
+
+ERT_CHECKED const struct PidSignature *
+pollPidSignatureReceiver(struct PidSignatureReceiver *self,
+                         struct Ert_File             *aFile);
+
 /* -------------------------------------------------------------------------- */
 
 ERT_END_C_SCOPE;
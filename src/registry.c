@@ -0,0 +1,605 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2016, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "registry.h"
+#include "pidsignature_.h"
+
+#include "ert/error.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* -------------------------------------------------------------------------- */
+/* Sentry Registry
+ *
+ * The registry is an optional file, usually in /run, that is shared by
+ * all the sentries on the host. The file holds a fixed number of slots,
+ * and each sentry claims a slot by storing its pid as the owner. The
+ * owner is the only writer of the entry in the slot, and brackets each
+ * update with increments of a sequence number so that readers can copy
+ * the entry without taking any locks, and retry if the sequence number
+ * shows that the entry changed while it was being copied.
+ *
+ * A sentry that terminates abruptly leaves its slot claimed, so the
+ * slots of owners that no longer exist are reclaimed by new sentries,
+ * and skipped by readers. Each entry records the signature of the
+ * sentry, so that an owner whose pid has been reused by an unrelated
+ * process is recognised as no longer existing. */
+
+#define REGISTRY_RETRIES 64
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+mapRegistry_(struct Registry *self, int aProt)
+{
+    int rc = -1;
+
+    struct stat fileStat;
+    ERT_ERROR_IF(
+        ert_fstatFile(self->mFile, &fileStat));
+
+    ERT_ERROR_IF(
+        sizeof(*self->mRegion) > fileStat.st_size,
+        {
+            errno = EPROTO;
+        });
+
+    void *region;
+    ERT_ERROR_IF(
+        (region = mmap(0, sizeof(*self->mRegion),
+                       aProt, MAP_SHARED,
+                       self->mFile->mFd, 0),
+         MAP_FAILED == region));
+    self->mRegion = region;
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+checkRegistry_(const struct Registry *self)
+{
+    int rc = -1;
+
+    const struct RegistryRegion_ *region = self->mRegion;
+
+    ERT_ERROR_IF(
+        REGISTRY_VERSION != __atomic_load_n(
+            &region->mVersion, __ATOMIC_ACQUIRE) ||
+        REGISTRY_SLOTS != __atomic_load_n(
+            &region->mSlots, __ATOMIC_RELAXED) ||
+        sizeof(region->mSlot[0]) != __atomic_load_n(
+            &region->mSlotSize, __ATOMIC_RELAXED),
+        {
+            errno = EPROTO;
+        });
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+createRegistry(struct Registry *self, const char *aFileName)
+{
+    int rc = -1;
+
+    self->mFile   = 0;
+    self->mRegion = 0;
+    self->mSlot   = 0;
+
+    ERT_ERROR_IF(
+        ert_createFile(
+            &self->mFile_,
+            ert_openFd(aFileName,
+                       O_RDWR | O_CREAT | O_CLOEXEC,
+                       Ert_Mode(S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH))));
+    self->mFile = &self->mFile_;
+
+    /* Sentries starting concurrently might race to size and initialise
+     * a new registry, but they all write the same values, so there is
+     * no need to serialise them. */
+
+    struct stat fileStat;
+    ERT_ERROR_IF(
+        ert_fstatFile(self->mFile, &fileStat));
+
+    if (sizeof(*self->mRegion) > fileStat.st_size)
+        ERT_ERROR_IF(
+            ert_ftruncateFile(self->mFile, sizeof(*self->mRegion)));
+
+    ERT_ERROR_IF(
+        mapRegistry_(self, PROT_READ | PROT_WRITE));
+
+    struct RegistryRegion_ *region = self->mRegion;
+
+    if ( ! __atomic_load_n(&region->mVersion, __ATOMIC_ACQUIRE))
+    {
+        uint32_t version = 0;
+
+        __atomic_store_n(
+            &region->mSlots, REGISTRY_SLOTS, __ATOMIC_RELAXED);
+        __atomic_store_n(
+            &region->mSlotSize, sizeof(region->mSlot[0]), __ATOMIC_RELAXED);
+        __atomic_compare_exchange_n(
+            &region->mVersion, &version, REGISTRY_VERSION,
+            false, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+    }
+
+    ERT_ERROR_IF(
+        checkRegistry_(self));
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (rc)
+            self = closeRegistry(self);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+openRegistry(struct Registry *self, const char *aFileName)
+{
+    int rc = -1;
+
+    self->mFile   = 0;
+    self->mRegion = 0;
+    self->mSlot   = 0;
+
+    ERT_ERROR_IF(
+        ert_createFile(
+            &self->mFile_,
+            ert_openFd(aFileName, O_RDONLY | O_CLOEXEC, Ert_Mode(0))));
+    self->mFile = &self->mFile_;
+
+    ERT_ERROR_IF(
+        mapRegistry_(self, PROT_READ));
+
+    /* A registry that is still being initialised is empty. */
+
+    if (__atomic_load_n(&self->mRegion->mVersion, __ATOMIC_ACQUIRE))
+        ERT_ERROR_IF(
+            checkRegistry_(self));
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (rc)
+            self = closeRegistry(self);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+struct Registry *
+closeRegistry(struct Registry *self)
+{
+    if (self)
+    {
+        releaseRegistrySlot(self);
+
+        if (self->mRegion)
+            ERT_ABORT_IF(
+                munmap(self->mRegion, sizeof(*self->mRegion)));
+
+        self->mFile = ert_closeFile(self->mFile);
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+static bool
+deadRegistryOwner_(int32_t aOwner, const char *aSignature)
+{
+    /* An owner that has not yet recorded its signature can only be
+     * checked by pid. Otherwise the owner is only alive if the process
+     * with that pid still has the same signature. Any failure to obtain
+     * the signature, other than the process not existing, leaves
+     * the owner in place. */
+
+    if ( ! aSignature[0])
+        return kill(aOwner, 0) && ESRCH == errno;
+
+    struct PidSignature *signature = createPidSignature(Ert_Pid(aOwner), 0);
+
+    bool dead = signature
+        ? strcmp(signature->mSignature, aSignature)
+        : ENOENT == errno;
+
+    signature = destroyPidSignature(signature);
+
+    return dead;
+}
+
+/* -------------------------------------------------------------------------- */
+static bool
+deadRegistrySlotOwner_(const struct RegistrySlot_ *aSlot, int32_t aOwner)
+{
+    /* The signature of the owner is only available once the owner has
+     * written its entry, and is copied using the same protocol that
+     * readers use to copy the entry. */
+
+    char signature[sizeof(aSlot->mEntry.mSentrySignature)] = "";
+
+    for (unsigned retry = 0; REGISTRY_RETRIES > retry; ++retry)
+    {
+        uint32_t seq = __atomic_load_n(&aSlot->mSeq, __ATOMIC_ACQUIRE);
+
+        if (seq & 1)
+            continue;
+
+        int32_t sentryPid = aSlot->mEntry.mSentryPid;
+
+        memcpy(signature, aSlot->mEntry.mSentrySignature, sizeof(signature));
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        if (seq == __atomic_load_n(&aSlot->mSeq, __ATOMIC_RELAXED))
+        {
+            if (aOwner != sentryPid)
+                signature[0] = 0;
+            break;
+        }
+
+        signature[0] = 0;
+    }
+
+    signature[sizeof(signature) - 1] = 0;
+
+    return deadRegistryOwner_(aOwner, signature);
+}
+
+/* -------------------------------------------------------------------------- */
+static uint32_t
+beginRegistryUpdate_(struct RegistrySlot_ *aSlot)
+{
+    /* A previous owner that died part way through an update will
+     * have left the sequence number odd, and it can be used as is. */
+
+    uint32_t seq = __atomic_load_n(&aSlot->mSeq, __ATOMIC_RELAXED) | 1;
+
+    __atomic_store_n(&aSlot->mSeq, seq, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    return seq;
+}
+
+static void
+endRegistryUpdate_(struct RegistrySlot_ *aSlot, uint32_t aSeq)
+{
+    __atomic_store_n(&aSlot->mSeq, aSeq + 1, __ATOMIC_RELEASE);
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+copyRegistryPidFile_(char *aBuf, size_t aBufSize, const char *aPidFileName)
+{
+    int rc = -1;
+
+    /* Relative names are resolved against the current directory, which
+     * the sentry abandons once it has started. */
+
+    size_t dirLen = 0;
+
+    if ('/' != aPidFileName[0])
+    {
+        ERT_ERROR_UNLESS(
+            getcwd(aBuf, aBufSize));
+
+        dirLen = strlen(aBuf);
+        if (1 != dirLen)
+            aBuf[dirLen++] = '/';
+    }
+
+    size_t nameLen = strlen(aPidFileName);
+
+    ERT_ERROR_IF(
+        aBufSize <= dirLen + nameLen,
+        {
+            errno = ENAMETOOLONG;
+        });
+
+    memcpy(aBuf + dirLen, aPidFileName, nameLen + 1);
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+claimRegistrySlot(struct Registry           *self,
+                  struct Ert_Pid             aChildPid,
+                  const struct PidSignature *aSignature,
+                  const char                *aPidFileName,
+                  const struct sockaddr_un  *aServerAddr)
+{
+    int rc = -1;
+
+    struct PidSignature *sentrySignature = 0;
+
+    int32_t sentryPid = ert_ownProcessId().mPid;
+
+    ert_ensure( ! self->mSlot);
+
+    /* Prepare the complete entry before claiming a slot so that a
+     * slot is never claimed only to be abandoned. */
+
+    struct RegistryEntry entry =
+    {
+        .mSentryPid = sentryPid,
+        .mChildPid  = aChildPid.mPid,
+        .mState     = SentryStatusStarting,
+    };
+
+    ERT_ERROR_UNLESS(
+        sentrySignature = createPidSignature(Ert_Pid(sentryPid), 0));
+
+    size_t sentrySignatureLen = strlen(sentrySignature->mSignature);
+
+    ERT_ERROR_IF(
+        sizeof(entry.mSentrySignature) <= sentrySignatureLen,
+        {
+            errno = ENAMETOOLONG;
+        });
+    memcpy(entry.mSentrySignature,
+           sentrySignature->mSignature, sentrySignatureLen + 1);
+
+    if (aSignature && aSignature->mSignature)
+    {
+        size_t signatureLen = strlen(aSignature->mSignature);
+
+        ERT_ERROR_IF(
+            sizeof(entry.mSignature) <= signatureLen,
+            {
+                errno = ENAMETOOLONG;
+            });
+        memcpy(entry.mSignature, aSignature->mSignature, signatureLen + 1);
+    }
+
+    if (aPidFileName)
+        ERT_ERROR_IF(
+            copyRegistryPidFile_(
+                entry.mPidFile, sizeof(entry.mPidFile), aPidFileName));
+
+    /* The pid server listens on an abstract address, so the name
+     * starts after the leading nul and is padded with nuls. */
+
+    if (aServerAddr)
+        memcpy(entry.mServerAddr,
+               &aServerAddr->sun_path[1],
+               sizeof(aServerAddr->sun_path) - 1);
+
+    struct RegistryRegion_ *region = self->mRegion;
+
+    for (unsigned ix = 0; ERT_NUMBEROF(region->mSlot) > ix; ++ix)
+    {
+        struct RegistrySlot_ *slot = &region->mSlot[ix];
+
+        int32_t owner = __atomic_load_n(&slot->mOwner, __ATOMIC_ACQUIRE);
+
+        if (owner && ! deadRegistrySlotOwner_(slot, owner))
+            continue;
+
+        if (__atomic_compare_exchange_n(
+                &slot->mOwner, &owner, sentryPid,
+                false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        {
+            self->mSlot = slot;
+            break;
+        }
+    }
+
+    ERT_ERROR_UNLESS(
+        self->mSlot,
+        {
+            errno = ENOSPC;
+        });
+
+    uint32_t seq = beginRegistryUpdate_(self->mSlot);
+    self->mSlot->mEntry = entry;
+    endRegistryUpdate_(self->mSlot, seq);
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        sentrySignature = destroyPidSignature(sentrySignature);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+void
+setRegistryState(struct Registry *self, enum SentryStatusState aState)
+{
+    if (self && self->mSlot)
+    {
+        uint32_t seq = beginRegistryUpdate_(self->mSlot);
+        self->mSlot->mEntry.mState = aState;
+        endRegistryUpdate_(self->mSlot, seq);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+void
+releaseRegistrySlot(struct Registry *self)
+{
+    /* Processes forked from the sentry share the mapping, but only the
+     * sentry itself can release its slot. */
+
+    if (self && self->mSlot)
+    {
+        struct RegistrySlot_ *slot = self->mSlot;
+
+        self->mSlot = 0;
+
+        int32_t sentryPid = ert_ownProcessId().mPid;
+
+        if (sentryPid == __atomic_load_n(&slot->mOwner, __ATOMIC_RELAXED))
+        {
+            uint32_t seq = beginRegistryUpdate_(slot);
+            slot->mEntry.mSentryPid = 0;
+            slot->mEntry.mState     = SentryStatusExited;
+            endRegistryUpdate_(slot, seq);
+
+            __atomic_store_n(&slot->mOwner, 0, __ATOMIC_RELEASE);
+        }
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+static bool
+snapshotRegistrySlot_(const struct RegistrySlot_ *aSlot,
+                      struct RegistryEntry       *aEntry)
+{
+    /* Give up on an entry that is continually changing, or whose owner
+     * died part way through an update. The owner is published before
+     * the entry is written, so the entry is only valid once it names
+     * the same sentry as the owner.
+     *
+     * Listing only checks that the owner exists, so that enumerating
+     * many entries does not read /proc for each of them. A recycled
+     * owner pid can leave a stale entry listed until a writer reclaims
+     * the slot using the signature of the owner. */
+
+    for (unsigned retry = 0; REGISTRY_RETRIES > retry; ++retry)
+    {
+        uint32_t seq = __atomic_load_n(&aSlot->mSeq, __ATOMIC_ACQUIRE);
+
+        if (seq & 1)
+            continue;
+
+        int32_t owner = __atomic_load_n(&aSlot->mOwner, __ATOMIC_ACQUIRE);
+
+        if ( ! owner)
+            break;
+
+        memcpy(aEntry, &aSlot->mEntry, sizeof(*aEntry));
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        if (seq == __atomic_load_n(&aSlot->mSeq, __ATOMIC_RELAXED))
+        {
+            aEntry->mSignature[sizeof(aEntry->mSignature) - 1]   = 0;
+            aEntry->mPidFile[sizeof(aEntry->mPidFile) - 1]       = 0;
+            aEntry->mServerAddr[sizeof(aEntry->mServerAddr) - 1] = 0;
+
+            aEntry->mSentrySignature[
+                sizeof(aEntry->mSentrySignature) - 1] = 0;
+
+            if (owner != aEntry->mSentryPid ||
+                (kill(owner, 0) && ESRCH == errno))
+                break;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+printRegistry(const struct Registry *self, FILE *aFile)
+{
+    int rc = -1;
+
+    const struct RegistryRegion_ *region = self->mRegion;
+
+    if (__atomic_load_n(&region->mVersion, __ATOMIC_ACQUIRE))
+    {
+        for (unsigned ix = 0; ERT_NUMBEROF(region->mSlot) > ix; ++ix)
+        {
+            struct RegistryEntry entry;
+
+            if ( ! snapshotRegistrySlot_(&region->mSlot[ix], &entry))
+                continue;
+
+            ERT_ERROR_IF(
+                0 > fprintf(
+                    aFile,
+                    "pid %" PRId32 " sentry %" PRId32 " state %s"
+                    " pidfile %s server %s%s signature %s\n",
+                    entry.mChildPid,
+                    entry.mSentryPid,
+                    ownSentryStatusStateName(entry.mState),
+                    entry.mPidFile[0] ? entry.mPidFile : "-",
+                    entry.mServerAddr[0] ? "@" : "",
+                    entry.mServerAddr[0] ? entry.mServerAddr : "-",
+                    entry.mSignature[0] ? entry.mSignature : "-"));
+        }
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
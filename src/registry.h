@@ -0,0 +1,121 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2016, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#include "ert/compiler.h"
+#include "ert/file.h"
+#include "ert/pid.h"
+
+#include "sentrystatus.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <sys/un.h>
+
+ERT_BEGIN_C_SCOPE;
+
+struct PidSignature;
+
+/* -------------------------------------------------------------------------- */
+#define REGISTRY_VERSION 2
+#define REGISTRY_SLOTS   256
+
+struct RegistryEntry
+{
+    int32_t  mSentryPid;
+    int32_t  mChildPid;
+    uint32_t mState;            /* enum SentryStatusState */
+    uint32_t mReserved;
+    char     mSignature[128];
+    char     mSentrySignature[128];
+    char     mPidFile[256];     /* Absolute path, or empty */
+    char     mServerAddr[       /* Abstract address, or empty */
+        sizeof(((struct sockaddr_un *) 0)->sun_path)];
+};
+
+struct RegistrySlot_
+{
+    uint32_t mSeq;              /* Odd while the entry is being updated */
+    int32_t  mOwner;            /* Pid of the sentry holding the slot */
+
+    struct RegistryEntry mEntry;
+};
+
+struct RegistryRegion_
+{
+    uint32_t mVersion;          /* Set once the header is initialised */
+    uint32_t mSlots;
+    uint32_t mSlotSize;
+    uint32_t mReserved;
+
+    struct RegistrySlot_ mSlot[REGISTRY_SLOTS];
+};
+
+struct Registry
+{
+    struct Ert_File  mFile_;
+    struct Ert_File *mFile;
+
+    struct RegistryRegion_ *mRegion;
+    struct RegistrySlot_   *mSlot;
+};
+
+/* -------------------------------------------------------------------------- */
+ERT_CHECKED int
+createRegistry(struct Registry *self, const char *aFileName);
+
+ERT_CHECKED int
+openRegistry(struct Registry *self, const char *aFileName);
+
+struct Registry *
+closeRegistry(struct Registry *self);
+
+ERT_CHECKED int
+claimRegistrySlot(struct Registry           *self,
+                  struct Ert_Pid             aChildPid,
+                  const struct PidSignature *aSignature,
+                  const char                *aPidFileName,
+                  const struct sockaddr_un  *aServerAddr);
+
+void
+setRegistryState(struct Registry *self, enum SentryStatusState aState);
+
+void
+releaseRegistrySlot(struct Registry *self);
+
+ERT_CHECKED int
+printRegistry(const struct Registry *self, FILE *aFile);
+
+/* -------------------------------------------------------------------------- */
+
+ERT_END_C_SCOPE;
+
+#endif /* REGISTRY_H */
@@ -30,6 +30,7 @@
 #include "sentry.h"
 
 #include "options_.h"
+#include "pidsignature_.h"
 
 #include <fcntl.h>
 #include <unistd.h>
@@ -76,6 +77,44 @@ raiseSentrySigCont_(struct Sentry *self)
     return raiseChildProcessSigCont(self->mChildProcess);
 }
 
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+registerSentry_(struct Sentry *self)
+{
+    int rc = -1;
+
+    struct PidSignature *signature = 0;
+
+    ERT_ERROR_UNLESS(
+        signature = createPidSignature(self->mChildProcess->mPid, 0));
+
+    ERT_ERROR_IF(
+        createRegistry(&self->mRegistry_, gOptions.mServer.mRegistry));
+    self->mRegistry = &self->mRegistry_;
+
+    ERT_ERROR_IF(
+        claimRegistrySlot(
+            self->mRegistry,
+            self->mChildProcess->mPid,
+            signature,
+            gOptions.mServer.mPidFile,
+            self->mPidServer ? &self->mPidServer->mSocketAddr : 0));
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        signature = destroyPidSignature(signature);
+
+        if (rc)
+            self->mRegistry = closeRegistry(self->mRegistry);
+    });
+
+    return rc;
+}
+
 /* -------------------------------------------------------------------------- */
 int
 createSentry(struct Sentry      *self,
@@ -89,6 +128,10 @@ createSentry(struct Sentry      *self,
     self->mSyncSocket       = 0;
     self->mPidFile          = 0;
     self->mPidServer        = 0;
+    self->mStdoutFile       = 0;
+    self->mUmbilicalBeat    = 0;
+    self->mStatus           = 0;
+    self->mRegistry         = 0;
     self->mUmbilicalProcess = 0;
 
     ERT_ERROR_IF(
@@ -156,12 +199,26 @@ createSentry(struct Sentry      *self,
             });
         self->mPidFile = &self->mPidFile_;
 
+        setPidFileFormat(self->mPidFile, gOptions.mServer.mPidFileFormat);
+
         ERT_ERROR_IF(
             createPidServer(&self->mPidServer_,
-                            self->mChildProcess->mPid));
+                            self->mChildProcess->mPid,
+                            gOptions.mServer.mReferences,
+                            gOptions.mServer.mLease_s));
         self->mPidServer = &self->mPidServer_;
     }
 
+    /* Register the sentry before changing directory so that the name
+     * of the pidfile can be recorded as an absolute path. The registry
+     * is only an index of the sentries, so failing to register is not
+     * fatal. */
+
+    if (gOptions.mServer.mRegistry && registerSentry_(self))
+        ert_warn(
+            errno,
+            "Unable to register in %s", gOptions.mServer.mRegistry);
+
     /* If not running in test mode, change directory to avoid holding
      * a reference that prevents a volume being unmounted. Otherwise
      * do not change directories in case a core file needs to be
@@ -219,6 +276,10 @@ closeSentry(struct Sentry *self)
 {
     if (self)
     {
+        self->mRegistry        = closeRegistry(self->mRegistry);
+        self->mStatus          = closeSentryStatus(self->mStatus);
+        self->mUmbilicalBeat   = closeUmbilicalBeat(self->mUmbilicalBeat);
+        self->mStdoutFile      = ert_closeFile(self->mStdoutFile);
         self->mPidServer       = closePidServer(self->mPidServer);
         self->mPidFile         = destroyPidFile(self->mPidFile);
         self->mSyncSocket      = ert_closeBellSocketPair(self->mSyncSocket);
@@ -239,13 +300,96 @@ announceSentryPidFile(struct Sentry *self)
      * to create the file to fail, and it is simpler to avoid having
      * clean up the umbilical process. */
 
-    return ! self->mPidFile
-        ? Ert_Pid(0)
-        : createPidFile(
-            self->mPidFile,
-            self->mChildProcess->mPid,
-            &self->mPidServer->mSocketAddr,
-            gOptions.mServer.mPidFileMode);
+    if ( ! self->mPidFile)
+        return Ert_Pid(0);
+
+    /* If the child process will indicate when it is ready, only reserve
+     * the pidfile now, and publish its content once the child is ready.
+     * The pidfile remains locked in the meantime, so readers will wait
+     * rather than connect to a child that is only partially started. */
+
+    if (gOptions.mServer.mNotify)
+    {
+        self->mPidServerAddr = self->mPidServer->mSocketAddr;
+
+        return reservePidFile(self->mPidFile, gOptions.mServer.mPidFileMode);
+    }
+
+    return createPidFile(
+        self->mPidFile,
+        self->mChildProcess->mPid,
+        &self->mPidServer->mSocketAddr,
+        gOptions.mServer.mPidFileMode);
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+announceSentryChild_(struct Sentry *self, int aFd)
+{
+    int rc = -1;
+
+    struct Ert_Pid childPid = self->mChildProcess->mPid;
+
+    /* Mark the registry entry as running before identifying the child
+     * so that anyone that learns of the child can also find it there. */
+
+    setRegistryState(self->mRegistry, SentryStatusRunning);
+
+    if (gOptions.mServer.mIdentify)
+    {
+        ERT_TEST_RACE
+        ({
+            ERT_ERROR_IF(
+                -1 == dprintf(aFd,
+                              "%" PRId_Ert_Pid "\n",
+                              FMTd_Ert_Pid(childPid)));
+        });
+    }
+
+    if (gOptions.mServer.mAnnounce)
+        ert_message(0,
+                "started pid %" PRId_Ert_Pid " %s",
+                FMTd_Ert_Pid(childPid),
+                ownShellCommandName(self->mChildProcess->mShellCommand));
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+publishSentry_(struct Sentry *self, struct ChildProcess *aChildProcess)
+{
+    int rc = -1;
+
+    /* The child process has indicated that it is ready, so publish
+     * the pidfile before identifying the child, as would have been
+     * done had the child not been required to indicate readiness. */
+
+    if (self->mPidFile)
+        ERT_ERROR_IF(
+            publishPidFile(
+                self->mPidFile, aChildProcess->mPid, &self->mPidServerAddr));
+
+    ERT_ERROR_IF(
+        announceSentryChild_(
+            self,
+            self->mStdoutFile ? self->mStdoutFile->mFd : STDOUT_FILENO));
+
+    self->mStdoutFile = ert_closeFile(self->mStdoutFile);
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -272,16 +416,66 @@ runSentry(struct Sentry       *self,
      * purged so that the umbilical does not inadvertently hold file
      * descriptors that should only be held by the child process. */
 
-    ERT_ERROR_IF(
-        createUmbilicalProcess(&self->mUmbilicalProcess_,
-                               self->mChildProcess,
-                               self->mUmbilicalSocket,
-                               self->mPidServer),
-        {
-            ert_terminate(
-                errno,
-                "Unable to create umbilical process");
-        });
+    if (gOptions.mServer.mSharedBeat)
+    {
+        /* Create the shared heartbeat after the child process has been
+         * forked so that only the sentry and the umbilical process
+         * have access to the region. */
+
+        ERT_ERROR_IF(
+            createUmbilicalBeat(&self->mUmbilicalBeat_),
+            {
+                ert_terminate(
+                    errno,
+                    "Unable to create umbilical heartbeat");
+            });
+        self->mUmbilicalBeat = &self->mUmbilicalBeat_;
+    }
+
+    if (self->mPidServer)
+    {
+        /* Publish the status of the sentry where the PidServer can
+         * read it to answer status queries from clients. */
+
+        ERT_ERROR_IF(
+            createSentryStatus(&self->mStatus_),
+            {
+                ert_terminate(
+                    errno,
+                    "Unable to create sentry status");
+            });
+        self->mStatus = &self->mStatus_;
+
+        attachPidServerStatus(self->mPidServer, self->mStatus);
+    }
+
+    if (gOptions.mServer.mUmbilicalDaemon)
+        ERT_ERROR_IF(
+            registerUmbilicalProcess(&self->mUmbilicalProcess_,
+                                     self->mChildProcess,
+                                     self->mUmbilicalSocket,
+                                     self->mPidServer,
+                                     self->mStatus,
+                                     gOptions.mServer.mUmbilicalDaemon),
+            {
+                ert_terminate(
+                    errno,
+                    "Unable to register with umbilical daemon %s",
+                    gOptions.mServer.mUmbilicalDaemon);
+            });
+    else
+        ERT_ERROR_IF(
+            createUmbilicalProcess(&self->mUmbilicalProcess_,
+                                   self->mChildProcess,
+                                   self->mUmbilicalSocket,
+                                   self->mPidServer,
+                                   self->mUmbilicalBeat,
+                                   self->mStatus),
+            {
+                ert_terminate(
+                    errno,
+                    "Unable to create umbilical process");
+            });
     self->mUmbilicalProcess = &self->mUmbilicalProcess_;
 
     ert_ensure( ! self->mUmbilicalSocket->mChildSocket);
@@ -295,7 +489,7 @@ runSentry(struct Sentry       *self,
         reapSentry_(self));
 
     /* The PidServer instance will continue to run in the umbilical process,
-       so the instance that was created in the watchdog is no longer
+       or in the umbilical daemon, so the instance that was created in the watchdog is no longer
        required. */
 
     self->mPidServer = closePidServer(self->mPidServer);
@@ -361,24 +555,14 @@ runSentry(struct Sentry       *self,
      * after the pidfile is created, announce the child pid if
      * required. Do this here before releasing the child process
      * so that this content does not become co-mingled with other
-     * data on stdout when the child is running untethered. */
-
-    if (gOptions.mServer.mIdentify)
-    {
-        ERT_TEST_RACE
-        ({
-            ERT_ERROR_IF(
-                -1 == dprintf(STDOUT_FILENO,
-                              "%" PRId_Ert_Pid "\n",
-                              FMTd_Ert_Pid(childPid)));
-        });
-    }
+     * data on stdout when the child is running untethered.
+     *
+     * If the child process will indicate when it is ready, defer
+     * the announcement until then. */
 
-    if (gOptions.mServer.mAnnounce)
-        ert_message(0,
-                "started pid %" PRId_Ert_Pid " %s",
-                FMTd_Ert_Pid(childPid),
-                ownShellCommandName(self->mChildProcess->mShellCommand));
+    if ( ! gOptions.mServer.mNotify)
+        ERT_ERROR_IF(
+            announceSentryChild_(self, STDOUT_FILENO));
 
     ERT_TEST_RACE
     ({
@@ -410,6 +594,18 @@ runSentry(struct Sentry       *self,
             discardStdout = true;
     }
 
+    /* Retain a reference to the original stdout if the identification
+     * of the child process is deferred until the child is ready. */
+
+    if (gOptions.mServer.mNotify && gOptions.mServer.mIdentify)
+    {
+        ERT_ERROR_IF(
+            ert_createFile(
+                &self->mStdoutFile_,
+                fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 0)));
+        self->mStdoutFile = &self->mStdoutFile_;
+    }
+
     if (discardStdout)
     {
         ERT_ERROR_IF(
@@ -456,7 +652,27 @@ runSentry(struct Sentry       *self,
             self->mUmbilicalProcess,
             self->mUmbilicalSocket->mParentSocket->mSocket->mFile,
             aParentPid,
-            aParentPipe));
+            aParentPipe,
+            ChildProcessReadyMethod(self, publishSentry_)));
+
+    self->mStdoutFile = ert_closeFile(self->mStdoutFile);
+
+    setRegistryState(self->mRegistry, SentryStatusExited);
+
+    /* The child process has terminated and its output has been drained,
+     * so publish its exit code before stopping the umbilical. The pid
+     * server sends the exit code to waiting clients as the umbilical
+     * stops, well before the pid file is released and the child
+     * process reaped. */
+
+    if (self->mStatus)
+    {
+        struct Ert_ExitCode childExitCode;
+        ERT_ERROR_IF(
+            peekChildProcess(self->mChildProcess, &childExitCode));
+
+        setSentryStatusExitCode(self->mStatus, childExitCode.mStatus);
+    }
 
     /* Attempt to stop the umbilical process cleanly so that the watchdog
      * can exit in an orderly fashion with the exit status of the child
@@ -516,12 +732,21 @@ runSentry(struct Sentry       *self,
 
     if (self->mPidFile)
     {
-        ERT_ERROR_IF(
-            acquirePidFileWriteLock(self->mPidFile));
+        /* If the child process never indicated that it was ready, the
+         * pidfile was never published, and the lock is still held. */
+
+        if ( ! self->mPidFile->mLock)
+            ERT_ERROR_IF(
+                acquirePidFileWriteLock(self->mPidFile));
 
         self->mPidFile = destroyPidFile(self->mPidFile);
     }
 
+    /* The pidfile no longer names the child process, so withdraw the
+     * entry from the registry at the same time. */
+
+    releaseRegistrySlot(self->mRegistry);
+
     /* The child process has terminated, and the umbilical process should
      * have terminated, so detach the signal watchers. After this point
      * a signal received by the watchdog will likely cause it to terminate,
@@ -565,7 +790,7 @@ runSentry(struct Sentry       *self,
      * sure that the exit code only indicates success if the umbilical
      * process is also successful. */
 
-    if (RUNNING_ON_VALGRIND)
+    if (RUNNING_ON_VALGRIND && umbilicalPid.mPid)
     {
         int umbilicalStatus;
         ERT_ERROR_IF(
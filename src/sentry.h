@@ -31,7 +31,10 @@
 
 #include "childprocess.h"
 #include "umbilical.h"
+#include "umbilicalbeat.h"
+#include "sentrystatus.h"
 #include "pidserver.h"
+#include "registry.h"
 
 #include "pidfile_.h"
 
@@ -66,6 +69,19 @@ struct Sentry
 
     struct PidServer  mPidServer_;
     struct PidServer *mPidServer;
+    struct sockaddr_un mPidServerAddr;
+
+    struct Ert_File  mStdoutFile_;
+    struct Ert_File *mStdoutFile;
+
+    struct UmbilicalBeat  mUmbilicalBeat_;
+    struct UmbilicalBeat *mUmbilicalBeat;
+
+    struct SentryStatus  mStatus_;
+    struct SentryStatus *mStatus;
+
+    struct Registry  mRegistry_;
+    struct Registry *mRegistry;
 
     struct UmbilicalProcess  mUmbilicalProcess_;
     struct UmbilicalProcess *mUmbilicalProcess;
@@ -0,0 +1,351 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2016, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "sentrystatus.h"
+
+#include "ert/error.h"
+
+#include <fcntl.h>
+#include <inttypes.h>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/memfd.h>
+
+/* -------------------------------------------------------------------------- */
+/* Sentry Status
+ *
+ * The sentry publishes a summary of its state in a region of shared
+ * memory so that the pid server, which runs in the umbilical process,
+ * can answer status queries without involving the sentry. Each field
+ * is written and read atomically by itself, so a snapshot might mix
+ * values published at slightly different times, but never contains
+ * a torn value. Times are recorded against the monotonic clock, which
+ * is shared by all the processes on the host, and converted to ages
+ * when the snapshot is taken. */
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+mapSentryStatus_(struct SentryStatus *self, int aProt)
+{
+    int rc = -1;
+
+    void *region;
+    ERT_ERROR_IF(
+        (region = mmap(0, sizeof(*self->mRegion),
+                       aProt, MAP_SHARED,
+                       self->mFile->mFd, 0),
+         MAP_FAILED == region));
+    self->mRegion = region;
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+createSentryStatus(struct SentryStatus *self)
+{
+    int rc = -1;
+
+    self->mFile   = 0;
+    self->mRegion = 0;
+
+    ERT_ERROR_IF(
+        ert_createFile(
+            &self->mFile_,
+            syscall(SYS_memfd_create,
+                    "pidsentry-status", MFD_CLOEXEC | MFD_ALLOW_SEALING)));
+    self->mFile = &self->mFile_;
+
+    ERT_ERROR_IF(
+        ert_ftruncateFile(self->mFile, sizeof(*self->mRegion)));
+
+    /* Seal the size of the region before it is shared, so that no
+     * reader can be made to fault by truncating the file. */
+
+    ERT_ERROR_IF(
+        fcntl(self->mFile->mFd,
+              F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL));
+
+    ERT_ERROR_IF(
+        mapSentryStatus_(self, PROT_READ | PROT_WRITE));
+
+    __atomic_store_n(
+        &self->mRegion->mStart_ns,
+        ert_monotonicTime().monotonic.ns, __ATOMIC_RELEASE);
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (rc)
+            self = closeSentryStatus(self);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+adoptSentryStatus(struct SentryStatus *self, int aFd)
+{
+    int rc = -1;
+
+    self->mFile   = 0;
+    self->mRegion = 0;
+
+    ERT_ERROR_IF(
+        ert_closeFdOnExec(aFd, O_CLOEXEC));
+
+    ERT_ERROR_IF(
+        ert_createFile(&self->mFile_, aFd));
+    self->mFile = &self->mFile_;
+
+    /* The region is only written by the sentry, so map it read only,
+     * and only if its size cannot change underneath the mapping. */
+
+    int seals;
+    ERT_ERROR_IF(
+        (seals = fcntl(self->mFile->mFd, F_GET_SEALS),
+         -1 == seals));
+
+    ERT_ERROR_UNLESS(
+        F_SEAL_SHRINK & seals,
+        {
+            errno = EPERM;
+        });
+
+    ERT_ERROR_IF(
+        mapSentryStatus_(self, PROT_READ));
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (rc)
+            self = closeSentryStatus(self);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+struct SentryStatus *
+closeSentryStatus(struct SentryStatus *self)
+{
+    if (self)
+    {
+        if (self->mRegion)
+            ERT_ABORT_IF(
+                munmap(self->mRegion, sizeof(*self->mRegion)));
+
+        self->mFile = ert_closeFile(self->mFile);
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+void
+setSentryStatusState(struct SentryStatus    *self,
+                     enum SentryStatusState  aState,
+                     unsigned                aTermination)
+{
+    if (self)
+    {
+        __atomic_store_n(
+            &self->mRegion->mTermination, aTermination, __ATOMIC_RELEASE);
+        __atomic_store_n(
+            &self->mRegion->mState, aState, __ATOMIC_RELEASE);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+void
+setSentryStatusExitCode(struct SentryStatus *self, int aExitCode)
+{
+    /* The exit code is published before the drained flag, so that a
+     * reader that sees the flag also sees the exit code. */
+
+    if (self)
+    {
+        __atomic_store_n(
+            &self->mRegion->mExitCode, aExitCode, __ATOMIC_RELEASE);
+        __atomic_store_n(
+            &self->mRegion->mDrained, 1, __ATOMIC_RELEASE);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+void
+markSentryStatusTether(struct SentryStatus *self, uint64_t aBytes)
+{
+    /* This is called from the tether thread, which is the only writer
+     * of the tether fields. */
+
+    if (self)
+    {
+        __atomic_store_n(
+            &self->mRegion->mTetherBytes, aBytes, __ATOMIC_RELEASE);
+        __atomic_store_n(
+            &self->mRegion->mTether_ns,
+            ert_monotonicTime().monotonic.ns, __ATOMIC_RELEASE);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+void
+markSentryStatusRtt(struct SentryStatus *self,
+                    struct Ert_Duration  aMean,
+                    struct Ert_Duration  aMax)
+{
+    if (self)
+    {
+        __atomic_store_n(
+            &self->mRegion->mRttMean_ns, aMean.duration.ns, __ATOMIC_RELEASE);
+        __atomic_store_n(
+            &self->mRegion->mRttMax_ns, aMax.duration.ns, __ATOMIC_RELEASE);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+void
+snapshotSentryStatus(const struct SentryStatus   *self,
+                     struct Ert_Pid               aChildPid,
+                     struct SentryStatusSnapshot *aSnapshot)
+{
+    const struct SentryStatusRegion_ *region = self->mRegion;
+
+    uint64_t now_ns = ert_monotonicTime().monotonic.ns;
+
+    uint64_t start_ns  = __atomic_load_n(&region->mStart_ns, __ATOMIC_ACQUIRE);
+    uint64_t tether_ns = __atomic_load_n(&region->mTether_ns, __ATOMIC_ACQUIRE);
+
+    *aSnapshot = (struct SentryStatusSnapshot)
+    {
+        .mVersion     = SENTRY_STATUS_VERSION,
+        .mSize        = sizeof(*aSnapshot),
+        .mChildPid    = aChildPid.mPid,
+        .mState       = __atomic_load_n(&region->mState, __ATOMIC_ACQUIRE),
+        .mTermination =
+            __atomic_load_n(&region->mTermination, __ATOMIC_ACQUIRE),
+        .mUptime_ms   =
+            now_ns > start_ns ? (now_ns - start_ns) / (1000 * 1000) : 0,
+        .mTetherIdle_ms =
+            ! tether_ns
+            ? UINT64_MAX
+            : now_ns > tether_ns ? (now_ns - tether_ns) / (1000 * 1000) : 0,
+        .mTetherBytes =
+            __atomic_load_n(&region->mTetherBytes, __ATOMIC_ACQUIRE),
+        .mRttMean_us  =
+            __atomic_load_n(&region->mRttMean_ns, __ATOMIC_ACQUIRE) / 1000,
+        .mRttMax_us   =
+            __atomic_load_n(&region->mRttMax_ns, __ATOMIC_ACQUIRE) / 1000,
+        .mExitCode    =
+            __atomic_load_n(&region->mDrained, __ATOMIC_ACQUIRE)
+            ? __atomic_load_n(&region->mExitCode, __ATOMIC_ACQUIRE)
+            : -1,
+    };
+}
+
+/* -------------------------------------------------------------------------- */
+const char *
+ownSentryStatusStateName(unsigned aState)
+{
+    static const char *stateNames[] =
+    {
+        [SentryStatusStarting]    = "starting",
+        [SentryStatusRunning]     = "running",
+        [SentryStatusTerminating] = "terminating",
+        [SentryStatusExited]      = "exited",
+    };
+
+    return
+        ERT_NUMBEROF(stateNames) > aState ? stateNames[aState] : "unknown";
+}
+
+/* -------------------------------------------------------------------------- */
+int
+printSentryStatusSnapshot(const struct SentryStatusSnapshot *self,
+                          FILE                              *aFile)
+{
+    return fprintf(
+        aFile,
+        "pid %" PRId32 " state %s termination %" PRIu32
+        " uptime %" PRIu64 "ms"
+        " tether idle %" PRId64 "ms bytes %" PRIu64
+        " rtt mean %" PRIu64 "us max %" PRIu64 "us"
+        " exit %" PRId32 "\n",
+        self->mChildPid,
+        ownSentryStatusStateName(self->mState),
+        self->mTermination,
+        self->mUptime_ms,
+        UINT64_MAX == self->mTetherIdle_ms
+        ? -1 : (int64_t) self->mTetherIdle_ms,
+        self->mTetherBytes,
+        self->mRttMean_us,
+        self->mRttMax_us,
+        self->mExitCode);
+}
+
+/* -------------------------------------------------------------------------- */
+int
+printSentryStatusSnapshotJson(const struct SentryStatusSnapshot *self,
+                              FILE                              *aFile)
+{
+    return fprintf(
+        aFile,
+        "{\"pid\":%" PRId32 ",\"state\":\"%s\",\"termination\":%" PRIu32 ","
+        "\"uptime_ms\":%" PRIu64 ","
+        "\"tether_idle_ms\":%" PRId64 ",\"tether_bytes\":%" PRIu64 ","
+        "\"rtt_mean_us\":%" PRIu64 ",\"rtt_max_us\":%" PRIu64 ","
+        "\"exit_code\":%" PRId32 "}\n",
+        self->mChildPid,
+        ownSentryStatusStateName(self->mState),
+        self->mTermination,
+        self->mUptime_ms,
+        UINT64_MAX == self->mTetherIdle_ms
+        ? -1 : (int64_t) self->mTetherIdle_ms,
+        self->mTetherBytes,
+        self->mRttMean_us,
+        self->mRttMax_us,
+        self->mExitCode);
+}
+
+/* -------------------------------------------------------------------------- */
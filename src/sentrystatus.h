@@ -0,0 +1,169 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2016, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef SENTRYSTATUS_H
+#define SENTRYSTATUS_H
+
+#include "ert/compiler.h"
+#include "ert/file.h"
+#include "ert/pid.h"
+#include "ert/timekeeping.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+ERT_BEGIN_C_SCOPE;
+
+/* -------------------------------------------------------------------------- */
+#define SENTRY_STATUS_VERSION 1
+
+enum SentryStatusState
+{
+    SentryStatusStarting,
+    SentryStatusRunning,
+    SentryStatusTerminating,
+    SentryStatusExited,
+};
+
+struct SentryStatusRegion_
+{
+    uint64_t mStart_ns;         /* Monotonic time the sentry started */
+    uint64_t mTether_ns;        /* Monotonic time of last tether activity */
+    uint64_t mTetherBytes;      /* Bytes copied from the tether */
+    uint64_t mRttMean_ns;       /* Moving average umbilical round trip */
+    uint64_t mRttMax_ns;
+    uint32_t mState;            /* enum SentryStatusState */
+    uint32_t mTermination;      /* Signal plan steps taken */
+    uint32_t mDrained;          /* Child exited and output drained */
+    int32_t  mExitCode;         /* Valid once drained */
+};
+
+/* The snapshot is sent in reply to SENTRY_STATUS_QUERY_REQUEST written
+ * by a client holding a reference on the pid server socket. Fields are
+ * only ever added to the end of the snapshot, so clients must use mSize
+ * rather than the size of this structure.
+ *
+ * A client holding a reference can also write SENTRY_STATUS_WAIT_REQUEST
+ * on that connection, and the snapshot is sent there once the child
+ * process has exited and its output has been drained. Other clients
+ * still holding a reference when the lease expires after the exit are
+ * sent SENTRY_STATUS_LEASE_EXPIRED before the connection is closed.
+ *
+ * A client holding a reference can write SENTRY_STATUS_ATTACH_REQUEST
+ * to receive the reading end of a pipe carrying a copy of the output
+ * of the child process. The reply is a single byte, with the pipe
+ * attached if the request could be satisfied.
+ *
+ * A client holding a reference can write SENTRY_STATUS_RECONFIGURE_REQUEST
+ * followed by a struct SentryConfig to change the configuration of the
+ * sentry. The reply is SENTRY_STATUS_RECONFIGURE_REQUEST once the
+ * configuration is passed to the sentry, or SENTRY_STATUS_REFUSED. The
+ * configuration is passed to the sentry as SENTRY_CONFIG_MESSAGE on the
+ * umbilical connection, carrying a pipe from which to read it. */
+
+#define SENTRY_STATUS_QUERY_REQUEST       'q'
+#define SENTRY_STATUS_WAIT_REQUEST        'w'
+#define SENTRY_STATUS_LEASE_EXPIRED       'x'
+#define SENTRY_STATUS_ATTACH_REQUEST      'a'
+#define SENTRY_STATUS_RECONFIGURE_REQUEST 'r'
+#define SENTRY_STATUS_REFUSED             '-'
+
+#define SENTRY_CONFIG_MESSAGE '~'
+
+struct SentryStatusSnapshot
+{
+    uint32_t mVersion;
+    uint32_t mSize;
+    int32_t  mChildPid;
+    uint32_t mState;            /* enum SentryStatusState */
+    uint32_t mTermination;      /* Signal plan steps taken */
+    uint32_t mReserved;
+    uint64_t mUptime_ms;        /* Time since the sentry started */
+    uint64_t mTetherIdle_ms;    /* Time since tether activity, or ~0 */
+    uint64_t mTetherBytes;
+    uint64_t mRttMean_us;
+    uint64_t mRttMax_us;
+    int32_t  mExitCode;         /* Once drained, otherwise -1 */
+    uint32_t mReserved2;
+};
+
+struct SentryStatus
+{
+    struct Ert_File  mFile_;
+    struct Ert_File *mFile;
+
+    struct SentryStatusRegion_ *mRegion;
+};
+
+/* -------------------------------------------------------------------------- */
+ERT_CHECKED int
+createSentryStatus(struct SentryStatus *self);
+
+ERT_CHECKED int
+adoptSentryStatus(struct SentryStatus *self, int aFd);
+
+struct SentryStatus *
+closeSentryStatus(struct SentryStatus *self);
+
+void
+setSentryStatusState(struct SentryStatus    *self,
+                     enum SentryStatusState  aState,
+                     unsigned                aTermination);
+
+void
+setSentryStatusExitCode(struct SentryStatus *self, int aExitCode);
+
+void
+markSentryStatusTether(struct SentryStatus *self, uint64_t aBytes);
+
+void
+markSentryStatusRtt(struct SentryStatus *self,
+                    struct Ert_Duration  aMean,
+                    struct Ert_Duration  aMax);
+
+void
+snapshotSentryStatus(const struct SentryStatus   *self,
+                     struct Ert_Pid               aChildPid,
+                     struct SentryStatusSnapshot *aSnapshot);
+
+const char *
+ownSentryStatusStateName(unsigned aState);
+
+int
+printSentryStatusSnapshot(const struct SentryStatusSnapshot *self,
+                          FILE                              *aFile);
+
+int
+printSentryStatusSnapshotJson(const struct SentryStatusSnapshot *self,
+                              FILE                              *aFile);
+
+/* -------------------------------------------------------------------------- */
+
+ERT_END_C_SCOPE;
+
+#endif /* SENTRYSTATUS_H */
@@ -0,0 +1,244 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2016, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "slab.h"
+
+#include "ert/error.h"
+
+#include <stdlib.h>
+
+/* -------------------------------------------------------------------------- */
+/* Slab Allocator
+ *
+ * Objects of a single size are carved from larger chunks, and returned
+ * to a free list threaded through the objects themselves, so that
+ * creating and destroying many small records costs one allocation for
+ * each chunk rather than one for each record. Chunks are only released
+ * when the slab is closed, so the footprint follows the largest number
+ * of objects that were in use at the same time.
+ *
+ * A slab that is filled at startup holds a fixed number of objects,
+ * and never allocates again. Once all its objects are in use, further
+ * allocations fail with ENOBUFS, leaving the caller to decide how to
+ * shed the load. */
+
+union SlabAlign_
+{
+    long double mLongDouble;
+    long long   mLongLong;
+    void       *mPointer;
+};
+
+struct SlabChunk_
+{
+    struct SlabChunk_ *mNext;
+    union SlabAlign_   mObjects[];
+};
+
+struct SlabObject_
+{
+    struct SlabObject_ *mNext;
+};
+
+/* -------------------------------------------------------------------------- */
+void
+createSlab(struct Slab *self,
+           const char  *aName, size_t aSize, unsigned aPerChunk)
+{
+    size_t align = sizeof(union SlabAlign_);
+
+    if (aSize < sizeof(struct SlabObject_))
+        aSize = sizeof(struct SlabObject_);
+
+    self->mName     = aName;
+    self->mSize     = (aSize + align - 1) / align * align;
+    self->mPerChunk = aPerChunk ? aPerChunk : 1;
+    self->mChunks   = 0;
+    self->mUsed     = 0;
+    self->mLimit    = 0;
+    self->mFree     = 0;
+    self->mChunk    = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+struct Slab *
+closeSlab(struct Slab *self)
+{
+    if (self)
+    {
+        ert_ensure( ! self->mUsed);
+
+        while (self->mChunk)
+        {
+            struct SlabChunk_ *chunk = self->mChunk;
+
+            self->mChunk = chunk->mNext;
+
+            free(chunk);
+        }
+
+        self->mFree   = 0;
+        self->mChunks = 0;
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+growSlab_(struct Slab *self, unsigned aObjects)
+{
+    int rc = -1;
+
+    struct SlabChunk_ *chunk;
+
+    ERT_ERROR_UNLESS(
+        (chunk = malloc(sizeof(*chunk) + self->mSize * aObjects)));
+
+    chunk->mNext = self->mChunk;
+    self->mChunk = chunk;
+
+    ++self->mChunks;
+
+    char *objects = (char *) chunk->mObjects;
+
+    for (unsigned ix = aObjects; ix--; )
+    {
+        struct SlabObject_ *free_ =
+            (struct SlabObject_ *) (objects + ix * self->mSize);
+
+        free_->mNext = self->mFree;
+        self->mFree  = free_;
+    }
+
+    ert_debug(
+        1,
+        "%s slab chunk %u objects %u",
+        self->mName, self->mChunks, aObjects);
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+fillSlab(struct Slab *self, unsigned aObjects)
+{
+    int rc = -1;
+
+    /* Carve all the objects from a single chunk, and prevent the slab
+     * from growing any further. */
+
+    ERT_ERROR_IF(
+        self->mChunk || ! aObjects,
+        {
+            errno = EINVAL;
+        });
+
+    ERT_ERROR_IF(
+        growSlab_(self, aObjects));
+
+    self->mPerChunk = aObjects;
+    self->mLimit    = aObjects;
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+void *
+allocSlab(struct Slab *self)
+{
+    int rc = -1;
+
+    struct SlabObject_ *object = 0;
+
+    if ( ! self->mFree)
+    {
+        ERT_ERROR_IF(
+            self->mLimit,
+            {
+                errno = ENOBUFS;
+            });
+
+        ERT_ERROR_IF(
+            growSlab_(self, self->mPerChunk));
+    }
+
+    object      = self->mFree;
+    self->mFree = object->mNext;
+
+    ++self->mUsed;
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc ? 0 : object;
+}
+
+/* -------------------------------------------------------------------------- */
+void
+freeSlab(struct Slab *self, void *aObject)
+{
+    if (aObject)
+    {
+        struct SlabObject_ *object = aObject;
+
+        ert_ensure(self->mUsed);
+
+        object->mNext = self->mFree;
+        self->mFree   = object;
+
+        --self->mUsed;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+size_t
+ownSlabFootprint(const struct Slab *self)
+{
+    return
+        self->mChunks *
+        (sizeof(struct SlabChunk_) + self->mSize * self->mPerChunk);
+}
+
+/* -------------------------------------------------------------------------- */
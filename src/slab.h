@@ -0,0 +1,77 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2016, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef SLAB_H
+#define SLAB_H
+
+#include "ert/compiler.h"
+
+#include <stddef.h>
+
+ERT_BEGIN_C_SCOPE;
+
+struct SlabChunk_;
+
+/* -------------------------------------------------------------------------- */
+struct Slab
+{
+    const char        *mName;
+    size_t             mSize;       /* Size of each object */
+    unsigned           mPerChunk;   /* Objects carved from each chunk */
+    unsigned           mChunks;     /* Chunks allocated */
+    unsigned           mUsed;       /* Objects in use */
+    unsigned           mLimit;      /* Objects available, or zero if unbounded */
+    void              *mFree;       /* Objects available for reuse */
+    struct SlabChunk_ *mChunk;
+};
+
+/* -------------------------------------------------------------------------- */
+void
+createSlab(struct Slab *self,
+           const char  *aName, size_t aSize, unsigned aPerChunk);
+
+struct Slab *
+closeSlab(struct Slab *self);
+
+ERT_CHECKED int
+fillSlab(struct Slab *self, unsigned aObjects);
+
+ERT_CHECKED void *
+allocSlab(struct Slab *self);
+
+void
+freeSlab(struct Slab *self, void *aObject);
+
+size_t
+ownSlabFootprint(const struct Slab *self);
+
+/* -------------------------------------------------------------------------- */
+
+ERT_END_C_SCOPE;
+
+#endif /* SLAB_H */
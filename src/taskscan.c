@@ -0,0 +1,857 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2016, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "taskscan.h"
+#include "pidsignature_.h"
+
+#include "ert/parse.h"
+#include "ert/file.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <inttypes.h>
+
+#include <sys/syscall.h>
+
+/* -------------------------------------------------------------------------- */
+/* Thread Scanner
+ *
+ * Periodically sample the scheduler state of each thread in the process
+ * group of the child process. A thread stuck in uninterruptible sleep
+ * (eg on a dead NFS mount) can stall a service even though other threads
+ * continue to produce output on the tether.
+ *
+ * The members of the process group are found by walking the descendants
+ * of the child process, and the scan is made incremental by holding open
+ * the task directory of each process, and the stat and children files
+ * of each thread, so that each sample only requires a pread(2) of files
+ * that are already open.
+ *
+ * The signature of each process is recorded when the process is found,
+ * so that a signal is never delivered to an unrelated process that has
+ * reused the pid of a process that has since exited. */
+
+/* -------------------------------------------------------------------------- */
+static struct TaskScanThread_ *
+closeTaskScanThread_(struct TaskScanThread_ *self)
+{
+    if (self)
+    {
+        if (-1 != self->mChildrenFd)
+            ERT_ABORT_IF(
+                ert_closeFd(self->mChildrenFd));
+
+        if (-1 != self->mStatFd)
+            ERT_ABORT_IF(
+                ert_closeFd(self->mStatFd));
+
+        free(self);
+    }
+
+    return 0;
+}
+
+static ERT_CHECKED struct TaskScanThread_ *
+createTaskScanThread_(DIR *aTaskDir, struct Ert_Pid aTid)
+{
+    int rc = -1;
+
+    struct TaskScanThread_ *self = 0;
+
+    ERT_ERROR_UNLESS(
+        (self = malloc(sizeof(*self))));
+
+    self->mTid        = aTid;
+    self->mStatFd     = -1;
+    self->mChildrenFd = -1;
+    self->mGeneration = 0;
+    self->mState      = 0;
+    self->mSince      = (struct Ert_EventClockTime) ERT_EVENTCLOCKTIME_INIT;
+    self->mReported   = false;
+
+    char fileName[sizeof(int) * CHAR_BIT + sizeof("/children")];
+
+    ERT_ERROR_IF(
+        0 > sprintf(fileName, "%" PRId_Ert_Pid "/stat", FMTd_Ert_Pid(aTid)));
+
+    ERT_ERROR_IF(
+        (self->mStatFd = openat(
+            dirfd(aTaskDir), fileName, O_RDONLY | O_CLOEXEC),
+         -1 == self->mStatFd));
+
+    /* The children file is only available if the kernel is configured
+     * with CONFIG_PROC_CHILDREN. Without it, only the threads of the
+     * child process itself can be scanned. */
+
+    ERT_ERROR_IF(
+        0 > sprintf(fileName,
+                    "%" PRId_Ert_Pid "/children", FMTd_Ert_Pid(aTid)));
+
+    ERT_ERROR_IF(
+        (self->mChildrenFd = openat(
+            dirfd(aTaskDir), fileName, O_RDONLY | O_CLOEXEC),
+         -1 == self->mChildrenFd && ENOENT != errno));
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (rc)
+            self = closeTaskScanThread_(self);
+    });
+
+    return self;
+}
+
+/* -------------------------------------------------------------------------- */
+static void
+releaseTaskScanProcessThreads_(struct TaskScanProcess_ *self)
+{
+    while ( ! TAILQ_EMPTY(&self->mThreads))
+    {
+        struct TaskScanThread_ *thread = TAILQ_FIRST(&self->mThreads);
+
+        TAILQ_REMOVE(&self->mThreads, thread, mList_);
+
+        thread = closeTaskScanThread_(thread);
+    }
+}
+
+static struct TaskScanProcess_ *
+closeTaskScanProcess_(struct TaskScanProcess_ *self)
+{
+    if (self)
+    {
+        releaseTaskScanProcessThreads_(self);
+
+        if (self->mTaskDir)
+            ERT_ABORT_IF(
+                closedir(self->mTaskDir));
+
+        self->mSignature = destroyPidSignature(self->mSignature);
+
+        free(self);
+    }
+
+    return 0;
+}
+
+static ERT_CHECKED struct TaskScanProcess_ *
+createTaskScanProcess_(struct TaskScan *aScan, struct Ert_Pid aPid)
+{
+    int rc = -1;
+    int fd = -1;
+
+    struct TaskScanProcess_ *self = 0;
+
+    ERT_ERROR_UNLESS(
+        (self = malloc(sizeof(*self))));
+
+    self->mPid        = aPid;
+    self->mSignature  = 0;
+    self->mTaskDir    = 0;
+    self->mGeneration = aScan->mGeneration;
+    self->mDetached   = false;
+
+    TAILQ_INIT(&self->mThreads);
+
+    char dirName[sizeof(int) * CHAR_BIT + sizeof("/task")];
+
+    ERT_ERROR_IF(
+        0 > sprintf(dirName, "%" PRId_Ert_Pid "/task", FMTd_Ert_Pid(aPid)));
+
+    ERT_ERROR_IF(
+        (fd = openat(aScan->mProcFd,
+                     dirName, O_RDONLY | O_DIRECTORY | O_CLOEXEC),
+         -1 == fd));
+
+    ERT_ERROR_UNLESS(
+        (self->mTaskDir = fdopendir(fd)));
+    fd = -1;
+
+    /* Record the signature once the task directory is open, so that
+     * the signature describes the same process as the directory. */
+
+    ERT_ERROR_UNLESS(
+        (self->mSignature = createPidSignature(aPid, 0)));
+
+    ert_debug(
+        1,
+        "scanning threads of pid %" PRId_Ert_Pid,
+        FMTd_Ert_Pid(aPid));
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (-1 != fd)
+            ERT_ABORT_IF(
+                ert_closeFd(fd));
+
+        if (rc)
+            self = closeTaskScanProcess_(self);
+    });
+
+    return self;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+createTaskScan(struct TaskScan     *self,
+               struct Ert_Pid       aPid,
+               struct Ert_Pgid      aPgid,
+               const char          *aStates,
+               struct Ert_Duration  aThreshold)
+{
+    int rc = -1;
+
+    self->mPid        = aPid;
+    self->mPgid       = aPgid;
+    self->mProcFd     = -1;
+    self->mGeneration = 0;
+    self->mStates     = aStates;
+    self->mThreshold  = aThreshold;
+
+    TAILQ_INIT(&self->mProcesses);
+
+    ERT_ERROR_IF(
+        (self->mProcFd = ert_openFd(
+            "/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC, Ert_Mode(0)),
+         -1 == self->mProcFd));
+
+    struct TaskScanProcess_ *process;
+    ERT_ERROR_UNLESS(
+        (process = createTaskScanProcess_(self, aPid)));
+
+    TAILQ_INSERT_TAIL(&self->mProcesses, process, mList_);
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (rc)
+            self = closeTaskScan(self);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+struct TaskScan *
+closeTaskScan(struct TaskScan *self)
+{
+    if (self)
+    {
+        while ( ! TAILQ_EMPTY(&self->mProcesses))
+        {
+            struct TaskScanProcess_ *process = TAILQ_FIRST(&self->mProcesses);
+
+            TAILQ_REMOVE(&self->mProcesses, process, mList_);
+
+            process = closeTaskScanProcess_(process);
+        }
+
+        if (-1 != self->mProcFd)
+            ERT_ABORT_IF(
+                ert_closeFd(self->mProcFd));
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+printTaskScan(const struct TaskScan *self, FILE *aFile)
+{
+    return fprintf(aFile,
+                   "<task scan %p pid %" PRId_Ert_Pid " pgid %" PRId_Ert_Pgid ">",
+                   self,
+                   FMTd_Ert_Pid(self->mPid),
+                   FMTd_Ert_Pgid(self->mPgid));
+}
+
+/* -------------------------------------------------------------------------- */
+static struct TaskScanProcess_ *
+findTaskScanProcess_(struct TaskScan *self, struct Ert_Pid aPid)
+{
+    struct TaskScanProcess_ *process;
+
+    TAILQ_FOREACH(process, &self->mProcesses, mList_)
+    {
+        if (process->mPid.mPid == aPid.mPid)
+            break;
+    }
+
+    return process;
+}
+
+static struct TaskScanThread_ *
+findTaskScanThread_(struct TaskScanProcess_ *self, struct Ert_Pid aTid)
+{
+    struct TaskScanThread_ *thread;
+
+    TAILQ_FOREACH(thread, &self->mThreads, mList_)
+    {
+        if (thread->mTid.mPid == aTid.mPid)
+            break;
+    }
+
+    return thread;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+scanTaskScanChildren_(struct TaskScan        *self,
+                      struct TaskScanThread_ *aThread)
+{
+    int rc = -1;
+
+    /* Each pid in the children file is listed as a decimal number
+     * followed by a space. Read the file in chunks, carrying any
+     * partial number over to the next chunk. */
+
+    char  buf[256];
+    off_t offset  = 0;
+    size_t carry  = 0;
+
+    while (1)
+    {
+        ssize_t rdlen;
+        ERT_ERROR_IF(
+            (rdlen = pread(aThread->mChildrenFd,
+                           buf + carry, sizeof(buf) - carry, offset),
+             -1 == rdlen && ESRCH != errno && ENOENT != errno));
+
+        if (0 >= rdlen)
+            break;
+
+        offset += rdlen;
+
+        char *bufptr = buf;
+        char *bufend = buf + carry + rdlen;
+
+        while (1)
+        {
+            char *sep = memchr(bufptr, ' ', bufend - bufptr);
+            if ( ! sep)
+                break;
+
+            *sep = 0;
+
+            struct Ert_Pid childPid;
+            ERT_ERROR_IF(
+                ert_parsePid(bufptr, &childPid));
+
+            bufptr = sep + 1;
+
+            struct TaskScanProcess_ *process =
+                findTaskScanProcess_(self, childPid);
+
+            if ( ! process)
+            {
+                /* Tolerate the child exiting before its task directory
+                 * can be opened. Any other failure is unexpected. */
+
+                ERT_ERROR_UNLESS(
+                    (process = createTaskScanProcess_(self, childPid)) ||
+                    ENOENT == errno);
+
+                if ( ! process)
+                    continue;
+
+                TAILQ_INSERT_TAIL(&self->mProcesses, process, mList_);
+            }
+
+            process->mGeneration = self->mGeneration;
+        }
+
+        carry = bufend - bufptr;
+
+        ERT_ERROR_IF(
+            carry == sizeof(buf),
+            {
+                errno = ERANGE;
+            });
+
+        memmove(buf, bufptr, carry);
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static void
+reportTaskScanThread_(struct TaskScan                 *self,
+                      struct TaskScanProcess_         *aProcess,
+                      struct TaskScanThread_          *aThread,
+                      const struct Ert_EventClockTime *aScanTime)
+{
+    /* Try to show where the thread is waiting in the kernel since that
+     * is the most useful clue when diagnosing a stuck thread. Any
+     * failure here is of no consequence. */
+
+    char wchan[64] = "";
+
+    char fileName[sizeof(int) * CHAR_BIT + sizeof("/wchan")];
+
+    if (0 < sprintf(fileName,
+                    "%" PRId_Ert_Pid "/wchan", FMTd_Ert_Pid(aThread->mTid)))
+    {
+        int fd = openat(
+            dirfd(aProcess->mTaskDir), fileName, O_RDONLY | O_CLOEXEC);
+
+        if (-1 != fd)
+        {
+            ssize_t rdlen = read(fd, wchan, sizeof(wchan)-1);
+
+            wchan[0 < rdlen ? rdlen : 0] = 0;
+
+            if ( ! strcmp(wchan, "0"))
+                wchan[0] = 0;
+
+            ERT_ABORT_IF(
+                ert_closeFd(fd));
+        }
+    }
+
+    uint64_t stalled_s =
+        (aScanTime->eventclock.ns - aThread->mSince.eventclock.ns) /
+        ERT_NSECS(Ert_Seconds(1)).ns;
+
+    ert_warn(
+        0,
+        "Thread %" PRId_Ert_Pid " of pid %" PRId_Ert_Pid
+        " in state %c for %" PRIu64 "s%s%s",
+        FMTd_Ert_Pid(aThread->mTid),
+        FMTd_Ert_Pid(aProcess->mPid),
+        aThread->mState,
+        stalled_s,
+        wchan[0] ? " waiting in " : "",
+        wchan);
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+sampleTaskScanThread_(struct TaskScan                 *self,
+                      struct TaskScanProcess_         *aProcess,
+                      struct TaskScanThread_          *aThread,
+                      const struct Ert_EventClockTime *aScanTime)
+{
+    int rc = -1;
+
+    int stalled = 0;
+
+    /* Use pread(2) so that the stat file descriptor can be reused
+     * across scans. Once the thread has exited, the read will
+     * fail with ESRCH, and the thread is discarded. */
+
+    char buf[512];
+
+    ssize_t rdlen;
+    ERT_ERROR_IF(
+        (rdlen = pread(aThread->mStatFd, buf, sizeof(buf)-1, 0),
+         -1 == rdlen && ESRCH != errno && ENOENT != errno));
+
+    if (0 >= rdlen)
+    {
+        aThread->mGeneration = 0;
+    }
+    else
+    {
+        buf[rdlen] = 0;
+
+        /* The command name is enclosed in parentheses but can itself
+         * contain parentheses, so find the last closing parenthesis
+         * before parsing the state and process group. */
+
+        char *word;
+        ERT_ERROR_UNLESS(
+            (word = memrchr(buf, ')', rdlen)),
+            {
+                errno = ERANGE;
+            });
+
+        char state;
+        int  pgrp;
+        ERT_ERROR_UNLESS(
+            2 == sscanf(word+1, " %c %*d %d", &state, &pgrp),
+            {
+                errno = ERANGE;
+            });
+
+        if (pgrp != self->mPgid.mPgid)
+        {
+            ert_debug(
+                1,
+                "pid %" PRId_Ert_Pid " left pgid %" PRId_Ert_Pgid,
+                FMTd_Ert_Pid(aProcess->mPid),
+                FMTd_Ert_Pgid(self->mPgid));
+
+            aProcess->mDetached = true;
+        }
+        else
+        {
+            aThread->mState = state;
+
+            if ( ! strchr(self->mStates, state))
+            {
+                aThread->mSince    = (struct Ert_EventClockTime)
+                    ERT_EVENTCLOCKTIME_INIT;
+                aThread->mReported = false;
+            }
+            else if ( ! aThread->mSince.eventclock.ns)
+            {
+                aThread->mSince = *aScanTime;
+            }
+            else if ( ! aThread->mReported &&
+                      aScanTime->eventclock.ns >=
+                          aThread->mSince.eventclock.ns +
+                          self->mThreshold.duration.ns)
+            {
+                reportTaskScanThread_(self, aProcess, aThread, aScanTime);
+
+                aThread->mReported = true;
+                ++stalled;
+            }
+
+            if (-1 != aThread->mChildrenFd)
+                ERT_ERROR_IF(
+                    scanTaskScanChildren_(self, aThread));
+        }
+    }
+
+    rc = stalled;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+scanTaskScanProcess_(struct TaskScan                 *self,
+                     struct TaskScanProcess_         *aProcess,
+                     const struct Ert_EventClockTime *aScanTime)
+{
+    int rc = -1;
+
+    int stalled = 0;
+
+    /* Rewinding the task directory is sufficient to obtain a fresh
+     * list of the threads in the process. Threads that are no
+     * longer listed are discarded below. */
+
+    rewinddir(aProcess->mTaskDir);
+
+    while (1)
+    {
+        struct dirent *entry;
+
+        errno = 0;
+        entry = readdir(aProcess->mTaskDir);
+
+        if ( ! entry)
+        {
+            ERT_ERROR_IF(
+                errno && ESRCH != errno && ENOENT != errno);
+            break;
+        }
+
+        if ('.' == entry->d_name[0])
+            continue;
+
+        struct Ert_Pid tid;
+        ERT_ERROR_IF(
+            ert_parsePid(entry->d_name, &tid));
+
+        struct TaskScanThread_ *thread = findTaskScanThread_(aProcess, tid);
+
+        if ( ! thread)
+        {
+            ERT_ERROR_UNLESS(
+                (thread = createTaskScanThread_(aProcess->mTaskDir, tid)) ||
+                ENOENT == errno);
+
+            if ( ! thread)
+                continue;
+
+            TAILQ_INSERT_TAIL(&aProcess->mThreads, thread, mList_);
+        }
+
+        thread->mGeneration = self->mGeneration;
+    }
+
+    struct TaskScanThread_ *thread = TAILQ_FIRST(&aProcess->mThreads);
+
+    while (thread && ! aProcess->mDetached)
+    {
+        struct TaskScanThread_ *next = TAILQ_NEXT(thread, mList_);
+
+        if (thread->mGeneration == self->mGeneration)
+        {
+            int sampled;
+            ERT_ERROR_IF(
+                (sampled = sampleTaskScanThread_(
+                    self, aProcess, thread, aScanTime),
+                 -1 == sampled));
+
+            stalled += sampled;
+        }
+
+        if (thread->mGeneration != self->mGeneration)
+        {
+            TAILQ_REMOVE(&aProcess->mThreads, thread, mList_);
+
+            thread = closeTaskScanThread_(thread);
+        }
+
+        thread = next;
+    }
+
+    /* A process that has left the process group is retained without
+     * any open files so that it is not rediscovered on every scan. */
+
+    if (aProcess->mDetached)
+    {
+        releaseTaskScanProcessThreads_(aProcess);
+
+        ERT_ERROR_IF(
+            closedir(aProcess->mTaskDir));
+        aProcess->mTaskDir = 0;
+    }
+
+    rc = stalled;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+runTaskScan(struct TaskScan *self, const struct Ert_EventClockTime *aScanTime)
+{
+    int rc = -1;
+
+    int stalled = 0;
+
+    ++self->mGeneration;
+
+    /* Processes discovered during the scan are appended to the list,
+     * so the descendants of the child process are visited in the same
+     * scan that first discovers them. */
+
+    struct TaskScanProcess_ *process;
+
+    TAILQ_FOREACH(process, &self->mProcesses, mList_)
+    {
+        if (process->mDetached)
+            continue;
+
+        int scanned;
+        ERT_ERROR_IF(
+            (scanned = scanTaskScanProcess_(self, process, aScanTime),
+             -1 == scanned));
+
+        stalled += scanned;
+    }
+
+    /* Discard processes that have exited, and processes outside the
+     * process group that are no longer listed by their parent. Orphaned
+     * members of the process group are retained until they exit. */
+
+    process = TAILQ_FIRST(&self->mProcesses);
+
+    while (process)
+    {
+        struct TaskScanProcess_ *next = TAILQ_NEXT(process, mList_);
+
+        if (process->mDetached
+            ? process->mGeneration != self->mGeneration
+            : TAILQ_EMPTY(&process->mThreads))
+        {
+            ert_debug(
+                1,
+                "stop scanning pid %" PRId_Ert_Pid,
+                FMTd_Ert_Pid(process->mPid));
+
+            TAILQ_REMOVE(&self->mProcesses, process, mList_);
+
+            process = closeTaskScanProcess_(process);
+        }
+
+        process = next;
+    }
+
+    rc = stalled;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        ert_finally_warn_if(-1 == rc, self, printTaskScan);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+signalTaskScanProcess_(struct TaskScanProcess_ *self, int aSigNum)
+{
+    int rc = -1;
+
+    int                  pidFd     = -1;
+    struct PidSignature *signature = 0;
+
+    int signalled = 0;
+
+    /* Open a pidfd before checking the signature of the process, so
+     * that the pid cannot be reused between the check and the signal.
+     * Without pidfds, only a short window remains between the two. */
+
+#ifdef SYS_pidfd_open
+    pidFd = syscall(SYS_pidfd_open, self->mPid.mPid, 0);
+#else
+    pidFd = -1;
+    errno = ENOSYS;
+#endif
+
+    ERT_ERROR_IF(
+        -1 == pidFd && ESRCH != errno && ENOSYS != errno);
+
+    if (-1 != pidFd || ENOSYS == errno)
+    {
+        ERT_ERROR_IF(
+            (signature = createPidSignature(self->mPid, 0),
+             ! signature && ENOENT != errno));
+
+        if ( ! signature ||
+             strcmp(signature->mSignature, self->mSignature->mSignature))
+        {
+            ert_debug(
+                1,
+                "pid %" PRId_Ert_Pid " no longer scanned process",
+                FMTd_Ert_Pid(self->mPid));
+        }
+        else
+        {
+            int err = -1;
+
+            errno = ENOSYS;
+
+#ifdef SYS_pidfd_send_signal
+            if (-1 != pidFd)
+                err = syscall(SYS_pidfd_send_signal, pidFd, aSigNum, 0, 0);
+#endif
+
+            if (-1 == err && ENOSYS == errno)
+                err = kill(self->mPid.mPid, aSigNum);
+
+            ERT_ERROR_IF(
+                -1 == err && ESRCH != errno);
+
+            signalled = ! err;
+        }
+    }
+
+    rc = signalled;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (-1 != pidFd)
+            ERT_ABORT_IF(
+                ert_closeFd(pidFd));
+
+        signature = destroyPidSignature(signature);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+signalTaskScan(struct TaskScan *self, int aSigNum)
+{
+    int rc = -1;
+
+    int signalled = 0;
+
+    /* Signal each process found by the most recent scan, including
+     * descendants that have left the process group but are still
+     * listed by their parent, and orphaned members of the group. A
+     * process that has exited since the scan is skipped, as is any
+     * process that has since reused its pid. */
+
+    struct TaskScanProcess_ *process;
+
+    TAILQ_FOREACH(process, &self->mProcesses, mList_)
+    {
+        int sent;
+        ERT_ERROR_IF(
+            (sent = signalTaskScanProcess_(process, aSigNum),
+             -1 == sent));
+
+        signalled += sent;
+    }
+
+    rc = signalled;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        ert_finally_warn_if(-1 == rc, self, printTaskScan);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
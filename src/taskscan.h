@@ -0,0 +1,125 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2016, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef TASKSCAN_H
+#define TASKSCAN_H
+
+#include "ert/compiler.h"
+#include "ert/pid.h"
+#include "ert/timekeeping.h"
+#include "ert/queue.h"
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <dirent.h>
+
+ERT_BEGIN_C_SCOPE;
+
+struct PidSignature;
+
+/* -------------------------------------------------------------------------- */
+struct TaskScanThread_;
+typedef TAILQ_ENTRY(TaskScanThread_) TaskScanThreadListEntryT;
+
+struct TaskScanThread_
+{
+    TaskScanThreadListEntryT mList_;
+
+    struct Ert_Pid mTid;
+    int            mStatFd;         /* Held open across scans */
+    int            mChildrenFd;     /* Held open across scans */
+    unsigned       mGeneration;     /* Scan in which thread was last listed */
+
+    char                      mState;
+    struct Ert_EventClockTime mSince;    /* Entry into flagged state */
+    bool                      mReported;
+};
+
+typedef TAILQ_HEAD(TaskScanThreadList_,
+                   TaskScanThread_) TaskScanThreadListT_;
+
+/* -------------------------------------------------------------------------- */
+struct TaskScanProcess_;
+typedef TAILQ_ENTRY(TaskScanProcess_) TaskScanProcessListEntryT;
+
+struct TaskScanProcess_
+{
+    TaskScanProcessListEntryT mList_;
+
+    struct Ert_Pid mPid;
+    DIR           *mTaskDir;        /* Zero if process is not in the group */
+    unsigned       mGeneration;     /* Scan in which process was last listed */
+    bool           mDetached;       /* Process has left the process group */
+
+    struct PidSignature *mSignature;    /* Identity when first listed */
+
+    struct TaskScanThreadList_ mThreads;
+};
+
+typedef TAILQ_HEAD(TaskScanProcessList_,
+                   TaskScanProcess_) TaskScanProcessListT_;
+
+/* -------------------------------------------------------------------------- */
+struct TaskScan
+{
+    struct Ert_Pid  mPid;
+    struct Ert_Pgid mPgid;
+
+    int                 mProcFd;
+    unsigned            mGeneration;
+    const char         *mStates;
+    struct Ert_Duration mThreshold;
+
+    struct TaskScanProcessList_ mProcesses;
+};
+
+/* -------------------------------------------------------------------------- */
+ERT_CHECKED int
+createTaskScan(struct TaskScan     *self,
+               struct Ert_Pid       aPid,
+               struct Ert_Pgid      aPgid,
+               const char          *aStates,
+               struct Ert_Duration  aThreshold);
+
+struct TaskScan *
+closeTaskScan(struct TaskScan *self);
+
+ERT_CHECKED int
+runTaskScan(struct TaskScan *self, const struct Ert_EventClockTime *aScanTime);
+
+ERT_CHECKED int
+signalTaskScan(struct TaskScan *self, int aSigNum);
+
+int
+printTaskScan(const struct TaskScan *self, FILE *aFile);
+
+/* -------------------------------------------------------------------------- */
+
+ERT_END_C_SCOPE;
+
+#endif /* TASKSCAN_H */
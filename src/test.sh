@@ -73,6 +73,35 @@ stoppedprocess()
     return 0
 }
 
+stalledclient()
+{
+    # Connect to the pid server named in the pid file, announce the
+    # connection, but never send the signature to the pid server.
+
+    python3 - "$@" <<'EOF'
+import socket, sys, time
+address = open(sys.argv[1]).read().split('\n')[3]
+client = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+client.connect('\0' + address)
+print('connected', flush=True)
+time.sleep(int(sys.argv[2]))
+EOF
+}
+
+stalledsentry()
+{
+    # Connect to the umbilical daemon, announce the connection, but
+    # never send the registration record to the umbilical daemon.
+
+    python3 - "$@" <<'EOF'
+import socket, sys, time
+client = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+client.connect('\0' + sys.argv[1])
+print('connected', flush=True)
+time.sleep(int(sys.argv[2]))
+EOF
+}
+
 testCaseBegin()
 {
     TESTCASE=$1
@@ -302,6 +331,200 @@ runTests()
     rm -f $PIDFILE.tmp
     testCaseEnd
 
+    testCaseBegin 'Fan out command over pid files'
+    rm -f $PIDFILE.a $PIDFILE.b $PIDFILE.c
+    testOutput "ok,ok,nonexistent" = '$(
+        pidsentry -s -i -p $PIDFILE.a -u -- "while : ; do sleep 1 ; done" | {
+            read PARENT SENTRY UMBILICAL
+            read CHILD_A
+            pidsentry -s -i -p $PIDFILE.b -u -- "while : ; do sleep 1 ; done" | {
+                read PARENT SENTRY UMBILICAL
+                read CHILD_B
+                pidsentry -c --fanout 1 -- "$PIDFILE.{a,b,c}" true |
+                    cut -d" " -f1 | paste -sd, -
+                kill -9 $CHILD_B
+                waitwhile liveprocess $CHILD_B
+            }
+            kill -9 $CHILD_A
+            waitwhile liveprocess $CHILD_A
+        }
+    )'
+    [ ! -f $PIDFILE.a ]
+    [ ! -f $PIDFILE.b ]
+    testCaseEnd
+
+    testCaseBegin 'Client verbs without command'
+    rm -f $PIDFILE
+    testOutput "ok" = '$(
+        pidsentry -s -i -p $PIDFILE -u -- "while : ; do sleep 1 ; done" | {
+            read PARENT SENTRY UMBILICAL
+            read CHILD
+            [ x"$(pidsentry -c --printpid $PIDFILE)" = x"$CHILD" ] &&
+            pidsentry -c --status $PIDFILE >/dev/null &&
+            pidsentry -c --signal KILL $PIDFILE &&
+            echo ok
+            waitwhile liveprocess $CHILD
+        }
+    )'
+    [ ! -f $PIDFILE ]
+    testCaseEnd
+
+    testCaseBegin 'Client command receives pidfd of child'
+    rm -f $PIDFILE
+    testOutput "ok" = '$(
+        pidsentry -s -i -p $PIDFILE -u -- "while : ; do sleep 1 ; done" | {
+            read PARENT SENTRY UMBILICAL
+            read CHILD
+            pidsentry -c $PIDFILE '\''
+                [ -z "${PIDSENTRY_PIDFD++}" ] || {
+                    FD=/proc/self/fd/$PIDSENTRY_PIDFD
+                    FDINFO=/proc/self/fdinfo/$PIDSENTRY_PIDFD
+                    [ x"$(readlink $FD)" = x"anon_inode:[pidfd]" ] &&
+                    grep -q "^Pid:[[:space:]]*$PIDSENTRY_PID\$" $FDINFO
+                }'\'' &&
+            pidsentry -c --signal KILL $PIDFILE &&
+            echo ok
+            waitwhile liveprocess $CHILD
+        }
+    )'
+    [ ! -f $PIDFILE ]
+    testCaseEnd
+
+    testCaseBegin 'Client waits for running child'
+    rm -f $PIDFILE
+    testOutput "3" = '$(
+        pidsentry -s -i -p $PIDFILE -u -- "sleep 2 ; exit 3" | {
+            read PARENT SENTRY UMBILICAL
+            read CHILD
+            liveprocess $CHILD
+            pidsentry -c --wait $PIDFILE || /bin/echo $?
+        }
+    )'
+    [ ! -f $PIDFILE ]
+    testCaseEnd
+
+    testCaseBegin 'Client waits for exited child'
+    rm -f $PIDFILE
+    testExit 3 pidsentry -s -p $PIDFILE -- 'exit 3'
+    [ ! -f $PIDFILE ]
+    testExit 1 pidsentry -c --wait $PIDFILE
+    testExit 1 pidsentry -c -R --wait $PIDFILE
+    testCaseEnd
+
+    testCaseBegin 'Client reference lease expires'
+    rm -f $PIDFILE $PIDFILE.lease
+    testOutput "255,expired" = '$(
+        pidsentry -s -i -p $PIDFILE -u --lease 1 -- "sleep 2" | {
+            read PARENT SENTRY UMBILICAL
+            read CHILD
+            pidsentry -c $PIDFILE "sleep 6" 2>$PIDFILE.lease || /bin/echo $?
+            ! grep -q "Lease on reference" $PIDFILE.lease || /bin/echo expired
+        } | paste -sd, -
+    )'
+    [ ! -f $PIDFILE ]
+    rm -f $PIDFILE.lease
+    testCaseEnd
+
+    testCaseBegin 'Stalled client does not block pid server'
+    if command -v python3 >/dev/null ; then
+        rm -f $PIDFILE
+        testOutput "ok" = '$(
+            pidsentry -s -i -p $PIDFILE -u -- "while : ; do sleep 1 ; done" | {
+                read PARENT SENTRY UMBILICAL
+                read CHILD
+                stalledclient $PIDFILE 10 | {
+                    read CONNECTED
+                    START=$(date +%s)
+                    [ x"$(pidsentry -c --printpid $PIDFILE)" = x"$CHILD" ] &&
+                    [ $(( $(date +%s) - START )) -lt 5 ] &&
+                    echo ok
+                    kill -9 $CHILD
+                }
+                waitwhile liveprocess $CHILD
+            }
+        )'
+        [ ! -f $PIDFILE ]
+    fi
+    testCaseEnd
+
+    testCaseBegin 'Client attach to output'
+    rm -f $PIDFILE
+    testOutput "ok" = '$(
+        pidsentry -s -i -p $PIDFILE -- "while echo tick ; do sleep 1 ; done" | {
+            read PARENT SENTRY UMBILICAL
+            read CHILD
+            pidsentry -c --attach $PIDFILE | {
+                read TICK && [ x"$TICK" = xtick ]
+            } &&
+            pidsentry -c --signal KILL $PIDFILE &&
+            echo ok
+            waitwhile liveprocess $CHILD
+        }
+    )'
+    [ ! -f $PIDFILE ]
+    testCaseEnd
+
+    testCaseBegin 'Client reconfigures tether timeout'
+    rm -f $PIDFILE
+    testOutput "done" = '$(
+        pidsentry -s -i -p $PIDFILE -t 2 -- "sleep 4 ; echo done" | {
+            read PARENT SENTRY UMBILICAL
+            read CHILD
+            pidsentry -c --reconfigure timeout=30 $PIDFILE &&
+            read DONE &&
+            echo "$DONE"
+        }
+    )'
+    testCaseEnd
+
+    testCaseBegin 'Client reconfigures tree plan without scan'
+    # A plan that targets the process tree cannot be applied to a sentry
+    # that has no scan of the tree, and the original plan remains.
+    rm -f $PIDFILE
+    testOutput "exit $((128 + 9))" = '$(
+        {
+            pidsentry -s -i -p $PIDFILE -t 2 --abortplan KILL -- sleep 60
+            echo "exit $?"
+        } | {
+            read PARENT SENTRY UMBILICAL
+            read CHILD
+            pidsentry -c --reconfigure abortplan=TERM:tree $PIDFILE
+            read EXIT
+            echo "$EXIT"
+        }
+    )'
+    testCaseEnd
+
+    testCaseBegin 'Binary pidfile format'
+    rm -f $PIDFILE
+    testOutput "ok" = '$(
+        pidsentry -s -i -p $PIDFILE --pidfileformat binary -- sleep 2 | {
+            read PARENT SENTRY UMBILICAL
+            read CHILD
+            [ x"$(pidsentry -c --printpid $PIDFILE)" = x"$CHILD" ] &&
+            [ x"$(head -c 8 $PIDFILE)" = xPIDSNTRY ] &&
+            echo ok
+        }
+    )'
+    [ ! -f $PIDFILE ]
+    testCaseEnd
+
+    testCaseBegin 'Client lists registered sentries'
+    rm -f $PIDFILE $PIDFILE.registry
+    testOutput "running" = '$(
+        pidsentry -s -i -p $PIDFILE --registry $PIDFILE.registry -- sleep 2 | {
+            read PARENT SENTRY UMBILICAL
+            read CHILD
+            pidsentry -c --list $PIDFILE.registry | {
+                read PIDTAG PID SENTRYTAG SENTRYPID STATETAG STATE REST
+                [ x"$PID/$SENTRYPID" = x"$CHILD/$SENTRY" ] && echo "$STATE"
+            }
+        }
+    )'
+    testOutput "" = '$(pidsentry -c --list $PIDFILE.registry)'
+    rm -f $PIDFILE.registry
+    testCaseEnd
+
     testCaseBegin 'Identify processes'
     for REPLY in $(
       exec sh -c '
@@ -436,6 +659,87 @@ runTests()
     )'
     testCaseEnd
 
+    testCaseBegin 'Umbilical program'
+    # The umbilical replaces the image of the sentry with the dedicated
+    # umbilical program. Record the proportional set size of each
+    # to show the saving.
+    [ -n "$VALGRIND" ] || [ -n "${RPATH++}" ] || testOutput "OK" = '$(
+        pidsentry -s -i -- "while : ; do sleep 1 ; done" |
+        {
+            read PARENT SENTRY UMBILICAL
+            read CHILD
+            for N in 1 2 3 4 5 ; do
+                EXE=$(readlink /proc/$UMBILICAL/exe)
+                [ x"${EXE##*/}" != x"pidumbilical" ] || break
+                sleep 1
+            done
+            for P in $SENTRY $UMBILICAL ; do
+                ! [ -r /proc/$P/smaps_rollup ] ||
+                    printf "%s %s\n" "$(readlink /proc/$P/exe)" \
+                        "$(grep ^Pss: /proc/$P/smaps_rollup)" >&2
+            done
+            [ x"${EXE##*/}" != x"pidumbilical" ] || /bin/echo OK
+            kill $CHILD || { /bin/echo NOTOK ; exit 1 ; }
+        }
+    )'
+    testCaseEnd
+
+    testCaseBegin 'Umbilical suspicion'
+    # Ensure that a healthy umbilical is not suspected, and that the
+    # distributions of round trip times and ping intervals are reported.
+    testOutput "OK" = '$(
+        pidsentry -s -d --suspicion 8 -- sleep 3 2>&1 >/dev/null |
+            grep -q "umbilical rtt" && /bin/echo OK)'
+    testOutput "OK" = '$(
+        pidsentry -s -d --suspicion 8 -- sleep 3 2>&1 >/dev/null |
+            grep -q "umbilical ping interval" && /bin/echo OK)'
+    testCaseEnd
+
+    testCaseBegin 'Umbilical daemon'
+    # Register sentries with a stand-alone umbilical daemon, and ensure
+    # that the daemon kills the child when the sentry is killed.
+    [ -n "$VALGRIND" ] || [ -n "${RPATH++}" ] || {
+        UMBILICALDAEMON=pidsentry-test-$$
+        ./pidumbilical "$UMBILICALDAEMON" &
+        UMBILICALDAEMONPID=$!
+        sleep 1
+        testExit 0 pidsentry -s --umbilicaldaemon "$UMBILICALDAEMON" -- true
+        testExit 0 pidsentry -s --umbilicaldaemon "$UMBILICALDAEMON" \
+            -p $PIDFILE -- sleep 2
+        testOutput "OK" = '$(
+            pidsentry -s -i --umbilicaldaemon "$UMBILICALDAEMON" -- \
+                "while : ; do sleep 1 ; done" |
+            {
+                read PARENT SENTRY UMBILICAL
+                read CHILD
+                [ x"$UMBILICAL" = x0 ] || { /bin/echo NOTOK ; exit 1 ; }
+                kill -9 $SENTRY
+                SLEPT=0
+                while liveprocess $CHILD ; do
+                    sleep 1
+                    [ $(( ++SLEPT )) -lt 60 ] || exit 1
+                done
+                /bin/echo OK
+            }
+        )'
+        # Ensure that a sentry that stalls part way through its
+        # registration does not hold up the registration of another.
+        if command -v python3 >/dev/null ; then
+            testOutput "ok" = '$(
+                stalledsentry "$UMBILICALDAEMON" 10 | {
+                    read CONNECTED
+                    START=$(date +%s)
+                    pidsentry -s --umbilicaldaemon "$UMBILICALDAEMON" -- true &&
+                    [ $(( $(date +%s) - START )) -lt 5 ] &&
+                    echo ok
+                }
+            )'
+        fi
+        kill $UMBILICALDAEMONPID
+        wait $UMBILICALDAEMONPID || :
+    }
+    testCaseEnd
+
     testCaseBegin 'Watchdog process file descriptors'
     # i.   stdin
     # ii.  stdout
@@ -1084,6 +1388,101 @@ runTests()
     )
     [ "$REPLY" -ge 6 ]
     testCaseEnd
+
+    testCaseBegin 'Thread hang detector'
+    testExit 1 pidsentry -s --hang 2,Q -- true
+    testExit 1 pidsentry -s --hang 2,D,stop -- true
+    testExit 0 pidsentry -s --hang 0 -- true
+    testExit $((128 + 15)) pidsentry -s -u --hang 2,S,term -- sleep 60
+    testCaseEnd
+
+    testCaseBegin 'Heartbeat region'
+    testExit 1 pidsentry -s --heartbeat 1,0 -- true
+    testExit 0 pidsentry -s --heartbeat 4,2 -- 'test -n "$PIDSENTRY_HEARTBEAT"'
+    testExit 0 pidsentry -s --heartbeat 4,2,HB -- 'test -n "$HB" && sleep 4'
+    testExit $((128 + 6)) pidsentry -s -u --heartbeat 1,2 -- 'printf "\001" |
+        dd bs=1 seek=64 conv=notrunc 2>/dev/null \
+            of=/proc/self/fd/$PIDSENTRY_HEARTBEAT
+        sleep 60'
+    testCaseEnd
+
+    testCaseBegin 'Signal plans'
+    testExit 1 pidsentry -s --termplan BOGUS -- true
+    testExit 1 pidsentry -s --abortplan TERM:self -- true
+    testExit $((128 + 15)) pidsentry -s -t 1 --abortplan TERM@300ms,KILL -- \
+        sleep 60
+    testExit $((128 + 9)) pidsentry -s -t 1 --abortplan TERM:pgid@1s,KILL -- \
+        'trap "" 15 ; sleep 60'
+    testExit $((128 + 9)) pidsentry -s -t 1 --abortplan KILL:tree -- \
+        'sleep 60 ; sleep 60'
+    testCaseEnd
+
+    testCaseBegin 'Tether drain'
+    testExit 1 pidsentry -s -t ,,,1xs -- true
+    testOutput "OK" = '$(pidsentry -s -t ,,,500ms -- /bin/echo OK)'
+    testOutput "OK" = '$(
+        START=$(date +%s)
+        OUTPUT=$(pidsentry -s -- "echo OK ; sleep 60 &")
+        [ $(( $(date +%s) - START )) -ge 10 ] || /bin/echo $OUTPUT)'
+    testOutput "OK" = '$(
+        START=$(date +%s)
+        rm -f scratch/drained
+        { pidsentry -s -t ,,,1 -- "head -c 100000 /dev/zero" 2>/dev/null
+          date +%s > scratch/drained ; } | sleep 5
+        [ $(( $(cat scratch/drained) - START )) -ge 5 ] || /bin/echo OK)'
+    # Leave output in the tether when the child terminates, and ensure
+    # that the drain stops once the tether is empty even though a
+    # grandchild holds the tether open.
+    testOutput "OK 300000" = '$(
+        START=$(date +%s)
+        rm -f scratch/drained
+        BYTES=$(
+            { pidsentry -s -- "head -c 300000 /dev/zero ; sleep 60 &" \
+                  2>/dev/null
+              date +%s > scratch/drained ; } | { sleep 2 ; wc -c ; })
+        [ $(( $(cat scratch/drained) - START )) -ge 10 ] ||
+            /bin/echo OK $((BYTES)))'
+    testCaseEnd
+
+    testCaseBegin 'Umbilical wakeups'
+    testExit 0 pidsentry -s -t ,2 -- sleep 6
+    testOutput "OK" = '$(
+        pidsentry -s -d -t ,2 -- sleep 3 2>&1 >/dev/null |
+        grep -q "umbilical [0-9]* wakeups in" && /bin/echo OK)'
+    testCaseEnd
+
+    testCaseBegin 'Umbilical shared heartbeat'
+    testExit 0 pidsentry -s --sharedbeat -t ,2 -- sleep 4
+    testOutput "OK" = '$(
+        pidsentry -s -d --sharedbeat -t ,2 -- sleep 3 2>&1 >/dev/null |
+        grep -q "umbilical heartbeat shared" && /bin/echo OK)'
+    testCaseEnd
+
+    testCaseBegin 'Notification socket'
+    testExit 0 pidsentry -s --notify -- 'test -n "$NOTIFY_SOCKET"'
+    if command -v systemd-notify >/dev/null ; then
+        testExit 0 pidsentry -s -q --notify -t 4 -- 'for N in 1 2 3 4 ; do
+            systemd-notify WATCHDOG=1 ; sleep 1 ; done'
+        rm -f $PIDFILE scratch/ready
+        mkfifo scratch/ready
+        testOutput "OK" = '$(
+            pidsentry -s -i -u --notify -p $PIDFILE -- "
+                read READY < $PWD/scratch/ready
+                systemd-notify --ready
+                while : ; do sleep 1 ; done" | {
+                    read PARENT SENTRY UMBILICAL
+                    [ -s $PIDFILE ] || READY=OK
+                    echo > scratch/ready
+                    read CHILD
+                    ! [ -s $PIDFILE ] || /bin/echo ${READY:-}
+                    kill -9 $CHILD
+                    waitwhile liveprocess $CHILD
+            }
+        )'
+        rm -f scratch/ready
+        [ ! -f $PIDFILE ]
+    fi
+    testCaseEnd
 }
 
 unset TEST_MODE_EXTENDED
@@ -29,6 +29,7 @@
 
 #include "tether.h"
 
+#include "sentrystatus.h"
 #include "options_.h"
 
 #include "ert/pollfd.h"
@@ -37,8 +38,13 @@
 #include <unistd.h>
 #include <poll.h>
 #include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
 
 #include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 
 /* -------------------------------------------------------------------------- */
 enum PollFdTetherKind
@@ -74,17 +80,34 @@ static const char *pollFdTimerNames_[] =
  * in the main thread from blocking that might arise when writing to
  * the destination file descriptor. The destination file descriptor
  * cannot be guaranteed to be non-blocking because it is inherited
- * when the watchdog process is started. */
+ * when the watchdog process is started.
+ *
+ * Writes to the destination never block, but instead wait for the
+ * destination to become ready in the event loop of the thread. This
+ * ensures that the thread always remains responsive to the request to
+ * flush the tether, and allows the drain deadline to be enforced by
+ * the event loop without having to interrupt a blocking write. */
 
 struct TetherPoll
 {
     struct TetherThread *mThread;
     int                  mSrcFd;
-    int                  mDstFd;
+    bool                 mSplice;
     char                *mBuf;
     size_t               mBufLen;
     char                *mBufPtr;
     char                *mBufEnd;
+    uint64_t             mBytes;     /* Bytes written to the destination */
+    size_t               mTeed;      /* Bytes at the head already teed */
+
+    struct {
+        bool                 mActive;
+        bool                 mEmpty;
+        int                  mFd;
+        enum TetherDrainMode mMode;
+        size_t               mBytes;
+        const char          *mReason;
+    } mDrain;
 
     struct pollfd                mPollFds[POLL_FD_TETHER_KINDS];
     struct Ert_PollFdAction      mPollFdActions[POLL_FD_TETHER_KINDS];
@@ -92,34 +115,97 @@ struct TetherPoll
                                      POLL_FD_TETHER_TIMER_KINDS];
 };
 
-static ERT_CHECKED int
-pollFdControl_(struct TetherPoll               *self,
-               const struct Ert_EventClockTime *aPollTime)
+static ssize_t
+writeTether_(struct TetherPoll *self, const char *aBuf, size_t aLen)
 {
-    int rc = -1;
+    int fd = self->mDrain.mFd;
 
-    char buf[1];
+    if (TetherDrainSocket == self->mDrain.mMode)
+        return send(fd, aBuf, aLen, MSG_DONTWAIT);
 
-    ERT_ERROR_IF(
-        -1 == ert_readFd(
-            self->mPollFds[POLL_FD_TETHER_CONTROL].fd, buf, sizeof(buf), 0));
+    if (TetherDrainPolled == self->mDrain.mMode)
+    {
+        /* The output file descriptor could not be made non-blocking,
+         * so only write when the output is ready, and limit the amount
+         * written so that a pipe will accept it without blocking. */
 
-    ert_debug(0, "tether disconnection request received");
+        int ready = ert_waitFdWriteReady(fd, &Ert_ZeroDuration);
 
-    /* Note that gOptions.mServer.mTimeout.mDrain_s might be zero to indicate
-     * that the no drain timeout is to be enforced. */
+        if (-1 == ready)
+            return -1;
 
-    self->mPollFdTimerActions[POLL_FD_TETHER_TIMER_DISCONNECT].mPeriod =
-        Ert_Duration(
-            ERT_NSECS(Ert_Seconds(gOptions.mServer.mTimeout.mDrain_s)));
+        if ( ! ready)
+        {
+            errno = EWOULDBLOCK;
+            return -1;
+        }
 
-    rc = 0;
+        if (PIPE_BUF < aLen)
+            aLen = PIPE_BUF;
+    }
 
-Ert_Finally:
+    return write(fd, aBuf, aLen);
+}
 
-    ERT_FINALLY({});
+/* Subscribers are attached by the main thread, but are fed by the
+ * tether thread. Each subscriber receives a copy of the data at the head
+ * of the tether using tee(2) before the data is consumed, so that the
+ * data is not copied through the tether thread. A subscriber that
+ * cannot keep up is discarded, rather than being allowed to slow the
+ * child process, so that each subscriber always receives an unbroken
+ * stream.
+ *
+ * Files must not be opened or closed in the tether thread, so a
+ * discarded subscriber is replaced by a duplicate of the null pipe
+ * rather than being closed. This releases the subscriber pipe
+ * immediately so that the reader sees end of file, while the slot
+ * itself is reclaimed later by the main thread. */
+
+static size_t
+teeTether_(struct TetherPoll *self, size_t aLen)
+{
+    if ( ! self->mTeed)
+    {
+        struct TetherThread *thread = self->mThread;
 
-    return rc;
+        pthread_mutex_t *lock = ert_lockMutex(thread->mSubscribers.mMutex);
+
+        for (unsigned ix = 0; ix < TETHER_SUBSCRIBERS; ++ix)
+        {
+            int fd = thread->mSubscribers.mFd[ix];
+
+            if (-1 == fd || thread->mSubscribers.mBroken[ix])
+                continue;
+
+#ifdef __linux__
+            ssize_t teeBytes = tee(
+                self->mSrcFd, fd, aLen, SPLICE_F_NONBLOCK);
+#else
+            ssize_t teeBytes = -1;
+            errno = ENOSYS;
+#endif
+
+            if (teeBytes != aLen)
+            {
+                ert_debug(
+                    0,
+                    "discarding tether subscriber fd %d teed %zd errno %d",
+                    fd, teeBytes, -1 == teeBytes ? errno : 0);
+
+                if (dup3(thread->mNullPipe->mRdFile->mFd, fd, O_CLOEXEC) != fd)
+                    ert_warn(
+                        errno, "Unable to discard tether subscriber fd %d", fd);
+
+                thread->mSubscribers.mBroken[ix] = true;
+            }
+        }
+
+        lock = ert_unlockMutex(lock);
+
+        self->mTeed = aLen;
+    }
+
+    return self->mTeed < aLen ? self->mTeed : aLen;
 }
 
 static ERT_CHECKED int
@@ -142,17 +228,23 @@ pollFdDrainCopy_(struct TetherPoll               *self,
             if ( ! available)
             {
                 ert_debug(0, "tether drain input empty");
+                self->mDrain.mReason = self->mDrain.mEmpty ? "empty" : "closed";
                 break;
             }
 
             /* This read(2) call should not block since the file
              * descriptor is created by the sentry and only read
-             * in this thread. */
+             * in this thread. Read no more than has been teed to
+             * the subscribers. */
+
+            size_t rdLen = teeTether_(
+                self,
+                available < self->mBufLen ? available : self->mBufLen);
 
             ssize_t rdSize = -1;
 
             ERT_ERROR_IF(
-                (rdSize = read(self->mSrcFd, self->mBuf, self->mBufLen),
+                (rdSize = read(self->mSrcFd, self->mBuf, rdLen),
                  -1 == rdSize && EINTR != errno && EWOULDBLOCK != errno));
 
             /* This is unlikely to happen since the ioctl() reported
@@ -162,6 +254,7 @@ pollFdDrainCopy_(struct TetherPoll               *self,
             if ( ! rdSize)
             {
                 ert_debug(0, "tether drain input closed");
+                self->mDrain.mReason = "closed";
                 break;
             }
 
@@ -169,7 +262,9 @@ pollFdDrainCopy_(struct TetherPoll               *self,
             {
                 ert_debug(1, "read %zd bytes from fd %d", rdSize, self->mSrcFd);
 
-                ert_ensure(rdSize <= self->mBufLen);
+                ert_ensure(rdSize <= rdLen);
+
+                self->mTeed -= rdSize;
 
                 self->mBufPtr = self->mBuf;
                 self->mBufEnd = self->mBufPtr + rdSize;
@@ -182,22 +277,22 @@ pollFdDrainCopy_(struct TetherPoll               *self,
         }
         else
         {
-            /* This write(2) call will likely block if it is unable to
-             * write all the data to the output file descriptor
-             * immediately. */
+            /* This write will not block. If the output is not ready,
+             * wait for it in the event loop. */
 
             ssize_t wrSize = -1;
 
             ERT_ERROR_IF(
-                (wrSize = write(self->mDstFd,
-                                self->mBufPtr,
-                                self->mBufEnd - self->mBufPtr),
+                (wrSize = writeTether_(self,
+                                       self->mBufPtr,
+                                       self->mBufEnd - self->mBufPtr),
                  -1 == wrSize && (EPIPE       != errno &&
                                   EWOULDBLOCK != errno &&
                                   EINTR       != errno)));
             if ( ! wrSize)
             {
                 ert_debug(0, "tether drain output closed");
+                self->mDrain.mReason = "output closed";
                 break;
             }
 
@@ -206,16 +301,22 @@ pollFdDrainCopy_(struct TetherPoll               *self,
                 if (EPIPE == errno)
                 {
                     ert_debug(0, "tether drain output broken");
+                    self->mDrain.mReason = "output broken";
                     break;
                 }
             }
             else
             {
-                ert_debug(1, "wrote %zd bytes to fd %d", wrSize, self->mDstFd);
+                ert_debug(
+                    1, "wrote %zd bytes to fd %d", wrSize, self->mDrain.mFd);
 
                 ert_ensure(wrSize <= self->mBufEnd - self->mBufPtr);
 
                 self->mBufPtr += wrSize;
+                self->mBytes  += wrSize;
+
+                if (self->mDrain.mActive)
+                    self->mDrain.mBytes += wrSize;
 
                 if (self->mBufEnd == self->mBufPtr)
                 {
@@ -225,6 +326,25 @@ pollFdDrainCopy_(struct TetherPoll               *self,
                         ERT_POLL_INPUTEVENTS;
                     pollFds[POLL_FD_TETHER_OUTPUT].events =
                         ERT_POLL_DISCONNECTEVENT;
+
+                    /* Once the child process has terminated, stop as
+                     * soon as the tether is empty rather than waiting
+                     * for an input event that might never arrive. */
+
+                    if (self->mDrain.mEmpty)
+                    {
+                        int available;
+
+                        ERT_ERROR_IF(
+                            ert_ioctlFd(self->mSrcFd, FIONREAD, &available));
+
+                        if ( ! available)
+                        {
+                            ert_debug(0, "tether drain input empty");
+                            self->mDrain.mReason = "empty";
+                            break;
+                        }
+                    }
                 }
             }
         }
@@ -280,24 +400,28 @@ pollFdDrainSplice_(struct TetherPoll               *self,
         if ( ! available)
         {
             ert_debug(0, "tether drain input empty");
+            self->mDrain.mReason = self->mDrain.mEmpty ? "empty" : "closed";
             break;
         }
 
         /* Use the amount of data available in the input file descriptor
          * to specify the amount of data to splice.
          *
-         * This splice(2) call will likely block if it is unable to
-         * write all the data to the output file descriptor immediately.
-         * Note that it cannot block on reading the input file descriptor
-         * because that file descriptor is private to this process, the
-         * amount of input available is known and is only read by this
-         * thread. */
+         * This splice(2) call will not block because splice is only used
+         * when the output file descriptor is non-blocking. Note that it
+         * cannot block on reading the input file descriptor because that
+         * file descriptor is private to this process, the amount of input
+         * available is known and is only read by this thread.
+         *
+         * Splice no more than has been teed to the subscribers, so that
+         * input left behind by a partial splice is not teed again. */
 
         ssize_t splicedBytes;
 
         ERT_ERROR_IF(
             (splicedBytes = ert_spliceFd(
-                self->mSrcFd, self->mDstFd, available, SPLICE_F_MOVE),
+                self->mSrcFd, self->mDrain.mFd,
+                teeTether_(self, available), SPLICE_F_MOVE),
              -1 == splicedBytes &&
              EPIPE       != errno &&
              EWOULDBLOCK != errno &&
@@ -306,6 +430,7 @@ pollFdDrainSplice_(struct TetherPoll               *self,
         if ( ! splicedBytes)
         {
             ert_debug(0, "tether drain output closed");
+            self->mDrain.mReason = "output closed";
             break;
         }
 
@@ -314,6 +439,7 @@ pollFdDrainSplice_(struct TetherPoll               *self,
             if (EPIPE == errno)
             {
                 ert_debug(0, "tether drain output broken");
+                self->mDrain.mReason = "output broken";
                 break;
             }
         }
@@ -322,7 +448,13 @@ pollFdDrainSplice_(struct TetherPoll               *self,
             ert_debug(
                 1,
                 "drained %zd bytes from fd %d to fd %d",
-                splicedBytes, self->mSrcFd, self->mDstFd);
+                splicedBytes, self->mSrcFd, self->mDrain.mFd);
+
+            self->mBytes += splicedBytes;
+            self->mTeed  -= splicedBytes;
+
+            if (self->mDrain.mActive)
+                self->mDrain.mBytes += splicedBytes;
 
             int srcFdReady = -1;
             ERT_ERROR_IF(
@@ -355,6 +487,23 @@ pollFdDrainSplice_(struct TetherPoll               *self,
                     ERT_POLL_INPUTEVENTS;
                 pollFds[POLL_FD_TETHER_OUTPUT].events =
                     ERT_POLL_DISCONNECTEVENT;
+
+                /* Once the child process has terminated, stop as soon
+                 * as the tether is empty rather than waiting for an
+                 * input event that might never arrive. */
+
+                if (self->mDrain.mEmpty)
+                {
+                    ERT_ERROR_IF(
+                        ert_ioctlFd(self->mSrcFd, FIONREAD, &available));
+
+                    if ( ! available)
+                    {
+                        ert_debug(0, "tether drain input empty");
+                        self->mDrain.mReason = "empty";
+                        break;
+                    }
+                }
             }
         }
 
@@ -389,7 +538,7 @@ pollFdDrain_(struct TetherPoll               *self,
 
         int drained = -1;
 
-        if (self->mBuf)
+        if ( ! self->mSplice)
             ERT_ERROR_IF(
                 (drained = pollFdDrainCopy_(self, aPollTime),
                  -1 == drained));
@@ -398,6 +547,8 @@ pollFdDrain_(struct TetherPoll               *self,
                 (drained = pollFdDrainSplice_(self, aPollTime),
                  -1 == drained));
 
+        markSentryStatusTether(self->mThread->mStatus, self->mBytes);
+
         if (drained)
             self->mPollFds[POLL_FD_TETHER_CONTROL].events = 0;
     }
@@ -411,6 +562,61 @@ Ert_Finally:
     return rc;
 }
 
+static ERT_CHECKED int
+pollFdControl_(struct TetherPoll               *self,
+               const struct Ert_EventClockTime *aPollTime)
+{
+    int rc = -1;
+
+    char buf[1];
+
+    ERT_ERROR_IF(
+        -1 == ert_readFd(
+            self->mPollFds[POLL_FD_TETHER_CONTROL].fd, buf, sizeof(buf), 0));
+
+    enum TetherThreadFlush flush = buf[0];
+
+    ert_debug(0, "tether disconnection request %d received", flush);
+
+    if ( ! self->mDrain.mActive)
+    {
+        self->mDrain.mActive = true;
+
+        /* Note that gOptions.mServer.mTimeout.mDrain_ms might be zero to
+         * indicate that the no drain timeout is to be enforced. Measure
+         * the deadline from the time the request is received. */
+
+        struct Ert_PollFdTimerAction *disconnectTimer =
+            &self->mPollFdTimerActions[POLL_FD_TETHER_TIMER_DISCONNECT];
+
+        disconnectTimer->mPeriod = Ert_Duration(
+            ERT_NSECS(Ert_MilliSeconds(gOptions.mServer.mTimeout.mDrain_ms)));
+
+        ert_lapTimeRestart(&disconnectTimer->mSince, aPollTime);
+    }
+
+    /* Once the child process has terminated, no more input will be
+     * produced by the child itself, so the drain can complete as soon
+     * as the tether is empty. Check now because there might not be
+     * any further input events to indicate that the tether is empty. */
+
+    if (TetherThreadFlushTerminated == flush && ! self->mDrain.mEmpty)
+    {
+        self->mDrain.mEmpty = true;
+
+        ERT_ERROR_IF(
+            pollFdDrain_(self, aPollTime));
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
 static ERT_CHECKED int
 pollFdTimerDisconnected_(struct TetherPoll               *self,
                          const struct Ert_EventClockTime *aPollTime)
@@ -423,7 +629,12 @@ pollFdTimerDisconnected_(struct TetherPoll               *self,
     self->mPollFdTimerActions[POLL_FD_TETHER_TIMER_DISCONNECT].mPeriod =
         Ert_ZeroDuration;
 
-    self->mPollFds[POLL_FD_TETHER_CONTROL].events = 0;
+    if (self->mPollFds[POLL_FD_TETHER_CONTROL].events)
+    {
+        self->mDrain.mReason = "deadline";
+
+        self->mPollFds[POLL_FD_TETHER_CONTROL].events = 0;
+    }
 
     rc = 0;
 
@@ -447,8 +658,6 @@ tetherThreadMain_(struct TetherThread *self)
 
     struct Ert_PollFd *pollfd = 0;
 
-    struct Ert_ThreadSigMask *threadSigMask = 0;
-
     {
         pthread_mutex_t *lock = ert_lockMutex(self->mState.mMutex);
         self->mState.mValue = TETHER_THREAD_RUNNING;
@@ -461,25 +670,34 @@ tetherThreadMain_(struct TetherThread *self)
      * inherited by the chlid. */
 
     int srcFd     = STDIN_FILENO;
-    int dstFd     = STDOUT_FILENO;
     int controlFd = self->mControlPipe->mRdFile->mFd;
 
     /* The file descriptor for stdin is a pipe created by the watchdog
      * so it is known to be nonblocking. The file descriptor for stdout
-     * is inherited, so it is likely blocking. */
+     * is inherited, so it is likely blocking, and output is instead
+     * written to the private file descriptor created for the drain
+     * where one is available. */
+
+    int dstFd = -1 == self->mDrain.mFd ? STDOUT_FILENO : self->mDrain.mFd;
 
     ert_ensure(0 < ert_ownFdNonBlocking(srcFd));
 
-    /* The splice() call is not supported on Linux if stdout is configured
-     * for O_APPEND. In this case, fall back to using the slower
-     * read-write approach to transfer data. For more information
-     * see the following:
+    /* The splice() call can only be used if the output file descriptor
+     * is non-blocking because SPLICE_F_NONBLOCK only applies to the
+     * pipe, and not to the output file descriptor. Otherwise, use the
+     * read-write approach so that each write can be made without
+     * blocking.
+     *
+     * The splice() call is also not supported on Linux if the output
+     * is configured for O_APPEND. For more information see the
+     * following:
      *
      * https://bugzilla.kernel.org/show_bug.cgi?id=82841 */
 
     bool useReadWrite = true;
 
 #ifdef __linux__
+    if (TetherDrainNonBlocking == self->mDrain.mMode)
     {
         int dstFlags = -1;
 
@@ -491,29 +709,33 @@ tetherThreadMain_(struct TetherThread *self)
     }
 #endif
 
-    if (ert_testAction(Ert_TestLevelRace))
+    if (TetherDrainNonBlocking == self->mDrain.mMode &&
+        ert_testAction(Ert_TestLevelRace))
         useReadWrite = ! useReadWrite;
 
     char readWriteBuffer[16 * 1024];
 
-    /* The tether thread is configured to receive SIGALRM, but
-     * these signals are not delivered until the thread is
-     * flushed after the child process has terminated. */
-
-    struct Ert_ThreadSigMask threadSigMask_;
-    threadSigMask = ert_pushThreadSigMask(
-        &threadSigMask_, Ert_ThreadSigMaskUnblock,
-        (const int []) { SIGALRM, 0 });
-
     struct TetherPoll tetherpoll =
     {
         .mThread = self,
         .mSrcFd  = srcFd,
-        .mDstFd  = dstFd,
-        .mBuf    = useReadWrite ? readWriteBuffer : 0,
+        .mSplice = ! useReadWrite,
+        .mBuf    = readWriteBuffer,
         .mBufLen = sizeof(readWriteBuffer),
         .mBufPtr = 0,
         .mBufEnd = 0,
+        .mBytes  = 0,
+        .mTeed   = 0,
+
+        .mDrain =
+        {
+            .mActive = false,
+            .mEmpty  = false,
+            .mFd     = dstFd,
+            .mMode   = self->mDrain.mMode,
+            .mBytes  = 0,
+            .mReason = "closed",
+        },
 
         .mPollFds =
         {
@@ -560,7 +782,19 @@ tetherThreadMain_(struct TetherThread *self)
 
     pollfd = ert_closePollFd(pollfd);
 
-    threadSigMask = ert_popThreadSigMask(threadSigMask);
+    self->mDrain.mBytes  = tetherpoll.mDrain.mBytes;
+    self->mDrain.mReason = tetherpoll.mDrain.mReason;
+
+    if ( ! strcmp("deadline", self->mDrain.mReason))
+        ert_warn(
+            0,
+            "Tether drain deadline expired after %zu bytes",
+            self->mDrain.mBytes);
+    else
+        ert_debug(
+            0,
+            "tether drained %zu bytes %s",
+            self->mDrain.mBytes, self->mDrain.mReason);
 
     /* Close the input file descriptor so that there is a chance
      * to propagte SIGPIPE to the child process. */
@@ -594,8 +828,6 @@ Ert_Finally:
     ERT_FINALLY
     ({
         pollfd = ert_closePollFd(pollfd);
-
-        threadSigMask = ert_popThreadSigMask(threadSigMask);
     });
 
     return rc;
@@ -609,14 +841,94 @@ closeTetherThread_(struct TetherThread *self)
 
     self->mControlPipe = ert_closePipe(self->mControlPipe);
 
+    if (-1 != self->mDrain.mFd)
+        ERT_ABORT_IF(
+            ert_closeFd(self->mDrain.mFd));
+    self->mDrain.mFd = -1;
+
+    for (unsigned ix = 0; ix < TETHER_SUBSCRIBERS; ++ix)
+    {
+        if (-1 != self->mSubscribers.mFd[ix])
+            ERT_ABORT_IF(
+                ert_closeFd(self->mSubscribers.mFd[ix]));
+        self->mSubscribers.mFd[ix] = -1;
+    }
+
     self->mState.mCond     = ert_destroyCond(self->mState.mCond);
     self->mState.mMutex    = ert_destroyMutex(self->mState.mMutex);
     self->mActivity.mMutex = ert_destroyMutex(self->mActivity.mMutex);
+
+    self->mSubscribers.mMutex = ert_destroyMutex(self->mSubscribers.mMutex);
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+createTetherDrain_(struct TetherThread *self, int aFd)
+{
+    int rc = -1;
+
+    /* The destination file descriptor is inherited, and the open file
+     * description is shared with other processes, so it cannot simply
+     * be made non-blocking. Where the destination has no file offset,
+     * obtain a private open file description that can be made
+     * non-blocking. Writes to regular files do not wait for a reader,
+     * sockets can use MSG_DONTWAIT, and anything else falls back to
+     * polling before writing.
+     *
+     * This is done here rather than in the tether thread because
+     * files must not be opened in that thread. */
+
+    self->mDrain.mFd     = -1;
+    self->mDrain.mMode   = TetherDrainPolled;
+    self->mDrain.mBytes  = 0;
+    self->mDrain.mReason = 0;
+
+    int fdFlags = -1;
+    ERT_ERROR_IF(
+        (fdFlags = ert_ownFdFlags(aFd),
+         -1 == fdFlags));
+
+    struct stat fdStat;
+    ERT_ERROR_IF(
+        fstat(aFd, &fdStat));
+
+    if ((fdFlags & O_NONBLOCK) || S_ISREG(fdStat.st_mode))
+        self->mDrain.mMode = TetherDrainNonBlocking;
+    else if (S_ISSOCK(fdStat.st_mode))
+        self->mDrain.mMode = TetherDrainSocket;
+    else if (S_ISFIFO(fdStat.st_mode) || S_ISCHR(fdStat.st_mode))
+    {
+        char fdName[sizeof("/proc/self/fd/") + sizeof(int) * CHAR_BIT];
+
+        ERT_ERROR_IF(
+            0 > snprintf(fdName, sizeof(fdName), "/proc/self/fd/%d", aFd));
+
+        self->mDrain.mFd = ert_openFd(
+            fdName,
+            O_WRONLY | O_NONBLOCK | O_NOCTTY | O_CLOEXEC, Ert_Mode(0));
+
+        if (-1 != self->mDrain.mFd)
+            self->mDrain.mMode = TetherDrainNonBlocking;
+        else
+            ert_debug(0, "unable to reopen fd %d errno %d", aFd, errno);
+    }
+
+    ert_debug(0, "tether drain fd %d mode %d", aFd, self->mDrain.mMode);
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
 }
 
 /* -------------------------------------------------------------------------- */
 int
-createTetherThread(struct TetherThread *self, struct Ert_Pipe *aNullPipe)
+createTetherThread(struct TetherThread *self,
+                   struct Ert_Pipe     *aNullPipe,
+                   struct SentryStatus *aStatus)
 {
     int rc = -1;
 
@@ -624,16 +936,29 @@ createTetherThread(struct TetherThread *self, struct Ert_Pipe *aNullPipe)
     self->mState.mMutex    = ert_createMutex(&self->mState.mMutex_);
     self->mState.mCond     = ert_createCond(&self->mState.mCond_);
 
+    self->mSubscribers.mMutex = ert_createMutex(&self->mSubscribers.mMutex_);
+
+    for (unsigned ix = 0; ix < TETHER_SUBSCRIBERS; ++ix)
+    {
+        self->mSubscribers.mFd[ix]     = -1;
+        self->mSubscribers.mBroken[ix] = false;
+    }
+
     self->mControlPipe     = 0;
     self->mNullPipe        = aNullPipe;
+    self->mStatus          = aStatus;
     self->mActivity.mSince = ert_eventclockTime();
     self->mState.mValue    = TETHER_THREAD_STOPPED;
     self->mFlushed         = false;
+    self->mDrain.mFd       = -1;
 
     ERT_ERROR_IF(
         ert_createPipe(&self->mControlPipe_, O_CLOEXEC | O_NONBLOCK));
     self->mControlPipe = &self->mControlPipe_;
 
+    ERT_ERROR_IF(
+        createTetherDrain_(self, STDOUT_FILENO));
+
     {
         struct Ert_ThreadSigMask  threadSigMask_;
         struct Ert_ThreadSigMask *threadSigMask =
@@ -670,14 +995,27 @@ Ert_Finally:
 
 /* -------------------------------------------------------------------------- */
 int
-pingTetherThread(struct TetherThread *self)
+flushTetherThread(struct TetherThread *self, enum TetherThreadFlush aFlush)
 {
     int rc = -1;
 
-    ert_debug(0, "ping tether thread");
+    ert_debug(0, "flushing tether thread %d", aFlush);
+
+    /* This code will race the tether thread which might finished
+     * because it already has detected that the child process has
+     * terminated and closed its file descriptors. */
+
+    char buf[1] = { aFlush };
 
+    ssize_t wrlen;
     ERT_ERROR_IF(
-        ert_killThread(self->mThread, SIGALRM));
+        (wrlen = ert_writeFile(self->mControlPipe->mWrFile,
+                               buf, sizeof(buf), 0),
+         -1 == wrlen
+         ? EPIPE != errno
+         : (errno = 0, sizeof(buf) != wrlen)));
+
+    self->mFlushed = true;
 
     rc = 0;
 
@@ -690,36 +1028,59 @@ Ert_Finally:
 
 /* -------------------------------------------------------------------------- */
 int
-flushTetherThread(struct TetherThread *self)
+attachTetherThread(struct TetherThread *self, int aFd)
 {
     int rc = -1;
 
-    ert_debug(0, "flushing tether thread");
+    pthread_mutex_t *lock = 0;
 
-    ERT_ERROR_IF(
-        ert_watchProcessClock(Ert_WatchProcessMethodNil(), Ert_ZeroDuration));
+    /* Subscribers are only opened and closed here in the main thread
+     * because files must not be opened or closed in the tether thread.
+     * Reclaim the slots of subscribers that the tether thread has
+     * discarded before looking for a free slot. */
 
-    /* This code will race the tether thread which might finished
-     * because it already has detected that the child process has
-     * terminated and closed its file descriptors. */
+    lock = ert_lockMutex(self->mSubscribers.mMutex);
 
-    char buf[1] = { 0 };
+    int slot = -1;
+
+    for (unsigned ix = 0; ix < TETHER_SUBSCRIBERS; ++ix)
+    {
+        if (self->mSubscribers.mBroken[ix])
+        {
+            ERT_ERROR_IF(
+                ert_closeFd(self->mSubscribers.mFd[ix]));
+
+            self->mSubscribers.mFd[ix]     = -1;
+            self->mSubscribers.mBroken[ix] = false;
+        }
+
+        if (-1 == slot && -1 == self->mSubscribers.mFd[ix])
+            slot = ix;
+    }
 
-    ssize_t wrlen;
     ERT_ERROR_IF(
-        (wrlen = ert_writeFile(self->mControlPipe->mWrFile,
-                               buf, sizeof(buf), 0),
-         -1 == wrlen
-         ? EPIPE != errno
-         : (errno = 0, sizeof(buf) != wrlen)));
+        -1 == slot,
+        {
+            errno = EBUSY;
+        });
 
-    self->mFlushed = true;
+    /* The subscriber must never block the tether thread. */
+
+    ERT_ERROR_IF(
+        ert_nonBlockingFd(aFd, O_NONBLOCK));
+
+    self->mSubscribers.mFd[slot] = aFd;
+
+    ert_debug(0, "attached tether subscriber fd %d", aFd);
 
     rc = 0;
 
 Ert_Finally:
 
-    ERT_FINALLY({});
+    ERT_FINALLY
+    ({
+        lock = ert_unlockMutex(lock);
+    });
 
     return rc;
 }
@@ -750,9 +1111,6 @@ closeTetherThread(struct TetherThread *self)
 
         self->mThread = ert_closeThread(self->mThread);
 
-        ERT_ABORT_IF(
-            ert_unwatchProcessClock());
-
         closeTetherThread_(self);
     }
 
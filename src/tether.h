@@ -34,8 +34,20 @@
 #include "ert/timekeeping.h"
 #include "ert/thread.h"
 
+#include <stdbool.h>
+
 ERT_BEGIN_C_SCOPE;
 
+struct SentryStatus;
+
+/* -------------------------------------------------------------------------- */
+/* A client attached to the pid server receives a copy of the tether on a
+ * pipe. The umbilical sends the writing end of the pipe to the sentry with
+ * TETHER_ATTACH_MESSAGE on the umbilical connection. */
+
+#define TETHER_ATTACH_MESSAGE '+'
+#define TETHER_SUBSCRIBERS    8
+
 /* -------------------------------------------------------------------------- */
 enum TetherThreadState
 {
@@ -44,6 +56,19 @@ enum TetherThreadState
     TETHER_THREAD_STOPPING,
 };
 
+enum TetherThreadFlush
+{
+    TetherThreadFlushStopping,
+    TetherThreadFlushTerminated,
+};
+
+enum TetherDrainMode
+{
+    TetherDrainPolled,
+    TetherDrainNonBlocking,
+    TetherDrainSocket,
+};
+
 struct TetherThread
 {
     struct Ert_Pipe  mControlPipe_;
@@ -52,8 +77,16 @@ struct TetherThread
     struct Ert_Thread  mThread_;
     struct Ert_Thread *mThread;
 
-    struct Ert_Pipe *mNullPipe;
-    bool             mFlushed;
+    struct Ert_Pipe     *mNullPipe;
+    struct SentryStatus *mStatus;
+    bool                 mFlushed;
+
+    struct {
+        int                  mFd;
+        enum TetherDrainMode mMode;
+        size_t               mBytes;
+        const char          *mReason;
+    } mDrain;
 
     struct {
         pthread_mutex_t            mMutex_;
@@ -61,6 +94,13 @@ struct TetherThread
         struct Ert_EventClockTime  mSince;
     } mActivity;
 
+    struct {
+        pthread_mutex_t  mMutex_;
+        pthread_mutex_t *mMutex;
+        int              mFd[TETHER_SUBSCRIBERS];       /* Or -1 if unused */
+        bool             mBroken[TETHER_SUBSCRIBERS];   /* Reader has gone */
+    } mSubscribers;
+
     struct {
         pthread_mutex_t        mMutex_;
         pthread_mutex_t       *mMutex;
@@ -72,13 +112,15 @@ struct TetherThread
 
 /* -------------------------------------------------------------------------- */
 ERT_CHECKED int
-createTetherThread(struct TetherThread *self, struct Ert_Pipe *aNullPipe);
+createTetherThread(struct TetherThread *self,
+                   struct Ert_Pipe     *aNullPipe,
+                   struct SentryStatus *aStatus);
 
 ERT_CHECKED int
-pingTetherThread(struct TetherThread *self);
+flushTetherThread(struct TetherThread *self, enum TetherThreadFlush aFlush);
 
 ERT_CHECKED int
-flushTetherThread(struct TetherThread *self);
+attachTetherThread(struct TetherThread *self, int aFd);
 
 struct TetherThread *
 closeTetherThread(struct TetherThread *self);
@@ -28,16 +28,24 @@
 */
 
 #include "umbilical.h"
+#include "umbilicalmonitor.h"
+#include "umbilicalbeat.h"
+#include "sentrystatus.h"
 #include "childprocess.h"
 #include "pidserver.h"
 
 #include "options_.h"
 
 #include "ert/socketpair.h"
+#include "ert/unixsocket.h"
 #include "ert/process.h"
 #include "ert/fdset.h"
+#include "ert/env.h"
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 #include <unistd.h>
 #include <fcntl.h>
 
@@ -49,504 +57,19 @@
  * process terminates, or if the umbilical process terminates. Additionally
  * the umbilical process monitors the umbilical for periodic messages
  * sent by the sentry, and echoes the messages back to the sentry.
+ *
+ * Rather than continuing to run the full image of the sentry, the
+ * umbilical process replaces itself with a small dedicated program
+ * that contains only the umbilical monitor and the PidServer. This
+ * avoids holding on to the heap, library state and copy-on-write pages
+ * of the sentry for the lifetime of each umbilical process.
+ *
+ * Alternatively the sentry can register with a long-lived umbilical
+ * daemon, passing its end of the umbilical connection, its PidServer
+ * socket and its status region, so that a single process serves all
+ * the sentries on the host.
  */
 
-static const char *pollFdNames_[POLL_FD_MONITOR_KINDS] =
-{
-    [POLL_FD_MONITOR_UMBILICAL] = "umbilical",
-    [POLL_FD_MONITOR_PIDSERVER] = "pidserver",
-    [POLL_FD_MONITOR_PIDCLIENT] = "pidclient",
-    [POLL_FD_MONITOR_EVENTPIPE] = "event pipe",
-};
-
-static const char *pollFdTimerNames_[POLL_FD_MONITOR_TIMER_KINDS] =
-{
-    [POLL_FD_MONITOR_TIMER_UMBILICAL] = "umbilical",
-};
-
-/* -------------------------------------------------------------------------- */
-static ERT_CHECKED int
-pollFdPidServer_(struct UmbilicalMonitor         *self,
-                 const struct Ert_EventClockTime *aPollTime)
-{
-    int rc = -1;
-
-    ERT_ERROR_IF(
-        acceptPidServerConnection(self->mPidServer));
-
-    struct pollfd *pollFd = &self->mPoll.mFds[POLL_FD_MONITOR_PIDCLIENT];
-
-    if ( ! pollFd->events)
-    {
-        pollFd->fd     = self->mPidServer->mEventQueue->mFile->mFd;
-        pollFd->events = ERT_POLL_INPUTEVENTS;
-    }
-
-    rc = 0;
-
-Ert_Finally:
-
-    ERT_FINALLY({});
-
-    return rc;
-}
-
-/* -------------------------------------------------------------------------- */
-static ERT_CHECKED int
-pollFdPidClient_(struct UmbilicalMonitor         *self,
-                 const struct Ert_EventClockTime *aPollTime)
-{
-    int rc = -1;
-
-    if (cleanPidServer(self->mPidServer))
-    {
-        struct pollfd *pollFd = &self->mPoll.mFds[POLL_FD_MONITOR_PIDCLIENT];
-
-        pollFd->fd     = -1;
-        pollFd->events = 0;
-    }
-
-    rc = 0;
-
-Ert_Finally:
-
-    ERT_FINALLY({});
-
-    return rc;
-}
-
-/* -------------------------------------------------------------------------- */
-static void
-closeFdUmbilical_(struct UmbilicalMonitor *self)
-{
-    ERT_ABORT_IF(
-        shutdown(
-            self->mPoll.mFds[POLL_FD_MONITOR_UMBILICAL].fd,
-            SHUT_WR));
-
-    self->mPoll.mFds[POLL_FD_MONITOR_UMBILICAL].fd     = -1;
-    self->mPoll.mFds[POLL_FD_MONITOR_UMBILICAL].events = 0;
-
-    self->mPoll.mFds[POLL_FD_MONITOR_PIDSERVER].fd     = -1;
-    self->mPoll.mFds[POLL_FD_MONITOR_PIDSERVER].events = 0;
-
-    /* Since the umbilical connection is no longer being monitored, there
-     * is no reason to run its associated timer. */
-
-    self->mPoll.mFdTimerActions[POLL_FD_MONITOR_TIMER_UMBILICAL].mPeriod =
-        Ert_ZeroDuration;
-}
-
-static ERT_CHECKED int
-pollFdUmbilical_(struct UmbilicalMonitor         *self,
-                 const struct Ert_EventClockTime *aPollTime)
-{
-    int rc = -1;
-
-    char buf[1];
-
-    ssize_t rdlen;
-    ERT_ERROR_IF(
-        (rdlen = read(
-            self->mPoll.mFds[POLL_FD_MONITOR_UMBILICAL].fd, buf, sizeof(buf)),
-         -1 == rdlen
-         ? EINTR != errno && ECONNRESET != errno
-         : (errno = 0, rdlen && sizeof(buf) != rdlen)));
-
-    /* If the far end did not read the previous echo, and simply closed its
-     * end of the connection (likely because it detected the child
-     * process terminated), then the read will return ECONNRESET. This
-     * is equivalent to encountering the end of file. */
-
-    if ( ! rdlen)
-    {
-        errno = ECONNRESET;
-        rdlen = -1;
-    }
-
-    if (-1 == rdlen)
-    {
-        if (ECONNRESET == errno)
-        {
-            if (self->mUmbilical.mClosed)
-                ert_debug(0, "umbilical connection closed");
-            else
-                ert_warn(0, "Umbilical connection broken");
-
-            closeFdUmbilical_(self);
-        }
-    }
-    else
-    {
-        ert_debug(1, "received umbilical connection ping %zd", rdlen);
-
-        ert_ensure( ! self->mUmbilical.mClosed);
-
-        if ( ! buf[0])
-        {
-            ert_debug(1, "umbilical connection close request");
-
-            self->mUmbilical.mClosed = true;
-        }
-        else
-        {
-            ert_debug(1, "umbilical connection echo request");
-
-            /* Requests for echoes are posted so that they can
-             * be retried on EINTR. */
-
-            ERT_ERROR_IF(
-                Ert_EventLatchSettingError == ert_setEventLatch(
-                    self->mLatch.mEchoRequest));
-        }
-
-        /* Once activity is detected on the umbilical, reset the
-         * umbilical timer, but configure the timer so that it is
-         * out-of-phase with the expected activity on the umbilical
-         * to avoid having to deal with races when there is a tight
-         * finish. */
-
-        struct Ert_PollFdTimerAction *umbilicalTimer =
-            &self->mPoll.mFdTimerActions[POLL_FD_MONITOR_TIMER_UMBILICAL];
-
-        ert_lapTimeTrigger(&umbilicalTimer->mSince,
-                           umbilicalTimer->mPeriod, aPollTime);
-
-        ert_lapTimeDelay(
-            &umbilicalTimer->mSince,
-            Ert_Duration(
-                Ert_NanoSeconds(umbilicalTimer->mPeriod.duration.ns / 2)));
-
-        self->mUmbilical.mCycleCount = 0;
-    }
-
-    rc = 0;
-
-Ert_Finally:
-
-    ERT_FINALLY({});
-
-    return rc;
-}
-
-static ERT_CHECKED int
-pollFdTimerUmbilical_(
-    struct UmbilicalMonitor         *self,
-    const struct Ert_EventClockTime *aPollTime)
-{
-    int rc = -1;
-
-    /* If nothing is available from the umbilical connection after the
-     * timeout period expires, then assume that the sentry itself
-     * is stuck. */
-
-    struct Ert_ProcessState parentState =
-        ert_fetchProcessState(self->mUmbilical.mParentPid);
-
-    if (Ert_ProcessStateStopped == parentState.mState)
-    {
-        ert_debug(
-            0,
-            "umbilical timeout deferred due to "
-            "parent status %" PRIs_Ert_ProcessState,
-            FMTs_Ert_ProcessState(parentState));
-        self->mUmbilical.mCycleCount = 0;
-    }
-    else if (++self->mUmbilical.mCycleCount >= self->mUmbilical.mCycleLimit)
-    {
-        ert_warn(0, "Umbilical connection timed out");
-
-        closeFdUmbilical_(self);
-    }
-
-    rc = 0;
-
-Ert_Finally:
-
-    ERT_FINALLY({});
-
-    return rc;
-}
-
-/* -------------------------------------------------------------------------- */
-static int
-pollFdSendEcho_(struct UmbilicalMonitor         *self,
-                bool                             aEnabled,
-                const struct Ert_EventClockTime *aPollTime)
-{
-    int rc = -1;
-
-    ert_ensure(aEnabled);
-
-    /* The umbilical connection might have been closed by the time
-     * this code runs. */
-
-    if (-1 == self->mPoll.mFds[POLL_FD_MONITOR_UMBILICAL].fd)
-        ert_debug(0, "skipping umbilical echo");
-    else
-    {
-        /* Receiving EPIPE means that the umbilical connection
-         * has been closed. Rely on the umbilical connection
-         * reader to reactivate and detect the closed connection. */
-
-        char buf[1] = { '.' };
-
-        ssize_t wrlen;
-        ERT_ERROR_IF(
-            (wrlen = ert_writeFd(
-                self->mPoll.mFds[POLL_FD_MONITOR_UMBILICAL].fd,
-                buf, sizeof(buf), 0),
-             -1 == wrlen
-             ? EPIPE != errno
-             : (errno = 0, sizeof(buf) != wrlen)));
-
-        ert_debug(0, "sent umbilical echo");
-    }
-
-    rc = 0;
-
-Ert_Finally:
-
-    ERT_FINALLY({});
-
-    return rc;
-}
-
-/* -------------------------------------------------------------------------- */
-static ERT_CHECKED int
-pollFdEventPipe_(struct UmbilicalMonitor         *self,
-                 const struct Ert_EventClockTime *aPollTime)
-{
-    int rc = -1;
-
-    /* Actively test races by occasionally delaying this activity
-     * when in test mode. */
-
-    if ( ! ert_testSleep(Ert_TestLevelRace))
-    {
-        ert_debug(0, "checking event pipe");
-
-        ERT_ERROR_IF(
-            -1 == ert_pollEventPipe(
-                self->mEventPipe, aPollTime) && EINTR != errno);
-    }
-
-    rc = 0;
-
-Ert_Finally:
-
-    ERT_FINALLY({});
-
-    return rc;
-}
-
-/* -------------------------------------------------------------------------- */
-static bool
-pollFdCompletion_(struct UmbilicalMonitor *self)
-{
-    /* The umbilical event loop terminates when the connection to the
-     * sentry is closed, and when there are no more outstanding
-     * child process group references. */
-
-    return
-        ! self->mPoll.mFds[POLL_FD_MONITOR_UMBILICAL].events &&
-        ! self->mPoll.mFds[POLL_FD_MONITOR_PIDSERVER].events &&
-        ! self->mPoll.mFds[POLL_FD_MONITOR_PIDCLIENT].events;
-}
-
-/* -------------------------------------------------------------------------- */
-int
-createUmbilicalMonitor(
-    struct UmbilicalMonitor *self,
-    int                      aStdinFd,
-    struct Ert_Pid           aParentPid,
-    struct PidServer        *aPidServer)
-{
-    int rc = -1;
-
-    unsigned cycleLimit = 2;
-
-    self->mPidServer = aPidServer;
-    self->mEventPipe = 0;
-
-    ERT_ERROR_IF(
-        ert_createEventLatch(&self->mLatch.mEchoRequest_, "echo request"));
-    self->mLatch.mEchoRequest = &self->mLatch.mEchoRequest_;
-
-    ERT_ERROR_IF(
-        ert_createEventPipe(&self->mEventPipe_, O_CLOEXEC | O_NONBLOCK));
-    self->mEventPipe = &self->mEventPipe_;
-
-    ERT_ERROR_IF(
-        Ert_EventLatchSettingError == ert_bindEventLatchPipe(
-            self->mLatch.mEchoRequest, self->mEventPipe,
-            Ert_EventLatchMethod(
-                self, pollFdSendEcho_)));
-
-    self->mUmbilical = (ERT_DECLTYPE(self->mUmbilical))
-    {
-        .mCycleLimit = cycleLimit,
-        .mParentPid  = aParentPid,
-        .mClosed     = false,
-    };
-
-    self->mPoll = (ERT_DECLTYPE(self->mPoll))
-    {
-        .mFds =
-        {
-            [POLL_FD_MONITOR_UMBILICAL] =
-            {
-                .fd     = aStdinFd,
-                .events = ERT_POLL_INPUTEVENTS
-            },
-
-            [POLL_FD_MONITOR_PIDSERVER] =
-            {
-                .fd     = aPidServer
-                          ? aPidServer->mUnixSocket->mSocket->mFile->mFd : -1,
-                .events = aPidServer
-                          ? ERT_POLL_INPUTEVENTS : 0,
-            },
-
-            [POLL_FD_MONITOR_PIDCLIENT] =
-            {
-                .fd     = -1,
-                .events = 0,
-            },
-
-            [POLL_FD_MONITOR_EVENTPIPE] =
-            {
-                .fd     = self->mEventPipe->mPipe->mRdFile->mFd,
-                .events = ERT_POLL_INPUTEVENTS,
-            },
-        },
-
-        .mFdActions =
-        {
-            [POLL_FD_MONITOR_UMBILICAL] = {
-                Ert_PollFdCallbackMethod(self, pollFdUmbilical_) },
-            [POLL_FD_MONITOR_PIDSERVER] = {
-                Ert_PollFdCallbackMethod(self, pollFdPidServer_) },
-            [POLL_FD_MONITOR_PIDCLIENT] = {
-                Ert_PollFdCallbackMethod(self, pollFdPidClient_) },
-            [POLL_FD_MONITOR_EVENTPIPE] = {
-                Ert_PollFdCallbackMethod(self, pollFdEventPipe_) },
-        },
-
-        .mFdTimerActions =
-        {
-            [POLL_FD_MONITOR_TIMER_UMBILICAL] =
-            {
-                .mAction = Ert_PollFdCallbackMethod(
-                    self, pollFdTimerUmbilical_),
-                .mSince  = ERT_EVENTCLOCKTIME_INIT,
-                .mPeriod = Ert_Duration(
-                    Ert_NanoSeconds(
-                      ERT_NSECS(
-                        Ert_Seconds(gOptions.mServer.mTimeout.mUmbilical_s)).ns
-                      / cycleLimit)),
-            },
-        },
-    };
-
-    rc = 0;
-
-Ert_Finally:
-
-    ERT_FINALLY
-    ({
-        if (rc)
-            self = closeUmbilicalMonitor(self);
-    });
-
-    return rc;
-}
-
-/* -------------------------------------------------------------------------- */
-struct UmbilicalMonitor *
-closeUmbilicalMonitor(struct UmbilicalMonitor *self)
-{
-    if (self)
-    {
-        ERT_ABORT_IF(
-            Ert_EventLatchSettingError == ert_unbindEventLatchPipe(
-                self->mLatch.mEchoRequest));
-
-        self->mEventPipe          = ert_closeEventPipe(self->mEventPipe);
-        self->mLatch.mEchoRequest = ert_closeEventLatch(
-            self->mLatch.mEchoRequest);
-    }
-
-    return 0;
-}
-
-/* -------------------------------------------------------------------------- */
-int
-synchroniseUmbilicalMonitor(struct UmbilicalMonitor *self)
-{
-    int rc = -1;
-
-    /* Use a blocking read to wait for the sentry to signal that the
-     * umbilical monitor should proceed. */
-
-    ERT_ERROR_IF(
-        -1 == ert_waitFdReadReady(
-            self->mPoll.mFds[POLL_FD_MONITOR_UMBILICAL].fd, 0));
-
-    ERT_ERROR_IF(
-        pollFdUmbilical_(self, 0));
-
-    rc = 0;
-
-Ert_Finally:
-
-    ERT_FINALLY({});
-
-    return rc;
-}
-
-/* -------------------------------------------------------------------------- */
-int
-runUmbilicalMonitor(struct UmbilicalMonitor *self)
-{
-    int rc = -1;
-
-    struct Ert_PollFd  pollfd_;
-    struct Ert_PollFd *pollfd = 0;
-
-    ERT_ERROR_IF(
-        ert_createPollFd(
-            &pollfd_,
-            self->mPoll.mFds,
-            self->mPoll.mFdActions,
-            pollFdNames_, POLL_FD_MONITOR_KINDS,
-            self->mPoll.mFdTimerActions,
-            pollFdTimerNames_, POLL_FD_MONITOR_TIMER_KINDS,
-            Ert_PollFdCompletionMethod(self, pollFdCompletion_)));
-    pollfd = &pollfd_;
-
-    ERT_ERROR_IF(
-        ert_runPollFdLoop(pollfd));
-
-    rc = 0;
-
-Ert_Finally:
-
-    ERT_FINALLY
-    ({
-        pollfd = ert_closePollFd(pollfd);
-    });
-
-    return rc;
-}
-
-/* -------------------------------------------------------------------------- */
-bool
-ownUmbilicalMonitorClosedOrderly(const struct UmbilicalMonitor *self)
-{
-    return self->mUmbilical.mClosed;
-}
-
 /* -------------------------------------------------------------------------- */
 static ERT_CHECKED int
 prepareUmbilicalProcess_(struct UmbilicalProcess         *self,
@@ -564,6 +87,18 @@ prepareUmbilicalProcess_(struct UmbilicalProcess         *self,
             aPreFork->mWhitelistFds,
             self->mSocket->mChildSocket->mSocket->mFile));
 
+    if (self->mBeat)
+        ERT_ERROR_IF(
+            ert_insertFdSetFile(
+                aPreFork->mWhitelistFds,
+                self->mBeat->mFile));
+
+    if (self->mStatus)
+        ERT_ERROR_IF(
+            ert_insertFdSetFile(
+                aPreFork->mWhitelistFds,
+                self->mStatus->mFile));
+
     if (self->mPidServer)
     {
         ERT_ERROR_IF(
@@ -575,6 +110,17 @@ prepareUmbilicalProcess_(struct UmbilicalProcess         *self,
             ert_insertFdSetFile(
                 aPreFork->mWhitelistFds,
                 self->mPidServer->mEventQueue->mFile));
+
+        ERT_ERROR_IF(
+            ert_insertFdSetFile(
+                aPreFork->mWhitelistFds,
+                self->mPidServer->mTimerFile));
+
+        if (self->mPidServer->mPidFdFile)
+            ERT_ERROR_IF(
+                ert_insertFdSetFile(
+                    aPreFork->mWhitelistFds,
+                    self->mPidServer->mPidFdFile));
     }
 
     rc = 0;
@@ -682,75 +228,155 @@ Ert_Finally:
 
 /* -------------------------------------------------------------------------- */
 static ERT_CHECKED int
-runUmbilicalProcessChild_(struct UmbilicalProcess *self)
+execUmbilicalProcess_(struct UmbilicalProcess *self)
 {
     int rc = -1;
 
-    struct UmbilicalMonitor  umbilicalMonitor_;
-    struct UmbilicalMonitor *umbilicalMonitor = 0;
+    /* The dedicated umbilical program is installed alongside the
+     * program of the sentry. */
 
-    if (ert_testMode(Ert_TestLevelSync))
+    char exePath[PATH_MAX];
+
+    ssize_t exeLen;
+    ERT_ERROR_IF(
+        (exeLen = readlink("/proc/self/exe", exePath, sizeof(exePath)),
+         -1 == exeLen || (errno = ENAMETOOLONG, sizeof(exePath) == exeLen)));
+    exePath[exeLen] = 0;
+
+    char *exeName = strrchr(exePath, '/');
+    ERT_ERROR_UNLESS(
+        exeName,
+        {
+            errno = ENOENT;
+        });
+    ++exeName;
+
+    ERT_ERROR_IF(
+        sizeof(PIDUMBILICAL_PROGRAM) > sizeof(exePath) - (exeName - exePath),
+        {
+            errno = ENAMETOOLONG;
+        });
+    strcpy(exeName, PIDUMBILICAL_PROGRAM);
+
+    /* The umbilical connection is already available on stdin and
+     * stdout. Describe the remaining state by passing the numbers
+     * of the inherited file descriptors, and the process identifiers,
+     * in the environment. */
+
+    int pidServerFd = -1;
+    int pidFd       = -1;
+
+    if (self->mPidServer)
     {
+        pidServerFd = self->mPidServer->mUnixSocket->mSocket->mFile->mFd;
+
         ERT_ERROR_IF(
-            raise(SIGSTOP));
+            ert_closeFdOnExec(pidServerFd, 0));
+
+        if (self->mPidServer->mPidFdFile)
+        {
+            pidFd = self->mPidServer->mPidFdFile->mFd;
+
+            ERT_ERROR_IF(
+                ert_closeFdOnExec(pidFd, 0));
+        }
     }
 
-    /* The umbilical process is not the parent of the child process being
-     * watched, so that there is no reliable way to send a signal to that
-     * process alone because the pid might be recycled by the time the signal
-     * is sent. Instead rely on the umbilical monitor being in the same
-     * process group as the child process and use the process group as
-     * a means of controlling the cild process. */
+    int beatFd = -1;
 
-    ERT_ERROR_IF(
-        createUmbilicalMonitor(
-            &umbilicalMonitor_,
-            STDIN_FILENO, self->mSentryPid, self->mPidServer));
-    umbilicalMonitor = &umbilicalMonitor_;
+    if (self->mBeat)
+    {
+        beatFd = self->mBeat->mFile->mFd;
 
-    /* Synchronise with the sentry to avoid timing races. The sentry
-     * writes to the umbilical when it is ready to start timing. */
+        ERT_ERROR_IF(
+            ert_closeFdOnExec(beatFd, 0));
+    }
 
-    ert_debug(0, "synchronising umbilical");
+    int statusFd = -1;
 
-    ERT_ERROR_IF(
-        synchroniseUmbilicalMonitor(umbilicalMonitor));
+    if (self->mStatus)
+    {
+        statusFd = self->mStatus->mFile->mFd;
 
-    ert_debug(0, "synchronised umbilical");
+        ERT_ERROR_IF(
+            ert_closeFdOnExec(statusFd, 0));
+    }
 
+    struct UmbilicalArgs umbilicalArgs =
+    {
+        .mSentryPid   = self->mSentryPid,
+        .mSentryPgid  = self->mSentryPgid,
+        .mChildPid    = self->mChildProcess->mPid,
+        .mChildPgid   = self->mChildProcess->mPgid,
+        .mPidServerFd = pidServerFd,
+        .mPidFd       = pidFd,
+        .mBeatFd      = beatFd,
+        .mStatusFd    = statusFd,
+        .mTimeout_s   = gOptions.mServer.mTimeout.mUmbilical_s,
+        .mSuspicion   = gOptions.mServer.mSuspicion,
+        .mReferences  = gOptions.mServer.mReferences,
+        .mLease_s     = gOptions.mServer.mLease_s,
+        .mDebug       = gOptions.mOptions.mDebug,
+        .mTest        = gOptions.mOptions.mTest,
+    };
+
+    char umbilicalEnv[256];
     ERT_ERROR_IF(
-        runUmbilicalMonitor(umbilicalMonitor));
+        formatUmbilicalArgs(
+            &umbilicalArgs, umbilicalEnv, sizeof(umbilicalEnv)));
+
+    ERT_ERROR_UNLESS(
+        ert_setEnvString(PIDUMBILICAL_ENV, umbilicalEnv));
 
-    /* The umbilical monitor returns when the connection to the sentry
-     * is either lost or no longer active. Only issue a diagnostic if
-     * the shutdown was not orderly. */
+    ert_debug(0, "exec %s %s=%s", exePath, PIDUMBILICAL_ENV, umbilicalEnv);
 
-    if ( ! ownUmbilicalMonitorClosedOrderly(umbilicalMonitor))
-        ert_warn(
-            0,
-            "Killing child pgid %" PRId_Ert_Pgid " from umbilical",
-            FMTd_Ert_Pgid(self->mChildProcess->mPgid));
+    const char * const argv[] = { PIDUMBILICAL_PROGRAM, 0 };
 
     ERT_ERROR_IF(
-        killChildProcessGroup(self->mChildProcess));
+        (ert_execProcess(exePath, argv), true));
 
-    /* If the shutdown was not orderly, assume the worst and attempt to
-     * clean up the sentry process group. */
+    rc = 0;
 
-    if ( ! ownUmbilicalMonitorClosedOrderly(umbilicalMonitor))
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+runUmbilicalProcessChild_(struct UmbilicalProcess *self)
+{
+    int rc = -1;
+
+    if (ert_testMode(Ert_TestLevelSync))
+    {
         ERT_ERROR_IF(
-            ert_signalProcessGroup(self->mSentryPgid, SIGKILL));
+            raise(SIGSTOP));
+    }
+
+    /* Only if the dedicated umbilical program cannot be run, for example
+     * when running from a build tree using an explicit program
+     * interpreter, continue to run the umbilical monitor in the
+     * image of the sentry. */
 
-    ert_debug(0, "exit umbilical");
+    if (execUmbilicalProcess_(self))
+        ert_debug(0, "unable to exec umbilical program errno %d", errno);
+
+    ERT_ERROR_IF(
+        superviseUmbilicalMonitor(
+            self->mSentryPid,
+            self->mSentryPgid,
+            self->mChildProcess->mPgid,
+            self->mPidServer,
+            self->mBeat));
 
     rc = EXIT_SUCCESS;
 
 Ert_Finally:
 
-    ERT_FINALLY
-    ({
-        umbilicalMonitor = closeUmbilicalMonitor(umbilicalMonitor);
-    });
+    ERT_FINALLY({});
 
     return rc;
 }
@@ -760,7 +386,9 @@ int
 createUmbilicalProcess(struct UmbilicalProcess *self,
                        struct ChildProcess     *aChildProcess,
                        struct Ert_SocketPair   *aUmbilicalSocket,
-                       struct PidServer        *aPidServer)
+                       struct PidServer        *aPidServer,
+                       struct UmbilicalBeat    *aBeat,
+                       struct SentryStatus     *aStatus)
 {
     int rc = -1;
 
@@ -775,6 +403,8 @@ createUmbilicalProcess(struct UmbilicalProcess *self,
     self->mChildProcess = aChildProcess;
     self->mSocket       = aUmbilicalSocket;
     self->mPidServer    = aPidServer;
+    self->mBeat         = aBeat;
+    self->mStatus       = aStatus;
 
     /* Ensure that SIGHUP is blocked so that the umbilical process
      * will not terminate should it be orphaned when the parent process
@@ -837,6 +467,152 @@ Ert_Finally:
     return rc;
 }
 
+/* -------------------------------------------------------------------------- */
+int
+registerUmbilicalProcess(struct UmbilicalProcess *self,
+                         struct ChildProcess     *aChildProcess,
+                         struct Ert_SocketPair   *aUmbilicalSocket,
+                         struct PidServer        *aPidServer,
+                         struct SentryStatus     *aStatus,
+                         const char              *aDaemonName)
+{
+    int rc = -1;
+
+    struct Ert_UnixSocket  daemonSocket_;
+    struct Ert_UnixSocket *daemonSocket = 0;
+
+    self->mPid          = Ert_Pid(0);
+    self->mChildAnchor  = Ert_Pid(0);
+    self->mSentryAnchor = Ert_Pid(0);
+    self->mSentryPid    = ert_ownProcessId();
+    self->mSentryPgid   = ert_ownProcessGroupId();
+    self->mChildProcess = aChildProcess;
+    self->mSocket       = aUmbilicalSocket;
+    self->mPidServer    = aPidServer;
+    self->mBeat         = 0;
+    self->mStatus       = aStatus;
+
+    /* There is no umbilical process to create, so there is no process
+     * to anchor the process groups of the child and the sentry. The
+     * daemon kills the process groups by number should the sentry fail,
+     * but only while their leaders are those seen at registration. */
+
+    struct sockaddr_un daemonAddr;
+    ERT_ERROR_IF(
+        nameUmbilicalDaemon(&daemonAddr, aDaemonName));
+
+    struct Ert_Duration umbilicalTimeout =
+        Ert_Duration(
+            ERT_NSECS(Ert_Seconds(gOptions.mServer.mTimeout.mUmbilical_s)));
+
+    int err;
+    ERT_ERROR_IF(
+        (err = ert_connectUnixSocket(&daemonSocket_,
+                                     daemonAddr.sun_path,
+                                     sizeof(daemonAddr.sun_path)),
+         -1 == err && EINPROGRESS != errno));
+    daemonSocket = &daemonSocket_;
+
+    ERT_ERROR_IF(
+        (err = ert_waitUnixSocketWriteReady(daemonSocket, &umbilicalTimeout),
+         -1 == err || (errno = ETIMEDOUT, ! err)));
+
+    /* The registration is sent as a fixed size record, followed by
+     * the file descriptors of the umbilical connection, of the
+     * PidServer and its pidfd, and of the status of the sentry. */
+
+    struct UmbilicalArgs umbilicalArgs =
+    {
+        .mSentryPid   = self->mSentryPid,
+        .mSentryPgid  = self->mSentryPgid,
+        .mChildPid    = aChildProcess->mPid,
+        .mChildPgid   = aChildProcess->mPgid,
+        .mPidServerFd =
+            aPidServer ? aPidServer->mUnixSocket->mSocket->mFile->mFd : -1,
+        .mPidFd       =
+            aPidServer && aPidServer->mPidFdFile
+            ? aPidServer->mPidFdFile->mFd : -1,
+        .mBeatFd      = -1,
+        .mStatusFd    = aStatus ? aStatus->mFile->mFd : -1,
+        .mTimeout_s   = gOptions.mServer.mTimeout.mUmbilical_s,
+        .mSuspicion   = gOptions.mServer.mSuspicion,
+        .mReferences  = gOptions.mServer.mReferences,
+        .mLease_s     = gOptions.mServer.mLease_s,
+        .mDebug       = gOptions.mOptions.mDebug,
+        .mTest        = gOptions.mOptions.mTest,
+    };
+
+    char record[UMBILICAL_DAEMON_RECORD_SIZE] = { 0 };
+    ERT_ERROR_IF(
+        formatUmbilicalArgs(&umbilicalArgs, record, sizeof(record)));
+
+    ssize_t wrlen;
+    ERT_ERROR_IF(
+        (wrlen = ert_writeSocket(
+            daemonSocket->mSocket, record, sizeof(record), &umbilicalTimeout),
+         -1 == wrlen || (errno = EIO, sizeof(record) != wrlen)));
+
+    ERT_ERROR_IF(
+        ert_sendUnixSocketFd(
+            daemonSocket,
+            aUmbilicalSocket->mChildSocket->mSocket->mFile->mFd,
+            0));
+
+    if (aPidServer)
+    {
+        ERT_ERROR_IF(
+            ert_sendUnixSocketFd(
+                daemonSocket,
+                aPidServer->mUnixSocket->mSocket->mFile->mFd,
+                0));
+
+        if (aPidServer->mPidFdFile)
+            ERT_ERROR_IF(
+                ert_sendUnixSocketFd(
+                    daemonSocket,
+                    aPidServer->mPidFdFile->mFd,
+                    0));
+    }
+
+    if (aStatus)
+        ERT_ERROR_IF(
+            ert_sendUnixSocketFd(
+                daemonSocket,
+                aStatus->mFile->mFd,
+                0));
+
+    /* Wait for the daemon to acknowledge that it has taken over the
+     * umbilical connection before releasing the copy held here. */
+
+    int ready;
+    ERT_ERROR_IF(
+        (ready = ert_waitUnixSocketReadReady(daemonSocket, &umbilicalTimeout),
+         -1 == ready || (errno = ETIMEDOUT, ! ready)));
+
+    char buf[1];
+
+    ssize_t rdlen;
+    ERT_ERROR_IF(
+        (rdlen = ert_readSocket(
+            daemonSocket->mSocket, buf, sizeof(buf), &umbilicalTimeout),
+         -1 == rdlen || (errno = ECONNREFUSED, sizeof(buf) != rdlen)));
+
+    ert_debug(0, "registered with umbilical daemon %s", aDaemonName);
+
+    ert_closeSocketPairChild(self->mSocket);
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        daemonSocket = ert_closeUnixSocket(daemonSocket);
+    });
+
+    return rc;
+}
+
 /* -------------------------------------------------------------------------- */
 int
 stopUmbilicalProcess(struct UmbilicalProcess *self)
@@ -922,7 +698,10 @@ stopUmbilicalProcess(struct UmbilicalProcess *self)
                         continue;
                 }
 
-                umbilicalState = Stopping;
+                /* When registered with an umbilical daemon, there is
+                 * no umbilical process to wait upon. */
+
+                umbilicalState = self->mPid.mPid ? Stopping : Stopped;
             }
             else if (Stopping == umbilicalState)
             {
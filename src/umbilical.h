@@ -30,13 +30,7 @@
 #define UMBILICAL_H
 
 #include "ert/compiler.h"
-#include "ert/pollfd.h"
 #include "ert/pid.h"
-#include "ert/eventpipe.h"
-#include "ert/eventlatch.h"
-
-#include <poll.h>
-#include <stdbool.h>
 
 #include <sys/types.h>
 #include <sys/un.h>
@@ -48,6 +42,8 @@ struct Ert_SocketPair;
 struct PidFile;
 struct ChildProcess;
 struct PidServer;
+struct UmbilicalBeat;
+struct SentryStatus;
 
 /* -------------------------------------------------------------------------- */
 struct UmbilicalProcess
@@ -60,81 +56,26 @@ struct UmbilicalProcess
     struct ChildProcess   *mChildProcess;
     struct Ert_SocketPair *mSocket;
     struct PidServer      *mPidServer;
+    struct UmbilicalBeat  *mBeat;
+    struct SentryStatus   *mStatus;
 };
 
-/* -------------------------------------------------------------------------- */
-enum PollFdMonitorKind
-{
-    POLL_FD_MONITOR_UMBILICAL,
-    POLL_FD_MONITOR_PIDSERVER,
-    POLL_FD_MONITOR_PIDCLIENT,
-    POLL_FD_MONITOR_EVENTPIPE,
-    POLL_FD_MONITOR_KINDS
-};
-
-enum PollFdMonitorTimerKind
-{
-    POLL_FD_MONITOR_TIMER_UMBILICAL,
-    POLL_FD_MONITOR_TIMER_KINDS
-};
-
-struct UmbilicalMonitor
-{
-    struct
-    {
-        struct Ert_File *mFile;
-        unsigned         mCycleCount;
-        unsigned         mCycleLimit;
-        struct Ert_Pid   mParentPid;
-        bool             mClosed;
-    } mUmbilical;
-
-    struct PidServer *mPidServer;
-
-    struct
-    {
-        struct Ert_EventLatch  mEchoRequest_;
-        struct Ert_EventLatch *mEchoRequest;
-    } mLatch;
-
-    struct Ert_EventPipe  mEventPipe_;
-    struct Ert_EventPipe *mEventPipe;
-
-    struct
-    {
-        struct pollfd                mFds[POLL_FD_MONITOR_KINDS];
-        struct Ert_PollFdAction      mFdActions[POLL_FD_MONITOR_KINDS];
-        struct Ert_PollFdTimerAction mFdTimerActions[
-                                        POLL_FD_MONITOR_TIMER_KINDS];
-    } mPoll;
-};
-
-/* -------------------------------------------------------------------------- */
-ERT_CHECKED int
-createUmbilicalMonitor(
-    struct UmbilicalMonitor *self,
-    int                      aStdinFd,
-    struct Ert_Pid          aParentPid,
-    struct PidServer        *aPidServer);
-
-ERT_CHECKED struct UmbilicalMonitor *
-closeUmbilicalMonitor(struct UmbilicalMonitor *self);
-
-ERT_CHECKED int
-synchroniseUmbilicalMonitor(struct UmbilicalMonitor *self);
-
-ERT_CHECKED int
-runUmbilicalMonitor(struct UmbilicalMonitor *self);
-
-bool
-ownUmbilicalMonitorClosedOrderly(const struct UmbilicalMonitor *self);
-
 /* -------------------------------------------------------------------------- */
 ERT_CHECKED int
 createUmbilicalProcess(struct UmbilicalProcess *self,
                        struct ChildProcess     *aChildProcess,
                        struct Ert_SocketPair   *aUmbilicalSocket,
-                       struct PidServer        *aPidServer);
+                       struct PidServer        *aPidServer,
+                       struct UmbilicalBeat    *aBeat,
+                       struct SentryStatus     *aStatus);
+
+ERT_CHECKED int
+registerUmbilicalProcess(struct UmbilicalProcess *self,
+                         struct ChildProcess     *aChildProcess,
+                         struct Ert_SocketPair   *aUmbilicalSocket,
+                         struct PidServer        *aPidServer,
+                         struct SentryStatus     *aStatus,
+                         const char              *aDaemonName);
 
 ERT_CHECKED int
 stopUmbilicalProcess(struct UmbilicalProcess *self);
@@ -0,0 +1,228 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2016, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "umbilicalbeat.h"
+
+#include "ert/error.h"
+
+#include <fcntl.h>
+#include <inttypes.h>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/memfd.h>
+
+/* -------------------------------------------------------------------------- */
+/* Umbilical Heartbeat
+ *
+ * The sentry and the umbilical process normally demonstrate liveness
+ * to each other by exchanging pings over the umbilical connection,
+ * costing a write(2), a read(2) and a wakeup of the peer for each
+ * exchange. When both processes share a mapping created before
+ * the umbilical process is forked, each side can instead
+ * advance its own counter, and sample the counter of its peer on
+ * its own schedule. The umbilical connection is retained so that
+ * the termination of either process is still detected promptly. */
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+mapUmbilicalBeat_(struct UmbilicalBeat *self)
+{
+    int rc = -1;
+
+    void *region;
+    ERT_ERROR_IF(
+        (region = mmap(0, sizeof(*self->mRegion),
+                       PROT_READ | PROT_WRITE, MAP_SHARED,
+                       self->mFile->mFd, 0),
+         MAP_FAILED == region));
+    self->mRegion = region;
+
+    for (unsigned ix = 0; UmbilicalBeatSides > ix; ++ix)
+        self->mSample[ix] = 0;
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+createUmbilicalBeat(struct UmbilicalBeat *self)
+{
+    int rc = -1;
+
+    self->mFile   = 0;
+    self->mRegion = 0;
+
+    /* Back the region with a file rather than an anonymous mapping so
+     * that the region survives when the umbilical process replaces
+     * its program image. */
+
+    ERT_ERROR_IF(
+        ert_createFile(
+            &self->mFile_,
+            syscall(SYS_memfd_create,
+                    "pidsentry-umbilical", MFD_CLOEXEC | MFD_ALLOW_SEALING)));
+    self->mFile = &self->mFile_;
+
+    ERT_ERROR_IF(
+        ert_ftruncateFile(self->mFile, sizeof(*self->mRegion)));
+
+    /* Seal the size of the region before it is shared with the
+     * umbilical, so that neither process can cause the other to
+     * fault by truncating the file. */
+
+    ERT_ERROR_IF(
+        fcntl(self->mFile->mFd,
+              F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL));
+
+    ERT_ERROR_IF(
+        mapUmbilicalBeat_(self));
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (rc)
+            self = closeUmbilicalBeat(self);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+adoptUmbilicalBeat(struct UmbilicalBeat *self, int aFd)
+{
+    int rc = -1;
+
+    self->mFile   = 0;
+    self->mRegion = 0;
+
+    ERT_ERROR_IF(
+        ert_closeFdOnExec(aFd, O_CLOEXEC));
+
+    ERT_ERROR_IF(
+        ert_createFile(&self->mFile_, aFd));
+    self->mFile = &self->mFile_;
+
+    /* Only map a region whose size cannot change underneath the
+     * mapping. */
+
+    int seals;
+    ERT_ERROR_IF(
+        (seals = fcntl(self->mFile->mFd, F_GET_SEALS),
+         -1 == seals));
+
+    ERT_ERROR_UNLESS(
+        F_SEAL_SHRINK & seals,
+        {
+            errno = EPERM;
+        });
+
+    ERT_ERROR_IF(
+        mapUmbilicalBeat_(self));
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (rc)
+            self = closeUmbilicalBeat(self);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+struct UmbilicalBeat *
+closeUmbilicalBeat(struct UmbilicalBeat *self)
+{
+    if (self)
+    {
+        if (self->mRegion)
+            ERT_ABORT_IF(
+                munmap(self->mRegion, sizeof(*self->mRegion)));
+
+        self->mFile = ert_closeFile(self->mFile);
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+printUmbilicalBeat(const struct UmbilicalBeat *self, FILE *aFile)
+{
+    return fprintf(
+        aFile,
+        "<umbilicalbeat %p sentry %" PRIu64 " umbilical %" PRIu64 ">",
+        self,
+        self->mSample[UmbilicalBeatSentry],
+        self->mSample[UmbilicalBeatUmbilical]);
+}
+
+/* -------------------------------------------------------------------------- */
+void
+beatUmbilicalBeat(struct UmbilicalBeat *self, enum UmbilicalBeatSide aSide)
+{
+    ert_ensure(UmbilicalBeatSides > aSide);
+
+    __atomic_add_fetch(&self->mRegion->mBeat[aSide], 1, __ATOMIC_RELEASE);
+}
+
+/* -------------------------------------------------------------------------- */
+bool
+sampleUmbilicalBeat(struct UmbilicalBeat *self, enum UmbilicalBeatSide aSide)
+{
+    ert_ensure(UmbilicalBeatSides > aSide);
+
+    /* Report whether the counter of the specified side has advanced
+     * since the previous sample was taken. */
+
+    uint64_t beat = __atomic_load_n(
+        &self->mRegion->mBeat[aSide], __ATOMIC_ACQUIRE);
+
+    bool advanced = (beat != self->mSample[aSide]);
+
+    self->mSample[aSide] = beat;
+
+    return advanced;
+}
+
+/* -------------------------------------------------------------------------- */
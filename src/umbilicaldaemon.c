@@ -0,0 +1,1150 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2016, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "umbilicaldaemon.h"
+#include "pidsignature_.h"
+#include "wakeup.h"
+
+#include "ert/process.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+
+/* -------------------------------------------------------------------------- */
+/* Umbilical Daemon
+ *
+ * The umbilical daemon is a single long-lived process that takes the place
+ * of the umbilical process for each sentry that registers with it. Each
+ * sentry passes its end of the umbilical connection, and its pidserver
+ * socket, to the daemon which then services all of them from one
+ * event loop.
+ *
+ * The daemon is not in the same process group as any of the child
+ * processes it watches, but it can still kill those process groups
+ * when the corresponding sentry fails. It cannot anchor those process
+ * groups though, so the sentry must not rely on the umbilical process
+ * to keep its process group alive. Instead the daemon records the
+ * signature of the leader of each process group when the sentry
+ * registers, and declines to kill a process group whose number now
+ * belongs to a different leader.
+ */
+
+#define UMBILICAL_DAEMON_TICK_S     1
+#define UMBILICAL_DAEMON_REGISTER_S 5
+
+static const char *pollFdNames_[POLL_FD_DAEMON_KINDS] =
+{
+    [POLL_FD_DAEMON_SOCKET]     = "socket",
+    [POLL_FD_DAEMON_EVENTQUEUE] = "event queue",
+};
+
+static const char *pollFdTimerNames_[POLL_FD_DAEMON_TIMER_KINDS] =
+{
+    [POLL_FD_DAEMON_TIMER_UMBILICAL] = "umbilical",
+};
+
+/* -------------------------------------------------------------------------- */
+static struct UmbilicalDaemonSentry_ *
+closeUmbilicalDaemonSentry_(struct UmbilicalDaemonSentry_ *self)
+{
+    if (self)
+    {
+        ert_ensure( ! self->mList);
+
+        self->mClientEvent   = ert_closeFileEventQueueActivity(
+            self->mClientEvent);
+        self->mServerEvent   = ert_closeFileEventQueueActivity(
+            self->mServerEvent);
+        self->mRegisterEvent = ert_closeFileEventQueueActivity(
+            self->mRegisterEvent);
+        self->mEvent         = ert_closeFileEventQueueActivity(self->mEvent);
+
+        self->mPidServer      = closePidServer(self->mPidServer);
+        self->mStatus         = closeSentryStatus(self->mStatus);
+        self->mFile           = ert_closeFile(self->mFile);
+        self->mRegisterSocket = ert_closeUnixSocket(self->mRegisterSocket);
+
+        if (-1 != self->mPidServerFd)
+            close(self->mPidServerFd);
+        if (-1 != self->mPidFd)
+            close(self->mPidFd);
+
+        self->mChildLeader  = destroyPidSignature(self->mChildLeader);
+        self->mSentryLeader = destroyPidSignature(self->mSentryLeader);
+
+        free(self);
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+static void
+abandonUmbilicalDaemonSentry_(struct UmbilicalDaemonSentry_ *self)
+{
+    /* The sentry retains responsibility for its process groups until
+     * the daemon acknowledges the registration, so an abandoned
+     * registration kills nothing. Its resources are released when the
+     * daemon is next reaped. */
+
+    ert_ensure(UmbilicalDaemonRegistered_ != self->mRegistration);
+
+    self->mDisconnected = true;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+killUmbilicalDaemonProcessGroup_(struct Ert_Pgid            aPgid,
+                                 const struct PidSignature *aLeader)
+{
+    int rc = -1;
+
+    struct PidSignature *leader = 0;
+
+    /* A process group number cannot be reused while any member of the
+     * group remains, but once the group is empty the number can be
+     * taken by a new leader. Refuse to kill the process group if its
+     * leader is no longer the process seen at registration. */
+
+    if (aLeader)
+    {
+        ERT_ERROR_IF(
+            ! (leader = createPidSignature(Ert_Pid(aPgid.mPgid), 0)) &&
+            ENOENT != errno);
+
+        ERT_ERROR_IF(
+            leader && strcmp(leader->mSignature, aLeader->mSignature),
+            {
+                errno = ESRCH;
+            });
+    }
+
+    ERT_ERROR_IF(
+        ert_signalProcessGroup(aPgid, SIGKILL));
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        leader = destroyPidSignature(leader);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static void
+disconnectUmbilicalDaemonSentry_(struct UmbilicalDaemonSentry_ *self)
+{
+    /* Kill the child process group as the umbilical process would have
+     * done, and if the sentry did not close the connection in an
+     * orderly fashion, assume the worst and kill the sentry process
+     * group too. Failures are reported, but not propagated, so that
+     * the daemon continues to serve the other sentries. */
+
+    if (self->mDisconnected)
+        return;
+
+    self->mDisconnected = true;
+
+    if ( ! self->mClosed)
+        ert_warn(
+            0,
+            "Killing child pgid %" PRId_Ert_Pgid
+            " from umbilical daemon for sentry pid %" PRId_Ert_Pid,
+            FMTd_Ert_Pgid(self->mArgs.mChildPgid),
+            FMTd_Ert_Pid(self->mArgs.mSentryPid));
+
+    if (killUmbilicalDaemonProcessGroup_(
+            self->mArgs.mChildPgid, self->mChildLeader))
+        ert_warn(
+            errno,
+            "Unable to kill child pgid %" PRId_Ert_Pgid,
+            FMTd_Ert_Pgid(self->mArgs.mChildPgid));
+
+    if ( ! self->mClosed)
+    {
+        if (killUmbilicalDaemonProcessGroup_(
+                self->mArgs.mSentryPgid, self->mSentryLeader))
+            ert_warn(
+                errno,
+                "Unable to kill sentry pgid %" PRId_Ert_Pgid,
+                FMTd_Ert_Pgid(self->mArgs.mSentryPgid));
+    }
+
+    /* Clients waiting for the child process to exit are told now, and
+     * release their references so that the sentry can be reaped. */
+
+    if (self->mPidServer)
+        attachPidServerUmbilical(self->mPidServer, -1);
+
+    if (self->mPidServer && -1 == notifyPidServerExit(self->mPidServer))
+        ert_warn(
+            errno,
+            "Unable to notify pidserver clients for sentry pid %" PRId_Ert_Pid,
+            FMTd_Ert_Pid(self->mArgs.mSentryPid));
+}
+
+/* -------------------------------------------------------------------------- */
+static void
+reapUmbilicalDaemon_(struct UmbilicalDaemon *self)
+{
+    /* Resources are only released once the event queue has been
+     * drained, so that no pending event can refer to an activity
+     * that has already been closed. Sentries that still have
+     * outstanding pidserver clients are retained until the last
+     * of those clients disconnects. */
+
+    struct UmbilicalDaemonSentry_ *sentry = TAILQ_FIRST(&self->mSentries);
+
+    while (sentry)
+    {
+        struct UmbilicalDaemonSentry_ *next = TAILQ_NEXT(sentry, mList_);
+
+        if (sentry->mDisconnected)
+        {
+            sentry->mServerEvent    = ert_closeFileEventQueueActivity(
+                sentry->mServerEvent);
+            sentry->mRegisterEvent  = ert_closeFileEventQueueActivity(
+                sentry->mRegisterEvent);
+            sentry->mEvent          = ert_closeFileEventQueueActivity(
+                sentry->mEvent);
+            sentry->mFile           = ert_closeFile(sentry->mFile);
+            sentry->mRegisterSocket = ert_closeUnixSocket(
+                sentry->mRegisterSocket);
+
+            if ( ! sentry->mPidServer ||
+                 TAILQ_EMPTY(&sentry->mPidServer->mClients))
+            {
+                ert_debug(
+                    0,
+                    "release sentry pid %" PRId_Ert_Pid,
+                    FMTd_Ert_Pid(sentry->mArgs.mSentryPid));
+
+                reportUmbilicalRtt(&sentry->mRtt, "ping interval");
+
+                TAILQ_REMOVE(&self->mSentries, sentry, mList_);
+                sentry->mList = 0;
+
+                sentry = closeUmbilicalDaemonSentry_(sentry);
+            }
+        }
+
+        sentry = next;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+pollUmbilicalDaemonSentry_(struct UmbilicalDaemonSentry_ *self);
+
+static ERT_CHECKED int
+armUmbilicalDaemonSentry_(struct UmbilicalDaemonSentry_ *self)
+{
+    return ert_armFileEventQueueActivity(
+        self->mEvent,
+        Ert_FileEventQueuePollRead,
+        Ert_FileEventQueueActivityMethod(
+            self,
+            ERT_LAMBDA(
+                int, (struct UmbilicalDaemonSentry_ *self_),
+                {
+                    if (pollUmbilicalDaemonSentry_(self_))
+                    {
+                        ert_warn(
+                            errno,
+                            "Umbilical connection failed for "
+                            "sentry pid %" PRId_Ert_Pid,
+                            FMTd_Ert_Pid(self_->mArgs.mSentryPid));
+
+                        disconnectUmbilicalDaemonSentry_(self_);
+                    }
+
+                    return 0;
+                })));
+}
+
+static ERT_CHECKED int
+pollUmbilicalDaemonSentry_(struct UmbilicalDaemonSentry_ *self)
+{
+    int rc = -1;
+
+    char buf[1];
+
+    ssize_t rdlen;
+    ERT_ERROR_IF(
+        (rdlen = read(self->mFile->mFd, buf, sizeof(buf)),
+         -1 == rdlen
+         ? EINTR != errno && EWOULDBLOCK != errno && ECONNRESET != errno
+         : (errno = 0, false)));
+
+    /* As with the umbilical process, treat a connection reset in the
+     * same way as reaching the end of file. */
+
+    if ( ! rdlen || (-1 == rdlen && ECONNRESET == errno))
+    {
+        if (self->mClosed)
+            ert_debug(
+                0,
+                "umbilical connection closed for sentry pid %" PRId_Ert_Pid,
+                FMTd_Ert_Pid(self->mArgs.mSentryPid));
+        else
+            ert_warn(
+                0,
+                "Umbilical connection broken for sentry pid %" PRId_Ert_Pid,
+                FMTd_Ert_Pid(self->mArgs.mSentryPid));
+
+        disconnectUmbilicalDaemonSentry_(self);
+    }
+    else
+    {
+        if (-1 != rdlen)
+        {
+            ert_ensure( ! self->mClosed);
+
+            if ( ! buf[0])
+            {
+                ert_debug(
+                    1,
+                    "umbilical connection close request "
+                    "from sentry pid %" PRId_Ert_Pid,
+                    FMTd_Ert_Pid(self->mArgs.mSentryPid));
+
+                self->mClosed = true;
+            }
+            else
+            {
+                /* Record the interval since the previous ping, in the
+                 * same way as the umbilical process, unless the sentry
+                 * was stopped in the meantime. */
+
+                struct Ert_EventClockTime pingTime = ert_eventclockTime();
+
+                if (self->mPingTime.eventclock.ns && ! self->mPreempt)
+                    markUmbilicalRtt(
+                        &self->mRtt,
+                        Ert_Duration(
+                            Ert_NanoSeconds(
+                                pingTime.eventclock.ns -
+                                self->mPingTime.eventclock.ns)));
+
+                self->mPingTime = pingTime;
+                self->mPreempt  = false;
+
+                /* The echo is written without blocking. If the socket
+                 * buffer is full, the sentry has yet to read a previous
+                 * echo, and will still find that one. */
+
+                ssize_t wrlen;
+                ERT_ERROR_IF(
+                    (wrlen = ert_writeFd(self->mFile->mFd, buf, 1, 0),
+                     -1 == wrlen
+                     ? EWOULDBLOCK != errno && EINTR != errno && EPIPE != errno
+                     : (errno = EIO, 1 != wrlen)));
+            }
+
+            self->mSynchronised = true;
+            ert_lapTimeRestart(&self->mSince, 0);
+        }
+
+        ERT_ERROR_IF(
+            armUmbilicalDaemonSentry_(self));
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+armUmbilicalDaemonPidServer_(struct UmbilicalDaemonSentry_ *self);
+
+static ERT_CHECKED int
+armUmbilicalDaemonPidClient_(struct UmbilicalDaemonSentry_ *self)
+{
+    return ert_armFileEventQueueActivity(
+        self->mClientEvent,
+        Ert_FileEventQueuePollRead,
+        Ert_FileEventQueueActivityMethod(
+            self,
+            ERT_LAMBDA(
+                int, (struct UmbilicalDaemonSentry_ *self_),
+                {
+                    int rc_ = cleanPidServer(self_->mPidServer);
+
+                    if (-1 == rc_)
+                        ert_warn(
+                            errno,
+                            "Unable to clean pidserver for "
+                            "sentry pid %" PRId_Ert_Pid,
+                            FMTd_Ert_Pid(self_->mArgs.mSentryPid));
+
+                    return armUmbilicalDaemonPidClient_(self_);
+                })));
+}
+
+static ERT_CHECKED int
+armUmbilicalDaemonPidServer_(struct UmbilicalDaemonSentry_ *self)
+{
+    return ert_armFileEventQueueActivity(
+        self->mServerEvent,
+        Ert_FileEventQueuePollRead,
+        Ert_FileEventQueueActivityMethod(
+            self,
+            ERT_LAMBDA(
+                int, (struct UmbilicalDaemonSentry_ *self_),
+                {
+                    if (acceptPidServerConnection(self_->mPidServer))
+                        ert_warn(
+                            errno,
+                            "Unable to accept pidserver connection for "
+                            "sentry pid %" PRId_Ert_Pid,
+                            FMTd_Ert_Pid(self_->mArgs.mSentryPid));
+
+                    return armUmbilicalDaemonPidServer_(self_);
+                })));
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+identifyUmbilicalDaemonLeader_(struct PidSignature **aLeader,
+                               struct Ert_Pgid       aPgid)
+{
+    int rc = -1;
+
+    /* Identify the leader of the process group by its signature. If the
+     * leader has already gone, the process group cannot be anchored,
+     * and is killed by number as before. */
+
+    ERT_ERROR_IF(
+        ! (*aLeader = createPidSignature(Ert_Pid(aPgid.mPgid), 0)) &&
+        ENOENT != errno);
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+registerUmbilicalDaemonSentry_(struct UmbilicalDaemonSentry_ *self);
+
+static ERT_CHECKED int
+armUmbilicalDaemonRegistration_(struct UmbilicalDaemonSentry_ *self)
+{
+    return ert_armFileEventQueueActivity(
+        self->mRegisterEvent,
+        Ert_FileEventQueuePollRead,
+        Ert_FileEventQueueActivityMethod(
+            self,
+            ERT_LAMBDA(
+                int, (struct UmbilicalDaemonSentry_ *self_),
+                {
+                    /* A failed registration only affects the sentry
+                     * attempting to register, and must not terminate
+                     * the daemon. */
+
+                    if (registerUmbilicalDaemonSentry_(self_))
+                    {
+                        ert_warn(
+                            errno,
+                            "Unable to register sentry pid %" PRId_Ert_Pid,
+                            FMTd_Ert_Pid(self_->mArgs.mSentryPid));
+
+                        abandonUmbilicalDaemonSentry_(self_);
+                    }
+
+                    return 0;
+                })));
+}
+
+static ERT_CHECKED int
+registerUmbilicalDaemonSentry_(struct UmbilicalDaemonSentry_ *self)
+{
+    int rc = -1;
+
+    struct UmbilicalDaemon *daemon = self->mDaemon;
+
+    int fd = -1;
+
+    /* Take each step of the registration as far as the data already sent
+     * by the sentry allows, and return to the event loop to wait for the
+     * remainder rather than blocking. */
+
+    while (UmbilicalDaemonRegistered_ != self->mRegistration)
+    {
+        if (UmbilicalDaemonRegisterRecord_ == self->mRegistration)
+        {
+            ssize_t rdlen;
+            ERT_ERROR_IF(
+                (rdlen = read(
+                    self->mRegisterSocket->mSocket->mFile->mFd,
+                    self->mRecord + self->mRecordLen,
+                    sizeof(self->mRecord) - self->mRecordLen),
+                 -1 == rdlen
+                 ? EWOULDBLOCK != errno && EINTR != errno
+                 : (errno = EIO, ! rdlen)));
+
+            if (-1 == rdlen)
+                break;
+
+            self->mRecordLen += rdlen;
+
+            if (sizeof(self->mRecord) != self->mRecordLen)
+                continue;
+
+            self->mRecord[sizeof(self->mRecord) - 1] = 0;
+
+            struct UmbilicalArgs args;
+            ERT_ERROR_IF(
+                parseUmbilicalArgs(&args, self->mRecord));
+
+            /* The registration must originate from the sentry named in
+             * the record, and a shared heartbeat cannot be used because
+             * each sentry would need its own mapping. */
+
+            ERT_ERROR_IF(
+                args.mSentryPid.mPid != self->mArgs.mSentryPid.mPid ||
+                -1 != args.mBeatFd,
+                {
+                    errno = EPERM;
+                });
+
+            self->mArgs = args;
+
+            ERT_ERROR_IF(
+                identifyUmbilicalDaemonLeader_(
+                    &self->mChildLeader, self->mArgs.mChildPgid));
+            ERT_ERROR_IF(
+                identifyUmbilicalDaemonLeader_(
+                    &self->mSentryLeader, self->mArgs.mSentryPgid));
+
+            self->mRegistration = UmbilicalDaemonRegisterUmbilical_;
+        }
+        else if (UmbilicalDaemonRegisterUmbilical_ == self->mRegistration)
+        {
+            ERT_ERROR_IF(
+                (fd = ert_recvUnixSocketFd(
+                    self->mRegisterSocket, O_CLOEXEC | O_NONBLOCK),
+                 -1 == fd && EWOULDBLOCK != errno && EINTR != errno));
+
+            if (-1 == fd)
+                break;
+
+            ERT_ERROR_IF(
+                ert_createFile(&self->mFile_, fd));
+            self->mFile = &self->mFile_;
+            fd          = -1;
+
+            self->mRegistration =
+                -1 != self->mArgs.mPidServerFd
+                ? UmbilicalDaemonRegisterPidServer_
+                : UmbilicalDaemonRegisterStatus_;
+        }
+        else if (UmbilicalDaemonRegisterPidServer_ == self->mRegistration)
+        {
+            ERT_ERROR_IF(
+                (self->mPidServerFd = ert_recvUnixSocketFd(
+                    self->mRegisterSocket, O_CLOEXEC | O_NONBLOCK),
+                 -1 == self->mPidServerFd &&
+                 EWOULDBLOCK != errno && EINTR != errno));
+
+            if (-1 == self->mPidServerFd)
+                break;
+
+            self->mRegistration = UmbilicalDaemonRegisterPidFd_;
+        }
+        else if (UmbilicalDaemonRegisterPidFd_ == self->mRegistration)
+        {
+            if (-1 != self->mArgs.mPidFd)
+            {
+                ERT_ERROR_IF(
+                    (self->mPidFd = ert_recvUnixSocketFd(
+                        self->mRegisterSocket, O_CLOEXEC),
+                     -1 == self->mPidFd &&
+                     EWOULDBLOCK != errno && EINTR != errno));
+
+                if (-1 == self->mPidFd)
+                    break;
+            }
+
+            /* The pidserver takes ownership of both descriptors. */
+
+            int pidServerFd = self->mPidServerFd;
+            int pidFd       = self->mPidFd;
+
+            self->mPidServerFd = -1;
+            self->mPidFd       = -1;
+
+            ERT_ERROR_IF(
+                adoptPidServer(
+                    &self->mPidServer_,
+                    self->mArgs.mChildPid,
+                    pidServerFd,
+                    pidFd,
+                    self->mArgs.mReferences,
+                    self->mArgs.mLease_s));
+            self->mPidServer = &self->mPidServer_;
+
+            attachPidServerUmbilical(self->mPidServer, self->mFile->mFd);
+
+            self->mRegistration = UmbilicalDaemonRegisterStatus_;
+        }
+        else if (UmbilicalDaemonRegisterStatus_ == self->mRegistration)
+        {
+            if (-1 != self->mArgs.mStatusFd)
+            {
+                ERT_ERROR_IF(
+                    (fd = ert_recvUnixSocketFd(
+                        self->mRegisterSocket, O_CLOEXEC),
+                     -1 == fd && EWOULDBLOCK != errno && EINTR != errno));
+
+                if (-1 == fd)
+                    break;
+
+                ERT_ERROR_IF(
+                    adoptSentryStatus(&self->mStatus_, fd));
+                self->mStatus = &self->mStatus_;
+                fd            = -1;
+
+                if (self->mPidServer)
+                    attachPidServerStatus(self->mPidServer, self->mStatus);
+            }
+
+            if (self->mPidServer)
+            {
+                ERT_ERROR_IF(
+                    ert_createFileEventQueueActivity(
+                        &self->mServerEvent_,
+                        daemon->mEventQueue,
+                        self->mPidServer->mUnixSocket->mSocket->mFile));
+                self->mServerEvent = &self->mServerEvent_;
+
+                ERT_ERROR_IF(
+                    ert_createFileEventQueueActivity(
+                        &self->mClientEvent_,
+                        daemon->mEventQueue,
+                        self->mPidServer->mEventQueue->mFile));
+                self->mClientEvent = &self->mClientEvent_;
+
+                ERT_ERROR_IF(
+                    armUmbilicalDaemonPidServer_(self));
+                ERT_ERROR_IF(
+                    armUmbilicalDaemonPidClient_(self));
+            }
+
+            ERT_ERROR_IF(
+                ert_createFileEventQueueActivity(
+                    &self->mEvent_, daemon->mEventQueue, self->mFile));
+            self->mEvent = &self->mEvent_;
+
+            ERT_ERROR_IF(
+                armUmbilicalDaemonSentry_(self));
+
+            /* Acknowledge the registration only once the daemon has
+             * taken responsibility for the umbilical connection so that
+             * the sentry knows when it can release its own copy. Nothing
+             * else is written to the socket, so the acknowledgement
+             * does not need to wait for space. */
+
+            char buf[1] = { 0 };
+
+            ssize_t wrlen;
+            ERT_ERROR_IF(
+                (wrlen = ert_writeFd(
+                    self->mRegisterSocket->mSocket->mFile->mFd,
+                    buf, sizeof(buf), 0),
+                 -1 == wrlen || (errno = EIO, sizeof(buf) != wrlen)));
+
+            ert_debug(
+                0,
+                "registered sentry pid %" PRId_Ert_Pid
+                " child pgid %" PRId_Ert_Pgid,
+                FMTd_Ert_Pid(self->mArgs.mSentryPid),
+                FMTd_Ert_Pgid(self->mArgs.mChildPgid));
+
+            self->mRegistration = UmbilicalDaemonRegistered_;
+        }
+    }
+
+    if (UmbilicalDaemonRegistered_ != self->mRegistration)
+    {
+        ERT_ERROR_IF(
+            armUmbilicalDaemonRegistration_(self));
+    }
+    else
+    {
+        self->mRegisterEvent = ert_closeFileEventQueueActivity(
+            self->mRegisterEvent);
+        self->mRegisterSocket = ert_closeUnixSocket(self->mRegisterSocket);
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (-1 != fd)
+            close(fd);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+acceptUmbilicalDaemonSentry_(struct UmbilicalDaemon *self)
+{
+    int rc = -1;
+
+    struct UmbilicalDaemonSentry_ *sentry = 0;
+
+    ERT_ERROR_UNLESS(
+        (sentry = malloc(sizeof(*sentry))));
+
+    sentry->mList           = 0;
+    sentry->mDaemon         = self;
+    sentry->mRegistration   = UmbilicalDaemonRegisterRecord_;
+    sentry->mRegisterSocket = 0;
+    sentry->mRegisterEvent  = 0;
+    sentry->mRecordLen      = 0;
+    sentry->mPidServerFd    = -1;
+    sentry->mPidFd          = -1;
+    sentry->mChildLeader    = 0;
+    sentry->mSentryLeader   = 0;
+    sentry->mFile           = 0;
+    sentry->mEvent          = 0;
+    sentry->mPidServer      = 0;
+    sentry->mStatus         = 0;
+    sentry->mServerEvent    = 0;
+    sentry->mClientEvent    = 0;
+    sentry->mSince          = (struct Ert_EventClockTime)
+                              ERT_EVENTCLOCKTIME_INIT;
+    sentry->mPingTime       = (struct Ert_EventClockTime)
+                              ERT_EVENTCLOCKTIME_INIT;
+    sentry->mPreempt        = false;
+    sentry->mSynchronised   = false;
+    sentry->mClosed         = false;
+    sentry->mDisconnected   = false;
+
+    startUmbilicalRtt(&sentry->mRtt);
+
+    ERT_ERROR_IF(
+        ert_acceptUnixSocket(&sentry->mRegisterSocket_, self->mUnixSocket));
+    sentry->mRegisterSocket = &sentry->mRegisterSocket_;
+
+    /* Only accept registrations from sentries run by the same user,
+     * or by the superuser, in the same way as the pidserver. */
+
+    struct ucred cred;
+    ERT_ERROR_IF(
+        ert_ownUnixSocketPeerCred(sentry->mRegisterSocket, &cred));
+
+    ERT_ERROR_UNLESS(
+        geteuid() == cred.uid || ! cred.uid,
+        {
+            errno = EPERM;
+        });
+
+    sentry->mArgs = (struct UmbilicalArgs)
+    {
+        .mSentryPid   = Ert_Pid(cred.pid),
+        .mPidServerFd = -1,
+        .mPidFd       = -1,
+        .mBeatFd      = -1,
+        .mStatusFd    = -1,
+    };
+
+    /* The registration is driven from the event queue, and is bounded
+     * by the umbilical timer, so that a slow or silent sentry cannot
+     * stall the event loop serving the other sentries. */
+
+    ERT_ERROR_IF(
+        ert_nonBlockingFile(
+            sentry->mRegisterSocket->mSocket->mFile, O_NONBLOCK));
+
+    ERT_ERROR_IF(
+        ert_createFileEventQueueActivity(
+            &sentry->mRegisterEvent_,
+            self->mEventQueue,
+            sentry->mRegisterSocket->mSocket->mFile));
+    sentry->mRegisterEvent = &sentry->mRegisterEvent_;
+
+    ERT_ERROR_IF(
+        armUmbilicalDaemonRegistration_(sentry));
+
+    ert_lapTimeRestart(&sentry->mSince, 0);
+
+    TAILQ_INSERT_TAIL(&self->mSentries, sentry, mList_);
+    sentry->mList = &sentry->mList_;
+    sentry = 0;
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        sentry = closeUmbilicalDaemonSentry_(sentry);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+pollFdSocket_(struct UmbilicalDaemon          *self,
+              const struct Ert_EventClockTime *aPollTime)
+{
+    int rc = -1;
+
+    /* A failed registration only affects the sentry attempting to
+     * register, and must not terminate the daemon. */
+
+    if (acceptUmbilicalDaemonSentry_(self))
+        ert_warn(errno, "Unable to register sentry");
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+pollFdEventQueue_(struct UmbilicalDaemon          *self,
+                  const struct Ert_EventClockTime *aPollTime)
+{
+    int rc = -1;
+
+    ERT_ERROR_IF(
+        ert_pollFileEventQueueActivity(self->mEventQueue, &Ert_ZeroDuration));
+
+    reapUmbilicalDaemon_(self);
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+pollFdTimerUmbilical_(struct UmbilicalDaemon          *self,
+                      const struct Ert_EventClockTime *aPollTime)
+{
+    int rc = -1;
+
+    /* A single timer serves all the sentries. Each sentry is checked
+     * against its own umbilical timeout, or the time at which the
+     * suspicion level computed from its recent ping intervals crosses
+     * its threshold, and the granularity of the tick bounds the
+     * additional delay before a failure is noticed. */
+
+    struct UmbilicalDaemonSentry_ *sentry;
+
+    TAILQ_FOREACH(sentry, &self->mSentries, mList_)
+    {
+        struct Ert_Duration remaining;
+
+        /* Registrations are bounded so that a sentry that stalls part
+         * way through does not hold its resources in the daemon. */
+
+        if (UmbilicalDaemonRegistered_ != sentry->mRegistration)
+        {
+            if ( ! sentry->mDisconnected &&
+                ert_deadlineTimeExpired(
+                    &sentry->mSince,
+                    Ert_Duration(
+                        ERT_NSECS(Ert_Seconds(UMBILICAL_DAEMON_REGISTER_S))),
+                    &remaining,
+                    aPollTime))
+            {
+                ert_warn(
+                    ETIMEDOUT,
+                    "Unable to register sentry pid %" PRId_Ert_Pid,
+                    FMTd_Ert_Pid(sentry->mArgs.mSentryPid));
+
+                abandonUmbilicalDaemonSentry_(sentry);
+            }
+
+            continue;
+        }
+
+        if (sentry->mDisconnected || ! sentry->mSynchronised)
+            continue;
+
+        struct Ert_Duration deadline = ownUmbilicalRttArrivalDeadline(
+            &sentry->mRtt,
+            sentry->mArgs.mSuspicion,
+            Ert_Duration(ERT_NSECS(Ert_Seconds(sentry->mArgs.mTimeout_s))));
+
+        if (ert_deadlineTimeExpired(
+                &sentry->mSince, deadline, &remaining, aPollTime))
+        {
+            struct Ert_ProcessState sentryState =
+                ert_fetchProcessState(sentry->mArgs.mSentryPid);
+
+            if (Ert_ProcessStateStopped == sentryState.mState)
+            {
+                ert_debug(
+                    0,
+                    "umbilical timeout deferred due to "
+                    "sentry pid %" PRId_Ert_Pid
+                    " status %" PRIs_Ert_ProcessState,
+                    FMTd_Ert_Pid(sentry->mArgs.mSentryPid),
+                    FMTs_Ert_ProcessState(sentryState));
+
+                ert_lapTimeRestart(&sentry->mSince, aPollTime);
+
+                sentry->mPreempt = true;
+            }
+            else
+            {
+                if ( ! sentry->mArgs.mSuspicion)
+                    ert_warn(
+                        0,
+                        "Umbilical connection timed out for "
+                        "sentry pid %" PRId_Ert_Pid,
+                        FMTd_Ert_Pid(sentry->mArgs.mSentryPid));
+                else
+                {
+                    unsigned phi = ownUmbilicalRttArrivalPhi(
+                        &sentry->mRtt,
+                        Ert_Duration(
+                            Ert_NanoSeconds(
+                                aPollTime->eventclock.ns -
+                                sentry->mPingTime.eventclock.ns)));
+
+                    ert_warn(
+                        0,
+                        "Umbilical connection timed out for "
+                        "sentry pid %" PRId_Ert_Pid
+                        " with suspicion %u.%02u",
+                        FMTd_Ert_Pid(sentry->mArgs.mSentryPid),
+                        phi / 100, phi % 100);
+                }
+
+                reportUmbilicalRtt(&sentry->mRtt, "ping interval");
+
+                disconnectUmbilicalDaemonSentry_(sentry);
+            }
+        }
+    }
+
+    reapUmbilicalDaemon_(self);
+
+    struct Ert_PollFdTimerAction *umbilicalTimer =
+        &self->mPoll.mFdTimerActions[POLL_FD_DAEMON_TIMER_UMBILICAL];
+
+    alignWakeupTimer(umbilicalTimer, umbilicalTimer->mPeriod, aPollTime);
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED bool
+pollFdCompletion_(struct UmbilicalDaemon *self)
+{
+    /* The daemon serves sentries until it is killed. */
+
+    return false;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+createUmbilicalDaemon(struct UmbilicalDaemon *self, const char *aName)
+{
+    int rc = -1;
+
+    self->mUnixSocket = 0;
+    self->mEventQueue = 0;
+
+    TAILQ_INIT(&self->mSentries);
+
+    ERT_ERROR_IF(
+        nameUmbilicalDaemon(&self->mSocketAddr, aName));
+
+    ERT_ERROR_IF(
+        ert_createUnixSocket(
+            &self->mUnixSocket_,
+            self->mSocketAddr.sun_path,
+            sizeof(self->mSocketAddr.sun_path),
+            0));
+    self->mUnixSocket = &self->mUnixSocket_;
+
+    ERT_ERROR_IF(
+        ert_createFileEventQueue(&self->mEventQueue_, 64));
+    self->mEventQueue = &self->mEventQueue_;
+
+    self->mPoll = (__typeof__(self->mPoll))
+    {
+        .mFds =
+        {
+            [POLL_FD_DAEMON_SOCKET] =
+            {
+                .fd     = self->mUnixSocket->mSocket->mFile->mFd,
+                .events = ERT_POLL_INPUTEVENTS,
+            },
+
+            [POLL_FD_DAEMON_EVENTQUEUE] =
+            {
+                .fd     = self->mEventQueue->mFile->mFd,
+                .events = ERT_POLL_INPUTEVENTS,
+            },
+        },
+
+        .mFdActions =
+        {
+            [POLL_FD_DAEMON_SOCKET] = {
+                Ert_PollFdCallbackMethod(self, pollFdSocket_) },
+            [POLL_FD_DAEMON_EVENTQUEUE] = {
+                Ert_PollFdCallbackMethod(self, pollFdEventQueue_) },
+        },
+
+        .mFdTimerActions =
+        {
+            [POLL_FD_DAEMON_TIMER_UMBILICAL] =
+            {
+                .mAction = Ert_PollFdCallbackMethod(
+                    self, pollFdTimerUmbilical_),
+                .mSince  = ERT_EVENTCLOCKTIME_INIT,
+                .mPeriod = Ert_Duration(
+                    ERT_NSECS(Ert_Seconds(UMBILICAL_DAEMON_TICK_S))),
+            },
+        },
+    };
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (rc)
+            self = closeUmbilicalDaemon(self);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+struct UmbilicalDaemon *
+closeUmbilicalDaemon(struct UmbilicalDaemon *self)
+{
+    if (self)
+    {
+        while ( ! TAILQ_EMPTY(&self->mSentries))
+        {
+            struct UmbilicalDaemonSentry_ *sentry =
+                TAILQ_FIRST(&self->mSentries);
+
+            TAILQ_REMOVE(&self->mSentries, sentry, mList_);
+            sentry->mList = 0;
+
+            sentry = closeUmbilicalDaemonSentry_(sentry);
+        }
+
+        self->mEventQueue = ert_closeFileEventQueue(self->mEventQueue);
+        self->mUnixSocket = ert_closeUnixSocket(self->mUnixSocket);
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+runUmbilicalDaemon(struct UmbilicalDaemon *self)
+{
+    int rc = -1;
+
+    struct Ert_PollFd  pollfd_;
+    struct Ert_PollFd *pollfd = 0;
+
+    ERT_ERROR_IF(
+        setWakeupSlack(
+            self->mPoll.mFdTimerActions[
+                POLL_FD_DAEMON_TIMER_UMBILICAL].mPeriod));
+
+    ERT_ERROR_IF(
+        ert_createPollFd(
+            &pollfd_,
+            self->mPoll.mFds,
+            self->mPoll.mFdActions,
+            pollFdNames_, POLL_FD_DAEMON_KINDS,
+            self->mPoll.mFdTimerActions,
+            pollFdTimerNames_, POLL_FD_DAEMON_TIMER_KINDS,
+            Ert_PollFdCompletionMethod(self, pollFdCompletion_)));
+    pollfd = &pollfd_;
+
+    ert_debug(0, "umbilical daemon running");
+
+    ERT_ERROR_IF(
+        ert_runPollFdLoop(pollfd));
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        pollfd = ert_closePollFd(pollfd);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,177 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2016, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef UMBILICALDAEMON_H
+#define UMBILICALDAEMON_H
+
+#include "umbilicalmonitor.h"
+#include "umbilicalrtt.h"
+#include "pidserver.h"
+#include "sentrystatus.h"
+
+#include "ert/compiler.h"
+#include "ert/unixsocket.h"
+#include "ert/fileeventqueue.h"
+#include "ert/pollfd.h"
+#include "ert/queue.h"
+
+#include <poll.h>
+#include <stdbool.h>
+
+#include <sys/un.h>
+
+ERT_BEGIN_C_SCOPE;
+
+struct UmbilicalDaemon;
+struct PidSignature;
+
+/* -------------------------------------------------------------------------- */
+enum UmbilicalDaemonRegistration_
+{
+    UmbilicalDaemonRegisterRecord_,
+    UmbilicalDaemonRegisterUmbilical_,
+    UmbilicalDaemonRegisterPidServer_,
+    UmbilicalDaemonRegisterPidFd_,
+    UmbilicalDaemonRegisterStatus_,
+    UmbilicalDaemonRegistered_
+};
+
+struct UmbilicalDaemonSentry_;
+typedef TAILQ_ENTRY(UmbilicalDaemonSentry_) UmbilicalDaemonSentryListEntryT;
+
+struct UmbilicalDaemonSentry_
+{
+    UmbilicalDaemonSentryListEntryT  mList_;
+    UmbilicalDaemonSentryListEntryT *mList;
+
+    struct UmbilicalDaemon *mDaemon;
+    struct UmbilicalArgs    mArgs;
+
+    /* Registration proceeds a step at a time as the sentry sends its
+     * record and then each of its file descriptors, so that a slow
+     * sentry does not stall the daemon. */
+
+    enum UmbilicalDaemonRegistration_ mRegistration;
+
+    struct Ert_UnixSocket  mRegisterSocket_;
+    struct Ert_UnixSocket *mRegisterSocket;
+
+    struct Ert_FileEventQueueActivity  mRegisterEvent_;
+    struct Ert_FileEventQueueActivity *mRegisterEvent;
+
+    char   mRecord[UMBILICAL_DAEMON_RECORD_SIZE];
+    size_t mRecordLen;
+    int    mPidServerFd;
+    int    mPidFd;
+
+    /* The leaders of the process groups are identified when the sentry
+     * registers, so that the process groups are not killed should their
+     * numbers have been recycled. */
+
+    struct PidSignature *mChildLeader;
+    struct PidSignature *mSentryLeader;
+
+    struct Ert_File  mFile_;
+    struct Ert_File *mFile;
+
+    struct Ert_FileEventQueueActivity  mEvent_;
+    struct Ert_FileEventQueueActivity *mEvent;
+
+    struct PidServer  mPidServer_;
+    struct PidServer *mPidServer;
+
+    struct SentryStatus  mStatus_;
+    struct SentryStatus *mStatus;
+
+    struct Ert_FileEventQueueActivity  mServerEvent_;
+    struct Ert_FileEventQueueActivity *mServerEvent;
+
+    struct Ert_FileEventQueueActivity  mClientEvent_;
+    struct Ert_FileEventQueueActivity *mClientEvent;
+
+    struct Ert_EventClockTime mSince;
+    struct Ert_EventClockTime mPingTime;
+    struct UmbilicalRtt       mRtt;
+    bool                      mPreempt;
+    bool                      mSynchronised;
+    bool                      mClosed;
+    bool                      mDisconnected;
+};
+
+typedef TAILQ_HEAD(UmbilicalDaemonSentryList_,
+                   UmbilicalDaemonSentry_) UmbilicalDaemonSentryListT_;
+
+/* -------------------------------------------------------------------------- */
+enum PollFdDaemonKind
+{
+    POLL_FD_DAEMON_SOCKET,
+    POLL_FD_DAEMON_EVENTQUEUE,
+    POLL_FD_DAEMON_KINDS
+};
+
+enum PollFdDaemonTimerKind
+{
+    POLL_FD_DAEMON_TIMER_UMBILICAL,
+    POLL_FD_DAEMON_TIMER_KINDS
+};
+
+struct UmbilicalDaemon
+{
+    struct Ert_UnixSocket  mUnixSocket_;
+    struct Ert_UnixSocket *mUnixSocket;
+    struct sockaddr_un     mSocketAddr;
+
+    struct Ert_FileEventQueue  mEventQueue_;
+    struct Ert_FileEventQueue *mEventQueue;
+
+    struct UmbilicalDaemonSentryList_ mSentries;
+
+    struct
+    {
+        struct pollfd                mFds[POLL_FD_DAEMON_KINDS];
+        struct Ert_PollFdAction      mFdActions[POLL_FD_DAEMON_KINDS];
+        struct Ert_PollFdTimerAction mFdTimerActions[
+                                        POLL_FD_DAEMON_TIMER_KINDS];
+    } mPoll;
+};
+
+/* -------------------------------------------------------------------------- */
+ERT_CHECKED int
+createUmbilicalDaemon(struct UmbilicalDaemon *self, const char *aName);
+
+struct UmbilicalDaemon *
+closeUmbilicalDaemon(struct UmbilicalDaemon *self);
+
+ERT_CHECKED int
+runUmbilicalDaemon(struct UmbilicalDaemon *self);
+
+/* -------------------------------------------------------------------------- */
+
+ERT_END_C_SCOPE;
+
+#endif /* UMBILICALDAEMON_H */
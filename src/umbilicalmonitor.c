@@ -0,0 +1,946 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2016, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "umbilicalmonitor.h"
+#include "pidserver.h"
+
+#include "options_.h"
+
+#include "ert/process.h"
+#include "ert/parse.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+/* -------------------------------------------------------------------------- */
+/* Umbilical Monitor
+ *
+ * The umbilical monitor is the event loop run by the umbilical process.
+ * It is kept apart from the code that creates the umbilical process so
+ * that it can be linked into a small dedicated executable that is run
+ * in place of the full image of the sentry.
+ */
+
+static const char *pollFdNames_[POLL_FD_MONITOR_KINDS] =
+{
+    [POLL_FD_MONITOR_UMBILICAL] = "umbilical",
+    [POLL_FD_MONITOR_PIDSERVER] = "pidserver",
+    [POLL_FD_MONITOR_PIDCLIENT] = "pidclient",
+    [POLL_FD_MONITOR_EVENTPIPE] = "event pipe",
+};
+
+static const char *pollFdTimerNames_[POLL_FD_MONITOR_TIMER_KINDS] =
+{
+    [POLL_FD_MONITOR_TIMER_UMBILICAL] = "umbilical",
+};
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+pollFdPidServer_(struct UmbilicalMonitor         *self,
+                 const struct Ert_EventClockTime *aPollTime)
+{
+    int rc = -1;
+
+    ERT_ERROR_IF(
+        acceptPidServerConnection(self->mPidServer));
+
+    struct pollfd *pollFd = &self->mPoll.mFds[POLL_FD_MONITOR_PIDCLIENT];
+
+    if ( ! pollFd->events)
+    {
+        pollFd->fd     = self->mPidServer->mEventQueue->mFile->mFd;
+        pollFd->events = ERT_POLL_INPUTEVENTS;
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+pollFdPidClient_(struct UmbilicalMonitor         *self,
+                 const struct Ert_EventClockTime *aPollTime)
+{
+    int rc = -1;
+
+    if (cleanPidServer(self->mPidServer))
+    {
+        struct pollfd *pollFd = &self->mPoll.mFds[POLL_FD_MONITOR_PIDCLIENT];
+
+        pollFd->fd     = -1;
+        pollFd->events = 0;
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+closeFdUmbilical_(struct UmbilicalMonitor *self)
+{
+    int rc = -1;
+
+    ERT_ABORT_IF(
+        shutdown(
+            self->mPoll.mFds[POLL_FD_MONITOR_UMBILICAL].fd,
+            SHUT_WR));
+
+    self->mPoll.mFds[POLL_FD_MONITOR_UMBILICAL].fd     = -1;
+    self->mPoll.mFds[POLL_FD_MONITOR_UMBILICAL].events = 0;
+
+    self->mPoll.mFds[POLL_FD_MONITOR_PIDSERVER].fd     = -1;
+    self->mPoll.mFds[POLL_FD_MONITOR_PIDSERVER].events = 0;
+
+    /* Since the umbilical connection is no longer being monitored, there
+     * is no reason to run its associated timer. */
+
+    self->mPoll.mFdTimerActions[POLL_FD_MONITOR_TIMER_UMBILICAL].mPeriod =
+        Ert_ZeroDuration;
+
+    /* The sentry has gone, so tell clients that are waiting for the
+     * child process to exit. Those clients release their references,
+     * and if none remain, there is nothing more to clean. */
+
+    if (self->mPidServer)
+    {
+        attachPidServerUmbilical(self->mPidServer, -1);
+
+        int idle;
+        ERT_ERROR_IF(
+            (idle = notifyPidServerExit(self->mPidServer),
+             -1 == idle));
+
+        if (idle)
+        {
+            struct pollfd *pollFd =
+                &self->mPoll.mFds[POLL_FD_MONITOR_PIDCLIENT];
+
+            pollFd->fd     = -1;
+            pollFd->events = 0;
+        }
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+static void
+markFdUmbilicalPing_(struct UmbilicalMonitor         *self,
+                     const struct Ert_EventClockTime *aPollTime)
+{
+    /* Record the interval since the previous ping, unless the sentry
+     * was stopped in the meantime, since the stoppage says nothing
+     * about the health of the umbilical connection. */
+
+    struct Ert_EventClockTime pingTime =
+        aPollTime ? *aPollTime : ert_eventclockTime();
+
+    if (self->mUmbilical.mPingTime.eventclock.ns && ! self->mUmbilical.mPreempt)
+        markUmbilicalRtt(
+            &self->mUmbilical.mRtt,
+            Ert_Duration(
+                Ert_NanoSeconds(
+                    pingTime.eventclock.ns -
+                    self->mUmbilical.mPingTime.eventclock.ns)));
+
+    self->mUmbilical.mPingTime = pingTime;
+    self->mUmbilical.mPreempt  = false;
+
+    /* If a suspicion threshold is configured, wait for the next ping
+     * only until the suspicion level computed from the recent
+     * intervals crosses the threshold, but never longer than the
+     * full umbilical timeout. A shared heartbeat keeps the timer in
+     * phase with the sentry, so the period is left alone. */
+
+    if ( ! self->mUmbilical.mBeat)
+    {
+        struct Ert_Duration deadline = ownUmbilicalRttArrivalDeadline(
+            &self->mUmbilical.mRtt,
+            self->mUmbilical.mSuspicion,
+            self->mUmbilical.mCeiling);
+
+        self->mPoll.mFdTimerActions[POLL_FD_MONITOR_TIMER_UMBILICAL].mPeriod =
+            Ert_Duration(
+                Ert_NanoSeconds(
+                    deadline.duration.ns / self->mUmbilical.mCycleLimit));
+    }
+}
+
+static ERT_CHECKED int
+pollFdUmbilical_(struct UmbilicalMonitor         *self,
+                 const struct Ert_EventClockTime *aPollTime)
+{
+    int rc = -1;
+
+    char buf[1];
+
+    ssize_t rdlen;
+    ERT_ERROR_IF(
+        (rdlen = read(
+            self->mPoll.mFds[POLL_FD_MONITOR_UMBILICAL].fd, buf, sizeof(buf)),
+         -1 == rdlen
+         ? EINTR != errno && ECONNRESET != errno
+         : (errno = 0, rdlen && sizeof(buf) != rdlen)));
+
+    /* If the far end did not read the previous echo, and simply closed its
+     * end of the connection (likely because it detected the child
+     * process terminated), then the read will return ECONNRESET. This
+     * is equivalent to encountering the end of file. */
+
+    if ( ! rdlen)
+    {
+        errno = ECONNRESET;
+        rdlen = -1;
+    }
+
+    if (-1 == rdlen)
+    {
+        if (ECONNRESET == errno)
+        {
+            if (self->mUmbilical.mClosed)
+                ert_debug(0, "umbilical connection closed");
+            else
+                ert_warn(0, "Umbilical connection broken");
+
+            ERT_ERROR_IF(
+                closeFdUmbilical_(self));
+        }
+    }
+    else
+    {
+        ert_debug(1, "received umbilical connection ping %zd", rdlen);
+
+        markWakeupMeter(&self->mUmbilical.mWakeups);
+
+        ert_ensure( ! self->mUmbilical.mClosed);
+
+        if ( ! buf[0])
+        {
+            ert_debug(1, "umbilical connection close request");
+
+            self->mUmbilical.mClosed = true;
+        }
+        else
+        {
+            ert_debug(1, "umbilical connection echo request");
+
+            /* Requests for echoes are posted so that they can
+             * be retried on EINTR. */
+
+            ERT_ERROR_IF(
+                Ert_EventLatchSettingError == ert_setEventLatch(
+                    self->mLatch.mEchoRequest));
+
+            markFdUmbilicalPing_(self, aPollTime);
+        }
+
+        /* Once activity is detected on the umbilical, reset the
+         * umbilical timer, but configure the timer so that it is
+         * out-of-phase with the expected activity on the umbilical
+         * to avoid having to deal with races when there is a tight
+         * finish. The sentry pings at most once per period, so
+         * delay the timer slightly beyond the next expected ping
+         * to avoid waking when the connection is healthy. */
+
+        struct Ert_PollFdTimerAction *umbilicalTimer =
+            &self->mPoll.mFdTimerActions[POLL_FD_MONITOR_TIMER_UMBILICAL];
+
+        ert_lapTimeRestart(&umbilicalTimer->mSince, aPollTime);
+
+        ert_lapTimeDelay(
+            &umbilicalTimer->mSince,
+            Ert_Duration(
+                Ert_NanoSeconds(umbilicalTimer->mPeriod.duration.ns / 8)));
+
+        self->mUmbilical.mCycleCount = 0;
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+static ERT_CHECKED int
+pollFdTimerUmbilical_(
+    struct UmbilicalMonitor         *self,
+    const struct Ert_EventClockTime *aPollTime)
+{
+    int rc = -1;
+
+    markWakeupMeter(&self->mUmbilical.mWakeups);
+
+    /* When sharing a heartbeat with the sentry, show that the umbilical
+     * monitor is running on each tick, and keep the ticks in phase
+     * so that they coincide with those of the sentry. */
+
+    struct Ert_PollFdTimerAction *umbilicalTimer =
+        &self->mPoll.mFdTimerActions[POLL_FD_MONITOR_TIMER_UMBILICAL];
+
+    if (self->mUmbilical.mBeat)
+    {
+        beatUmbilicalBeat(self->mUmbilical.mBeat, UmbilicalBeatUmbilical);
+
+        alignWakeupTimer(umbilicalTimer, umbilicalTimer->mPeriod, aPollTime);
+    }
+
+    /* If nothing is available from the umbilical connection after the
+     * timeout period expires, then assume that the sentry itself
+     * is stuck. */
+
+    struct Ert_ProcessState parentState =
+        ert_fetchProcessState(self->mUmbilical.mParentPid);
+
+    if (self->mUmbilical.mBeat &&
+        sampleUmbilicalBeat(self->mUmbilical.mBeat, UmbilicalBeatSentry))
+    {
+        self->mUmbilical.mCycleCount = 0;
+    }
+    else if (Ert_ProcessStateStopped == parentState.mState)
+    {
+        ert_debug(
+            0,
+            "umbilical timeout deferred due to "
+            "parent status %" PRIs_Ert_ProcessState,
+            FMTs_Ert_ProcessState(parentState));
+        self->mUmbilical.mCycleCount = 0;
+        self->mUmbilical.mPreempt    = true;
+    }
+    else if (++self->mUmbilical.mCycleCount >= self->mUmbilical.mCycleLimit)
+    {
+        if ( ! self->mUmbilical.mSuspicion || self->mUmbilical.mBeat)
+            ert_warn(0, "Umbilical connection timed out");
+        else
+        {
+            unsigned phi = ownUmbilicalRttArrivalPhi(
+                &self->mUmbilical.mRtt,
+                Ert_Duration(
+                    Ert_NanoSeconds(
+                        aPollTime->eventclock.ns -
+                        self->mUmbilical.mPingTime.eventclock.ns)));
+
+            ert_warn(
+                0,
+                "Umbilical connection timed out with suspicion %u.%02u",
+                phi / 100, phi % 100);
+        }
+
+        reportUmbilicalRtt(&self->mUmbilical.mRtt, "ping interval");
+
+        ERT_ERROR_IF(
+            closeFdUmbilical_(self));
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+pollFdSendEcho_(struct UmbilicalMonitor         *self,
+                bool                             aEnabled,
+                const struct Ert_EventClockTime *aPollTime)
+{
+    int rc = -1;
+
+    ert_ensure(aEnabled);
+
+    /* The umbilical connection might have been closed by the time
+     * this code runs. */
+
+    if (-1 == self->mPoll.mFds[POLL_FD_MONITOR_UMBILICAL].fd)
+        ert_debug(0, "skipping umbilical echo");
+    else
+    {
+        /* Receiving EPIPE means that the umbilical connection
+         * has been closed. Rely on the umbilical connection
+         * reader to reactivate and detect the closed connection. */
+
+        char buf[1] = { '.' };
+
+        ssize_t wrlen;
+        ERT_ERROR_IF(
+            (wrlen = ert_writeFd(
+                self->mPoll.mFds[POLL_FD_MONITOR_UMBILICAL].fd,
+                buf, sizeof(buf), 0),
+             -1 == wrlen
+             ? EPIPE != errno
+             : (errno = 0, sizeof(buf) != wrlen)));
+
+        ert_debug(0, "sent umbilical echo");
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static ERT_CHECKED int
+pollFdEventPipe_(struct UmbilicalMonitor         *self,
+                 const struct Ert_EventClockTime *aPollTime)
+{
+    int rc = -1;
+
+    /* Actively test races by occasionally delaying this activity
+     * when in test mode. */
+
+    if ( ! ert_testSleep(Ert_TestLevelRace))
+    {
+        ert_debug(0, "checking event pipe");
+
+        ERT_ERROR_IF(
+            -1 == ert_pollEventPipe(
+                self->mEventPipe, aPollTime) && EINTR != errno);
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static bool
+pollFdCompletion_(struct UmbilicalMonitor *self)
+{
+    /* The umbilical event loop terminates when the connection to the
+     * sentry is closed, and when there are no more outstanding
+     * child process group references. */
+
+    return
+        ! self->mPoll.mFds[POLL_FD_MONITOR_UMBILICAL].events &&
+        ! self->mPoll.mFds[POLL_FD_MONITOR_PIDSERVER].events &&
+        ! self->mPoll.mFds[POLL_FD_MONITOR_PIDCLIENT].events;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+createUmbilicalMonitor(
+    struct UmbilicalMonitor *self,
+    int                      aStdinFd,
+    struct Ert_Pid           aParentPid,
+    struct PidServer        *aPidServer,
+    struct UmbilicalBeat    *aBeat)
+{
+    int rc = -1;
+
+    unsigned cycleLimit = 2;
+
+    self->mPidServer = aPidServer;
+    self->mEventPipe = 0;
+
+    /* Clients of the pid server attach to the output of the child
+     * process through the umbilical connection to the sentry. */
+
+    if (self->mPidServer)
+        attachPidServerUmbilical(self->mPidServer, aStdinFd);
+
+    ERT_ERROR_IF(
+        ert_createEventLatch(&self->mLatch.mEchoRequest_, "echo request"));
+    self->mLatch.mEchoRequest = &self->mLatch.mEchoRequest_;
+
+    ERT_ERROR_IF(
+        ert_createEventPipe(&self->mEventPipe_, O_CLOEXEC | O_NONBLOCK));
+    self->mEventPipe = &self->mEventPipe_;
+
+    ERT_ERROR_IF(
+        Ert_EventLatchSettingError == ert_bindEventLatchPipe(
+            self->mLatch.mEchoRequest, self->mEventPipe,
+            Ert_EventLatchMethod(
+                self, pollFdSendEcho_)));
+
+    self->mUmbilical = (ERT_DECLTYPE(self->mUmbilical))
+    {
+        .mCycleLimit = cycleLimit,
+        .mParentPid  = aParentPid,
+        .mClosed     = false,
+        .mSuspicion  = gOptions.mServer.mSuspicion,
+        .mPreempt    = false,
+        .mCeiling    = Ert_Duration(
+            ERT_NSECS(Ert_Seconds(gOptions.mServer.mTimeout.mUmbilical_s))),
+        .mPingTime   = ERT_EVENTCLOCKTIME_INIT,
+        .mBeat       = aBeat,
+    };
+
+    startUmbilicalRtt(&self->mUmbilical.mRtt);
+
+    self->mPoll = (ERT_DECLTYPE(self->mPoll))
+    {
+        .mFds =
+        {
+            [POLL_FD_MONITOR_UMBILICAL] =
+            {
+                .fd     = aStdinFd,
+                .events = ERT_POLL_INPUTEVENTS
+            },
+
+            [POLL_FD_MONITOR_PIDSERVER] =
+            {
+                .fd     = aPidServer
+                          ? aPidServer->mUnixSocket->mSocket->mFile->mFd : -1,
+                .events = aPidServer
+                          ? ERT_POLL_INPUTEVENTS : 0,
+            },
+
+            [POLL_FD_MONITOR_PIDCLIENT] =
+            {
+                .fd     = -1,
+                .events = 0,
+            },
+
+            [POLL_FD_MONITOR_EVENTPIPE] =
+            {
+                .fd     = self->mEventPipe->mPipe->mRdFile->mFd,
+                .events = ERT_POLL_INPUTEVENTS,
+            },
+        },
+
+        .mFdActions =
+        {
+            [POLL_FD_MONITOR_UMBILICAL] = {
+                Ert_PollFdCallbackMethod(self, pollFdUmbilical_) },
+            [POLL_FD_MONITOR_PIDSERVER] = {
+                Ert_PollFdCallbackMethod(self, pollFdPidServer_) },
+            [POLL_FD_MONITOR_PIDCLIENT] = {
+                Ert_PollFdCallbackMethod(self, pollFdPidClient_) },
+            [POLL_FD_MONITOR_EVENTPIPE] = {
+                Ert_PollFdCallbackMethod(self, pollFdEventPipe_) },
+        },
+
+        .mFdTimerActions =
+        {
+            [POLL_FD_MONITOR_TIMER_UMBILICAL] =
+            {
+                .mAction = Ert_PollFdCallbackMethod(
+                    self, pollFdTimerUmbilical_),
+                .mSince  = ERT_EVENTCLOCKTIME_INIT,
+                .mPeriod = Ert_Duration(
+                    Ert_NanoSeconds(
+                      ERT_NSECS(
+                        Ert_Seconds(gOptions.mServer.mTimeout.mUmbilical_s)).ns
+                      / cycleLimit)),
+            },
+        },
+    };
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (rc)
+            self = closeUmbilicalMonitor(self);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+struct UmbilicalMonitor *
+closeUmbilicalMonitor(struct UmbilicalMonitor *self)
+{
+    if (self)
+    {
+        ERT_ABORT_IF(
+            Ert_EventLatchSettingError == ert_unbindEventLatchPipe(
+                self->mLatch.mEchoRequest));
+
+        self->mEventPipe          = ert_closeEventPipe(self->mEventPipe);
+        self->mLatch.mEchoRequest = ert_closeEventLatch(
+            self->mLatch.mEchoRequest);
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+synchroniseUmbilicalMonitor(struct UmbilicalMonitor *self)
+{
+    int rc = -1;
+
+    /* Use a blocking read to wait for the sentry to signal that the
+     * umbilical monitor should proceed. */
+
+    ERT_ERROR_IF(
+        -1 == ert_waitFdReadReady(
+            self->mPoll.mFds[POLL_FD_MONITOR_UMBILICAL].fd, 0));
+
+    ERT_ERROR_IF(
+        pollFdUmbilical_(self, 0));
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+runUmbilicalMonitor(struct UmbilicalMonitor *self)
+{
+    int rc = -1;
+
+    struct Ert_PollFd  pollfd_;
+    struct Ert_PollFd *pollfd = 0;
+
+    ERT_ERROR_IF(
+        setWakeupSlack(
+            self->mPoll.mFdTimerActions[
+                POLL_FD_MONITOR_TIMER_UMBILICAL].mPeriod));
+
+    ERT_ERROR_IF(
+        ert_createPollFd(
+            &pollfd_,
+            self->mPoll.mFds,
+            self->mPoll.mFdActions,
+            pollFdNames_, POLL_FD_MONITOR_KINDS,
+            self->mPoll.mFdTimerActions,
+            pollFdTimerNames_, POLL_FD_MONITOR_TIMER_KINDS,
+            Ert_PollFdCompletionMethod(self, pollFdCompletion_)));
+    pollfd = &pollfd_;
+
+    startWakeupMeter(&self->mUmbilical.mWakeups, "umbilical");
+
+    ERT_ERROR_IF(
+        ert_runPollFdLoop(pollfd));
+
+    reportWakeupMeter(&self->mUmbilical.mWakeups);
+    reportUmbilicalRtt(&self->mUmbilical.mRtt, "ping interval");
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        pollfd = ert_closePollFd(pollfd);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+bool
+ownUmbilicalMonitorClosedOrderly(const struct UmbilicalMonitor *self)
+{
+    return self->mUmbilical.mClosed;
+}
+/* -------------------------------------------------------------------------- */
+enum UmbilicalArgsField_
+{
+    UmbilicalArgsSentryPid_,
+    UmbilicalArgsSentryPgid_,
+    UmbilicalArgsChildPid_,
+    UmbilicalArgsChildPgid_,
+    UmbilicalArgsPidServerFd_,
+    UmbilicalArgsPidFd_,
+    UmbilicalArgsBeatFd_,
+    UmbilicalArgsStatusFd_,
+    UmbilicalArgsTimeout_,
+    UmbilicalArgsSuspicion_,
+    UmbilicalArgsReferences_,
+    UmbilicalArgsLease_,
+    UmbilicalArgsDebug_,
+    UmbilicalArgsTest_,
+    UmbilicalArgsFields_
+};
+
+int
+formatUmbilicalArgs(const struct UmbilicalArgs *self,
+                    char                       *aBuf,
+                    size_t                      aBufLen)
+{
+    int rc = -1;
+
+    int bufLen;
+    ERT_ERROR_IF(
+        (bufLen = snprintf(
+            aBuf, aBufLen,
+            "%" PRId_Ert_Pid ",%" PRId_Ert_Pgid ","
+            "%" PRId_Ert_Pid ",%" PRId_Ert_Pgid ","
+            "%d,%d,%d,%d,%u,%u,%u,%u,%u,%u",
+            FMTd_Ert_Pid(self->mSentryPid),
+            FMTd_Ert_Pgid(self->mSentryPgid),
+            FMTd_Ert_Pid(self->mChildPid),
+            FMTd_Ert_Pgid(self->mChildPgid),
+            self->mPidServerFd,
+            self->mPidFd,
+            self->mBeatFd,
+            self->mStatusFd,
+            self->mTimeout_s,
+            self->mSuspicion,
+            self->mReferences,
+            self->mLease_s,
+            self->mDebug,
+            self->mTest),
+         0 > bufLen || (errno = ENOSPC, aBufLen <= bufLen)));
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+parseUmbilicalArgs(struct UmbilicalArgs *self, const char *aArgs)
+{
+    int rc = -1;
+
+    struct Ert_ParseArgList *argList = 0;
+
+    struct Ert_ParseArgList argList_;
+    ERT_ERROR_IF(
+        ert_createParseArgListCSV(&argList_, aArgs));
+    argList = &argList_;
+
+    ERT_ERROR_IF(
+        UmbilicalArgsFields_ != argList->mArgc,
+        {
+            errno = EINVAL;
+        });
+
+    int sentryPgid;
+    int childPgid;
+
+    ERT_ERROR_IF(
+        ert_parsePid(
+            argList->mArgv[UmbilicalArgsSentryPid_], &self->mSentryPid));
+    ERT_ERROR_IF(
+        ert_parseInt(
+            argList->mArgv[UmbilicalArgsSentryPgid_], &sentryPgid));
+    ERT_ERROR_IF(
+        ert_parsePid(
+            argList->mArgv[UmbilicalArgsChildPid_], &self->mChildPid));
+    ERT_ERROR_IF(
+        ert_parseInt(
+            argList->mArgv[UmbilicalArgsChildPgid_], &childPgid));
+    ERT_ERROR_IF(
+        ert_parseInt(
+            argList->mArgv[UmbilicalArgsPidServerFd_], &self->mPidServerFd));
+    ERT_ERROR_IF(
+        ert_parseInt(
+            argList->mArgv[UmbilicalArgsPidFd_], &self->mPidFd));
+    ERT_ERROR_IF(
+        ert_parseInt(
+            argList->mArgv[UmbilicalArgsBeatFd_], &self->mBeatFd));
+    ERT_ERROR_IF(
+        ert_parseInt(
+            argList->mArgv[UmbilicalArgsStatusFd_], &self->mStatusFd));
+    ERT_ERROR_IF(
+        ert_parseUInt(
+            argList->mArgv[UmbilicalArgsTimeout_], &self->mTimeout_s));
+    ERT_ERROR_IF(
+        ert_parseUInt(
+            argList->mArgv[UmbilicalArgsSuspicion_], &self->mSuspicion));
+    ERT_ERROR_IF(
+        ert_parseUInt(
+            argList->mArgv[UmbilicalArgsReferences_], &self->mReferences));
+    ERT_ERROR_IF(
+        ert_parseUInt(
+            argList->mArgv[UmbilicalArgsLease_], &self->mLease_s));
+    ERT_ERROR_IF(
+        ert_parseUInt(
+            argList->mArgv[UmbilicalArgsDebug_], &self->mDebug));
+    ERT_ERROR_IF(
+        ert_parseUInt(
+            argList->mArgv[UmbilicalArgsTest_], &self->mTest));
+
+    self->mSentryPgid = Ert_Pgid(sentryPgid);
+    self->mChildPgid  = Ert_Pgid(childPgid);
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        if (argList)
+            argList = ert_closeParseArgList(argList);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+nameUmbilicalDaemon(struct sockaddr_un *aAddr, const char *aName)
+{
+    int rc = -1;
+
+    /* The umbilical daemon listens on a name in the abstract namespace
+     * so that no stale file is left behind should the daemon be
+     * killed. */
+
+    size_t nameLen = strlen(aName);
+
+    ERT_ERROR_IF(
+        ! nameLen || nameLen + 1 >= sizeof(aAddr->sun_path),
+        {
+            errno = EINVAL;
+        });
+
+    memset(aAddr, 0, sizeof(*aAddr));
+
+    aAddr->sun_family  = AF_UNIX;
+    aAddr->sun_path[0] = 0;
+    memcpy(&aAddr->sun_path[1], aName, nameLen);
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+superviseUmbilicalMonitor(struct Ert_Pid        aSentryPid,
+                          struct Ert_Pgid       aSentryPgid,
+                          struct Ert_Pgid       aChildPgid,
+                          struct PidServer     *aPidServer,
+                          struct UmbilicalBeat *aBeat)
+{
+    int rc = -1;
+
+    struct UmbilicalMonitor  umbilicalMonitor_;
+    struct UmbilicalMonitor *umbilicalMonitor = 0;
+
+    /* The umbilical process is not the parent of the child process being
+     * watched, so that there is no reliable way to send a signal to that
+     * process alone because the pid might be recycled by the time the signal
+     * is sent. Instead rely on the umbilical monitor being in the same
+     * process group as the child process and use the process group as
+     * a means of controlling the cild process. */
+
+    ERT_ERROR_IF(
+        createUmbilicalMonitor(
+            &umbilicalMonitor_,
+            STDIN_FILENO, aSentryPid, aPidServer, aBeat));
+    umbilicalMonitor = &umbilicalMonitor_;
+
+    /* Synchronise with the sentry to avoid timing races. The sentry
+     * writes to the umbilical when it is ready to start timing. */
+
+    ert_debug(0, "synchronising umbilical");
+
+    ERT_ERROR_IF(
+        synchroniseUmbilicalMonitor(umbilicalMonitor));
+
+    ert_debug(0, "synchronised umbilical");
+
+    ERT_ERROR_IF(
+        runUmbilicalMonitor(umbilicalMonitor));
+
+    /* The umbilical monitor returns when the connection to the sentry
+     * is either lost or no longer active. Only issue a diagnostic if
+     * the shutdown was not orderly. */
+
+    if ( ! ownUmbilicalMonitorClosedOrderly(umbilicalMonitor))
+        ert_warn(
+            0,
+            "Killing child pgid %" PRId_Ert_Pgid " from umbilical",
+            FMTd_Ert_Pgid(aChildPgid));
+
+    ERT_ERROR_IF(
+        ert_signalProcessGroup(aChildPgid, SIGKILL),
+        {
+            ert_warn(
+                errno,
+                "Unable to kill child pgid %" PRId_Ert_Pgid,
+                FMTd_Ert_Pgid(aChildPgid));
+        });
+
+    /* If the shutdown was not orderly, assume the worst and attempt to
+     * clean up the sentry process group. */
+
+    if ( ! ownUmbilicalMonitorClosedOrderly(umbilicalMonitor))
+        ERT_ERROR_IF(
+            ert_signalProcessGroup(aSentryPgid, SIGKILL));
+
+    ert_debug(0, "exit umbilical");
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY
+    ({
+        umbilicalMonitor = closeUmbilicalMonitor(umbilicalMonitor);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
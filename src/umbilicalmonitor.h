@@ -0,0 +1,178 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2016, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef UMBILICALMONITOR_H
+#define UMBILICALMONITOR_H
+
+#include "wakeup.h"
+#include "umbilicalbeat.h"
+#include "umbilicalrtt.h"
+
+#include "ert/compiler.h"
+#include "ert/pollfd.h"
+#include "ert/pid.h"
+#include "ert/eventpipe.h"
+#include "ert/eventlatch.h"
+
+#include <poll.h>
+#include <stdbool.h>
+
+#include <sys/un.h>
+
+ERT_BEGIN_C_SCOPE;
+
+struct PidServer;
+
+/* -------------------------------------------------------------------------- */
+#define PIDUMBILICAL_PROGRAM "pidumbilical"
+#define PIDUMBILICAL_ENV     "PIDSENTRY_UMBILICAL"
+
+#define UMBILICAL_DAEMON_RECORD_SIZE 128
+
+/* The description of the umbilical, passed from the sentry in the
+ * environment of the umbilical program, or in the registration
+ * with an umbilical daemon. */
+
+struct UmbilicalArgs
+{
+    struct Ert_Pid  mSentryPid;
+    struct Ert_Pgid mSentryPgid;
+    struct Ert_Pid  mChildPid;
+    struct Ert_Pgid mChildPgid;
+    int             mPidServerFd;
+    int             mPidFd;
+    int             mBeatFd;
+    int             mStatusFd;
+    unsigned        mTimeout_s;
+    unsigned        mSuspicion;
+    unsigned        mReferences;
+    unsigned        mLease_s;
+    unsigned        mDebug;
+    unsigned        mTest;
+};
+
+/* -------------------------------------------------------------------------- */
+enum PollFdMonitorKind
+{
+    POLL_FD_MONITOR_UMBILICAL,
+    POLL_FD_MONITOR_PIDSERVER,
+    POLL_FD_MONITOR_PIDCLIENT,
+    POLL_FD_MONITOR_EVENTPIPE,
+    POLL_FD_MONITOR_KINDS
+};
+
+enum PollFdMonitorTimerKind
+{
+    POLL_FD_MONITOR_TIMER_UMBILICAL,
+    POLL_FD_MONITOR_TIMER_KINDS
+};
+
+struct UmbilicalMonitor
+{
+    struct
+    {
+        struct Ert_File *mFile;
+        unsigned         mCycleCount;
+        unsigned         mCycleLimit;
+        struct Ert_Pid   mParentPid;
+        bool             mClosed;
+
+        unsigned                  mSuspicion; /* Phi threshold, or zero */
+        bool                      mPreempt;
+        struct Ert_Duration       mCeiling;
+        struct Ert_EventClockTime mPingTime;
+        struct UmbilicalRtt       mRtt;
+
+        struct WakeupMeter    mWakeups;
+        struct UmbilicalBeat *mBeat;
+    } mUmbilical;
+
+    struct PidServer *mPidServer;
+
+    struct
+    {
+        struct Ert_EventLatch  mEchoRequest_;
+        struct Ert_EventLatch *mEchoRequest;
+    } mLatch;
+
+    struct Ert_EventPipe  mEventPipe_;
+    struct Ert_EventPipe *mEventPipe;
+
+    struct
+    {
+        struct pollfd                mFds[POLL_FD_MONITOR_KINDS];
+        struct Ert_PollFdAction      mFdActions[POLL_FD_MONITOR_KINDS];
+        struct Ert_PollFdTimerAction mFdTimerActions[
+                                        POLL_FD_MONITOR_TIMER_KINDS];
+    } mPoll;
+};
+
+/* -------------------------------------------------------------------------- */
+ERT_CHECKED int
+createUmbilicalMonitor(
+    struct UmbilicalMonitor *self,
+    int                      aStdinFd,
+    struct Ert_Pid           aParentPid,
+    struct PidServer        *aPidServer,
+    struct UmbilicalBeat    *aBeat);
+
+ERT_CHECKED struct UmbilicalMonitor *
+closeUmbilicalMonitor(struct UmbilicalMonitor *self);
+
+ERT_CHECKED int
+synchroniseUmbilicalMonitor(struct UmbilicalMonitor *self);
+
+ERT_CHECKED int
+runUmbilicalMonitor(struct UmbilicalMonitor *self);
+
+bool
+ownUmbilicalMonitorClosedOrderly(const struct UmbilicalMonitor *self);
+
+ERT_CHECKED int
+formatUmbilicalArgs(const struct UmbilicalArgs *self,
+                    char                       *aBuf,
+                    size_t                      aBufLen);
+
+ERT_CHECKED int
+parseUmbilicalArgs(struct UmbilicalArgs *self, const char *aArgs);
+
+ERT_CHECKED int
+nameUmbilicalDaemon(struct sockaddr_un *aAddr, const char *aName);
+
+ERT_CHECKED int
+superviseUmbilicalMonitor(struct Ert_Pid        aSentryPid,
+                          struct Ert_Pgid       aSentryPgid,
+                          struct Ert_Pgid       aChildPgid,
+                          struct PidServer     *aPidServer,
+                          struct UmbilicalBeat *aBeat);
+
+/* -------------------------------------------------------------------------- */
+
+ERT_END_C_SCOPE;
+
+#endif /* UMBILICALMONITOR_H */
@@ -0,0 +1,274 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2016, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "umbilicalrtt.h"
+
+#include "ert/error.h"
+
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+
+/* -------------------------------------------------------------------------- */
+/* Umbilical Round Trip Times
+ *
+ * The round trip time of each umbilical ping is recorded in a histogram
+ * with power of two buckets measured in microseconds, and in a moving
+ * average of the recent samples. The moving average feeds a phi accrual
+ * failure detector that models the round trip time as an exponential
+ * distribution, so that the suspicion level is:
+ *
+ *     phi(t) = -log10(P(rtt > t)) = t / (mean * ln(10))
+ *
+ * Since phi grows linearly with the time waited, the time at which the
+ * suspicion crosses a threshold is computed directly rather than by
+ * polling. Suspicion is only computed once enough samples have been
+ * seen, and the mean is held above a floor so that a quiet host with
+ * very short round trips does not become hair-triggered.
+ *
+ * The umbilical monitor and the umbilical daemon do not see round trips,
+ * only the arrival of each ping. They record the interval between
+ * pings instead, and model the lateness of the next ping beyond the
+ * mean interval as an exponential distribution scaled by the mean
+ * deviation of the intervals, held above the same floor:
+ *
+ *     phi(t) = (t - mean) / (dev * ln(10))    when t > mean */
+
+#define UMBILICAL_RTT_SAMPLES   8     /* Samples before trusting phi */
+#define UMBILICAL_RTT_WEIGHT    8     /* Moving average weight */
+#define UMBILICAL_RTT_FLOOR_MS  100   /* Least mean round trip time */
+
+#define UMBILICAL_RTT_LN10_NUM  23026 /* ln(10) as a fraction */
+#define UMBILICAL_RTT_LN10_DEN  10000
+
+/* -------------------------------------------------------------------------- */
+void
+startUmbilicalRtt(struct UmbilicalRtt *self)
+{
+    *self = (struct UmbilicalRtt) { .mSamples = 0 };
+}
+
+/* -------------------------------------------------------------------------- */
+void
+markUmbilicalRtt(struct UmbilicalRtt *self, struct Ert_Duration aRtt)
+{
+    uint64_t rtt_ns = aRtt.duration.ns;
+    uint64_t rtt_us = rtt_ns / 1000;
+
+    unsigned bucket = 0;
+
+    while (rtt_us >>= 1)
+    {
+        if (UMBILICAL_RTT_BUCKETS == ++bucket)
+        {
+            --bucket;
+            break;
+        }
+    }
+
+    ++self->mBucket[bucket];
+
+    if (self->mMax_ns < rtt_ns)
+        self->mMax_ns = rtt_ns;
+
+    if ( ! self->mSamples++)
+        self->mMean_ns = rtt_ns;
+    else
+    {
+        uint64_t dev_ns;
+
+        if (rtt_ns > self->mMean_ns)
+        {
+            dev_ns          = rtt_ns - self->mMean_ns;
+            self->mMean_ns += dev_ns / UMBILICAL_RTT_WEIGHT;
+        }
+        else
+        {
+            dev_ns          = self->mMean_ns - rtt_ns;
+            self->mMean_ns -= dev_ns / UMBILICAL_RTT_WEIGHT;
+        }
+
+        if (dev_ns > self->mDev_ns)
+            self->mDev_ns += (dev_ns - self->mDev_ns) / UMBILICAL_RTT_WEIGHT;
+        else
+            self->mDev_ns -= (self->mDev_ns - dev_ns) / UMBILICAL_RTT_WEIGHT;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+static uint64_t
+ownUmbilicalRttFloor_(uint64_t aValue_ns)
+{
+    uint64_t floor_ns = ERT_NSECS(Ert_MilliSeconds(UMBILICAL_RTT_FLOOR_MS)).ns;
+
+    return aValue_ns > floor_ns ? aValue_ns : floor_ns;
+}
+
+static uint64_t
+ownUmbilicalRttMean_(const struct UmbilicalRtt *self)
+{
+    return ownUmbilicalRttFloor_(self->mMean_ns);
+}
+
+/* -------------------------------------------------------------------------- */
+unsigned
+ownUmbilicalRttPhi(const struct UmbilicalRtt *self,
+                   struct Ert_Duration        aElapsed)
+{
+    /* Return the suspicion level in hundredths to avoid involving
+     * floating point. */
+
+    uint64_t phi = 0;
+
+    if (UMBILICAL_RTT_SAMPLES <= self->mSamples)
+    {
+        phi =
+            aElapsed.duration.ns * 100 * UMBILICAL_RTT_LN10_DEN /
+            (ownUmbilicalRttMean_(self) * UMBILICAL_RTT_LN10_NUM);
+
+        if (phi > UINT_MAX)
+            phi = UINT_MAX;
+    }
+
+    return phi;
+}
+
+/* -------------------------------------------------------------------------- */
+struct Ert_Duration
+ownUmbilicalRttDeadline(const struct UmbilicalRtt *self,
+                        unsigned                   aThreshold,
+                        struct Ert_Duration        aCeiling)
+{
+    /* Find the time at which the suspicion level reaches the threshold,
+     * but never wait beyond the ceiling. Until enough samples have been
+     * seen, only the ceiling applies. */
+
+    uint64_t deadline_ns = aCeiling.duration.ns;
+
+    if (aThreshold && UMBILICAL_RTT_SAMPLES <= self->mSamples)
+    {
+        uint64_t suspect_ns =
+            aThreshold * ownUmbilicalRttMean_(self) *
+            UMBILICAL_RTT_LN10_NUM / UMBILICAL_RTT_LN10_DEN;
+
+        if (suspect_ns < deadline_ns)
+            deadline_ns = suspect_ns;
+    }
+
+    return Ert_Duration(Ert_NanoSeconds(deadline_ns));
+}
+
+/* -------------------------------------------------------------------------- */
+unsigned
+ownUmbilicalRttArrivalPhi(const struct UmbilicalRtt *self,
+                          struct Ert_Duration        aElapsed)
+{
+    /* Return the suspicion level in hundredths. No suspicion accrues
+     * until the mean interval between arrivals has passed. */
+
+    uint64_t phi = 0;
+
+    if (UMBILICAL_RTT_SAMPLES <= self->mSamples &&
+        aElapsed.duration.ns > self->mMean_ns)
+    {
+        phi =
+            (aElapsed.duration.ns - self->mMean_ns) *
+            100 * UMBILICAL_RTT_LN10_DEN /
+            (ownUmbilicalRttFloor_(self->mDev_ns) * UMBILICAL_RTT_LN10_NUM);
+
+        if (phi > UINT_MAX)
+            phi = UINT_MAX;
+    }
+
+    return phi;
+}
+
+/* -------------------------------------------------------------------------- */
+struct Ert_Duration
+ownUmbilicalRttArrivalDeadline(const struct UmbilicalRtt *self,
+                               unsigned                   aThreshold,
+                               struct Ert_Duration        aCeiling)
+{
+    /* Find the time after the last arrival at which the suspicion level
+     * reaches the threshold, but never wait beyond the ceiling. */
+
+    uint64_t deadline_ns = aCeiling.duration.ns;
+
+    if (aThreshold && UMBILICAL_RTT_SAMPLES <= self->mSamples)
+    {
+        uint64_t suspect_ns =
+            self->mMean_ns +
+            aThreshold * ownUmbilicalRttFloor_(self->mDev_ns) *
+            UMBILICAL_RTT_LN10_NUM / UMBILICAL_RTT_LN10_DEN;
+
+        if (suspect_ns < deadline_ns)
+            deadline_ns = suspect_ns;
+    }
+
+    return Ert_Duration(Ert_NanoSeconds(deadline_ns));
+}
+
+/* -------------------------------------------------------------------------- */
+void
+reportUmbilicalRtt(const struct UmbilicalRtt *self, const char *aName)
+{
+    /* Show the distribution as a list of non-empty buckets, each
+     * labelled with the upper bound of the bucket in microseconds. */
+
+    char distribution[UMBILICAL_RTT_BUCKETS * 32] = "";
+
+    size_t used = 0;
+
+    for (unsigned ix = 0; UMBILICAL_RTT_BUCKETS > ix; ++ix)
+    {
+        if (self->mBucket[ix] && used < sizeof(distribution))
+        {
+            int len = snprintf(
+                distribution + used, sizeof(distribution) - used,
+                " <%" PRIu64 "us:%" PRIu64,
+                (uint64_t) 2 << ix, self->mBucket[ix]);
+
+            if (0 < len)
+                used += len;
+        }
+    }
+
+    ert_debug(
+        0,
+        "umbilical %s %" PRIu64 " samples mean %" PRIu64 "us "
+        "dev %" PRIu64 "us max %" PRIu64 "us%s",
+        aName,
+        self->mSamples,
+        self->mMean_ns / 1000,
+        self->mDev_ns / 1000,
+        self->mMax_ns / 1000,
+        distribution);
+}
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,83 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2016, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef UMBILICALRTT_H
+#define UMBILICALRTT_H
+
+#include "ert/compiler.h"
+#include "ert/timekeeping.h"
+
+#include <stdint.h>
+
+ERT_BEGIN_C_SCOPE;
+
+/* -------------------------------------------------------------------------- */
+#define UMBILICAL_RTT_BUCKETS 24
+
+struct UmbilicalRtt
+{
+    uint64_t mSamples;
+    uint64_t mMean_ns;          /* Moving average of recent samples */
+    uint64_t mDev_ns;           /* Moving average of the deviation */
+    uint64_t mMax_ns;
+    uint64_t mBucket[UMBILICAL_RTT_BUCKETS];
+};
+
+/* -------------------------------------------------------------------------- */
+void
+startUmbilicalRtt(struct UmbilicalRtt *self);
+
+void
+markUmbilicalRtt(struct UmbilicalRtt *self, struct Ert_Duration aRtt);
+
+unsigned
+ownUmbilicalRttPhi(const struct UmbilicalRtt *self,
+                   struct Ert_Duration        aElapsed);
+
+struct Ert_Duration
+ownUmbilicalRttDeadline(const struct UmbilicalRtt *self,
+                        unsigned                   aThreshold,
+                        struct Ert_Duration        aCeiling);
+
+unsigned
+ownUmbilicalRttArrivalPhi(const struct UmbilicalRtt *self,
+                          struct Ert_Duration        aElapsed);
+
+struct Ert_Duration
+ownUmbilicalRttArrivalDeadline(const struct UmbilicalRtt *self,
+                               unsigned                   aThreshold,
+                               struct Ert_Duration        aCeiling);
+
+void
+reportUmbilicalRtt(const struct UmbilicalRtt *self, const char *aName);
+
+/* -------------------------------------------------------------------------- */
+
+ERT_END_C_SCOPE;
+
+#endif /* UMBILICALRTT_H */
@@ -0,0 +1,166 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2016, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "wakeup.h"
+
+#include "ert/error.h"
+
+#include <inttypes.h>
+
+#include <sys/prctl.h>
+
+#define WAKEUP_SLACK_FRACTION 16
+#define WAKEUP_SLACK_MS       50
+
+/* -------------------------------------------------------------------------- */
+/* Wakeup Coalescing
+ *
+ * Periodic wakeups keep otherwise idle cores out of their deeper idle
+ * states. The cost is reduced by giving the kernel some slack to merge
+ * nearby timer expirations, and by aligning periodic timers to a phase
+ * that is shared by every process on the host. The monotonic clock is
+ * common to all processes, so timers that expire on multiples of the
+ * same period wake together rather than at scattered times. */
+
+int
+setWakeupSlack(struct Ert_Duration aPeriod)
+{
+    int rc = -1;
+
+    /* Allow the kernel a fraction of the period as slack, but bound the
+     * slack so that other timers in the same thread are not noticeably
+     * delayed. The timer slack applies only to the calling thread, and
+     * is inherited by any thread or process that it subsequently creates.
+     * A slack of zero would restore the default, so leave the slack
+     * unchanged if there is no period. */
+
+    uint64_t slack_ns = aPeriod.duration.ns / WAKEUP_SLACK_FRACTION;
+    uint64_t limit_ns = ERT_NSECS(Ert_MilliSeconds(WAKEUP_SLACK_MS)).ns;
+
+    if (slack_ns > limit_ns)
+        slack_ns = limit_ns;
+
+    if (slack_ns)
+    {
+        ert_debug(0, "timer slack %" PRIu64 "ns", slack_ns);
+
+        ERT_ERROR_IF(
+            prctl(PR_SET_TIMERSLACK, (unsigned long) slack_ns, 0, 0, 0));
+    }
+
+    rc = 0;
+
+Ert_Finally:
+
+    ERT_FINALLY({});
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+void
+alignWakeupTimer(struct Ert_PollFdTimerAction    *aTimer,
+                 struct Ert_Duration              aPeriod,
+                 const struct Ert_EventClockTime *aPollTime)
+{
+    aTimer->mPeriod = aPeriod;
+
+    uint64_t period_ns = aPeriod.duration.ns;
+
+    if (period_ns)
+    {
+        /* Arrange for the timer to expire at the next multiple of the
+         * period as measured by the monotonic clock. */
+
+        uint64_t monotonic_ns = ert_monotonicTime().monotonic.ns;
+
+        ert_lapTimeTrigger(&aTimer->mSince, aPeriod, aPollTime);
+        ert_lapTimeDelay(
+            &aTimer->mSince,
+            Ert_Duration(
+                Ert_NanoSeconds(period_ns - monotonic_ns % period_ns)));
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+struct Ert_Duration
+ownWakeupTimerRemaining(const struct Ert_PollFdTimerAction *aTimer,
+                        const struct Ert_EventClockTime    *aPollTime)
+{
+    uint64_t expiry_ns =
+        aTimer->mSince.eventclock.ns + aTimer->mPeriod.duration.ns;
+
+    return Ert_Duration(
+        Ert_NanoSeconds(
+            expiry_ns > aPollTime->eventclock.ns
+            ? expiry_ns - aPollTime->eventclock.ns : 0));
+}
+
+/* -------------------------------------------------------------------------- */
+void
+startWakeupMeter(struct WakeupMeter *self, const char *aName)
+{
+    self->mName    = aName;
+    self->mSince   = ert_eventclockTime();
+    self->mWakeups = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+void
+markWakeupMeter(struct WakeupMeter *self)
+{
+    ++self->mWakeups;
+}
+
+/* -------------------------------------------------------------------------- */
+void
+reportWakeupMeter(const struct WakeupMeter *self)
+{
+    struct Ert_EventClockTime now = ert_eventclockTime();
+
+    uint64_t elapsed_ms =
+        ERT_MSECS(
+            Ert_NanoSeconds(
+                now.eventclock.ns - self->mSince.eventclock.ns)).ms;
+
+    /* Report the rate in thousandths of a wakeup per second to
+     * avoid involving floating point. */
+
+    uint64_t rate = elapsed_ms ? self->mWakeups * 1000000 / elapsed_ms : 0;
+
+    ert_debug(
+        0,
+        "%s %lu wakeups in %" PRIu64 "ms rate %" PRIu64 ".%03" PRIu64 "/s",
+        self->mName,
+        self->mWakeups,
+        elapsed_ms,
+        rate / 1000, rate % 1000);
+}
+
+/* -------------------------------------------------------------------------- */